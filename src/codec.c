@@ -109,6 +109,13 @@ static const TblType K_PosTable3[12] = {
     {0xe,  2}, {0xe,  2}, {0xe,  2}, {0xe,  2},
 };
 
+// Gen3 scrambler seeds for lanes 0 to 7, repeating for higher lanes
+
+static const uint32_t Gen3LfsrSeed [GEN3NUMSEEDS] = {
+    0x1dbfbc, 0x0607bb, 0x1ec760, 0x18c0db,
+    0x010f12, 0x19cfc9, 0x0277ce, 0x1bb807
+};
+
 static const unsigned int Bitrev4 [16] =
                                    {0x0, 0x8, 0x4, 0xc,
                                     0x2, 0xa, 0x6, 0xe,
@@ -122,40 +129,6 @@ static const unsigned int NumOfOnes4 [16] =
                                        1, 2, 2, 3,
                                        2, 3, 3, 4};
 
-unsigned const int Bitrev8 [256] = {
-    0x00, 0x80, 0x40, 0xc0, 0x20, 0xa0, 0x60, 0xe0,
-    0x10, 0x90, 0x50, 0xd0, 0x30, 0xb0, 0x70, 0xf0,
-    0x08, 0x88, 0x48, 0xc8, 0x28, 0xa8, 0x68, 0xe8,
-    0x18, 0x98, 0x58, 0xd8, 0x38, 0xb8, 0x78, 0xf8,
-    0x04, 0x84, 0x44, 0xc4, 0x24, 0xa4, 0x64, 0xe4,
-    0x14, 0x94, 0x54, 0xd4, 0x34, 0xb4, 0x74, 0xf4,
-    0x0c, 0x8c, 0x4c, 0xcc, 0x2c, 0xac, 0x6c, 0xec,
-    0x1c, 0x9c, 0x5c, 0xdc, 0x3c, 0xbc, 0x7c, 0xfc,
-    0x02, 0x82, 0x42, 0xc2, 0x22, 0xa2, 0x62, 0xe2,
-    0x12, 0x92, 0x52, 0xd2, 0x32, 0xb2, 0x72, 0xf2,
-    0x0a, 0x8a, 0x4a, 0xca, 0x2a, 0xaa, 0x6a, 0xea,
-    0x1a, 0x9a, 0x5a, 0xda, 0x3a, 0xba, 0x7a, 0xfa,
-    0x06, 0x86, 0x46, 0xc6, 0x26, 0xa6, 0x66, 0xe6,
-    0x16, 0x96, 0x56, 0xd6, 0x36, 0xb6, 0x76, 0xf6,
-    0x0e, 0x8e, 0x4e, 0xce, 0x2e, 0xae, 0x6e, 0xee,
-    0x1e, 0x9e, 0x5e, 0xde, 0x3e, 0xbe, 0x7e, 0xfe,
-    0x01, 0x81, 0x41, 0xc1, 0x21, 0xa1, 0x61, 0xe1,
-    0x11, 0x91, 0x51, 0xd1, 0x31, 0xb1, 0x71, 0xf1,
-    0x09, 0x89, 0x49, 0xc9, 0x29, 0xa9, 0x69, 0xe9,
-    0x19, 0x99, 0x59, 0xd9, 0x39, 0xb9, 0x79, 0xf9,
-    0x05, 0x85, 0x45, 0xc5, 0x25, 0xa5, 0x65, 0xe5,
-    0x15, 0x95, 0x55, 0xd5, 0x35, 0xb5, 0x75, 0xf5,
-    0x0d, 0x8d, 0x4d, 0xcd, 0x2d, 0xad, 0x6d, 0xed,
-    0x1d, 0x9d, 0x5d, 0xdd, 0x3d, 0xbd, 0x7d, 0xfd,
-    0x03, 0x83, 0x43, 0xc3, 0x23, 0xa3, 0x63, 0xe3,
-    0x13, 0x93, 0x53, 0xd3, 0x33, 0xb3, 0x73, 0xf3,
-    0x0b, 0x8b, 0x4b, 0xcb, 0x2b, 0xab, 0x6b, 0xeb,
-    0x1b, 0x9b, 0x5b, 0xdb, 0x3b, 0xbb, 0x7b, 0xfb,
-    0x07, 0x87, 0x47, 0xc7, 0x27, 0xa7, 0x67, 0xe7,
-    0x17, 0x97, 0x57, 0xd7, 0x37, 0xb7, 0x77, 0xf7,
-    0x0f, 0x8f, 0x4f, 0xcf, 0x2f, 0xaf, 0x6f, 0xef,
-    0x1f, 0x9f, 0x5f, 0xdf, 0x3f, 0xbf, 0x7f, 0xff};
-
 // -------------------------------------------------------------------------
 // ScrambleAdvance()
 //
@@ -181,6 +154,74 @@ static void ScrambleAdvance(const int reset, uint32_t* const lfsr)
     *lfsr = newlfsr;
 }
 
+// -------------------------------------------------------------------------
+// Encode8b10b()
+//
+// Look up the 10 bit code for a data byte or control code, c, for the
+// running disparity rd, and update rd
+//
+// -------------------------------------------------------------------------
+
+static unsigned int Encode8b10b (const unsigned int c, int* rd)
+{
+    unsigned int code3, code5, tblidx;
+    const TblType *tbl5, *tbl3;
+
+    // For data bytes
+    if (c < 256)
+    {
+        // Pick 5 bit table based on running disparity
+        tbl5 = (*rd == -1) ? NegTable5 : PosTable5;
+
+        // 3 bit table based in the disparity of the 5 bit table and current
+        // running disparity. If total Positive, choose NegTable3 else PosTable3.
+        tbl3 = (tbl5[c & 0x1f].disparity == (*rd == 1 ? 0 : 2)) ? NegTable3 : PosTable3;
+
+        // Extract codes
+        code5 = tbl5[c & 0x1f].code;
+        code3 = tbl3[c >> 5].code ;
+
+        // Bit reverse 3b/4b code to avoid a run of 5 bits
+        if (((code5 & 0x30) == 0x30 && (code3 & 0x7) == 0x7) || ((code5 & 0x30) == 0x0 && (code3 & 0x7) == 0x0))
+        {
+            code3 = Bitrev4[code3];
+        }
+
+        // Calculate new running disparity
+        *rd += tbl5[c & 0x1f].disparity  +  tbl3[c >> 5].disparity;
+
+    // For control codes
+    }
+    else
+    {
+        // K28.0 to K28.7
+        if ((c & 0xf) == 0xc)
+        {
+            tblidx = (c >> 5) & 0x7;
+        }
+        else
+        {
+            tblidx = (c == 0x1f7) ? 8 :
+                     (c == 0x1fb) ? 9 :
+                     (c == 0x1fd) ? 10 :
+                                    11;
+        }
+
+        tbl5 = (*rd == -1) ? K_NegTable5 : K_PosTable5;
+
+        tbl3 = (tbl5[tblidx].disparity == (*rd == 1 ? 0 : 2)) ? K_NegTable3 : K_PosTable3;
+
+        code5 = tbl5[tblidx].code;
+        code3 = tbl3[tblidx].code;
+
+        // Calculate new running disparity
+        *rd += tbl5[tblidx].disparity + tbl3[tblidx].disparity;
+    }
+
+    // Construct 10 bit code
+    return code3 << 6 | code5;
+}
+
 // -------------------------------------------------------------------------
 // Encode()
 //
@@ -190,8 +231,7 @@ static void ScrambleAdvance(const int reset, uint32_t* const lfsr)
 
 unsigned int Encode (const int data, const int no_scramble, const int no_8b10b, const int lane, const int linkwidth, const int node)
 {
-    unsigned int code, code3, code5, c, tblidx;
-    const TblType *tbl5, *tbl3;
+    unsigned int code, c;
 
     if (!no_scramble && data <= 0xff)
     {
@@ -209,63 +249,46 @@ unsigned int Encode (const int data, const int no_scramble, const int no_8b10b,
 
     if (!no_8b10b)
     {
-        // For data bytes
-        if (c < 256)
-        {
-            // Pick 5 bit table based on running disparity
-            tbl5 = (this->rd[lane] == -1) ? NegTable5 : PosTable5;
+        code = Encode8b10b(c, &this->rd[lane]);
+    }
+    else
+    {
+        code = c;
+    }
 
-            // 3 bit table based in the disparity of the 5 bit table and current
-            // running disparity. If total Positive, choose NegTable3 else PosTable3.
-            tbl3 = (tbl5[c & 0x1f].disparity == (this->rd[lane] == 1 ? 0 : 2)) ? NegTable3 : PosTable3;
+    return code;
+}
 
-            // Extract codes
-            code5 = tbl5[c & 0x1f].code;
-            code3 = tbl3[c >> 5].code ;
+// -------------------------------------------------------------------------
+// EncodeAltDisparity()
+//
+// Return the 10 bit code of the same data byte or control code as code,
+// but for the opposite running disparity, by searching the encoder's
+// tables. If the symbol has the same code for both running disparities,
+// or code is not a valid symbol, code is returned unchanged.
+//
+// -------------------------------------------------------------------------
 
-            // Bit reverse 3b/4b code to avoid a run of 5 bits
-            if (((code5 & 0x30) == 0x30 && (code3 & 0x7) == 0x7) || ((code5 & 0x30) == 0x0 && (code3 & 0x7) == 0x0))
-            {
-                code3 = Bitrev4[code3];
-            }
+unsigned int EncodeAltDisparity (const unsigned int code)
+{
+    // The control codes K28.0 to K28.7, K23.7, K27.7, K29.7 and K30.7
+    static const unsigned int kcodes[12] = {0x11c, 0x13c, 0x15c, 0x17c, 0x19c, 0x1bc, 0x1dc, 0x1fc,
+                                            0x1f7, 0x1fb, 0x1fd, 0x1fe};
+    unsigned int c, neg, pos;
+    int          rd;
 
-            // Calculate new running disparity
-            this->rd[lane] += tbl5[c & 0x1f].disparity  +  tbl3[c >> 5].disparity;
+    for (int idx = 0; idx < 256 + 12; idx++)
+    {
+        c   = (idx < 256) ? (unsigned)idx : kcodes[idx - 256];
+        rd  = -1;
+        neg = Encode8b10b(c, &rd);
+        rd  = 1;
+        pos = Encode8b10b(c, &rd);
 
-        // For control codes
-        }
-        else
+        if (code == neg || code == pos)
         {
-            // K28.0 to K28.7
-            if ((c & 0xf) == 0xc)
-            {
-                tblidx = (c >> 5) & 0x7;
-            }
-            else
-            {
-                tblidx = (c == 0x1f7) ? 8 :
-                         (c == 0x1fb) ? 9 :
-                         (c == 0x1fd) ? 10 :
-                                        11;
-            }
-
-            tbl5 = (this->rd[lane] == -1) ? K_NegTable5 : K_PosTable5;
-
-            tbl3 = (tbl5[tblidx].disparity == (this->rd[lane] == 1 ? 0 : 2)) ? K_NegTable3 : K_PosTable3;
-
-            code5 = tbl5[tblidx].code;
-            code3 = tbl3[tblidx].code;
-
-            // Calculate new running disparity
-            this->rd[lane] += tbl5[tblidx].disparity + tbl3[tblidx].disparity;
+            return (code == neg) ? pos : neg;
         }
-
-        // Construct 10 bit code
-        code = code3 << 6 | code5;
-    }
-    else
-    {
-        code = c;
     }
 
     return code;
@@ -371,25 +394,137 @@ unsigned int Decode (const int data, const int no_scramble, const int no_8b10b,
 }
 
 // -------------------------------------------------------------------------
-// PciCrc()
+// Gen3Scramble()
 //
-// Calculate CRC after next 'Bits' shifted
+// Scramble (or descramble) a byte with a Gen3 lane scrambler, LSB
+// first, advancing the LFSR by 8 bits. With bypass set the LFSR still
+// advances, but the byte is returned unchanged.
 //
 // -------------------------------------------------------------------------
 
-uint32_t PciCrc (uint32_t Data, uint32_t CrcIn, uint32_t Bits, uint32_t poly, uint32_t crcsize)
+static unsigned int Gen3Scramble (const unsigned int data, const int bypass, uint32_t *lfsr)
 {
-    uint32_t Crc = CrcIn, topbit;
-    int i;
+    unsigned int out = data;
+    uint32_t     fb;
 
-    topbit = MAX_CRC_TOP_BIT >> (MAXCRCSIZE - crcsize);
+    for (int bit = 0; bit < BYTEWIDTH; bit++)
+    {
+        fb    = (*lfsr >> 22) & 1;
+        out  ^= bypass ? 0 : (fb << bit);
+        *lfsr = ((*lfsr << 1) & GEN3LFSRMASK) ^ (fb ? GEN3LFSRPOLY : 0);
+    }
+
+    return out;
+}
+
+// -------------------------------------------------------------------------
+// Gen3Symbol()
+//
+// Scrambling rules common to Gen3 encode and decode. A sync header
+// starts a new block, with an OS block identified by its first symbol,
+// which is never scrambled. Data blocks are scrambled, as are TS1/TS2
+// symbols after the first. Other OS symbols bypass the scrambler,
+// with the LFSR held for SKP OSs and reset at the end of an EIEOS.
+//
+// -------------------------------------------------------------------------
+
+static unsigned int Gen3Symbol (const unsigned int data, const int sync, const int no_scramble,
+                                uint32_t *lfsr, int *sym, int *os, const int lane)
+{
+    unsigned int out;
+
+    if (sync)
+    {
+        *sym = 0;
+        *os  = (sync == GEN3_SYNC_OS) ? (int)data : -1;
+    }
+
+    if (*os == -1 || ((*os == GEN3_TS1 || *os == GEN3_TS2) && *sym != 0))
+    {
+        out = Gen3Scramble(data, no_scramble, lfsr);
+    }
+    else if (*os == GEN3_SKP)
+    {
+        out = data;
+    }
+    else
+    {
+        out = Gen3Scramble(data, true, lfsr);
+    }
+
+    if (*os == GEN3_EIEOS && *sym == (GEN3_BLOCK_SYMS-1))
+    {
+        *lfsr = Gen3LfsrSeed[lane % GEN3NUMSEEDS];
+    }
+
+    *sym += (*sym < GEN3_BLOCK_SYMS) ? 1 : 0;
+
+    return out;
+}
+
+// -------------------------------------------------------------------------
+// Gen3Encode()
+//
+// Do Gen3 128b/130b encoding of a byte for a lane. When sync is non-zero
+// the byte starts a new block, and the sync header is returned in bits
+// 9:8 of the code. The last symbols of a SKP OS are replaced with the
+// lane's scrambler state.
+//
+// -------------------------------------------------------------------------
 
-    for (i = 0; i < Bits; i++)
+unsigned int Gen3Encode (const int data, const int sync, const int no_scramble, const int lane, const int node)
+{
+    unsigned int byte = data & 0xff;
+
+    if (!sync && this->g3eos[lane] == GEN3_SKP && this->g3esym[lane] >= GEN3SKPLFSRSYM)
     {
-        Crc = (Crc << 1UL) ^ ((((Crc & topbit) ? 1 : 0) ^ ((Data >> i) & 1)) ? poly : 0);
+        byte = (this->g3elfsr[lane] >> (BYTEWIDTH * (GEN3_BLOCK_SYMS - 1 - this->g3esym[lane]))) & 0xff;
     }
 
-    return Crc;
+    return (sync << BYTEWIDTH) | Gen3Symbol(byte, sync, no_scramble, &this->g3elfsr[lane], &this->g3esym[lane], &this->g3eos[lane], lane);
+}
+
+// -------------------------------------------------------------------------
+// Gen3Decode()
+//
+// Do Gen3 128b/130b decoding of a lane code. Any sync header is
+// returned in bits 9:8, marking the start of a block. The scrambler
+// state carried in SKP OSs is checked against the lane's own.
+//
+// -------------------------------------------------------------------------
+
+unsigned int Gen3Decode (const int data, const int no_scramble, const int lane, const int node)
+{
+    int          sync = (data >> BYTEWIDTH) & 0x3;
+    unsigned int byte = data & 0xff;
+
+    if (!sync && this->g3dos[lane] == GEN3_SKP && this->g3dsym[lane] >= GEN3SKPLFSRSYM &&
+        byte != ((this->g3dlfsr[lane] >> (BYTEWIDTH * (GEN3_BLOCK_SYMS - 1 - this->g3dsym[lane]))) & 0xff))
+    {
+        VPrint("Gen3Decode: ***Warning --- SKP OS scrambler state mismatch on lane %d at node %d\n", lane, node);
+    }
+
+    return (sync << BYTEWIDTH) | Gen3Symbol(byte, sync, no_scramble, &this->g3dlfsr[lane], &this->g3dsym[lane], &this->g3dos[lane], lane);
+}
+
+// -------------------------------------------------------------------------
+// Gen3CodecReset()
+//
+// Reset the Gen3 lane scramblers to their seeds and block tracking
+//
+// -------------------------------------------------------------------------
+
+void Gen3CodecReset (const int node)
+{
+    for (int lane = 0; lane < MAX_LINK_WIDTH; lane++)
+    {
+        this->g3elfsr[lane] = Gen3LfsrSeed[lane % GEN3NUMSEEDS];
+        this->g3dlfsr[lane] = Gen3LfsrSeed[lane % GEN3NUMSEEDS];
+        this->g3esym[lane]  = GEN3_BLOCK_SYMS;
+        this->g3dsym[lane]  = GEN3_BLOCK_SYMS;
+        this->g3eos[lane]   = -1;
+        this->g3dos[lane]   = -1;
+    }
 }
 
 // -------------------------------------------------------------------------
@@ -419,6 +554,8 @@ void InitCodec (const int node)
 
     this->ts_active = 0;
     this->last_lane0_sym = 0;
+
+    Gen3CodecReset(node);
 }
 
 // Allow reuse in other files
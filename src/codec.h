@@ -38,6 +38,7 @@
 #include "pcie_dpi.h"
 #endif
 #include "pcie.h"
+#include "pcie_crc.h"
 
 // -------------------------------------------------------------------------
 // DEFINES
@@ -78,16 +79,13 @@
 
 #define DEFAULTLFSRVALUE           0xffff
 
-// CRC definitions
-#define TLP_CRC_INITIAL_VALUE      0xffffffff
-#define DLLP_CRC_INITIAL_VALUE     0xffff
+// Gen3 scrambler: x^23 + x^21 + x^16 + x^8 + x^5 + x^2 + 1, with per lane seeds
+#define GEN3LFSRMASK               0x7fffff
+#define GEN3LFSRPOLY               0x210125
+#define GEN3NUMSEEDS               8
 
-#define TLPPOLY                    0x04c11db7U
-#define TLPCRCSIZE                 32
-#define MAX_CRC_TOP_BIT            0x80000000U
-#define DLLPPOLY                   0x100b
-#define DLLPCRCSIZE                16
-#define MAXCRCSIZE                 TLPCRCSIZE
+// Symbol from which a Gen3 SKP OS carries the scrambler state
+#define GEN3SKPLFSRSYM             (GEN3_SKP_END_SYM + 1)
 
 // -------------------------------------------------------------------------
 // TYPEDEFS
@@ -105,6 +103,15 @@ typedef struct {
 
     bool     ts_active;
     int     last_lane0_sym;
+
+    // Gen3 per lane scramblers, symbol in current block and block's
+    // OS identifier (-1 for a data block)
+    uint32_t g3elfsr [MAX_LINK_WIDTH];
+    uint32_t g3dlfsr [MAX_LINK_WIDTH];
+    int      g3esym  [MAX_LINK_WIDTH];
+    int      g3dsym  [MAX_LINK_WIDTH];
+    int      g3eos   [MAX_LINK_WIDTH];
+    int      g3dos   [MAX_LINK_WIDTH];
 } CodecState_t, *pCodecState_t;
 
 // -------------------------------------------------------------------------
@@ -113,8 +120,13 @@ typedef struct {
 
 extern unsigned int Encode    (const int      data, const int no_scramble, const int no_8b10b,  const int lane, const int linkwidth, const int node);
 extern unsigned int Decode    (const int      data, const int no_scramble, const int no_8b10b,  const int lane, const int linkwidth, const int node);
-extern uint32_t     PciCrc    (const uint32_t Data, const uint32_t CrcIn,  const uint32_t Bits, const uint32_t poly, const uint32_t crcsize);
 extern void         InitCodec (const int node);
 
+extern unsigned int EncodeAltDisparity (const unsigned int code);
+
+extern unsigned int Gen3Encode     (const int data, const int sync, const int no_scramble, const int lane, const int node);
+extern unsigned int Gen3Decode     (const int data, const int no_scramble, const int lane, const int node);
+extern void         Gen3CodecReset (const int node);
+
 #endif
 
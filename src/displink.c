@@ -32,6 +32,29 @@
 #include "pcie.h"
 #include "pcie_utils.h"
 #include "displink.h"
+#include "dispwriter.h"
+
+// -------------------------------------------------------------------------
+// DEFINES
+// -------------------------------------------------------------------------
+
+// Display output, queued to the asynchronous writer when enabled, or
+// completing a partial line the node holds from when it was
+#define DISPPRINT(...)                                     \
+    do {                                                   \
+        if (DispWriterMode != DISP_ASYNC_OFF ||            \
+            DispWriterHeld[dispnode])                      \
+            DispWriterPrintf(dispnode, __VA_ARGS__);       \
+        else                                               \
+            VPrint(__VA_ARGS__);                           \
+    } while (0)
+
+// -------------------------------------------------------------------------
+// STATICS
+// -------------------------------------------------------------------------
+
+// Node whose output is currently being displayed
+static __thread int dispnode = 0;
 
 char fmtupstr[FMT_STR_SIZE]   = {0};
 char fmtdnstr[FMT_STR_SIZE]   = {0};
@@ -39,6 +62,9 @@ char fmterrstr[FMT_STR_SIZE]  = {0};
 char fmtnormstr[FMT_STR_SIZE] = {0};
 char fmtdatastr[FMT_STR_SIZE] = {0};
 
+// TLP field display routines, using DISPPRINT() and the above format strings
+#include "disptlp.h"
+
 // -------------------------------------------------------------------------
 // IsDispEnabled()
 //
@@ -136,9 +162,19 @@ void ContDisp (pUserConfig_t usrconf, const int node)
                 sidx++;
             }
 
-            if ((buf[sidx] >= '0' && buf[sidx] <= '9') ||
-                (buf[sidx] >= 'a' && buf[sidx] <= 'f') ||
-                (buf[sidx] >= 'A' && buf[sidx] <= 'F'))
+            // Display filter rule
+            if (strncmp(&buf[sidx], "filter", 6) == 0)
+            {
+                DispFilterAdd(usrconf, &buf[sidx+6], node);
+            }
+            // Triggered capture settings
+            else if (strncmp(&buf[sidx], "trigger", 7) == 0)
+            {
+                TrigConfig(usrconf, &buf[sidx+7], node);
+            }
+            else if ((buf[sidx] >= '0' && buf[sidx] <= '9') ||
+                     (buf[sidx] >= 'a' && buf[sidx] <= 'f') ||
+                     (buf[sidx] >= 'A' && buf[sidx] <= 'F'))
             {
                 sscanf(&buf[sidx], "%x %llu", &usrconf->contdisp[dispidx].control, (long long unsigned *)&usrconf->contdisp[dispidx].time);
 
@@ -154,148 +190,301 @@ void ContDisp (pUserConfig_t usrconf, const int node)
 }
 
 // -------------------------------------------------------------------------
-// CheckContDisp()
+// DispFilterParse()
+//
+// Parse a display filter rule. The rule is a list of space separated
+// fields, all of which must match:
+//
+//   type=<mem|cpl|cfg|msg|io|dllp>[,...]
+//   addr=<lo>[:<hi>]       (hex, memory and IO requests)
+//   rid=<id>[/<mask>]      (hex, requester ID)
+//   tag=<tag>[/<mask>]     (hex)
+//   node=<n>               (decimal, displayed node number)
+//   dir=<u|d>
+//
+// Raw symbols and ordered sets only match rules with no packet fields
+// (type, addr, rid or tag). A rule with an unknown type, or a bad
+// field, is rejected.
 //
-// Check if to activate next ContDisp entry
 // -------------------------------------------------------------------------
 
-inline void CheckContDisp (pUserConfig_t usrconf, const int node)
+int DispFilterParse (const char* rule, const pDispFilter_t filt, const int node)
 {
-    uint32_t cycleCount = GetCycleCount(node);
+    char buf[STRBUFSIZE];
+    char *tok, *val, *saveptr;
 
-    // If current time is at, or beyond, the indexed ContDisp...
-    if (usrconf->ContDispIdx < MAXCONSTDISP && GetCycleCount(node) >= usrconf->contdisp[usrconf->ContDispIdx].time)
+    memset(filt, 0, sizeof(DispFilter_t));
+
+    strncpy(buf, rule, STRBUFSIZE-1);
+    buf[STRBUFSIZE-1] = 0;
+
+    for (tok = strtok_r(buf, " \t\r\n", &saveptr); tok != NULL; tok = strtok_r(NULL, " \t\r\n", &saveptr))
     {
-        // Update active control with next value
-        usrconf->ActiveContDisp = usrconf->contdisp[usrconf->ContDispIdx].control;
+        // Stop at any trailing comment
+        if (strncmp(tok, "//", 2) == 0)
+        {
+            break;
+        }
 
-        // If simulation control bits set, action the control
-        if (usrconf->ActiveContDisp & (DISPFINISH | DISPSTOP))
+        if ((val = strchr(tok, '=')) == NULL)
         {
-            // Halt the simulation
-            VWrite((usrconf->ActiveContDisp & DISPSTOP) ? PVH_STOP : PVH_FINISH, 0, 0, node);
+            VPrint("DispFilterParse: %s***Warning --- bad display filter field '%s' at node %d. Ignoring rule%s\n", fmterrstr, tok, node, fmtnormstr);
+            return MEM_BAD_STATUS;
         }
+        *val++ = 0;
 
-        ConfigDispFormat(!(usrconf->ActiveContDisp & DISPSWNOCOLOUR));
+        if (strcmp(tok, "type") == 0)
+        {
+            char *kind, *kindptr;
 
-        // Increment the ContDisp index (up to maximum)
-        if (usrconf->ContDispIdx < MAXCONSTDISP)
+            filt->fields |= DISP_FILT_TYPE;
+            for (kind = strtok_r(val, ",", &kindptr); kind != NULL; kind = strtok_r(NULL, ",", &kindptr))
+            {
+                uint32_t bit = !strcmp(kind, "mem")  ? DISP_KIND_MEM  :
+                               !strcmp(kind, "cpl")  ? DISP_KIND_CPL  :
+                               !strcmp(kind, "cfg")  ? DISP_KIND_CFG  :
+                               !strcmp(kind, "msg")  ? DISP_KIND_MSG  :
+                               !strcmp(kind, "io")   ? DISP_KIND_IO   :
+                               !strcmp(kind, "dllp") ? DISP_KIND_DLLP : 0;
+
+                if (bit == 0)
+                {
+                    VPrint("DispFilterParse: %s***Warning --- unknown display filter type '%s' at node %d. Ignoring rule%s\n", fmterrstr, kind, node, fmtnormstr);
+                    return MEM_BAD_STATUS;
+                }
+
+                filt->kinds |= bit;
+            }
+
+            if (filt->kinds == 0)
+            {
+                VPrint("DispFilterParse: %s***Warning --- no display filter types at node %d. Ignoring rule%s\n", fmterrstr, node, fmtnormstr);
+                return MEM_BAD_STATUS;
+            }
+        }
+        else if (strcmp(tok, "addr") == 0)
         {
-            usrconf->ContDispIdx++;
+            filt->fields  |= DISP_FILT_ADDR;
+            filt->addr_lo  = strtoull(val, &val, 16);
+            filt->addr_hi  = (*val == ':') ? strtoull(val+1, NULL, 16) : filt->addr_lo;
+        }
+        else if (strcmp(tok, "rid") == 0)
+        {
+            filt->fields   |= DISP_FILT_RID;
+            filt->rid       = strtoul(val, &val, 16);
+            filt->rid_mask  = (*val == '/') ? strtoul(val+1, NULL, 16) : 0xffff;
+            filt->rid      &= filt->rid_mask;
+        }
+        else if (strcmp(tok, "tag") == 0)
+        {
+            filt->fields   |= DISP_FILT_TAG;
+            filt->tag       = strtoul(val, &val, 16);
+            filt->tag_mask  = (*val == '/') ? strtoul(val+1, NULL, 16) : 0x3ff;
+            filt->tag      &= filt->tag_mask;
+        }
+        else if (strcmp(tok, "node") == 0)
+        {
+            filt->fields |= DISP_FILT_NODE;
+            filt->node    = strtol(val, NULL, 10);
+        }
+        else if (strcmp(tok, "dir") == 0)
+        {
+            filt->fields |= DISP_FILT_DIR;
+            filt->down    = (val[0] == 'd' || val[0] == 'D');
+        }
+        else
+        {
+            VPrint("DispFilterParse: %s***Warning --- unknown display filter field '%s' at node %d. Ignoring rule%s\n", fmterrstr, tok, node, fmtnormstr);
+            return MEM_BAD_STATUS;
         }
     }
+
+    return MEM_GOOD_STATUS;
 }
 
 // -------------------------------------------------------------------------
-// DispTc()
+// DispFilterAdd()
+//
+// Parse a display filter rule (see DispFilterParse()) and add it to
+// the node's rules. Once any rules are added, only traffic matching
+// one or more of them is displayed.
 //
-// Display traffic class and other attributes
 // -------------------------------------------------------------------------
 
-inline static void DispTc (const char const *prefixstr, const char const *offstr,
-                           const uint32_t tl_type, const uint32_t tl_tc, const uint32_t tl_td,
-                           const uint32_t tl_ep, const uint32_t tl_attr, const uint32_t tl_length)
+int DispFilterAdd (pUserConfig_t usrconf, const char* rule, const int node)
 {
-    VPrint("%s: %sTraffic Class=%d%s%s%s%s", prefixstr, offstr, tl_tc,
-        tl_td           ? ", TLP Digest" : "",
-        tl_ep           ? ", Poisoned"   : "",
-        (tl_attr & 0x2) ? ", Relaxed ordering (PCI-X)" : ", Strong ordering (PCI)",
-        (tl_attr & 0x1) ? ", No snoop" : ""
-    );
-
-    if (tl_type & TL_TYPE_WRITE)
-        VPrint(", Payload Length=0x%03x DW",  tl_length ? tl_length : 1024);
-    VPrint("\n");
+    if (usrconf->NumDispFilters == MAX_DISP_FILTERS)
+    {
+        VPrint("DispFilterAdd: %s***Warning --- too many display filters at node %d. Ignoring rule%s\n", fmterrstr, node, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    if (DispFilterParse(rule, &usrconf->DispFilters[usrconf->NumDispFilters], node) != MEM_GOOD_STATUS)
+    {
+        return MEM_BAD_STATUS;
+    }
+
+    usrconf->DispFilterFields |= usrconf->DispFilters[usrconf->NumDispFilters++].fields;
+
+    return MEM_GOOD_STATUS;
 }
 
 // -------------------------------------------------------------------------
+// DispFilterClear()
+//
+// Remove all display filter rules, so all traffic is displayed
+//
 // -------------------------------------------------------------------------
 
-static inline void DispPayload(const char const *prefixstr, const char const *tloffstr, pPkt_t pkt, const uint32_t data_offset, const uint32_t tl_length)
+void DispFilterClear (pUserConfig_t usrconf)
 {
-    unsigned idx;
+    usrconf->NumDispFilters   = 0;
+    usrconf->DispFilterFields = 0;
+}
 
-    for (idx = 0; idx < (4 * tl_length); idx += 4)
-    {
-        uint32_t wdata = (pkt->data[data_offset+ idx] << 24) | (pkt->data[data_offset+ idx + 1] << 16)  | (pkt->data[data_offset+ idx + 2] << 8)  | (pkt->data[data_offset+ idx + 3]);
+// -------------------------------------------------------------------------
+// DispFilterRulesMatch()
+//
+// Returns true if the traffic matches one of num filter rules. fields
+// is the union of the rules' fields, and packet fields are only
+// decoded when a rule needs them. pkt is NULL for raw symbols and
+// ordered sets.
+//
+// -------------------------------------------------------------------------
 
-        if (!((idx / 4) % 8))
-            VPrint("%s: %s%s", prefixstr, tloffstr, fmtdatastr);
+bool DispFilterRulesMatch (const pPcieModelState_t const state, const bool rx, const pPkt_t const pkt,
+                           const DispFilter_t* filters, const int num, const uint32_t fields)
+{
+    uint32_t kind     = 0;
+    uint32_t rid      = 0;
+    uint32_t tag      = 0;
+    uint64_t addr     = 0;
+    bool     has_addr = false;
 
-        VPrint("%08x",wdata);
+    int  nodenum = rx ? state->usrconf.BackNodeNum : state->thisnode;
+    bool is_down = (rx && state->Endpoint) | (!rx && !state->Endpoint);
 
-        if (((idx / 4) % 8) == 7)
+    if (pkt != NULL && (fields & DISP_FILT_PKT_FIELDS))
+    {
+        if (pkt->data[0] == SDP)
         {
-            VPrint("%s\n", fmtnormstr);
+            kind = DISP_KIND_DLLP;
         }
         else
         {
-            VPrint(" ");
+            uint32_t tl_type     = pkt->data[3] & 0x7f;
+            uint32_t tl_type_adj = tl_type & (((tl_type & 0x30) == 0x30) ? ~0x7 : ~0x0);
+            uint32_t tl_word1    = (pkt->data[7]  << 24) | (pkt->data[8]  << 16) | (pkt->data[9]  << 8) | (pkt->data[10]);
+            uint32_t tl_word2    = (pkt->data[11] << 24) | (pkt->data[12] << 16) | (pkt->data[13] << 8) | (pkt->data[14]);
+            uint32_t tl_word3    = (pkt->data[15] << 24) | (pkt->data[16] << 16) | (pkt->data[17] << 8) | (pkt->data[18]);
+
+            rid = (tl_word1 >> 16) & 0xffff;
+            tag = GET_TAG_HI(pkt->data) | ((tl_word1 >>  8) & 0xff);
+
+            switch (tl_type_adj)
+            {
+            case TL_MRD32: case TL_MRDLCK32: case TL_MRD64: case TL_MRDLCK64: case TL_MWR32: case TL_MWR64:
+                kind     = DISP_KIND_MEM;
+                addr     = (tl_type & TL_TYPE_ADDR64) ? (((uint64_t)tl_word2 << 32) | tl_word3) : tl_word2;
+                has_addr = true;
+                break;
+            case TL_CPL: case TL_CPLD: case TL_CPLLK: case TL_CPLDLK:
+                // Requester ID and tag are in the third header word of completions
+                kind     = DISP_KIND_CPL;
+                rid      = (tl_word2 >> 16) & 0xffff;
+                tag      = GET_TAG_HI(pkt->data) | ((tl_word2 >>  8) & 0xff);
+                break;
+            case TL_CFGRD0: case TL_CFGRD1: case TL_CFGWR0: case TL_CFGWR1:
+                kind     = DISP_KIND_CFG;
+                break;
+            case TL_MSG: case TL_MSGD:
+                kind     = DISP_KIND_MSG;
+                break;
+            case TL_IORD: case TL_IOWR:
+                kind     = DISP_KIND_IO;
+                addr     = tl_word2;
+                has_addr = true;
+                break;
+            }
         }
     }
 
-    if ((idx/4)%8)
-        VPrint("%s\n", fmtnormstr);
+    for (int idx = 0; idx < num; idx++)
+    {
+        const DispFilter_t* filt = &filters[idx];
+
+        if (((filt->fields & DISP_FILT_NODE) && filt->node != nodenum) ||
+            ((filt->fields & DISP_FILT_DIR)  && filt->down != is_down))
+        {
+            continue;
+        }
+
+        if (filt->fields & DISP_FILT_PKT_FIELDS)
+        {
+            if (pkt == NULL                                                                                    ||
+                ((filt->fields & DISP_FILT_TYPE) && !(filt->kinds & kind))                                     ||
+                ((filt->fields & DISP_FILT_ADDR) && (!has_addr || addr < filt->addr_lo || addr > filt->addr_hi)) ||
+                ((filt->fields & DISP_FILT_RID)  && (kind == DISP_KIND_DLLP || (rid & filt->rid_mask) != filt->rid)) ||
+                ((filt->fields & DISP_FILT_TAG)  && (kind == DISP_KIND_DLLP || (tag & filt->tag_mask) != filt->tag)))
+            {
+                continue;
+            }
+        }
+
+        return true;
+    }
+
+    return false;
 }
 
 // -------------------------------------------------------------------------
+// DispFilterMatch()
+//
+// Returns true if the traffic matches one of the display filter rules
+// (or there are none)
+//
 // -------------------------------------------------------------------------
 
-inline static void DispTlpCrc(const char const *prefixstr, const char const *tloffstr, const char const *dlloffstr,
-                              const uint32_t tl_td, pPkt_t pkt)
+static inline bool DispFilterMatch (const pPcieModelState_t const state, const bool rx, const pPkt_t const pkt)
 {
-    PktData_t tl_type = pkt->data[3] & 0x7f;
+    const pUserConfig_t usrconf = &state->usrconf;
 
-    // Calculate LCRC and ECRC (if present)
-    uint32_t crc[4], ecrc[4];
-    uint32_t exp_lcrc, got_lcrc;
-    uint32_t exp_ecrc, got_ecrc;
+    return usrconf->NumDispFilters == 0 ||
+           DispFilterRulesMatch(state, rx, pkt, usrconf->DispFilters, usrconf->NumDispFilters, usrconf->DispFilterFields);
+}
 
-    unsigned lcrc_offset = 15 + 4 * (((tl_type & TL_TYPE_WRITE) ? GET_TLP_LENGTH(pkt->data) : 0) + TLP_HAS_DIGEST(pkt->data) + TLP_HDR_4DW(pkt->data));
-    crc[0] = pkt->data[lcrc_offset+0];
-    crc[1] = pkt->data[lcrc_offset+1];
-    crc[2] = pkt->data[lcrc_offset+2];
-    crc[3] = pkt->data[lcrc_offset+3];
-    CalcLcrc(pkt->data);
+// -------------------------------------------------------------------------
+// CheckContDisp()
+//
+// Check if to activate next ContDisp entry
+// -------------------------------------------------------------------------
 
-    exp_lcrc = ((uint32_t)pkt->data[lcrc_offset+0] << 24) | ((uint32_t)pkt->data[lcrc_offset+1] << 16) | ((uint32_t)pkt->data[lcrc_offset+2] << 8) | ((uint32_t)pkt->data[lcrc_offset+3]);
-    got_lcrc = ((uint32_t)crc[0] << 24) | ((uint32_t)crc[1] << 16) | ((uint32_t)crc[2] << 8) | ((uint32_t)crc[3]);
+inline void CheckContDisp (pUserConfig_t usrconf, const int node)
+{
+    uint32_t cycleCount = GetCycleCount(node);
 
-    if (TLP_HAS_DIGEST(pkt->data))
+    // If current time is at, or beyond, the indexed ContDisp...
+    if (usrconf->ContDispIdx < MAXCONSTDISP && GetCycleCount(node) >= usrconf->contdisp[usrconf->ContDispIdx].time)
     {
-        unsigned ecrc_offset = lcrc_offset - 4;
-        ecrc[0] = pkt->data[ecrc_offset+0];
-        ecrc[1] = pkt->data[ecrc_offset+1];
-        ecrc[2] = pkt->data[ecrc_offset+2];
-        ecrc[3] = pkt->data[ecrc_offset+3];
-        CalcEcrc(pkt->data);
-        exp_ecrc = ((uint32_t)pkt->data[ecrc_offset+0] << 24) | ((uint32_t)pkt->data[ecrc_offset+1] << 16) | ((uint32_t)pkt->data[ecrc_offset+2] << 8) | ((uint32_t)pkt->data[ecrc_offset+3]);
-        got_ecrc = ((uint32_t)ecrc[0] << 24) | ((uint32_t)ecrc[1] << 16) | ((uint32_t)ecrc[2] << 8) | ((uint32_t)ecrc[3]);
-    }
+        // Update active control with next value
+        usrconf->ActiveContDisp = usrconf->contdisp[usrconf->ContDispIdx].control;
 
-    if (tl_td)
-    {
-        if (got_ecrc == exp_ecrc)
+        // If simulation control bits set, action the control
+        if (usrconf->ActiveContDisp & (DISPFINISH | DISPSTOP))
         {
-            VPrint("%s: %sTL Good ECRC (%08x)\n", prefixstr, tloffstr, got_ecrc);
+            // Finish the node and halt the simulation
+            PcieFinish(node);
+            VWrite((usrconf->ActiveContDisp & DISPSTOP) ? PVH_STOP : PVH_FINISH, 0, 0, node);
         }
-        else
+
+        ConfigDispFormat(!(usrconf->ActiveContDisp & DISPSWNOCOLOUR));
+
+        // Increment the ContDisp index (up to maximum)
+        if (usrconf->ContDispIdx < MAXCONSTDISP)
         {
-            VPrint("%s: %sTL %s**Bad ECRC**%s (%08x v %08x)\n", prefixstr, tloffstr, fmterrstr, fmtnormstr, got_ecrc, exp_ecrc);
+            usrconf->ContDispIdx++;
         }
     }
-    else
-    {
-        VPrint("%s: %sTL No ECRC\n", prefixstr, tloffstr);
-    }
-    if (got_lcrc == exp_lcrc)
-    {
-        VPrint("%s: %sDL Good LCRC (%08x)\n", prefixstr, dlloffstr, got_lcrc);
-    }
-    else
-    {
-        VPrint("%s: %sDL%s **Bad LCRC%s** (%08x v %08x)\n", prefixstr, dlloffstr, fmterrstr, fmtnormstr, got_lcrc, exp_lcrc);
-    }
 }
 
 // -------------------------------------------------------------------------
@@ -307,43 +496,49 @@ inline static void DispTlpCrc(const char const *prefixstr, const char const *tlo
 
 void DispRaw(const pPcieModelState_t const state, const PktData_t *linkin, const int rx)
 {
+    if (!(state->usrconf.ActiveContDisp & DISPLAYERMASK))
+    {
+        return;
+    }
+
+    dispnode = state->thisnode;
 
-    if (IsDispEnabled(state, rx, DISPRAWSYM | DISPALL))
+    if (IsDispEnabled(state, rx, DISPRAWSYM | DISPALL) && DispFilterMatch(state, rx, NULL))
     {
         //VPrint("==> ep=%d rx=%d conf=%03x\n", state->Endpoint, rx,state->usrconf.ActiveContDisp);
         int is_down = (rx && state->Endpoint) | (!rx && !state->Endpoint);
 
-        VPrint("%sPCIE%s%d: %s", is_down ? fmtdnstr : fmtupstr, is_down ? "D" : "U", rx ? state->usrconf.BackNodeNum : state->thisnode, fmtnormstr);
+        DISPPRINT("%sPCIE%s%d: %s", is_down ? fmtdnstr : fmtupstr, is_down ? "D" : "U", rx ? state->usrconf.BackNodeNum : state->thisnode, fmtnormstr);
 
         for (int idx = 0; idx < state->LinkWidth; idx++)
         {
             switch (linkin[idx])
             {
-            case COM: VPrint("COM "); break;
-            case STP: VPrint("STP "); break;
-            case SDP: VPrint("SDP "); break;
-            case END: VPrint("END "); break;
-            case EDB: VPrint("EDB "); break;
-            case PAD: VPrint("PAD "); break;
-            case SKP: VPrint("SKP "); break;
-            case FTS: VPrint("FTS "); break;
-            case IDL: VPrint("IDL "); break;
-            case EIE: VPrint("EIE "); break;
-            case RV2: VPrint("RV2 "); break;
-            case RV3: VPrint("RV3 "); break;
+            case COM: DISPPRINT("COM "); break;
+            case STP: DISPPRINT("STP "); break;
+            case SDP: DISPPRINT("SDP "); break;
+            case END: DISPPRINT("END "); break;
+            case EDB: DISPPRINT("EDB "); break;
+            case PAD: DISPPRINT("PAD "); break;
+            case SKP: DISPPRINT("SKP "); break;
+            case FTS: DISPPRINT("FTS "); break;
+            case IDL: DISPPRINT("IDL "); break;
+            case EIE: DISPPRINT("EIE "); break;
+            case RV2: DISPPRINT("RV2 "); break;
+            case RV3: DISPPRINT("RV3 "); break;
             default:
               if (linkin[idx] & SYMCTRLBIT)
               {
-                  VPrint("??? ");
+                  DISPPRINT("??? ");
               }
               else
               {
-                  VPrint (" %02x ", linkin[idx]);
+                  DISPPRINT(" %02x ", linkin[idx]);
               }
               break;
             }
         }
-        VPrint("\n");
+        DISPPRINT("\n");
     }
 }
 
@@ -356,7 +551,14 @@ void DispRaw(const pPcieModelState_t const state, const PktData_t *linkin, const
 
 void DispOS(const pPcieModelState_t const state, const int type, const pTS_t const ts_data, const int lane, const bool rx, const int node)
 {
-    if (IsDispEnabled(state, rx, DISPPL | DISPALL))
+    if (!(state->usrconf.ActiveContDisp & DISPLAYERMASK))
+    {
+        return;
+    }
+
+    dispnode = state->thisnode;
+
+    if (IsDispEnabled(state, rx, DISPPL | DISPALL) && DispFilterMatch(state, rx, NULL))
     {
         char lanestr[STRBUFSIZE], linkstr[STRBUFSIZE], dirstr[STRBUFSIZE];
 
@@ -373,30 +575,31 @@ void DispOS(const pPcieModelState_t const state, const int type, const pTS_t con
             snprintf(lanestr, STRBUFSIZE, "%3d", ts_data->lanenum);
             snprintf(linkstr, STRBUFSIZE, "%3d", ts_data->linknum);
 
-            VPrint("%sPCIE%s%d%s %02d: PL TS%d OS Link=%s Lane=%s N_FTS=%2d DataRate=%s %s %s %s %s %s %s %s\n",
-                   (is_down ? fmtdnstr : fmtupstr),
-                   dirstr, nodenum, fmtnormstr,
-                   lane, (type == TS1_ID) ? 1 : 2,
-                   (ts_data->linknum == PAD) ? "PAD" : linkstr,
-                   (ts_data->lanenum == PAD) ? "PAD" : lanestr,
-                   ts_data->n_fts,
-                   (ts_data->datarate == 6)  ? "GEN2+GEN1" :
-                   (ts_data->datarate == 4)  ? "GEN2" :
-                   (ts_data->datarate == 2)  ? "GEN1" : "GEN?",
-                   (ts_data->datarate & TS_DATA_RATE_CHANGE_AUTO)  ? "AutonomousChange" : "",
-                   (ts_data->datarate & TS_DATA_RATE_CHANGE_SPEED) ? "SpeedChange" : "",
-                   (ts_data->control  & 0x01) ? "AssertReset"   : "",
-                   (ts_data->control  & 0x02) ? "DisableLink"   : "",
-                   (ts_data->control  & 0x04) ? "Loopback"      : "",
-                   (ts_data->control  & 0x08) ? "NoScramble"    : "",
-                   (ts_data->control  & 0x10) ? "ComplianceRx"  : ""
-                   );
+            DISPPRINT("%sPCIE%s%d%s %02d: PL TS%d OS Link=%s Lane=%s N_FTS=%2d DataRate=%s %s %s %s %s %s %s %s\n",
+                      (is_down ? fmtdnstr : fmtupstr),
+                      dirstr, nodenum, fmtnormstr,
+                      lane, (type == TS1_ID) ? 1 : 2,
+                      (ts_data->linknum == PAD) ? "PAD" : linkstr,
+                      (ts_data->lanenum == PAD) ? "PAD" : lanestr,
+                      ts_data->n_fts,
+                      (ts_data->datarate == 14) ? "GEN3+GEN2+GEN1" :
+                      (ts_data->datarate == 6)  ? "GEN2+GEN1" :
+                      (ts_data->datarate == 4)  ? "GEN2" :
+                      (ts_data->datarate == 2)  ? "GEN1" : "GEN?",
+                      (ts_data->datarate & TS_DATA_RATE_CHANGE_AUTO)  ? "AutonomousChange" : "",
+                      (ts_data->datarate & TS_DATA_RATE_CHANGE_SPEED) ? "SpeedChange" : "",
+                      (ts_data->control  & 0x01) ? "AssertReset"   : "",
+                      (ts_data->control  & 0x02) ? "DisableLink"   : "",
+                      (ts_data->control  & 0x04) ? "Loopback"      : "",
+                      (ts_data->control  & 0x08) ? "NoScramble"    : "",
+                      (ts_data->control  & 0x10) ? "ComplianceRx"  : ""
+                      );
             break;
-        case IDL: VPrint("%sPCIE%s%d%s %02d: PL Electrical idle ordered set\n", is_down ? fmtdnstr : fmtupstr, dirstr, nodenum, fmtnormstr, lane); break;
-        case FTS: VPrint("%sPCIE%s%d%s %02d: PL Fast training sequence ordered set\n", is_down ? fmtdnstr : fmtupstr, dirstr, nodenum, fmtnormstr, lane); break;
-        case EIE: VPrint("%sPCIE%s%d%s %02d: PL Electrical Idle Exit ordered set\n", is_down ? fmtdnstr : fmtupstr, dirstr, nodenum, fmtnormstr, lane); break;
-        case SKP: VPrint("%sPCIE%s%d%s %02d: PL Skip ordered set\n", is_down ? fmtdnstr : fmtupstr, dirstr, nodenum, fmtnormstr, lane); break;
-        default:  VPrint("%sPCIE%s%d%s %02d: PL %s**Unrecognised ordered set (0x%03x)**%s\n", is_down ? fmtdnstr : fmtupstr, dirstr, nodenum, fmtnormstr, lane, fmterrstr, type, fmtnormstr); break;
+        case IDL: DISPPRINT("%sPCIE%s%d%s %02d: PL Electrical idle ordered set\n", is_down ? fmtdnstr : fmtupstr, dirstr, nodenum, fmtnormstr, lane); break;
+        case FTS: DISPPRINT("%sPCIE%s%d%s %02d: PL Fast training sequence ordered set\n", is_down ? fmtdnstr : fmtupstr, dirstr, nodenum, fmtnormstr, lane); break;
+        case EIE: DISPPRINT("%sPCIE%s%d%s %02d: PL Electrical Idle Exit ordered set\n", is_down ? fmtdnstr : fmtupstr, dirstr, nodenum, fmtnormstr, lane); break;
+        case SKP: DISPPRINT("%sPCIE%s%d%s %02d: PL Skip ordered set\n", is_down ? fmtdnstr : fmtupstr, dirstr, nodenum, fmtnormstr, lane); break;
+        default:  DISPPRINT("%sPCIE%s%d%s %02d: PL %s**Unrecognised ordered set (0x%03x)**%s\n", is_down ? fmtdnstr : fmtupstr, dirstr, nodenum, fmtnormstr, lane, fmterrstr, type, fmtnormstr); break;
         }
     }
 }
@@ -410,25 +613,37 @@ void DispOS(const pPcieModelState_t const state, const int type, const pTS_t con
 
 void DispDll(const pPcieModelState_t const state, const pPkt_t const pkt, const bool rx)
 {
+    if (!(state->usrconf.ActiveContDisp & DISPLAYERMASK))
+    {
+        return;
+    }
+
+    dispnode = state->thisnode;
+
     char prefixstr[STRBUFSIZE];
     char offstr[STRBUFSIZE];
     bool phyen   = IsDispEnabled(state, rx, DISPPL | DISPALL);
     bool dllen   = IsDispEnabled(state, rx, DISPDL | DISPALL);
     bool is_down = (rx && state->Endpoint) | (!rx && !state->Endpoint);
 
+    if (!(phyen || dllen) || !DispFilterMatch(state, rx, pkt))
+    {
+        return;
+    }
+
     sprintf(prefixstr, "%sPCIE%s%d%s", is_down ? fmtdnstr : fmtupstr, is_down ? "D" : "U", rx ? state->usrconf.BackNodeNum : state->thisnode, fmtnormstr);
 
     if (phyen)
     {
-        VPrint("%s: {SDP\n", prefixstr);
-        VPrint("%s%s:", prefixstr, fmtdatastr);
+        DISPPRINT("%s: {SDP\n", prefixstr);
+        DISPPRINT("%s%s:", prefixstr, fmtdatastr);
         for (int idx = 1; idx <= 6; idx++)
         {
-            VPrint(" %02x", pkt->data[idx]);
+            DISPPRINT(" %02x", pkt->data[idx]);
         }
-        VPrint("%s", fmtnormstr);
+        DISPPRINT("%s", fmtnormstr);
 
-        VPrint("\n%s: %s}\n", prefixstr, pkt->data[pkt->ByteCount-1] == EDB ? "EDB" : "END");
+        DISPPRINT("\n%s: %s}\n", prefixstr, pkt->data[pkt->ByteCount-1] == EDB ? "EDB" : "END");
     }
 
     if (dllen)
@@ -455,7 +670,7 @@ void DispDll(const pPcieModelState_t const state, const pPkt_t const pkt, const
         {
         case DL_ACK:
         case DL_NAK:
-            VPrint("%s: %sDL %s seq %02d\n", prefixstr, offstr, (type == DL_ACK) ? "Ack" : "Nak" , data & 0xfff);
+            DISPPRINT("%s: %sDL %s seq %02d\n", prefixstr, offstr, (type == DL_ACK) ? "Ack" : "Nak" , data & 0xfff);
             break;
         case DL_INITFC1_P:
         case DL_INITFC1_NP:
@@ -463,7 +678,7 @@ void DispDll(const pPcieModelState_t const state, const pPkt_t const pkt, const
         case DL_INITFC2_P:
         case DL_INITFC2_NP:
         case DL_INITFC2_CPL:
-            VPrint("%s: %sDL %s%s VC%d  HdrFC=%d DataFC=%d\n", prefixstr, offstr, (type & 0x80) ? "InitFC2-" : "InitFC1-",
+            DISPPRINT("%s: %sDL %s%s VC%d  HdrFC=%d DataFC=%d\n", prefixstr, offstr, (type & 0x80) ? "InitFC2-" : "InitFC1-",
                                                     (type & 0x30) == 0x00 ? "P   " : (type & 0x30) == 0x10 ? "NP  " : "Cpl ", type & 0x7,
                                                     (data >> 14) & 0xff,
                                                     (data & 0xfff)
@@ -472,7 +687,7 @@ void DispDll(const pPcieModelState_t const state, const pPkt_t const pkt, const
         case DL_UPDATEFC_P:
         case DL_UPDATEFC_NP:
         case DL_UPDATEFC_CPL:
-            VPrint("%s: %sDL UpdateFC-%sVC%d  HdrFC=%d DataFC=%d\n", prefixstr, offstr,
+            DISPPRINT("%s: %sDL UpdateFC-%sVC%d  HdrFC=%d DataFC=%d\n", prefixstr, offstr,
                 (type & 0x30) == 0x00 ? "P   " : (type & 0x30) == 0x10 ? "NP  ": "Cpl ", type & 0x7,
                 (data >> 14) & 0xff,
                 (data & 0xfff)
@@ -482,30 +697,30 @@ void DispDll(const pPcieModelState_t const state, const pPkt_t const pkt, const
             // All PM DLLPs match on DL_PM_ENTER_L1 with low 3 bits masked, so complete decode here
             switch (type)
             {
-            case DL_PM_ENTER_L1  : VPrint("%s: %sDL PM_Enter_L1\n", prefixstr, offstr); break;
-            case DL_PM_ENTER_L23 : VPrint("%s: %sDL PM_Enter_L23\n", prefixstr, offstr); break;
-            case DL_PM_REQ_L0S   : VPrint("%s: %sDL PM_Active_State_Request_L0s\n", prefixstr, offstr); break;
-            case DL_PM_REQ_L1    : VPrint("%s: %sDL PM_Active_State_Request_L1\n", prefixstr, offstr); break;
-            case DL_PM_REQ_ACK   : VPrint("%s: %sDL PM_Request_Ack\n", prefixstr, offstr); break;
-            default: VPrint("%s:*** Unknown DLLP packet type\n", prefixstr); break;
+            case DL_PM_ENTER_L1  : DISPPRINT("%s: %sDL PM_Enter_L1\n", prefixstr, offstr); break;
+            case DL_PM_ENTER_L23 : DISPPRINT("%s: %sDL PM_Enter_L23\n", prefixstr, offstr); break;
+            case DL_PM_REQ_L0S   : DISPPRINT("%s: %sDL PM_Active_State_Request_L0s\n", prefixstr, offstr); break;
+            case DL_PM_REQ_L1    : DISPPRINT("%s: %sDL PM_Active_State_Request_L1\n", prefixstr, offstr); break;
+            case DL_PM_REQ_ACK   : DISPPRINT("%s: %sDL PM_Request_Ack\n", prefixstr, offstr); break;
+            default: DISPPRINT("%s:*** Unknown DLLP packet type\n", prefixstr); break;
             }
             break;
         case DL_VENDOR:
-            VPrint("%s: %sDL Vendor Specific DLLP\n", prefixstr, offstr);
+            DISPPRINT("%s: %sDL Vendor Specific DLLP\n", prefixstr, offstr);
             break;
         default:
-            VPrint("%s:*** Unknown DLLP packet type\n", prefixstr);
+            DISPPRINT("%s:*** Unknown DLLP packet type\n", prefixstr);
             break;
         }
 
-        VPrint("%s: %sDL ", prefixstr, offstr);
+        DISPPRINT("%s: %sDL ", prefixstr, offstr);
         if (is_good_crc)
         {
-            VPrint("Good DLLP CRC (%04x)\n", gotcrc);
+            DISPPRINT("Good DLLP CRC (%04x)\n", gotcrc);
         }
         else
         {
-            VPrint("**BAD PCIe DLLP CRC (%04x v %04x)\n", gotcrc, expcrc);
+            DISPPRINT("**BAD PCIe DLLP CRC (%04x v %04x)\n", gotcrc, expcrc);
         }
     }
 }
@@ -519,6 +734,13 @@ void DispDll(const pPcieModelState_t const state, const pPkt_t const pkt, const
 
 void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const bool rx)
 {
+    if (!(state->usrconf.ActiveContDisp & DISPLAYERMASK))
+    {
+        return;
+    }
+
+    dispnode = state->thisnode;
+
     int idx;
     char     prefixstr[STRBUFSIZE];
     char     tloffstr[STRBUFSIZE];
@@ -530,26 +752,31 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
 
     int is_down = (rx && state->Endpoint) | (!rx && !state->Endpoint);
 
+    if (!(phyen || dllen || tlen) || !DispFilterMatch(state, rx, pkt))
+    {
+        return;
+    }
+
     // Create marker suffix
     sprintf(prefixstr, "%sPCIE%s%d%s", is_down ? fmtdnstr : fmtupstr, is_down ? "D" : "U", rx ? state->usrconf.BackNodeNum : state->thisnode, fmtnormstr);
 
     if (phyen)
     {
-        VPrint("%s: {STP\n", prefixstr);
+        DISPPRINT("%s: {STP\n", prefixstr);
 
         for (idx = 1; pkt->data[idx] != EDB && pkt->data[idx] != END; idx++)
         {
             if ((idx-1)%22 == 0)
-                VPrint("%s:%s", prefixstr, fmtdatastr);
+                DISPPRINT("%s:%s", prefixstr, fmtdatastr);
 
-            VPrint(" %02x", pkt->data[idx]);
+            DISPPRINT(" %02x", pkt->data[idx]);
 
             if ((idx-1)%22 == 21)
-                VPrint("%s\n", fmtnormstr);
+                DISPPRINT("%s\n", fmtnormstr);
         }
-        VPrint("%s", fmtnormstr);
-        VPrint("%s", !((idx-1)%22) ? "" : "\n");
-        VPrint("%s: %s}\n", prefixstr, pkt->data[idx] == EDB ? "EDB" : "END");
+        DISPPRINT("%s", fmtnormstr);
+        DISPPRINT("%s", !((idx-1)%22) ? "" : "\n");
+        DISPPRINT("%s: %s}\n", prefixstr, pkt->data[idx] == EDB ? "EDB" : "END");
     }
 
     if (tlen)
@@ -575,7 +802,7 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
 
         // word 1 decode for mem, i/o and config
         uint32_t tl_id       = (tl_word1 >> 16) & 0xffff;
-        uint32_t tl_tag      = (tl_word1 >>  8) & 0xff;
+        uint32_t tl_tag      = GET_TAG_HI(pkt->data) | ((tl_word1 >>  8) & 0xff);
         uint32_t tl_lbe      = (tl_word1 >>  4) & 0xf; tl_lbe = ((tl_lbe & 0x8) ? 0x1000 : 0) | ((tl_lbe & 0x4) ? 0x0100 : 0) | ((tl_lbe & 0x2) ? 0x0010 : 0) | ((tl_lbe & 0x1) ? 0x0001 : 0);
         uint32_t tl_fbe      = (tl_word1 >>  0) & 0xf; tl_fbe = ((tl_fbe & 0x8) ? 0x1000 : 0) | ((tl_fbe & 0x4) ? 0x0100 : 0) | ((tl_fbe & 0x2) ? 0x0010 : 0) | ((tl_fbe & 0x1) ? 0x0001 : 0);
 
@@ -592,26 +819,26 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
         case TL_MWR32:
         case TL_MWR64:
 
-            VPrint("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
-            VPrint("%s: %sTL Mem %s req Addr=", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "write" : "read");
+            DISPPRINT("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
+            DISPPRINT("%s: %sTL Mem %s req Addr=", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "write" : "read");
 
             if (tl_type & TL_TYPE_ADDR64)
             {
-                VPrint("%016lx (64) ", ((uint64_t)tl_word2 << 32) | ((uint64_t)tl_word3));
+                DISPPRINT("%016lx (64) ", ((uint64_t)tl_word2 << 32) | ((uint64_t)tl_word3));
             }
             else
             {
-                VPrint("%08x (32) ", tl_word2);
+                DISPPRINT("%08x (32) ", tl_word2);
 
             }
 
-            VPrint("%s=%04x TAG=%02x FBE=%04x LBE=%04x ", (tl_type & TL_TYPE_MEMLOCK) ? "LOCKED ID" : "RID", tl_id, tl_tag, tl_fbe, tl_lbe);
+            DISPPRINT("%s=%04x TAG=%02x FBE=%04x LBE=%04x ", (tl_type & TL_TYPE_MEMLOCK) ? "LOCKED ID" : "RID", tl_id, tl_tag, tl_fbe, tl_lbe);
 
             if (!(tl_type & TL_TYPE_WRITE))
             {
-                VPrint("Len=%03x", tl_length);
+                DISPPRINT("Len=%03x", tl_length);
             }
-            VPrint("\n");
+            DISPPRINT("\n");
 
             // Display traffic class and other attributes
             DispTc (prefixstr, tloffstr, tl_type, tl_tc, tl_td, tl_ep, tl_attr, tl_length);
@@ -622,11 +849,11 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
                 // Calculate start of data offset, depending on 3 or 4 DW header (plus STP and 2 byte seq number)
                 data_offset = 15 + ((tl_type & TL_TYPE_ADDR64)? 4 : 0);
 
-                DispPayload(prefixstr, tloffstr, pkt, data_offset, tl_length);
+                DispPayload(prefixstr, tloffstr, pkt->data, data_offset, tl_length);
             }
 
             // Display LCRC and (if present) ECRC associated with the TLP
-            DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt);
+            DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt->data);
 
             break;
 
@@ -640,17 +867,17 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
             uint32_t tl_bcm       = (tl_word1 >> 12) & 0x1;
             uint32_t tl_byte_cnt  = (tl_word1 >>  0) & 0xfff;
             uint32_t tl_crid      = (tl_word2 >> 16) & 0xffff;
-            uint32_t tl_ctag      = (tl_word2 >>  8) & 0xff;
+            uint32_t tl_ctag      = (tl_tag & 0x300) | ((tl_word2 >>  8) & 0xff);
             uint32_t tl_laddr     = (tl_word2 >>  0) & 0x7f;
 
-            VPrint("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
-            VPrint("%s: %sTL Completion %s%s%s", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "with data " : "", (tl_type & TL_TYPE_MEMLOCK) ? "LOCKED " : "",
+            DISPPRINT("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
+            DISPPRINT("%s: %sTL Completion %s%s%s", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "with data " : "", (tl_type & TL_TYPE_MEMLOCK) ? "LOCKED " : "",
                       (tl_cstatus == 0) ? "Successful "              :
                       (tl_cstatus == 1) ? "Unsupported Request "     :
                       (tl_cstatus == 2) ? "Config Req Retry Status " :
                                           "Completer Abort "
                 );
-            VPrint("CID=%04x BCM=%d Byte Count=%03x RID=%04x TAG=%02x Lower Addr=%02x\n", tl_id, tl_bcm, tl_byte_cnt, tl_crid, tl_ctag, tl_laddr);
+            DISPPRINT("CID=%04x BCM=%d Byte Count=%03x RID=%04x TAG=%02x Lower Addr=%02x\n", tl_id, tl_bcm, tl_byte_cnt, tl_crid, tl_ctag, tl_laddr);
 
             // Display traffic class and other attributes
             DispTc (prefixstr, tloffstr, tl_type, tl_tc, tl_td, tl_ep, tl_attr, tl_length);
@@ -660,11 +887,11 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
             {
                 data_offset = 15; // SDP +  2 byte Seq Num + 3 DW header
 
-                DispPayload(prefixstr, tloffstr, pkt, data_offset, tl_length);
+                DispPayload(prefixstr, tloffstr, pkt->data, data_offset, tl_length);
             }
 
             // Display LCRC and (if present) ECRC associated with the TLP
-            DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt);
+            DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt->data);
 
             break;
         }
@@ -681,8 +908,8 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
             uint32_t tl_ereg = (tl_word2 >>  8) & 0xf;
             uint32_t tl_reg  = (tl_word2 >>  2) & 0x3f;
 
-            VPrint("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
-            VPrint("%s: %sTL Config %s type %d RID=%04x TAG=%02x FBE=%04x LBE=%04x Bus=%02x Dev=%02x Func=%x EReg=%x Reg=%02x\n",
+            DISPPRINT("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
+            DISPPRINT("%s: %sTL Config %s type %d RID=%04x TAG=%02x FBE=%04x LBE=%04x Bus=%02x Dev=%02x Func=%x EReg=%x Reg=%02x\n",
                 prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "write" : "read", tl_type & 1,
                 tl_id, tl_tag, tl_fbe, tl_lbe, tl_bus, tl_dev, tl_func, tl_ereg, tl_reg);
 
@@ -694,11 +921,11 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
             {
                 data_offset = 15; // SDP +  2 byte Seq Num + 3 DW header
 
-                DispPayload(prefixstr, tloffstr, pkt, data_offset, tl_length);
+                DispPayload(prefixstr, tloffstr, pkt->data, data_offset, tl_length);
             }
 
             // Display LCRC and (if present) ECRC associated with the TLP
-            DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt);
+            DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt->data);
             break;
         }
 
@@ -706,8 +933,8 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
         case TL_MSG:
         case TL_MSGD:
 
-            VPrint("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
-            VPrint("%s: %sTL Message req%s ", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? " with Data" : "");
+            DISPPRINT("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
+            DISPPRINT("%s: %sTL Message req%s ", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? " with Data" : "");
 
             uint32_t msg_code   = tl_word1 & 0xff;
             uint32_t vend_id    = tl_word2 & 0xffff;
@@ -715,44 +942,44 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
 
             switch(msg_code)
             {
-            case MSG_ASSERT_INTA  : VPrint("Assert INTA "); break;
-            case MSG_ASSERT_INTB  : VPrint("Assert INTB "); break;
-            case MSG_ASSERT_INTC  : VPrint("Assert INTC "); break;
-            case MSG_ASSERT_INTD  : VPrint("Assert INTD "); break;
-            case MSG_DEASSERT_INTA: VPrint("Deassert INTA "); break;
-            case MSG_DEASSERT_INTB: VPrint("Deassert INTB "); break;
-            case MSG_DEASSERT_INTC: VPrint("Deassert INTC "); break;
-            case MSG_DEASSERT_INTD: VPrint("Deassert INTD "); break;
-            case MSG_PM_ACTIVE_NAK: VPrint("PM Active State NAK "); break;
-            case MSG_PM_PME       : VPrint("PM Power Management Enable "); break;
-            case MSG_PME_OFF      : VPrint("PM Turn Off "); break;
-            case MSG_PME_TO_ACK   : VPrint("PM TO Ack "); break;
-            case MSG_ERR_COR      : VPrint("Error Correctable "); break;
-            case MSG_ERR_NONFATAL : VPrint("Error Non-fatal "); break;
-            case MSG_ERR_FATAL    : VPrint("Error Fatal "); break;
-            case MSG_UNLOCK       : VPrint("Unlock locked transaction "); break;
-            case MSG_SET_PWR_LIMIT: VPrint("Set slot power limit "); break;
-            case MSG_VENDOR_0     : VPrint("Vendor type 0 "); break;
-            case MSG_VENDOR_1     : VPrint("Vendor type 1 "); break;
-            default               : VPrint("%s**illegal Msg code**%s ", fmterrstr, fmtnormstr);
+            case MSG_ASSERT_INTA  : DISPPRINT("Assert INTA "); break;
+            case MSG_ASSERT_INTB  : DISPPRINT("Assert INTB "); break;
+            case MSG_ASSERT_INTC  : DISPPRINT("Assert INTC "); break;
+            case MSG_ASSERT_INTD  : DISPPRINT("Assert INTD "); break;
+            case MSG_DEASSERT_INTA: DISPPRINT("Deassert INTA "); break;
+            case MSG_DEASSERT_INTB: DISPPRINT("Deassert INTB "); break;
+            case MSG_DEASSERT_INTC: DISPPRINT("Deassert INTC "); break;
+            case MSG_DEASSERT_INTD: DISPPRINT("Deassert INTD "); break;
+            case MSG_PM_ACTIVE_NAK: DISPPRINT("PM Active State NAK "); break;
+            case MSG_PM_PME       : DISPPRINT("PM Power Management Enable "); break;
+            case MSG_PME_OFF      : DISPPRINT("PM Turn Off "); break;
+            case MSG_PME_TO_ACK   : DISPPRINT("PM TO Ack "); break;
+            case MSG_ERR_COR      : DISPPRINT("Error Correctable "); break;
+            case MSG_ERR_NONFATAL : DISPPRINT("Error Non-fatal "); break;
+            case MSG_ERR_FATAL    : DISPPRINT("Error Fatal "); break;
+            case MSG_UNLOCK       : DISPPRINT("Unlock locked transaction "); break;
+            case MSG_SET_PWR_LIMIT: DISPPRINT("Set slot power limit "); break;
+            case MSG_VENDOR_0     : DISPPRINT("Vendor type 0 "); break;
+            case MSG_VENDOR_1     : DISPPRINT("Vendor type 1 "); break;
+            default               : DISPPRINT("%s**illegal Msg code**%s ", fmterrstr, fmtnormstr);
             }
 
-            VPrint("ID=%04x TAG=%02x ", tl_id, tl_tag);
+            DISPPRINT("ID=%04x TAG=%02x ", tl_id, tl_tag);
 
             if (msg_code == MSG_VENDOR_0 || msg_code == MSG_VENDOR_1)
             {
-                VPrint("Vendor ID=%04x Vendor Data=%08x ", vend_id, tl_word3);
+                DISPPRINT("Vendor ID=%04x Vendor Data=%08x ", vend_id, tl_word3);
             }
 
             switch(route_type)
             {
-            case MSG_ROUTE_ROOT  : VPrint("(route to root complex)\n"); break;
-            case MSG_ROUTE_ADDR  : VPrint("(route by address)\n"); break;
-            case MSG_ROUTE_ID    : VPrint("(route by ID = 0x%04x)\n", tl_id); break;
-            case MSG_ROUTE_BCAST : VPrint("(broadcast from root complex)\n"); break;
-            case MSG_ROUTE_LOCAL : VPrint("(Local)\n"); break;
-            case MSG_ROUTE_GATHER: VPrint("(Gather and route to root complex)\n"); break;
-            default              : VPrint("(%s**illegal route**%s)\n", fmterrstr, fmtnormstr); break;
+            case MSG_ROUTE_ROOT  : DISPPRINT("(route to root complex)\n"); break;
+            case MSG_ROUTE_ADDR  : DISPPRINT("(route by address)\n"); break;
+            case MSG_ROUTE_ID    : DISPPRINT("(route by ID = 0x%04x)\n", tl_id); break;
+            case MSG_ROUTE_BCAST : DISPPRINT("(broadcast from root complex)\n"); break;
+            case MSG_ROUTE_LOCAL : DISPPRINT("(Local)\n"); break;
+            case MSG_ROUTE_GATHER: DISPPRINT("(Gather and route to root complex)\n"); break;
+            default              : DISPPRINT("(%s**illegal route**%s)\n", fmterrstr, fmtnormstr); break;
             }
 
             // Display traffic class and other attributes
@@ -763,21 +990,21 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
             {
                 data_offset = 19; // SDP +  2 byte Seq Num + 4 DW header
 
-                DispPayload(prefixstr, tloffstr, pkt, data_offset, tl_length);
+                DispPayload(prefixstr, tloffstr, pkt->data, data_offset, tl_length);
             }
 
             // Display LCRC and (if present) ECRC associated with the TLP
-            DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt);
+            DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt->data);
             break;
 
         // IO accesses
         case TL_IORD:
         case TL_IOWR:
 
-            VPrint("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
-            VPrint("%s: %sTL IO %s req Addr=", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "write" : "read");
-            VPrint("%08x (32) ", tl_word2);
-            VPrint("RID=%04x TAG=%02x FBE=%04x LBE=%04x\n", tl_id, tl_tag, tl_fbe, tl_lbe);
+            DISPPRINT("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
+            DISPPRINT("%s: %sTL IO %s req Addr=", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "write" : "read");
+            DISPPRINT("%08x (32) ", tl_word2);
+            DISPPRINT("RID=%04x TAG=%02x FBE=%04x LBE=%04x\n", tl_id, tl_tag, tl_fbe, tl_lbe);
 
             // Display traffic class and other attributes
             DispTc (prefixstr, tloffstr, tl_type, tl_tc, tl_td, tl_ep, tl_attr, tl_length);
@@ -788,11 +1015,11 @@ void DispTl(const pPcieModelState_t const state, const pPkt_t const pkt, const b
                 // Calculate start of data offset, depending on 3 or 4 DW header (plus STP and 2 byte seq number)
                 data_offset = 15 + ((tl_type & TL_TYPE_ADDR64)? 4 : 0);
 
-                DispPayload(prefixstr, tloffstr, pkt, data_offset, tl_length);
+                DispPayload(prefixstr, tloffstr, pkt->data, data_offset, tl_length);
             }
 
             // Display LCRC and (if present) ECRC associated with the TLP
-            DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt);
+            DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt->data);
             break;
         }
     }
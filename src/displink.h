@@ -48,6 +48,9 @@
 #define DISPSWENEP                   0x400
 #define DISPSWNOCOLOUR               0x800
 
+// All the display layer selections, for a fast check that display is off
+#define DISPLAYERMASK                (DISPALL | DISPTL | DISPDL | DISPPL | DISPRAWSYM)
+
 // Definitions for use in formatted packet information display
 
 //#define PCIENOFORMAT
@@ -127,6 +130,11 @@ extern char fmtdatastr[];
 void ConfigDispFormat (bool enable);
 void ContDisp         (pUserConfig_t usrconf,                 const int      node);
 void CheckContDisp    (pUserConfig_t usrconf,                 const int      node);
+int  DispFilterParse  (const char* rule,                      const pDispFilter_t filt, const int node);
+int  DispFilterAdd    (pUserConfig_t usrconf,                 const char*    rule,  const int node);
+bool DispFilterRulesMatch (const pPcieModelState_t const state, const bool rx, const pPkt_t const pkt,
+                           const DispFilter_t* filters, const int num, const uint32_t fields);
+void DispFilterClear  (pUserConfig_t usrconf);
 void DispRaw          (const pPcieModelState_t const state,   const PktData_t *linkin, const int rx);
 void DispOS           (const pPcieModelState_t const state,   const int          type, const pTS_t   const ts_data, const int lane, const bool rx, const int node);
 void DispDll          (const pPcieModelState_t const state,   const pPkt_t const pkt,  const bool rx);
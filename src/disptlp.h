@@ -0,0 +1,163 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// TLP field display routines, shared by the model's link display
+// (displink.c) and the offline trace decoder (tools/pcietracedec.c).
+// The including file defines DISPPRINT() and the fmtdatastr,
+// fmterrstr and fmtnormstr format strings, and links with
+// pcie_crc.c.
+//
+//=============================================================
+
+#ifndef _DISPTLP_H_
+#define _DISPTLP_H_
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdint.h>
+
+#include "pci_express.h"
+#include "pcie_crc.h"
+
+// -------------------------------------------------------------------------
+// DispTc()
+//
+// Display traffic class and other attributes
+// -------------------------------------------------------------------------
+
+static inline void DispTc (const char *prefixstr, const char *offstr,
+                           const uint32_t tl_type, const uint32_t tl_tc, const uint32_t tl_td,
+                           const uint32_t tl_ep, const uint32_t tl_attr, const uint32_t tl_length)
+{
+    DISPPRINT("%s: %sTraffic Class=%d%s%s%s%s", prefixstr, offstr, tl_tc,
+        tl_td           ? ", TLP Digest" : "",
+        tl_ep           ? ", Poisoned"   : "",
+        (tl_attr & 0x2) ? ", Relaxed ordering (PCI-X)" : ", Strong ordering (PCI)",
+        (tl_attr & 0x1) ? ", No snoop" : ""
+    );
+
+    if (tl_type & TL_TYPE_WRITE)
+        DISPPRINT(", Payload Length=0x%03x DW",  tl_length ? tl_length : 1024);
+    DISPPRINT("\n");
+}
+
+// -------------------------------------------------------------------------
+// DispPayload()
+//
+// Display a TLP's payload, eight words to a line
+// -------------------------------------------------------------------------
+
+static inline void DispPayload (const char *prefixstr, const char *tloffstr, const PktData_t *pkt, const uint32_t data_offset, const uint32_t tl_length)
+{
+    unsigned idx;
+
+    for (idx = 0; idx < (4 * tl_length); idx += 4)
+    {
+        uint32_t wdata = (pkt[data_offset+ idx] << 24) | (pkt[data_offset+ idx + 1] << 16)  | (pkt[data_offset+ idx + 2] << 8)  | (pkt[data_offset+ idx + 3]);
+
+        if (!((idx / 4) % 8))
+            DISPPRINT("%s: %s%s", prefixstr, tloffstr, fmtdatastr);
+
+        DISPPRINT("%08x",wdata);
+
+        if (((idx / 4) % 8) == 7)
+        {
+            DISPPRINT("%s\n", fmtnormstr);
+        }
+        else
+        {
+            DISPPRINT(" ");
+        }
+    }
+
+    if ((idx/4)%8)
+        DISPPRINT("%s\n", fmtnormstr);
+}
+
+// -------------------------------------------------------------------------
+// DispTlpCrc()
+//
+// Check and display a TLP's ECRC (if present) and LCRC. The CRCs in the
+// packet are regenerated in place.
+// -------------------------------------------------------------------------
+
+static inline void DispTlpCrc (const char *prefixstr, const char *tloffstr, const char *dlloffstr,
+                               const uint32_t tl_td, PktData_t *pkt)
+{
+    PktData_t tl_type = pkt[3] & 0x7f;
+
+    // Calculate LCRC and ECRC (if present)
+    uint32_t crc[4], ecrc[4];
+    uint32_t exp_lcrc, got_lcrc;
+    uint32_t exp_ecrc = 0, got_ecrc = 0;
+
+    unsigned lcrc_offset = 15 + 4 * (((tl_type & TL_TYPE_WRITE) ? GET_TLP_LENGTH(pkt) : 0) + TLP_HAS_DIGEST(pkt) + TLP_HDR_4DW(pkt));
+    crc[0] = pkt[lcrc_offset+0];
+    crc[1] = pkt[lcrc_offset+1];
+    crc[2] = pkt[lcrc_offset+2];
+    crc[3] = pkt[lcrc_offset+3];
+    CalcLcrc(pkt);
+
+    exp_lcrc = ((uint32_t)pkt[lcrc_offset+0] << 24) | ((uint32_t)pkt[lcrc_offset+1] << 16) | ((uint32_t)pkt[lcrc_offset+2] << 8) | ((uint32_t)pkt[lcrc_offset+3]);
+    got_lcrc = ((uint32_t)crc[0] << 24) | ((uint32_t)crc[1] << 16) | ((uint32_t)crc[2] << 8) | ((uint32_t)crc[3]);
+
+    if (TLP_HAS_DIGEST(pkt))
+    {
+        unsigned ecrc_offset = lcrc_offset - 4;
+        ecrc[0] = pkt[ecrc_offset+0];
+        ecrc[1] = pkt[ecrc_offset+1];
+        ecrc[2] = pkt[ecrc_offset+2];
+        ecrc[3] = pkt[ecrc_offset+3];
+        CalcEcrc(pkt);
+        exp_ecrc = ((uint32_t)pkt[ecrc_offset+0] << 24) | ((uint32_t)pkt[ecrc_offset+1] << 16) | ((uint32_t)pkt[ecrc_offset+2] << 8) | ((uint32_t)pkt[ecrc_offset+3]);
+        got_ecrc = ((uint32_t)ecrc[0] << 24) | ((uint32_t)ecrc[1] << 16) | ((uint32_t)ecrc[2] << 8) | ((uint32_t)ecrc[3]);
+    }
+
+    if (tl_td)
+    {
+        if (got_ecrc == exp_ecrc)
+        {
+            DISPPRINT("%s: %sTL Good ECRC (%08x)\n", prefixstr, tloffstr, got_ecrc);
+        }
+        else
+        {
+            DISPPRINT("%s: %sTL %s**Bad ECRC**%s (%08x v %08x)\n", prefixstr, tloffstr, fmterrstr, fmtnormstr, got_ecrc, exp_ecrc);
+        }
+    }
+    else
+    {
+        DISPPRINT("%s: %sTL No ECRC\n", prefixstr, tloffstr);
+    }
+    if (got_lcrc == exp_lcrc)
+    {
+        DISPPRINT("%s: %sDL Good LCRC (%08x)\n", prefixstr, dlloffstr, got_lcrc);
+    }
+    else
+    {
+        DISPPRINT("%s: %sDL%s **Bad LCRC%s** (%08x v %08x)\n", prefixstr, dlloffstr, fmterrstr, fmtnormstr, got_lcrc, exp_lcrc);
+    }
+}
+
+#endif
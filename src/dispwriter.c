@@ -0,0 +1,393 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Asynchronous link display writer. When enabled, display output
+// is formatted into a per node line buffer and complete lines are
+// pushed into a single producer/single consumer ring, without
+// locks. A background thread drains the rings to stdout, so the
+// stream I/O is off the simulation thread. Each node's lines are
+// written in the order produced. When a ring is full, the producer
+// either waits for space (DISP_ASYNC_BLOCK) or drops the line and
+// counts it (DISP_ASYNC_DROP). Other output (VPrint(), see pcie.h) waits
+// for the queued lines to be written first, so the two stay in order.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdarg.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+// Use the underlying VPrint() here, without waiting on the writer
+#define PCIE_VPRINT_DIRECT
+
+#include "pcie.h"
+#include "pcie_utils.h"
+#include "displink.h"
+#include "dispwriter.h"
+
+// -------------------------------------------------------------------------
+// TYPEDEFS
+// -------------------------------------------------------------------------
+
+typedef struct {
+    char     buf[DISP_RING_SIZE];
+    uint64_t head;                    // Written by producer only
+    uint64_t tail;                    // Written by writer thread only
+    uint32_t drops;                   // Lines dropped
+
+    // Producer side partial line
+    char     line[DISP_LINE_SIZE];
+    int      linelen;
+} DispRing_t, *pDispRing_t;
+
+// -------------------------------------------------------------------------
+// STATICS
+// -------------------------------------------------------------------------
+
+volatile int         DispWriterMode = DISP_ASYNC_OFF;
+bool                 DispWriterHeld[VP_MAX_NODES];
+
+static pDispRing_t   rings[VP_MAX_NODES];
+static pthread_t     writer;
+static volatile bool writer_running  = false;
+static volatile bool writer_stop     = false;
+
+// -------------------------------------------------------------------------
+// DrainRing()
+//
+// Write out all queued data in a ring. Returns true if anything written.
+//
+// -------------------------------------------------------------------------
+
+static bool DrainRing (const pDispRing_t ring)
+{
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = ring->tail;
+
+    if (head == tail)
+    {
+        return false;
+    }
+
+    uint32_t offset = tail & (DISP_RING_SIZE - 1);
+    uint64_t len    = head - tail;
+
+    // Write in up to two parts if the data wraps
+    if (offset + len > DISP_RING_SIZE)
+    {
+        fwrite(&ring->buf[offset], 1, DISP_RING_SIZE - offset, stdout);
+        fwrite(ring->buf, 1, len - (DISP_RING_SIZE - offset), stdout);
+    }
+    else
+    {
+        fwrite(&ring->buf[offset], 1, len, stdout);
+    }
+
+    __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+// -------------------------------------------------------------------------
+// WriterThread()
+//
+// Background thread draining the node rings until stopped and empty
+//
+// -------------------------------------------------------------------------
+
+static void* WriterThread (void* arg __attribute__((unused)))
+{
+    bool written, stopping;
+
+    for (;;)
+    {
+        // Sample the stop request before draining, so that everything
+        // queued before the request is written before exiting
+        stopping = writer_stop;
+        written  = false;
+
+        for (int node = 0; node < VP_MAX_NODES; node++)
+        {
+            pDispRing_t ring = __atomic_load_n(&rings[node], __ATOMIC_ACQUIRE);
+
+            if (ring != NULL)
+            {
+                written |= DrainRing(ring);
+            }
+        }
+
+        if (written)
+        {
+            fflush(stdout);
+        }
+        else if (stopping)
+        {
+            break;
+        }
+        else
+        {
+            usleep(DISP_WRITER_SLEEP_US);
+        }
+    }
+
+    return NULL;
+}
+
+// -------------------------------------------------------------------------
+// PushLine()
+//
+// Copy a line into a node's ring, waiting for space or dropping it,
+// depending on the mode. If the writer is stopped meanwhile, the line
+// is written directly, after anything left in the ring.
+//
+// -------------------------------------------------------------------------
+
+static void PushLine (const pDispRing_t ring, const char* line, const int len)
+{
+    uint64_t head = ring->head;
+
+    for (;;)
+    {
+        // The mode is only set off once the writer thread has exited, so
+        // the ring can safely be drained here
+        if (DispWriterMode == DISP_ASYNC_OFF)
+        {
+            DrainRing(ring);
+            fwrite(line, 1, len, stdout);
+            return;
+        }
+
+        if ((head + len - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) <= DISP_RING_SIZE)
+        {
+            break;
+        }
+
+        if (DispWriterMode == DISP_ASYNC_DROP)
+        {
+            ring->drops++;
+            return;
+        }
+
+        sched_yield();
+    }
+
+    uint32_t offset = head & (DISP_RING_SIZE - 1);
+
+    if (offset + len > DISP_RING_SIZE)
+    {
+        memcpy(&ring->buf[offset], line, DISP_RING_SIZE - offset);
+        memcpy(ring->buf, &line[DISP_RING_SIZE - offset], len - (DISP_RING_SIZE - offset));
+    }
+    else
+    {
+        memcpy(&ring->buf[offset], line, len);
+    }
+
+    __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+}
+
+// -------------------------------------------------------------------------
+// DispWriterPrintf()
+//
+// Format display output for a node, queuing each line once complete.
+// Must only be called from the node's own thread. The display also
+// comes here when synchronous while the node holds a partial line
+// (DispWriterHeld), so that the line is completed in order.
+//
+// -------------------------------------------------------------------------
+
+void DispWriterPrintf (const int node, const char* fmt, ...)
+{
+    va_list     args;
+    char        buf[DISP_LINE_SIZE];
+    int         len;
+    pDispRing_t ring = rings[node];
+
+    if (ring == NULL)
+    {
+        if ((ring = calloc(1, sizeof(DispRing_t))) == NULL)
+        {
+            VPrint("DispWriterPrintf: %s***Error --- memory allocation failure at node %d%s\n", fmterrstr, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+            return;
+        }
+        __atomic_store_n(&rings[node], ring, __ATOMIC_RELEASE);
+    }
+
+    va_start(args, fmt);
+    len = vsnprintf(buf, DISP_LINE_SIZE, fmt, args);
+    va_end(args);
+
+    len = (len < DISP_LINE_SIZE) ? len : DISP_LINE_SIZE - 1;
+
+    for (int idx = 0; idx < len; idx++)
+    {
+        ring->line[ring->linelen++] = buf[idx];
+
+        // Queue at the end of a line, or if the line buffer is full
+        if (buf[idx] == '\n' || ring->linelen == DISP_LINE_SIZE)
+        {
+            PushLine(ring, ring->line, ring->linelen);
+            ring->linelen = 0;
+        }
+    }
+
+    DispWriterHeld[node] = ring->linelen != 0;
+}
+
+// -------------------------------------------------------------------------
+// DispWriterFlush()
+//
+// Queue (or write, if synchronous) any partial display line held for a
+// node. Must only be called from the node's own thread, or once the node
+// threads are suspended at exit.
+//
+// -------------------------------------------------------------------------
+
+void DispWriterFlush (const int node)
+{
+    pDispRing_t ring = rings[node];
+
+    if (ring != NULL && ring->linelen)
+    {
+        PushLine(ring, ring->line, ring->linelen);
+        ring->linelen        = 0;
+        DispWriterHeld[node] = false;
+    }
+}
+
+// -------------------------------------------------------------------------
+// DispWriterSync()
+//
+// Wait for all display output queued so far to be written, so that
+// output written directly to stdout stays in order with it
+//
+// -------------------------------------------------------------------------
+
+void DispWriterSync (void)
+{
+    uint64_t heads[VP_MAX_NODES];
+
+    if (!writer_running)
+    {
+        return;
+    }
+
+    for (int node = 0; node < VP_MAX_NODES; node++)
+    {
+        pDispRing_t ring = __atomic_load_n(&rings[node], __ATOMIC_ACQUIRE);
+
+        heads[node] = (ring != NULL) ? __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) : 0;
+    }
+
+    for (int node = 0; node < VP_MAX_NODES; node++)
+    {
+        pDispRing_t ring = __atomic_load_n(&rings[node], __ATOMIC_ACQUIRE);
+
+        while (ring != NULL && writer_running && (int64_t)(heads[node] - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) > 0)
+        {
+            sched_yield();
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// DispWriterStop()
+//
+// Stop the writer thread, once all queued output is written, and
+// return to synchronous display output, reporting dropped line counts.
+// Partial lines stay with their nodes, to be completed by the node's
+// own output, or flushed when the node finishes (PcieFinish()).
+//
+// -------------------------------------------------------------------------
+
+void DispWriterStop (void)
+{
+    if (writer_running)
+    {
+        writer_stop = true;
+        pthread_join(writer, NULL);
+        writer_running = false;
+    }
+
+    DispWriterMode = DISP_ASYNC_OFF;
+
+    for (int node = 0; node < VP_MAX_NODES; node++)
+    {
+        if (rings[node] != NULL && rings[node]->drops)
+        {
+            VPrint("DispWriterStop: %d display lines dropped at node %d\n", rings[node]->drops, node);
+        }
+    }
+
+    fflush(stdout);
+}
+
+// -------------------------------------------------------------------------
+// DispWriterConfig()
+//
+// Select display writer mode, starting or stopping the writer thread
+// as required
+//
+// -------------------------------------------------------------------------
+
+void DispWriterConfig (const int mode)
+{
+    if (mode == DISP_ASYNC_OFF)
+    {
+        DispWriterStop();
+        return;
+    }
+
+    if (!writer_running)
+    {
+        writer_stop = false;
+
+        if (pthread_create(&writer, NULL, WriterThread, NULL))
+        {
+            VPrint("DispWriterConfig: %s***Warning --- could not start writer thread. Display output remains synchronous%s\n", fmterrstr, fmtnormstr);
+            return;
+        }
+
+        writer_running = true;
+    }
+
+    DispWriterMode = mode;
+}
+
+// -------------------------------------------------------------------------
+// DispWriterDrops()
+//
+// Return number of display lines dropped for a node
+//
+// -------------------------------------------------------------------------
+
+uint32_t DispWriterDrops (const int node)
+{
+    return (rings[node] != NULL) ? rings[node]->drops : 0;
+}
@@ -0,0 +1,69 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Asynchronous link display writer header
+//
+//=============================================================
+
+#ifndef _DISPWRITER_H_
+#define _DISPWRITER_H_
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdint.h>
+
+// -------------------------------------------------------------------------
+// DEFINES
+// -------------------------------------------------------------------------
+
+// Per node ring size (must be a power of 2) and maximum line length
+#define DISP_RING_SIZE               (256*1024)
+#define DISP_LINE_SIZE               1024
+
+// Writer thread poll period when all rings are empty
+#define DISP_WRITER_SLEEP_US         200
+
+// -------------------------------------------------------------------------
+// EXTERNAL REFERENCES
+// -------------------------------------------------------------------------
+
+// Current mode (DISP_ASYNC_xxx). Display output is queued when not DISP_ASYNC_OFF
+extern volatile int DispWriterMode;
+
+// Per node flag for a partial display line held in the node's line buffer
+extern bool         DispWriterHeld[];
+
+// -------------------------------------------------------------------------
+// PROTOTYPES
+// -------------------------------------------------------------------------
+
+extern void     DispWriterConfig (const int mode);
+extern void     DispWriterStop   (void);
+extern void     DispWriterSync   (void);
+extern void     DispWriterPrintf (const int node, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+extern void     DispWriterFlush  (const int node);
+extern uint32_t DispWriterDrops  (const int node);
+
+#endif
@@ -755,6 +755,25 @@ void InitLink(const int link_width, const int node)
     InitLinkGen(link_width, TS_DATA_RATE_GEN1, node);
 }
 
+// -------------------------------------------------------------------------
+// RetrainLink()
+//
+// Retrain an active link, through Recovery and back to L0. Called on
+// a REPLAY_NUM rollover when enabled (CONFIG_REPLAY_RETRAIN), and the
+// link partner must also enter Recovery.
+//
+// -------------------------------------------------------------------------
+
+void RetrainLink(const int node)
+{
+    int ltssm_state = LTSSM_RECOVERY;
+
+    do
+    {
+        ltssm_state = LinkState(ltssm_state, LTSSM_L0, 0, TS_DATA_RATE_GEN1, node);
+    } while (ltssm_state != LTSSM_L0);
+}
+
 // -------------------------------------------------------------------------
 // ConfigLinkInit()
 //
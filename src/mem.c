@@ -25,18 +25,33 @@
 // INCLUDES
 // -------------------------------------------------------------------------
 #include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+// POSIX shared memory backing of the memory pages (MemSharedOpen()) is not
+// available on Windows
+#if !defined(_WIN32)
+#define MEM_SHM_SUPPORTED
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include "pcie.h"
 #include "pcie_vhost_map.h"
 #include "displink.h"
+#include "pcie_kernels.h"
 
 // -------------------------------------------------------------------------
 // STATICS
 // -------------------------------------------------------------------------
 
 static pPrimaryTbl_t PrimaryTable[VP_MAX_NODES];
-static uint8_t       **pCfgSpace       = NULL;
-static uint8_t       **pCfgSpaceMask   = NULL;
+static pCfgFunc_t    *CfgFuncs[VP_MAX_NODES];
+static MemShm_t      MemShm[VP_MAX_NODES];
+static BarDecode_t   BarDecode[VP_MAX_NODES];
 
 // -------------------------------------------------------------------------
 // InitialiseMem()
@@ -63,7 +78,7 @@ void InitialiseMem (int node)
 
 static void InitialisePrimaryTable (const pPrimaryTbl_t table)
 {
-    int i;
+    uint32_t i;
 
     for (i = 0; i < TABLESIZE; i++)
     {
@@ -80,7 +95,7 @@ static void InitialisePrimaryTable (const pPrimaryTbl_t table)
 
 static void InitialiseTable (char **table)
 {
-    int i;
+    uint32_t i;
 
     for (i = 0; i < TABLESIZE; i++)
     {
@@ -133,33 +148,387 @@ static uint32_t GenHash12(const uint64_t addr)
 }
 
 // -------------------------------------------------------------------------
-// WriteRamByteBlock()
+// MemShmGetPage()
 //
-// Write a block of data to memory
+// Returns a pointer to the shared memory page for the given address, or
+// NULL if no shared memory object is open for the node, or the page is not
+// present and create is false. The directory is searched so that pages
+// allocated by an external process are found.
 //
 // -------------------------------------------------------------------------
 
-void WriteRamByteBlock(const uint64_t addr, const PktData_t *data, const int fbe, int const lbe, const int length, const uint32_t node)
+static uint8_t* MemShmGetPage(const uint64_t addr, const bool create, const uint32_t node)
 {
-    uint32_t pidx, sidx, offset;
-    int idx;
+    pMemShm_t shm  = &MemShm[node];
+    uint64_t  page = addr & MEM_SHM_DIR_ADDR_MASK;
+    uint64_t  entry;
+    uint32_t  used, idx;
 
-    idx = pidx = GenHash12(addr);
-    sidx = (addr >> 12) & TABLEMASK;
-    offset = addr & TABLEMASK;
+    if (shm->hdr == NULL)
+    {
+        return NULL;
+    }
 
-    if ((addr & ~TABLEMASK) != ((addr + length - 1) & ~TABLEMASK))
+    used = __atomic_load_n(&shm->hdr->used_pages, __ATOMIC_ACQUIRE);
+    used = (used > shm->hdr->num_pages) ? shm->hdr->num_pages : used;
+
+    for (idx = 0; idx < used; idx++)
     {
-        VPrint("WriteRamByteBlock: %s***Error --- block write crosses 4K boundary (addr=0x%llx len=0x%x%s\n", FMT_RED, (long long unsigned)addr, length, FMT_NORMAL);
+        entry = __atomic_load_n(&shm->dir[idx], __ATOMIC_ACQUIRE);
+
+        if ((entry & MEM_SHM_DIR_VALID) && (entry & MEM_SHM_DIR_ADDR_MASK) == page)
+        {
+            return &shm->data[(size_t)idx * shm->hdr->page_size];
+        }
+    }
+
+    if (!create)
+    {
+        return NULL;
+    }
+
+    idx = __atomic_fetch_add(&shm->hdr->used_pages, 1, __ATOMIC_ACQ_REL);
+
+    if (idx >= shm->hdr->num_pages)
+    {
+        VPrint("MemShmGetPage: %s***Error --- ran out of shared memory pages (%d) at node %d%s\n", FMT_RED, shm->hdr->num_pages, node, FMT_NORMAL);
         VWrite(PVH_FATAL, 0, 0, node);
+        return NULL;
+    }
+
+    __atomic_store_n(&shm->dir[idx], page | MEM_SHM_DIR_VALID, __ATOMIC_RELEASE);
+
+    return &shm->data[(size_t)idx * shm->hdr->page_size];
+}
+
+// -------------------------------------------------------------------------
+// MemLocalBlocks()
+//
+// Returns the number of the node's memory blocks held locally (not in a
+// shared memory object), filling in their table slots and addresses in
+// blks, if not NULL
+//
+// -------------------------------------------------------------------------
+
+static uint32_t MemLocalBlocks(const pMemShmMove_t blks, const uint32_t node)
+{
+    uint32_t pidx, sidx, nblks = 0;
+
+    if (PrimaryTable[node] == NULL)
+    {
+        return 0;
+    }
+
+    for (pidx = 0; pidx < TABLESIZE; pidx++)
+    {
+        if (PrimaryTable[node][pidx].valid && PrimaryTable[node][pidx].p != NULL)
+        {
+            for (sidx = 0; sidx < TABLESIZE; sidx++)
+            {
+                if ((PrimaryTable[node][pidx].p)[sidx] != NULL)
+                {
+                    if (blks != NULL)
+                    {
+                        blks[nblks].slot = &(PrimaryTable[node][pidx].p)[sidx];
+                        blks[nblks].addr = PrimaryTable[node][pidx].addr | ((uint64_t)sidx << 12);
+                    }
+                    nblks++;
+                }
+            }
+        }
+    }
+
+    return nblks;
+}
+
+// -------------------------------------------------------------------------
+// MemShmDetach()
+//
+// Unmap a node's shared memory object after a failed open, removing it
+// if it was created by the open
+//
+// -------------------------------------------------------------------------
+
+static void MemShmDetach(const pMemShm_t shm)
+{
+    munmap(shm->hdr, shm->size);
+
+    if (shm->owner)
+    {
+        shm_unlink(shm->name);
+    }
+
+    shm->hdr  = NULL;
+    shm->dir  = NULL;
+    shm->data = NULL;
+}
+
+// -------------------------------------------------------------------------
+// MemSharedOpen()
+//
+// Back the node's memory pages with a POSIX shared memory object, so
+// that other processes may access the memory contents directly. If name
+// is NULL, a default of /pcievhost_mem<node> is used. If the object
+// already exists (and has a valid header) it is attached to, otherwise
+// it is created with space for the specified number of 4K pages. Any
+// pages already written are moved into the object, except where an
+// existing object already has a page at the same address, which is kept.
+//
+// -------------------------------------------------------------------------
+
+int MemSharedOpen(const char* name, const uint32_t pages, const uint32_t node)
+{
+#if !defined(MEM_SHM_SUPPORTED)
+    VPrint("MemSharedOpen: %s***Error --- shared memory not supported on this platform at node %d%s\n", FMT_RED, node, FMT_NORMAL);
+    return MEM_BAD_STATUS;
+#else
+    pMemShm_t    shm = &MemShm[node];
+    pMemShmHdr_t hdr;
+    struct stat  sb;
+    pMemShmMove_t blks;
+    uint32_t     num_pages, dir_offset, data_offset, free_pages, nblks, bidx, conflicts = 0;
+    int          fd;
+    void*        base;
+
+    if (shm->hdr != NULL)
+    {
+        VPrint("MemSharedOpen: %s***Error --- shared memory already open at node %d%s\n", FMT_RED, node, FMT_NORMAL);
+        return MEM_BAD_STATUS;
+    }
+
+    if (name == NULL)
+    {
+        snprintf(shm->name, MEM_SHM_NAME_SIZE, MEM_SHM_DEFAULT_NAME, node);
+    }
+    else
+    {
+        snprintf(shm->name, MEM_SHM_NAME_SIZE, "%s", name);
+    }
+
+    num_pages   = pages ? pages : MEM_SHM_DEFAULT_PAGES;
+    dir_offset  = (sizeof(MemShmHdr_t) + 63) & ~63U;
+    data_offset = (dir_offset + num_pages * sizeof(uint64_t) + MEM_SHM_PAGE_SIZE - 1) & ~(MEM_SHM_PAGE_SIZE - 1);
+
+    if ((fd = shm_open(shm->name, O_RDWR | O_CREAT | O_EXCL, 0666)) >= 0)
+    {
+        shm->owner = true;
+        shm->size  = (size_t)data_offset + (size_t)num_pages * MEM_SHM_PAGE_SIZE;
+
+        if (ftruncate(fd, shm->size) != 0)
+        {
+            VPrint("MemSharedOpen: %s***Error --- failed to size %s (%s)%s\n", FMT_RED, shm->name, strerror(errno), FMT_NORMAL);
+            close(fd);
+            shm_unlink(shm->name);
+            return MEM_BAD_STATUS;
+        }
+    }
+    else if (errno == EEXIST && (fd = shm_open(shm->name, O_RDWR, 0)) >= 0)
+    {
+        shm->owner = false;
+
+        if (fstat(fd, &sb) != 0 || sb.st_size < (off_t)sizeof(MemShmHdr_t))
+        {
+            VPrint("MemSharedOpen: %s***Error --- existing object %s is invalid%s\n", FMT_RED, shm->name, FMT_NORMAL);
+            close(fd);
+            return MEM_BAD_STATUS;
+        }
+
+        shm->size = sb.st_size;
+    }
+    else
+    {
+        VPrint("MemSharedOpen: %s***Error --- failed to open %s (%s)%s\n", FMT_RED, shm->name, strerror(errno), FMT_NORMAL);
+        return MEM_BAD_STATUS;
     }
 
+    base = mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED)
+    {
+        VPrint("MemSharedOpen: %s***Error --- failed to map %s (%s)%s\n", FMT_RED, shm->name, strerror(errno), FMT_NORMAL);
+        if (shm->owner)
+        {
+            shm_unlink(shm->name);
+        }
+        return MEM_BAD_STATUS;
+    }
+
+    hdr = (pMemShmHdr_t)base;
+
+    if (shm->owner)
+    {
+        // New object is zero filled, so only header fields need setting.
+        // Magic number is written last, to mark header as valid.
+        hdr->version     = MEM_SHM_VERSION;
+        hdr->page_size   = MEM_SHM_PAGE_SIZE;
+        hdr->num_pages   = num_pages;
+        hdr->node        = node;
+        hdr->dir_offset  = dir_offset;
+        hdr->data_offset = data_offset;
+        hdr->used_pages  = 0;
+        __atomic_store_n(&hdr->magic, MEM_SHM_MAGIC, __ATOMIC_RELEASE);
+    }
+    else if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != MEM_SHM_MAGIC || hdr->version != MEM_SHM_VERSION ||
+             hdr->page_size != MEM_SHM_PAGE_SIZE ||
+             ((size_t)hdr->data_offset + (size_t)hdr->num_pages * hdr->page_size) > shm->size)
+    {
+        VPrint("MemSharedOpen: %s***Error --- existing object %s has an incompatible layout%s\n", FMT_RED, shm->name, FMT_NORMAL);
+        munmap(base, shm->size);
+        return MEM_BAD_STATUS;
+    }
+
+    shm->hdr  = hdr;
+    shm->dir  = (uint64_t*)((uint8_t*)base + hdr->dir_offset);
+    shm->data = (uint8_t*)base + hdr->data_offset;
+
+    // Move any existing memory blocks into the shared memory object. When attaching
+    // to an existing object, a page already in the object is kept in place of the
+    // local block, so that another process's data is not overwritten. The blocks'
+    // pages are all found, or allocated and filled, before any block is replaced,
+    // so that on failure the local memory is left as it was.
+    if ((nblks = MemLocalBlocks(NULL, node)) != 0)
+    {
+        if ((blks = malloc(nblks * sizeof(MemShmMove_t))) == NULL)
+        {
+            VPrint("MemSharedOpen: %s***Error --- memory allocation failure at node %d%s\n", FMT_RED, node, FMT_NORMAL);
+            MemShmDetach(shm);
+            return MEM_BAD_STATUS;
+        }
+
+        MemLocalBlocks(blks, node);
+
+        for (bidx = 0; bidx < nblks; bidx++)
+        {
+            blks[bidx].page = shm->owner ? NULL : MemShmGetPage(blks[bidx].addr, false, node);
+            conflicts      += blks[bidx].page != NULL;
+        }
+
+        free_pages = hdr->num_pages - __atomic_load_n(&hdr->used_pages, __ATOMIC_ACQUIRE);
+
+        if (hdr->used_pages > hdr->num_pages || (nblks - conflicts) > free_pages)
+        {
+            VPrint("MemSharedOpen: %s***Error --- too few free pages in %s for the %u memory blocks at node %d%s\n",
+                   FMT_RED, shm->name, nblks - conflicts, node, FMT_NORMAL);
+            free(blks);
+            MemShmDetach(shm);
+            return MEM_BAD_STATUS;
+        }
+
+        for (bidx = 0; bidx < nblks; bidx++)
+        {
+            if (blks[bidx].page == NULL)
+            {
+                if ((blks[bidx].page = MemShmGetPage(blks[bidx].addr, true, node)) == NULL)
+                {
+                    VPrint("MemSharedOpen: %s***Error --- no shared memory page for block at 0x%llx in %s at node %d%s\n",
+                           FMT_RED, (long long unsigned)blks[bidx].addr, shm->name, node, FMT_NORMAL);
+                    free(blks);
+                    MemShmDetach(shm);
+                    return MEM_BAD_STATUS;
+                }
+
+                memcpy(blks[bidx].page, *blks[bidx].slot, TABLESIZE);
+            }
+        }
+
+        for (bidx = 0; bidx < nblks; bidx++)
+        {
+            free(*blks[bidx].slot);
+            *blks[bidx].slot = (char*)blks[bidx].page;
+        }
+
+        free(blks);
+    }
+
+    if (conflicts)
+    {
+        VPrint("MemSharedOpen: %s***Warning --- %u local pages already present in %s discarded at node %d%s\n",
+               FMT_RED, conflicts, shm->name, node, FMT_NORMAL);
+    }
+
+    return MEM_GOOD_STATUS;
+#endif
+}
+
+// -------------------------------------------------------------------------
+// MemSharedClose()
+//
+// Detach the node's memory from its shared memory object, optionally
+// removing the object. The memory pages that were held in the object are
+// no longer accessible to the model afterwards.
+//
+// -------------------------------------------------------------------------
+
+void MemSharedClose(const bool unlink_obj, const uint32_t node)
+{
+#if defined(MEM_SHM_SUPPORTED)
+    pMemShm_t shm = &MemShm[node];
+    uint8_t*  end;
+    uint32_t  pidx, sidx;
+
+    if (shm->hdr == NULL)
+    {
+        return;
+    }
+
+    end = shm->data + (size_t)shm->hdr->num_pages * shm->hdr->page_size;
+
+    // Remove all references to pages in the object
+    if (PrimaryTable[node] != NULL)
+    {
+        for (pidx = 0; pidx < TABLESIZE; pidx++)
+        {
+            if (PrimaryTable[node][pidx].valid && PrimaryTable[node][pidx].p != NULL)
+            {
+                for (sidx = 0; sidx < TABLESIZE; sidx++)
+                {
+                    uint8_t* blk = (uint8_t*)(PrimaryTable[node][pidx].p)[sidx];
+
+                    if (blk >= shm->data && blk < end)
+                    {
+                        (PrimaryTable[node][pidx].p)[sidx] = NULL;
+                    }
+                }
+            }
+        }
+    }
+
+    munmap(shm->hdr, shm->size);
+
+    if (unlink_obj)
+    {
+        shm_unlink(shm->name);
+    }
+
+    shm->hdr  = NULL;
+    shm->dir  = NULL;
+    shm->data = NULL;
+#endif
+}
+
+// -------------------------------------------------------------------------
+// MemBlockSlot()
+//
+// Returns a pointer to the secondary table entry for the 4K block
+// holding addr, creating the primary table entry and secondary table
+// if not yet present
+//
+// -------------------------------------------------------------------------
+
+static char** MemBlockSlot(const uint64_t addr, const char* caller, const uint32_t node)
+{
+    uint32_t pidx, sidx, idx;
+
+    idx = pidx = GenHash12(addr);
+    sidx = (addr >> 12) & TABLEMASK;
+
     // No primary table, so allocate some space for one and initialise
     if (PrimaryTable[node] == NULL)
     {
         if ((PrimaryTable[node] = malloc(TABLESIZE * sizeof(PrimaryTbl_t))) == NULL)
         {
-            VPrint("WriteRamByteBlock: %s***Error --- failed to allocate primary table memory%s\n", FMT_RED, FMT_NORMAL);
+            VPrint("%s: %s***Error --- failed to allocate primary table memory%s\n", caller, FMT_RED, FMT_NORMAL);
             VWrite(PVH_FATAL, 0, 0, node);
         }
         InitialisePrimaryTable(PrimaryTable[node]);
@@ -173,7 +542,7 @@ void WriteRamByteBlock(const uint64_t addr, const PktData_t *data, const int fbe
         // If we have searched through the whole table....
         if (pidx == idx)
         {
-            VPrint("WriteRamByteBlock: %s***Error --- ran out of primary table space%s\n", FMT_RED, FMT_NORMAL);
+            VPrint("%s: %s***Error --- ran out of primary table space%s\n", caller, FMT_RED, FMT_NORMAL);
             VWrite(PVH_FATAL, 0, 0, node);
         }
     }
@@ -191,31 +560,53 @@ void WriteRamByteBlock(const uint64_t addr, const PktData_t *data, const int fbe
     {
         if ((PrimaryTable[node][pidx].p = malloc(TABLESIZE * sizeof(uint32_t *))) == NULL)
         {
-            VPrint("WriteRamByteBlock: %s***Error --- failed to allocate secondary table memory%s\n", FMT_RED, FMT_NORMAL);
+            VPrint("%s: %s***Error --- failed to allocate secondary table memory%s\n", caller, FMT_RED, FMT_NORMAL);
             VWrite(PVH_FATAL, 0, 0, node);
         }
         InitialiseTable(PrimaryTable[node][pidx].p);
     }
 
-    // No memory block allocated, so allocate some space
-    if ((PrimaryTable[node][pidx].p)[sidx] == NULL)
+    return &(PrimaryTable[node][pidx].p)[sidx];
+}
+
+// -------------------------------------------------------------------------
+// WriteRamByteBlock()
+//
+// Write a block of data to memory
+//
+// -------------------------------------------------------------------------
+
+void WriteRamByteBlock(const uint64_t addr, const PktData_t *data, const int fbe, int const lbe, const int length, const uint32_t node)
+{
+    uint32_t offset = addr & TABLEMASK;
+    char**   slot;
+
+    if ((addr & ~TABLEMASK) != ((addr + length - 1) & ~TABLEMASK))
     {
-        if (((PrimaryTable[node][pidx].p)[sidx] = malloc(TABLESIZE)) == NULL)
-        {
-            VPrint("WriteRamByteBlock: %s***Error --- failed to allocate memory%s\n", FMT_RED, FMT_NORMAL);
-            VWrite(PVH_FATAL, 0, 0, node);
-        }
+        VPrint("WriteRamByteBlock: %s***Error --- block write crosses 4K boundary (addr=0x%llx len=0x%x%s\n", FMT_RED, (long long unsigned)addr, length, FMT_NORMAL);
+        VWrite(PVH_FATAL, 0, 0, node);
     }
 
-    for (idx = 0; idx < length; idx++)
+    slot = MemBlockSlot(addr, "WriteRamByteBlock", node);
+
+    // No memory block allocated, so allocate some space (from the shared memory object, if open)
+    if (*slot == NULL)
     {
-        if ( (idx < 4 && ((1<<idx) & fbe)) ||
-             (idx >= (length-4) && ((1<<(4-(length-idx))) & lbe)) ||
-             (idx >= 4 && idx < (length-4)))
+        if (MemShm[node].hdr != NULL)
         {
-            ((char *)((PrimaryTable[node][pidx].p)[sidx]))[idx+offset] = data[idx];
+            if ((*slot = (char *)MemShmGetPage(addr, true, node)) == NULL)
+            {
+                return;
+            }
+        }
+        else if ((*slot = malloc(TABLESIZE)) == NULL)
+        {
+            VPrint("WriteRamByteBlock: %s***Error --- failed to allocate memory%s\n", FMT_RED, FMT_NORMAL);
+            VWrite(PVH_FATAL, 0, 0, node);
         }
     }
+
+    PcieKernelMaskedStore(&((uint8_t *)*slot)[offset], data, fbe, lbe, length);
 }
 
 // -------------------------------------------------------------------------
@@ -227,14 +618,16 @@ void WriteRamByteBlock(const uint64_t addr, const PktData_t *data, const int fbe
 
 int ReadRamByteBlock(const uint64_t addr, PktData_t *data, const int length, const uint32_t node)
 {
-    uint32_t pidx, sidx, offset;
-    int idx, len;
+    uint32_t    pidx, sidx, offset, idx;
+    uint8_t*    blk    = NULL;
+    char**      slot   = NULL;
+    const char* errstr = NULL;
 
     idx = pidx = GenHash12(addr);
     sidx = (addr >> 12) & TABLEMASK;
     offset = addr & TABLEMASK;
 
-    if ((addr & ~TABLEMASK) != ((addr + length) & ~TABLEMASK))
+    if ((addr & ~TABLEMASK) != ((addr + length - 1) & ~TABLEMASK))
     {
         VPrint("ReadRamByteBlock: %s***Error --- block read crosses 4K boundary%s\n", FMT_RED, FMT_NORMAL);
         VWrite(PVH_FATAL, 0, 0, node);
@@ -242,42 +635,57 @@ int ReadRamByteBlock(const uint64_t addr, PktData_t *data, const int length, con
 
     if (PrimaryTable[node] == NULL)
     {
-        VPrint("ReadRamByteBlock: %s***Error --- reading from uninitialised primary table%s\n", FMT_RED, FMT_NORMAL);
-        return MEM_BAD_STATUS;
+        errstr = "reading from uninitialised primary table";
     }
-
-    // Whilst we have detected a collision, increment primary offset until an invalid entry or we matched address
-    while (PrimaryTable[node][pidx].valid && PrimaryTable[node][pidx].addr != (addr & 0xffffffffff000000ULL))
+    else
     {
-        pidx = (pidx+1) % TABLESIZE;
+        // Whilst we have detected a collision, increment primary offset until an invalid entry or we matched address
+        while (PrimaryTable[node][pidx].valid && PrimaryTable[node][pidx].addr != (addr & 0xffffffffff000000ULL))
+        {
+            pidx = (pidx+1) % TABLESIZE;
+
+            // If we searched the whole table...
+            if (pidx == idx)
+            {
+                VPrint("ReadRamByteBlock: %s***Error --- address does not exist in primary table%s\n", FMT_RED, FMT_NORMAL);
+                VWrite(PVH_FATAL, 0, 0, node);
+            }
+        }
 
-        // If we searched the whole table...
-        if (pidx == idx)
+        // No secondary table, so flag an error
+        if (PrimaryTable[node][pidx].p == NULL)
         {
-            VPrint("ReadRamByteBlock: %s***Error --- address does not exist in primary table%s\n", FMT_RED, FMT_NORMAL);
-            VWrite(PVH_FATAL, 0, 0, node);
+            errstr = "reading from uninitialised secondary table";
+        }
+        // No memory block allocated, so flag an error
+        else if ((blk = (uint8_t *)(PrimaryTable[node][pidx].p)[sidx]) == NULL)
+        {
+            errstr = "reading from uninitialised memory block";
+            slot   = &(PrimaryTable[node][pidx].p)[sidx];
         }
     }
 
-    // No secondary table, so flag an error
-    if (PrimaryTable[node][pidx].p == NULL)
+    // A block not known locally may have been created by an external process in a
+    // shared memory object, so check there before flagging an error. A page found
+    // is added to the tables, so the object's directory is only searched once.
+    if (blk == NULL)
     {
-        VPrint("ReadRamByteBlock: %s***Error --- reading from uninitialised secondary table%s\n", FMT_RED, FMT_NORMAL);
-        return MEM_BAD_STATUS;
-    }
+        if ((blk = MemShmGetPage(addr, false, node)) == NULL)
+        {
+            VPrint("ReadRamByteBlock: %s***Error --- %s%s\n", FMT_RED, errstr, FMT_NORMAL);
+            return MEM_BAD_STATUS;
+        }
 
-    // No memory block allocated, so flag an error
-    if ((PrimaryTable[node][pidx].p)[sidx] == NULL)
-    {
-        VPrint("ReadRamByteBlock: %s***Error --- reading from uninitialised memory block%s\n", FMT_RED, FMT_NORMAL);
-        return MEM_BAD_STATUS;
-    }
+        if (slot == NULL)
+        {
+            slot = MemBlockSlot(addr, "ReadRamByteBlock", node);
+        }
 
-    for (idx = 0; idx < length; idx++)
-    {
-        data[idx] = ((char *)(PrimaryTable[node][pidx].p)[sidx])[idx+offset] & 0xff;
+        *slot = (char *)blk;
     }
 
+    PcieKernelWiden(data, &blk[offset], length);
+
     return MEM_GOOD_STATUS;
 }
 
@@ -474,10 +882,105 @@ uint64_t ReadRamDWord (const uint64_t addr, const int le, const uint32_t node)
     return data;
 }
 
+// -------------------------------------------------------------------------
+// GetCfgFunc()
+//
+// Return the config space state for a function of a node, allocating
+// it on first access if create is true. Returns NULL if the function
+// has no state and create is false.
+//
+// -------------------------------------------------------------------------
+
+static pCfgFunc_t GetCfgFunc (const uint32_t func, const bool create, const uint32_t node)
+{
+    if (CfgFuncs[node] == NULL)
+    {
+        if (!create)
+        {
+            return NULL;
+        }
+
+        DebugVPrint("GetCfgFunc: Allocate function table for node %d\n", node);
+
+        if ((CfgFuncs[node] = calloc(CFG_MAX_FUNCS, sizeof(pCfgFunc_t))) == NULL)
+        {
+            VPrint("GetCfgFunc: %s***Error --- failed to allocate config space function table%s\n", FMT_RED, FMT_NORMAL);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+    }
+
+    if (CfgFuncs[node][func] == NULL && create)
+    {
+        DebugVPrint("GetCfgFunc: Allocate state for function %d at node %d\n", func, node);
+
+        if ((CfgFuncs[node][func] = calloc(1, sizeof(CfgFunc_t))) == NULL)
+        {
+            VPrint("GetCfgFunc: %s***Error --- failed to allocate config space function state%s\n", FMT_RED, FMT_NORMAL);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+    }
+
+    return CfgFuncs[node][func];
+}
+
+// -------------------------------------------------------------------------
+// CfgAddrBad()
+//
+// Returns true, after reporting an error, if a config space address has a
+// non-zero bus number, which would otherwise alias onto a function of this
+// node's device
+//
+// -------------------------------------------------------------------------
+
+static bool CfgAddrBad (const uint32_t addr, const char* caller, const uint32_t node)
+{
+    if (CFG_ADDR_BUS(addr) != 0)
+    {
+        VPrint("%s: %s***Error --- config space address 0x%08x has non-zero bus number at node %d%s\n", caller, FMT_RED, addr, node, FMT_NORMAL);
+        VWrite(PVH_FATAL, 0, 0, node);
+        return true;
+    }
+
+    return false;
+}
+
+// -------------------------------------------------------------------------
+// InvalidateBarDecode()
+//
+// Mark the node's decoded BAR table as stale if a config space (or mask)
+// write of length bytes at register reg overlaps the BAR registers
+//
+// -------------------------------------------------------------------------
+
+static inline void InvalidateBarDecode (const uint32_t reg, const int length, const uint32_t node)
+{
+    if (reg < CFG_BAR_REGION_END && (reg + length) > CFG_BAR_HDR_OFFSET)
+    {
+        BarDecode[node].valid = false;
+    }
+}
+
+// -------------------------------------------------------------------------
+// ConfigSpaceFuncPresent()
+//
+// Returns true if the given function (device/function number) has a
+// configuration space
+//
+// -------------------------------------------------------------------------
+
+bool ConfigSpaceFuncPresent (const uint32_t func, const uint32_t node)
+{
+    pCfgFunc_t fn = (func < CFG_MAX_FUNCS) ? GetCfgFunc(func, false, node) : NULL;
+
+    return fn != NULL && fn->space != NULL;
+}
+
 // -------------------------------------------------------------------------
 // WriteConfigSpace()
 //
-// Write word to the 4K confg space page (separate from memory)
+// Write word to the 4K confg space page (separate from memory). The
+// function is selected with bits 23:16 of addr (see CFG_FUNC_ADDR()),
+// and the bus number bits must be zero.
 //
 // -------------------------------------------------------------------------
 
@@ -494,56 +997,53 @@ void WriteConfigSpace (const uint32_t addr, const uint32_t data, const uint32_t
 
 }
 
+// -------------------------------------------------------------------------
+// WriteConfigSpaceBuf()
+//
+// Write a buffer of bytes to a function's config space, with byte enables,
+// and optionally protecting bits marked read-only in the function's
+// config space mask. The function's config space is allocated on the first
+// write.
+//
+// -------------------------------------------------------------------------
+
 void WriteConfigSpaceBuf(const uint32_t addr, const PktData_t *data, const int fbe, const int lbe, const int length, bool use_mask, const uint32_t node)
 {
-    int  idx;
-    char mask;
+    uint32_t       reg    = CFG_ADDR_REG(addr);
+    pCfgFunc_t     fn;
+    const uint8_t* rdonly = NULL;
 
-    if (pCfgSpace == NULL)
+    if (CfgAddrBad(addr, "WriteConfigSpaceBuf", node))
     {
-        DebugVPrint("WriteConfigSpaceBuf:Allocate space for CfgSpace table\n");
-
-        if ((pCfgSpace = malloc(sizeof(char*) * VP_MAX_NODES)) == NULL)
-        {
-            VPrint("WriteConfigSpaceBuf: %s***Error --- failed to allocate config space memory%s\n", FMT_RED, FMT_NORMAL);
-            VWrite(PVH_FATAL, 0, 0, node);
-        }
-        for (idx = 0; idx < VP_MAX_NODES; idx++)
-        {
-            pCfgSpace[node] = NULL;
-        }
+        return;
     }
 
+    fn = GetCfgFunc(CFG_ADDR_FUNC(addr), true, node);
+
     // No config space, so allocate some space for one and initialise
-    if (pCfgSpace[node] == NULL)
+    if (fn->space == NULL)
     {
-        DebugVPrint("WriteConfigSpaceBuf:Allocate mem for CfgSpace[%d]\n", node);
-        if ((pCfgSpace[node] = calloc(TABLESIZE, 1)) == NULL)
+        DebugVPrint("WriteConfigSpaceBuf:Allocate mem for CfgSpace[%d] function %d\n", node, CFG_ADDR_FUNC(addr));
+        if ((fn->space = calloc(TABLESIZE, 1)) == NULL)
         {
             VPrint("WriteConfigSpace: %s***Error --- failed to allocate config space memory%s\n", FMT_RED, FMT_NORMAL);
             VWrite(PVH_FATAL, 0, 0, node);
         }
+
+        BarDecode[node].valid = false;
     }
 
-    for (idx = 0; idx < length; idx++)
-    {
-        // Generate mask if any specified, else make all bits writable
-        if (use_mask && pCfgSpaceMask != NULL)
-            if (pCfgSpaceMask[node] != NULL)
-                mask = ~pCfgSpaceMask[node][addr + idx];
-            else
-                mask = 0xff;
-        else
-            mask = 0xff;
+    InvalidateBarDecode(reg, length, node);
 
-        if ( (idx < 4 && ((1<<idx) & fbe)) ||
-             (idx >= (length-4) && ((1<<(4-(length-idx))) & lbe)) ||
-             (idx >= 4 && idx < (length-4)))
-        {
-            pCfgSpace[node][addr + idx] = (pCfgSpace[node][addr + idx] & ~mask) | ((data[idx] & 0xff) & mask);
-            DebugVPrint("*****WriteConfigSpaceBuf: %02x\n", pCfgSpace[node][addr + idx]);
-        }
+    // Use mask if any specified (set bits are read only), else make all bits writable
+    if (use_mask && fn->mask != NULL)
+    {
+        rdonly = &fn->mask[reg];
     }
+
+    PcieKernelMaskedMerge(&fn->space[reg], data, rdonly, fbe, lbe, length);
+
+    DebugVPrint("*****WriteConfigSpaceBuf: addr=0x%06x len=%d\n", addr, length);
 }
 
 // -------------------------------------------------------------------------
@@ -558,7 +1058,7 @@ uint32_t ReadConfigSpace(const uint32_t addr, const uint32_t node)
     PktData_t buff[4];
     uint32_t word = 0;
 
-    ReadConfigSpaceBuf(addr & 0xffc, buff, 4, node);
+    ReadConfigSpaceBuf(addr & CFG_ADDR_WORD_MASK, buff, 4, node);
 
     word = ((buff[3] & 0xff) << 24) |
            ((buff[2] & 0xff) << 16) |
@@ -591,33 +1091,31 @@ void ReadConfigSpaceBuf(const uint32_t addr, PktData_t * const data, const int l
 
 bool ReadConfigSpaceBufChk(const uint32_t addr, PktData_t * const data, const int len, const bool check, const uint32_t node)
 {
-    int  idx;
-    bool valid_config_space = true;
+    pCfgFunc_t fn;
+
+    if (CfgAddrBad(addr, "ReadConfigSpaceBufChk", node))
+    {
+        return false;
+    }
 
-    if (pCfgSpace == NULL)
-        valid_config_space = false;
-    else if (pCfgSpace[node] == NULL)
-        valid_config_space = false;
+    fn = GetCfgFunc(CFG_ADDR_FUNC(addr), false, node);
 
-    if (!valid_config_space)
+    if (fn == NULL || fn->space == NULL)
     {
         if (check)
         {
             VPrint("ReadConfigSpaceBufChk: %s***Error --- reading from uninitialised config space%s\n", FMT_RED, FMT_NORMAL);
             VWrite(PVH_FATAL, 0, 0, node);
         }
-    }
-    else
-    {
-        for (idx = 0; idx < len; idx++)
-        {
-            data[idx] = pCfgSpace[node][addr + idx];
 
-            DebugVPrint("*****ReadConfigSpace : %02x\n", data[idx] );
-        }
+        return false;
     }
 
-    return valid_config_space;
+    PcieKernelWiden(data, &fn->space[CFG_ADDR_REG(addr)], len);
+
+    DebugVPrint("*****ReadConfigSpace : addr=0x%06x len=%d\n", addr, len);
+
+    return true;
 }
 
 // -------------------------------------------------------------------------
@@ -645,39 +1143,34 @@ void WriteConfigSpaceMask (const uint32_t addr, const uint32_t data, const uint3
 
 void WriteConfigSpaceMaskBuf(const uint32_t addr, const PktData_t *data, const int length, const uint32_t node)
 {
-    int idx;
+    uint32_t   reg = CFG_ADDR_REG(addr);
+    pCfgFunc_t fn;
 
-    if (pCfgSpaceMask == NULL)
+    if (CfgAddrBad(addr, "WriteConfigSpaceMaskBuf", node))
     {
-        DebugVPrint("WriteConfigSpaceMask:Allocate space for CfgSpace table\n");
-
-        if ((pCfgSpaceMask = malloc(sizeof(char*) * VP_MAX_NODES)) == NULL)
-        {
-            VPrint("WriteConfigSpaceMaskBuf:%s ***Error --- failed to allocate config space memory%s\n", FMT_RED, FMT_NORMAL);
-            VWrite(PVH_FATAL, 0, 0, node);
-        }
-        for (idx = 0; idx < VP_MAX_NODES; idx++)
-        {
-            pCfgSpaceMask[node] = NULL;
-        }
+        return;
     }
 
-    // No config space, so allocate some space for one and initialise
-    if (pCfgSpaceMask[node] == NULL)
+    fn = GetCfgFunc(CFG_ADDR_FUNC(addr), true, node);
+
+    // No config space mask, so allocate some space for one and initialise
+    if (fn->mask == NULL)
     {
-        DebugVPrint("WriteConfigSpaceMask:Allocate mem for CfgSpaceMask[%d]\n", node);
-        if ((pCfgSpaceMask[node] = calloc(TABLESIZE, 1)) == NULL)
+        DebugVPrint("WriteConfigSpaceMask:Allocate mem for CfgSpaceMask[%d] function %d\n", node, CFG_ADDR_FUNC(addr));
+        if ((fn->mask = calloc(TABLESIZE, 1)) == NULL)
         {
             VPrint("WriteConfigSpaceMaskBuf: %s***Error --- failed to allocate config space memory%s\n", FMT_RED, FMT_NORMAL);
             VWrite(PVH_FATAL, 0, 0, node);
         }
-    }
 
-    for (idx = 0; idx < length; idx++)
-    {
-        pCfgSpaceMask[node][addr + idx] = (data[idx] & 0xff);
-        DebugVPrint("*****WriteConfigSpaceMaskBuf : %02x\n", pCfgSpaceMask[node][addr + idx]);
+        BarDecode[node].valid = false;
     }
+
+    InvalidateBarDecode(reg, length, node);
+
+    PcieKernelNarrow(&fn->mask[reg], data, length);
+
+    DebugVPrint("*****WriteConfigSpaceMaskBuf : addr=0x%06x len=%d\n", addr, length);
 }
 
 // -------------------------------------------------------------------------
@@ -692,7 +1185,7 @@ uint32_t ReadConfigSpaceMask(const uint32_t addr, const uint32_t node)
     PktData_t buff[4];
     uint32_t word = 0;
 
-    ReadConfigSpaceMaskBuf(addr & 0xffc, buff, 4, node);
+    ReadConfigSpaceMaskBuf(addr & CFG_ADDR_WORD_MASK, buff, 4, node);
 
     word = ((buff[3] & 0xff) << 24) |
            ((buff[2] & 0xff) << 16) |
@@ -726,31 +1219,434 @@ void ReadConfigSpaceMaskBuf(const uint32_t addr, PktData_t * const data, const i
 
 bool ReadConfigSpaceMaskBufChk(const uint32_t addr, PktData_t * const data, const int len, const bool check, const uint32_t node)
 {
-    int  idx;
-    bool valid_config_space = true;
+    pCfgFunc_t fn;
 
-    if (pCfgSpaceMask == NULL)
-        valid_config_space = false;
-    else if (pCfgSpaceMask[node] == NULL)
-        valid_config_space = false;
+    if (CfgAddrBad(addr, "ReadConfigSpaceMaskBufChk", node))
+    {
+        return false;
+    }
 
-    if (!valid_config_space)
+    fn = GetCfgFunc(CFG_ADDR_FUNC(addr), false, node);
+
+    if (fn == NULL || fn->mask == NULL)
     {
         if (check)
         {
             VPrint("ReadConfigSpaceMaskBufChk: %s***Error --- reading from uninitialised config space%s\n", FMT_RED, FMT_NORMAL);
             VWrite(PVH_FATAL, 0, 0, node);
         }
+
+        return false;
+    }
+
+    PcieKernelWiden(data, &fn->mask[CFG_ADDR_REG(addr)], len);
+
+    DebugVPrint("*****ReadConfigSpaceMaskBuf: addr=0x%06x len=%d\n", addr, len);
+
+    return true;
+}
+
+// -------------------------------------------------------------------------
+// CfgWord()
+//
+// Return the little endian 32 bit word at offset addr of a config
+// space (or mask) page
+//
+// -------------------------------------------------------------------------
+
+static inline uint64_t CfgWord (const uint8_t* const page, const uint32_t addr)
+{
+    return (uint64_t)page[addr] | ((uint64_t)page[addr+1] << 8) | ((uint64_t)page[addr+2] << 16) | ((uint64_t)page[addr+3] << 24);
+}
+
+// -------------------------------------------------------------------------
+// DecodeFuncBars()
+//
+// Add a function's BAR ranges to the node's BAR decode table, keeping
+// the table sorted on base address. The mask bits of a BAR are its
+// read-only bits, so mask+1 gives the BAR's size. A 64-bit BAR's upper
+// dword (and its mask) supplies bits 63:32 of the address, above the
+// lower dword's bits.
+//
+// -------------------------------------------------------------------------
+
+static void DecodeFuncBars (const pCfgFunc_t fn, const uint32_t func, const pBarDecode_t dec)
+{
+    BarRange_t   r;
+    uint64_t     bar, barmask, length;
+    unsigned     locatable;
+    int          idx, jdx;
+
+    for (idx = 0; idx < CFG_NUM_BARS; idx++)
+    {
+        uint32_t offset = CFG_BAR_HDR_OFFSET + 4*idx;
+
+        locatable = (fn->space[offset] & CFG_BAR_LOCATABLE_MASK) >> CFG_BAR_LOCATABLE_BIT_POS;
+
+        // Lower BAR bits, masking type/locatable and prefetchable bits
+        bar       = CfgWord(fn->space, offset) & 0xfffffffffffffff0ULL;
+        barmask   = CfgWord(fn->mask,  offset);
+
+        if (locatable == CFG_BAR_LOCATABLE_64_BIT)
+        {
+            // OR in upper bits of 64-bit BAR and mask, and skip over them
+            bar     |= CfgWord(fn->space, offset + 4) << 32;
+            barmask |= CfgWord(fn->mask,  offset + 4) << 32;
+            idx++;
+        }
+
+        // Calculate the length from the mask bits
+        length = (barmask + 1) & ((locatable == CFG_BAR_LOCATABLE_64_BIT) ? 0xffffffffffffffffULL : 0x00000000ffffffffULL);
+
+        // Unimplemented BARs (all bits read-only) have no range
+        if (length == 0)
+        {
+            continue;
+        }
+
+        r.base = bar;
+        r.end  = bar + length;
+        r.func = func;
+
+        // Insertion sort on base address
+        for (jdx = dec->num_ranges; jdx > 0 && dec->range[jdx-1].base > r.base; jdx--)
+        {
+            dec->range[jdx] = dec->range[jdx-1];
+        }
+        dec->range[jdx] = r;
+        dec->num_ranges++;
+    }
+}
+
+// -------------------------------------------------------------------------
+// DecodeBars()
+//
+// Rebuild the node's BAR decode table from the BAR registers and masks
+// of all functions with both a config space and mask configured. If
+// function 0's config space or mask isn't configured, all of the address
+// space is accessible (and belongs to function 0). Overlapping ranges
+// are not merged, but clipped, so that the lower based range takes
+// precedence over the overlapped part. An access must then lie wholly
+// within one (clipped) range, and one straddling the clip point of two
+// overlapping BARs is rejected.
+//
+// -------------------------------------------------------------------------
+
+static void DecodeBars (const uint32_t node)
+{
+    pBarDecode_t dec = &BarDecode[node];
+    pCfgFunc_t   fn  = GetCfgFunc(0, false, node);
+    int          idx, jdx, num_funcs = 0;
+    uint32_t     func;
+
+    dec->num_ranges = 0;
+    dec->all_access = fn == NULL || fn->space == NULL || fn->mask == NULL;
+    dec->valid      = true;
+
+    if (dec->all_access)
+    {
+        return;
+    }
+
+    for (func = 0; func < CFG_MAX_FUNCS; func++)
+    {
+        fn = CfgFuncs[node][func];
+        num_funcs += (fn != NULL && fn->space != NULL && fn->mask != NULL) ? 1 : 0;
+    }
+
+    // Make sure there is room for all of the functions' BARs
+    if (num_funcs * CFG_NUM_BARS > dec->max_ranges)
+    {
+        dec->max_ranges = num_funcs * CFG_NUM_BARS;
+
+        if ((dec->range = realloc(dec->range, dec->max_ranges * sizeof(BarRange_t))) == NULL)
+        {
+            VPrint("DecodeBars: %s***Error --- failed to allocate BAR decode table%s\n", FMT_RED, FMT_NORMAL);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+    }
+
+    for (func = 0; func < CFG_MAX_FUNCS; func++)
+    {
+        fn = CfgFuncs[node][func];
+
+        if (fn != NULL && fn->space != NULL && fn->mask != NULL)
+        {
+            DecodeFuncBars(fn, func, dec);
+        }
+    }
+
+    // Clip overlapping ranges so that the lookup need only check one
+    for (idx = 0, jdx = 1; jdx < dec->num_ranges; jdx++)
+    {
+        if (dec->range[jdx].base < dec->range[idx].end)
+        {
+            if (dec->range[jdx].end <= dec->range[idx].end)
+            {
+                continue;
+            }
+            dec->range[jdx].base = dec->range[idx].end;
+        }
+
+        dec->range[++idx] = dec->range[jdx];
+    }
+
+    if (dec->num_ranges)
+    {
+        dec->num_ranges = idx + 1;
+    }
+}
+
+// -------------------------------------------------------------------------
+// CheckBarAccess()
+//
+// Check an access of bytelen bytes at addr against the BARs. Returns true
+// if wholly within a configured BAR's region, including an access ending
+// on the region's last byte, or if this node's config
+// space or config space mask aren't configured, when all address space is
+// made available. If func is not NULL, the number of the function owning
+// the BAR is returned in it. The BAR decode is cached, and only rebuilt
+// after a config write to the BAR registers.
+//
+// -------------------------------------------------------------------------
+
+bool CheckBarAccess (const uint64_t addr, const uint32_t bytelen, int* func, const uint32_t node)
+{
+    pBarDecode_t dec = &BarDecode[node];
+    int lo, hi, mid;
+
+    if (!dec->valid)
+    {
+        DecodeBars(node);
+    }
+
+    if (func != NULL)
+    {
+        *func = 0;
+    }
+
+    if (dec->all_access)
+    {
+        return true;
+    }
+
+    // Binary search for the last range with a base not above addr
+    lo = 0;
+    hi = dec->num_ranges - 1;
+
+    while (lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+
+        if (dec->range[mid].base <= addr)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    if (hi >= 0 && addr < dec->range[hi].end && (addr + bytelen) <= dec->range[hi].end)
+    {
+        if (func != NULL)
+        {
+            *func = dec->range[hi].func;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+// -------------------------------------------------------------------------
+// LoadConfigSpaceImage()
+//
+// Load a function's config space, and config space mask, from an image
+// file. Binary images (CFG_IMAGE_BIN) are a 4K config space, optionally
+// followed by a 4K mask. Hex images (CFG_IMAGE_HEX) have lines of hex
+// values of the form:
+//
+//   <byte offset> <data word> [<mask word>]
+//
+// with words being little endian, as for WriteConfigSpace(). Blank lines,
+// and those starting with anything other than a hex digit (e.g. //
+// comments), are ignored.
+//
+// The image replaces the whole of the function's config space and mask,
+// with words not listed in a hex image, and the mask of a 4K binary image,
+// cleared. The whole file is checked before any of it is applied, so a
+// bad image leaves the function unchanged.
+//
+// -------------------------------------------------------------------------
+
+int LoadConfigSpaceImage (const char* fname, const int format, const uint32_t func, const uint32_t node)
+{
+    FILE*      fp;
+    char       buf[MEM_LINE_SIZE];
+    uint8_t*   image;
+    PktData_t* pbuf;
+    pCfgFunc_t fn;
+    unsigned   offset, data, mask;
+    uint32_t   len;
+    int        fields, line = 0, status = MEM_GOOD_STATUS;
+    bool       has_mask = false;
+
+    if (func >= CFG_MAX_FUNCS)
+    {
+        VPrint("LoadConfigSpaceImage: %s***Error --- function %d out of range at node %d%s\n", FMT_RED, func, node, FMT_NORMAL);
+        return MEM_BAD_STATUS;
+    }
+
+    if ((fp = fopen(fname, (format == CFG_IMAGE_BIN) ? "rb" : "r")) == NULL)
+    {
+        VPrint("LoadConfigSpaceImage: %s***Error --- failed to open %s at node %d%s\n", FMT_RED, fname, node, FMT_NORMAL);
+        return MEM_BAD_STATUS;
+    }
+
+    // Space image followed by mask image, built before being applied
+    if ((image = calloc(2*TABLESIZE, 1)) == NULL || (pbuf = malloc(TABLESIZE * sizeof(PktData_t))) == NULL)
+    {
+        VPrint("LoadConfigSpaceImage: %s***Error --- memory allocation failure at node %d%s\n", FMT_RED, node, FMT_NORMAL);
+        free(image);
+        fclose(fp);
+        return MEM_BAD_STATUS;
+    }
+
+    if (format == CFG_IMAGE_BIN)
+    {
+        len = fread(image, 1, 2*TABLESIZE, fp);
+
+        if ((len != TABLESIZE && len != 2*TABLESIZE) || fgetc(fp) != EOF)
+        {
+            VPrint("LoadConfigSpaceImage: %s***Error --- %s is not a 4K or 8K image at node %d%s\n", FMT_RED, fname, node, FMT_NORMAL);
+            status = MEM_BAD_STATUS;
+        }
+
+        has_mask = len == 2*TABLESIZE;
+    }
+    else
+    {
+        while (status == MEM_GOOD_STATUS && fgets(buf, MEM_LINE_SIZE, fp))
+        {
+            int sidx = 0;
+
+            line++;
+
+            // Removing whitespace
+            while (buf[sidx] == ' ' || buf[sidx] == '\t')
+            {
+                sidx++;
+            }
+
+            if (!isxdigit((unsigned char)buf[sidx]))
+            {
+                continue;
+            }
+
+            fields = sscanf(&buf[sidx], "%x %x %x", &offset, &data, &mask);
+
+            if (fields < 2 || offset > (TABLESIZE - 4) || (offset & 0x3))
+            {
+                VPrint("LoadConfigSpaceImage: %s***Error --- bad entry at line %d of %s at node %d%s\n", FMT_RED, line, fname, node, FMT_NORMAL);
+                status = MEM_BAD_STATUS;
+                break;
+            }
+
+            for (int idx = 0; idx < 4; idx++)
+            {
+                image[offset + idx]             = (data >> (idx*8)) & 0xff;
+                image[TABLESIZE + offset + idx] = (fields == 3) ? (mask >> (idx*8)) & 0xff : 0;
+            }
+
+            has_mask |= fields == 3;
+        }
+    }
+
+    fclose(fp);
+
+    if (status == MEM_GOOD_STATUS)
+    {
+        PcieKernelWiden(pbuf, image, TABLESIZE);
+        WriteConfigSpaceBuf(CFG_FUNC_ADDR(func, 0), pbuf, 0xf, 0xf, TABLESIZE, false, node);
+
+        // Write the mask if the image has one, or to clear an existing mask
+        fn = GetCfgFunc(func, false, node);
+
+        if (has_mask || fn->mask != NULL)
+        {
+            PcieKernelWiden(pbuf, &image[TABLESIZE], TABLESIZE);
+            WriteConfigSpaceMaskBuf(CFG_FUNC_ADDR(func, 0), pbuf, TABLESIZE, node);
+        }
+    }
+
+    free(pbuf);
+    free(image);
+
+    return status;
+}
+
+// -------------------------------------------------------------------------
+// DumpConfigSpaceImage()
+//
+// Write a function's config space, and config space mask (if it has one),
+// to an image file in a format that LoadConfigSpaceImage() accepts. Hex
+// images only list words where either the data or mask are non-zero, the
+// other words being cleared when the image is loaded.
+//
+// -------------------------------------------------------------------------
+
+int DumpConfigSpaceImage (const char* fname, const int format, const uint32_t func, const uint32_t node)
+{
+    FILE*      fp;
+    pCfgFunc_t fn = (func < CFG_MAX_FUNCS) ? GetCfgFunc(func, false, node) : NULL;
+    uint32_t   data, mask, offset;
+    int        ok = 1;
+
+    if (fn == NULL || fn->space == NULL)
+    {
+        VPrint("DumpConfigSpaceImage: %s***Error --- function %d has no config space at node %d%s\n", FMT_RED, func, node, FMT_NORMAL);
+        return MEM_BAD_STATUS;
+    }
+
+    if ((fp = fopen(fname, (format == CFG_IMAGE_BIN) ? "wb" : "w")) == NULL)
+    {
+        VPrint("DumpConfigSpaceImage: %s***Error --- failed to open %s at node %d%s\n", FMT_RED, fname, node, FMT_NORMAL);
+        return MEM_BAD_STATUS;
+    }
+
+    if (format == CFG_IMAGE_BIN)
+    {
+        ok = fwrite(fn->space, 1, TABLESIZE, fp) == TABLESIZE;
+
+        if (ok && fn->mask != NULL)
+        {
+            ok = fwrite(fn->mask, 1, TABLESIZE, fp) == TABLESIZE;
+        }
     }
     else
     {
-        for (idx = 0; idx < len; idx++)
+        fprintf(fp, "// Config space image of function %d, node %d\n//\n// offset data     mask\n", func, node);
+
+        for (offset = 0; offset < TABLESIZE && ok; offset += 4)
         {
-            data[idx] = pCfgSpaceMask[node][addr + idx];
+            data = (uint32_t)CfgWord(fn->space, offset);
+            mask = fn->mask ? (uint32_t)CfgWord(fn->mask, offset) : 0;
 
-            DebugVPrint("*****ReadConfigSpaceMaskBuf: %02x\n", data[idx] );
+            if (data || mask)
+            {
+                ok = fprintf(fp, "   %03x   %08x %08x\n", offset, data, mask) > 0;
+            }
         }
     }
 
-    return valid_config_space;
+    if (fclose(fp) != 0 || !ok)
+    {
+        VPrint("DumpConfigSpaceImage: %s***Error --- failed writing %s at node %d%s\n", FMT_RED, fname, node, FMT_NORMAL);
+        return MEM_BAD_STATUS;
+    }
+
+    return MEM_GOOD_STATUS;
 }
@@ -41,6 +41,9 @@
 #include "pcie_dpi.h"
 #endif
 
+#include "mem_shm.h"
+#include "pci_express.h"
+
 // -------------------------------------------------------------------------
 // DEFINES
 // -------------------------------------------------------------------------
@@ -51,6 +54,27 @@
 #define MEM_BAD_STATUS  1
 #define MEM_GOOD_STATUS 0
 
+// Config space addresses select a function's space with bits 23:16 (the
+// device/function, or ARI function, number), matching the layout of a
+// configuration TLP address, with the register offset in bits 11:0. A node
+// is a single device, so only this number indexes the config spaces,
+// limiting a node to CFG_MAX_FUNCS (256) functions. The bus number (bits
+// 31:24) is not part of the index, and addresses with a non-zero bus
+// number are rejected. (A received type 0 config request is for this
+// device, whatever its bus number, and has the bus number removed.)
+#define CFG_MAX_FUNCS                256
+#define CFG_FUNC_ADDR(_func, _reg)   ((((_func) & 0xff) << 16) | ((_reg) & 0xfff))
+#define CFG_ADDR_BUS(_addr)          (((_addr) >> 24) & 0xff)
+#define CFG_ADDR_FUNC(_addr)         (((_addr) >> 16) & 0xff)
+#define CFG_ADDR_REG(_addr)          ((_addr) & 0xfff)
+#define CFG_ADDR_WORD_MASK           0xffff0ffc
+
+// Config space image file formats
+#define CFG_IMAGE_HEX                0
+#define CFG_IMAGE_BIN                1
+
+#define MEM_LINE_SIZE                1024
+
 // -------------------------------------------------------------------------
 // TYPEDEFS
 // -------------------------------------------------------------------------
@@ -61,14 +85,53 @@ typedef struct {
     bool     valid;
 } PrimaryTbl_t, *pPrimaryTbl_t;
 
-typedef uint16_t  PktData_t;
-typedef uint16_t* pPktData_t;
+// Lazily allocated config space and mask pages of a function
+typedef struct {
+    uint8_t* space;
+    uint8_t* mask;
+} CfgFunc_t, *pCfgFunc_t;
+
+// Decoded BAR address ranges of all functions (end is exclusive), sorted on base
+// address, with overlapping ranges clipped (see DecodeBars() in mem.c)
+typedef struct {
+    uint64_t base;
+    uint64_t end;
+    int      func;
+} BarRange_t;
+
+typedef struct {
+    bool        valid;
+    bool        all_access;
+    int         num_ranges;
+    int         max_ranges;
+    BarRange_t* range;
+} BarDecode_t, *pBarDecode_t;
+
+// Per node state of an (optional) shared memory object backing the memory pages
+typedef struct {
+    pMemShmHdr_t hdr;
+    uint64_t*    dir;
+    uint8_t*     data;
+    size_t       size;
+    bool         owner;
+    char         name[MEM_SHM_NAME_SIZE];
+} MemShm_t, *pMemShm_t;
+
+// A local memory block to be moved into a shared memory object page
+typedef struct {
+    char**       slot;
+    uint64_t     addr;
+    uint8_t*     page;
+} MemShmMove_t, *pMemShmMove_t;
 
 // -------------------------------------------------------------------------
 // PROTOTYPES
 // -------------------------------------------------------------------------
 
 extern void     InitialiseMem             (int node);
+
+extern int      MemSharedOpen             (const char* name, const uint32_t pages, const uint32_t node);
+extern void     MemSharedClose            (const bool unlink_obj, const uint32_t node);
                                           
 extern void     WriteRamByteBlock         (const uint64_t addr, const PktData_t* const data, const int fbe, const int lbe, const int length, const uint32_t node);
 extern int      ReadRamByteBlock          (const uint64_t addr, PktData_t* const data, const int length, const uint32_t node);
@@ -94,4 +157,10 @@ extern void     ReadConfigSpaceMaskBuf    (const uint32_t addr, PktData_t* const
 extern bool     ReadConfigSpaceMaskBufChk (const uint32_t addr, PktData_t* const data, const int length, const bool check, const uint32_t node);
 extern bool     ReadConfigSpaceBufChk     (const uint32_t addr, PktData_t* const data, const int length, const bool check, const uint32_t node);
 
+extern bool     ConfigSpaceFuncPresent    (const uint32_t func, const uint32_t node);
+extern bool     CheckBarAccess            (const uint64_t addr, const uint32_t bytelen, int* func, const uint32_t node);
+
+extern int      LoadConfigSpaceImage      (const char* fname, const int format, const uint32_t func, const uint32_t node);
+extern int      DumpConfigSpaceImage      (const char* fname, const int format, const uint32_t func, const uint32_t node);
+
 #endif
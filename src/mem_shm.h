@@ -0,0 +1,72 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Published layout of the shared memory object used to back
+// a node's memory model when enabled with MemSharedOpen(). This
+// header has no dependencies on the rest of the model, and may be
+// included by external processes that map the same object.
+//
+// The object is laid out as:
+//
+//   offset 0           : MemShmHdr_t
+//   hdr.dir_offset     : uint64_t directory[hdr.num_pages]
+//   hdr.data_offset    : uint8_t  pages[hdr.num_pages][hdr.page_size]
+//
+// Directory entry n holds the (page aligned) PCIe address of page n,
+// ORed with MEM_SHM_DIR_VALID once the page is in use. Pages are
+// allocated by atomically incrementing hdr.used_pages, filling the
+// page if required, and then storing the directory entry. Both the
+// model and external processes may allocate pages in this way. If
+// an address appears more than once, the lowest entry is the one
+// used.
+//
+//=============================================================
+
+#ifndef _MEM_SHM_H_
+#define _MEM_SHM_H_
+
+#include <stdint.h>
+
+#define MEM_SHM_MAGIC                0x53485650   // "PVHS"
+#define MEM_SHM_VERSION              1
+#define MEM_SHM_PAGE_SIZE            4096
+#define MEM_SHM_DIR_VALID            0x1ULL
+#define MEM_SHM_DIR_ADDR_MASK        (~((uint64_t)MEM_SHM_PAGE_SIZE - 1))
+
+#define MEM_SHM_DEFAULT_NAME         "/pcievhost_mem%d"
+#define MEM_SHM_DEFAULT_PAGES        4096
+#define MEM_SHM_NAME_SIZE            256
+
+typedef struct {
+    uint32_t          magic;
+    uint32_t          version;
+    uint32_t          page_size;
+    uint32_t          num_pages;
+    uint32_t          node;
+    uint32_t          dir_offset;
+    uint32_t          data_offset;
+    volatile uint32_t used_pages;
+    uint64_t          reserved[4];
+} MemShmHdr_t, *pMemShmHdr_t;
+
+#endif
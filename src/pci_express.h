@@ -58,6 +58,7 @@
 
 #define TS_DATA_RATE_GEN1          0x02
 #define TS_DATA_RATE_GEN2          0x06
+#define TS_DATA_RATE_GEN3          0x0e
 #define TS_DATA_RATE_CHANGE_AUTO   0x40
 #define TS_DATA_RATE_CHANGE_SPEED  0x80
 
@@ -70,6 +71,37 @@
 #define TS_N_FTS_MAX_VALUE         0xff
 #define TS_LINK_NUM_MAX_VALUE      0xff
 
+// Gen3 (128b/130b) block sync headers, carried in bits 9:8 of the
+// first symbol of each block on a lane
+#define GEN3_SYNC_DATA             0x2
+#define GEN3_SYNC_OS               0x1
+#define GEN3_BLOCK_SYMS            16
+#define GEN3_TS_ID_SYM             10   // First TS identifier symbol
+
+// Gen3 framing tokens
+#define GEN3_IDL                   0x00
+#define GEN3_STP                   0x0f // Low nibble of first STP token byte
+#define GEN3_STP_MASK              0x0f
+#define GEN3_SDP0                  0xf0
+#define GEN3_SDP1                  0xac
+#define GEN3_EDB                   0xc0
+#define GEN3_EDS0                  0x1f
+#define GEN3_EDS1                  0x80
+#define GEN3_EDS2                  0x90
+#define GEN3_EDS3                  0x00
+#define GEN3_TOKEN_BYTES           4
+
+// Gen3 ordered set identifiers (first symbol of an OS block)
+#define GEN3_TS1                   0x1e
+#define GEN3_TS2                   0x2d
+#define GEN3_SKP                   0xaa
+#define GEN3_SKP_END               0xe1
+#define GEN3_SKP_END_SYM           12
+#define GEN3_EIEOS                 0x00
+#define GEN3_EIOS                  0x66
+#define GEN3_FTS                   0x55
+#define GEN3_PAD                   0xf7
+
 // TLP types
 #define TL_MRD32                   0x00 // 0000000
 #define TL_MRD64                   0x20 // 0100000
@@ -178,6 +210,8 @@
 
 // TYPE 0 field offsets of PCI compatible config space
 #define CFG_BAR_HDR_OFFSET              0x10
+#define CFG_NUM_BARS                    6
+#define CFG_BAR_REGION_END              (CFG_BAR_HDR_OFFSET + 4*CFG_NUM_BARS)
 #define CFG_CARDBUS_CIS_PTR_OFFSET      0x28
 #define CFG_SUBSYS_VENDOR_ID_OFFSET     0x2c
 #define CFG_SUBSYS_ID_OFFSET            0x2e
@@ -205,6 +239,51 @@
 #define MSICAPTYPE                      0x05
 #define PCIECAPTYPE                     0x10
 
+// -------------------------------------------------------------------------
+// Model packet buffer format
+//
+// Packets are held one byte per PktData_t from the STP/SDP symbol, and
+// are terminated with PKT_TERMINATION. This format is also used in the
+// binary link trace records (pcie_trace.h).
+// -------------------------------------------------------------------------
+
+#define LCRC_TERMINATION_LOOKAHEAD      5
+#define ECRC_TERMINATION_LOOKAHEAD      9
+#define PKT_TERMINATION                 0xffff
+
+#define MAX_RAW_PKT_SIZE                4125
+
+#define TLP_TYPE_VARIANT_BIT            0x01
+#define TLP_EP_VARIANT_BIT              0x40
+
+// Packet byte offsets used in CRC generation and length decode
+#define DLLP_SEQ_OFFSET                 1
+#define TLP_TYPE_BYTE_OFFSET            3
+#define TLP_TD_BYTE_OFFSET              5
+#define TLP_EP_BYTE_OFFSET              5
+#define TLP_LENGTH_OFFSET               5
+#define DLLP_CRC_OFFSET                 5
+
+#define GET_TLP_LENGTH_RAW(_PKT)        ((((_PKT)[TLP_LENGTH_OFFSET] & 0x3) << 8) | ((_PKT)[TLP_LENGTH_OFFSET+1] & 0xff))
+#define GET_TLP_LENGTH_ADJ(_PKT)        (GET_TLP_LENGTH_RAW(_PKT) ? GET_TLP_LENGTH_RAW(_PKT) : 1024)
+#define GET_TLP_LENGTH(_PKT)            GET_TLP_LENGTH_ADJ(_PKT)
+#define TLP_HAS_DIGEST(_PKT)            (((_PKT)[TLP_TD_BYTE_OFFSET] & 0x80) ? 1 : 0)
+#define TLP_HDR_4DW(_PKT)               (((_PKT)[TLP_TYPE_BYTE_OFFSET] & 0x20) ? 1 : 0)
+
+// CRC definitions
+#define TLP_CRC_INITIAL_VALUE           0xffffffff
+#define DLLP_CRC_INITIAL_VALUE          0xffff
+
+#define TLPPOLY                         0x04c11db7U
+#define TLPCRCSIZE                      32
+#define MAX_CRC_TOP_BIT                 0x80000000U
+#define DLLPPOLY                        0x100b
+#define DLLPCRCSIZE                     16
+#define MAXCRCSIZE                      TLPCRCSIZE
+
+typedef uint16_t  PktData_t;
+typedef uint16_t* pPktData_t;
+
 typedef struct  __attribute__ ((__packed__)) {
     uint16_t vendor_id;
     uint16_t device_id;
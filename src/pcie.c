@@ -36,6 +36,8 @@
 #include "codec.h"
 #include "ltssm.h"
 #include "displink.h"
+#include "pcie_kernels.h"
+#include "dispwriter.h"
 
 // -------------------------------------------------------------------------
 // GLOBALS
@@ -50,6 +52,202 @@ static pPcieModelState_t *pms = NULL;
 
 #define this pms[node]
 
+// -------------------------------------------------------------------------
+// TxPktData()
+//
+// Return the symbols to transmit for a packet; the packet's data, or
+// a Gen3 framed copy in Gen3 mode
+//
+// -------------------------------------------------------------------------
+
+static PktData_t* TxPktData(const pPkt_t pkt, const int node)
+{
+    if (pkt == NULL)
+    {
+        return NULL;
+    }
+
+    return this->usrconf.EnableGen3 ? Gen3FramePkt(this, pkt) : pkt->data;
+}
+
+// -------------------------------------------------------------------------
+// StartReplay()
+//
+// Account for a replay of the unacknowledged TLPs, with send_p already
+// rewound. The replay timer is restarted and REPLAY_NUM incremented,
+// flagging a link retrain (if enabled) when it rolls over.
+//
+// -------------------------------------------------------------------------
+
+static void StartReplay (const int node)
+{
+    this->replay.stats.replays++;
+    this->replay.running = true;
+    this->replay.start   = GetCycleCount(node);
+
+    if (++this->replay.num == REPLAY_NUM_ROLLOVER)
+    {
+        this->replay.num = 0;
+        this->replay.stats.rollovers++;
+        this->replay.retrain = this->usrconf.ReplayRetrain;
+    }
+}
+
+// -------------------------------------------------------------------------
+// ServiceAckNak()
+//
+// Free the packets at the head of the queue acknowledged by a received
+// ACK and, on a received NAK, replay the packets following the NAK'ed
+// sequence number, which the NAK acknowledges up to. Sequence numbers
+// are compared modulo 4096. An ACK making forward progress resets
+// REPLAY_NUM, and restarts the replay timer if any transmitted TLPs
+// remain unacknowledged, else stops it.
+//
+// -------------------------------------------------------------------------
+
+static void ServiceAckNak (const int node)
+{
+    pPkt_t tmp_p;
+    bool   progress = false;
+
+    if (this->curr_nak != NULLACK && (this->curr_ack == NULLACK || SEQ_LT(this->curr_ack, this->curr_nak)))
+    {
+        this->curr_ack = this->curr_nak;
+    }
+
+    if (this->curr_ack != NULLACK)
+    {
+        while ((this->head_p != NULL && this->head_p != this->send_p) &&
+               ((this->head_p->seq != DLLP_SEQ_ID && SEQ_LE(this->head_p->seq, this->curr_ack)) ||
+                (this->head_p->seq == DLLP_SEQ_ID)))
+        {
+            tmp_p = this->head_p;
+            progress |= (tmp_p->seq != DLLP_SEQ_ID);
+            this->head_p = this->head_p->NextPkt;
+            CheckFree(tmp_p->data);
+            CheckFree(tmp_p);
+        }
+        if (this->head_p == NULL)
+        {
+            this->head_p = this->end_p = this->send_p;
+        }
+        this->curr_ack = NULLACK;
+
+        if (progress)
+        {
+            this->replay.num     = 0;
+            this->replay.running = false;
+            this->replay.start   = GetCycleCount(node);
+
+            for (tmp_p = this->head_p; tmp_p != this->send_p && !this->replay.running; tmp_p = tmp_p->NextPkt)
+            {
+                this->replay.running = (tmp_p->seq != DLLP_SEQ_ID);
+            }
+        }
+    }
+
+    // If we have received a NAK, replay all the unacknowledged packets
+    if (this->curr_nak != NULLACK)
+    {
+        this->send_p   = this->head_p;
+        this->curr_nak = NULLACK;
+
+        StartReplay(node);
+    }
+}
+
+// -------------------------------------------------------------------------
+// CheckReplayTimer()
+//
+// If the replay timer has reached its limit (ReplayTimerLimit()), with
+// no forward progress, replay all the unacknowledged packets from the
+// head of the queue. This recovers from lost ACKs and NAKs, which would
+// otherwise leave the packets on the queue indefinitely.
+//
+// -------------------------------------------------------------------------
+
+static void CheckReplayTimer (const int node)
+{
+    if (!this->replay.running || this->usrconf.ReplayTimeout == REPLAY_TIMEOUT_OFF ||
+        (GetCycleCount(node) - this->replay.start) < ReplayTimerLimit(this))
+    {
+        return;
+    }
+
+    // Nothing transmitted is outstanding, so there is nothing to replay
+    if (this->head_p == this->send_p)
+    {
+        this->replay.running = false;
+        return;
+    }
+
+    this->replay.stats.timeouts++;
+    this->send_p = this->head_p;
+
+    StartReplay(node);
+}
+
+// -------------------------------------------------------------------------
+// InsertAckNak()
+//
+// If an ACK or NAK is pending and its AckNak latency timer has
+// expired (AckNakDue()), move it to the DLLP priority queue, to go
+// out at the next packet boundary ahead of any queued TLPs. Any later
+// good TLPs are acknowledged by the pending ACK, so it is sent for the
+// highest good sequence number seen. A new ACK or NAK is a new packet,
+// so the one queued is not overwritten by new input.
+//
+// -------------------------------------------------------------------------
+
+static void InsertAckNak (const int node)
+{
+    if (this->ack_to_send_p != NULL && AckNakDue(this, this->ack_to_send_p->TimeStamp))
+    {
+        AddPktToDllpQueue(this, this->ack_to_send_p);
+
+        // Mark as sent
+        this->ack_to_send_p = NULL;
+        this->ackstats.acks_sent++;
+    }
+
+    if (this->nak_to_send_p != NULL && AckNakDue(this, this->nak_to_send_p->TimeStamp))
+    {
+        AddPktToDllpQueue(this, this->nak_to_send_p);
+
+        // Mark as sent
+        this->nak_to_send_p = NULL;
+        this->ackstats.naks_sent++;
+    }
+}
+
+// -------------------------------------------------------------------------
+// NextTxPkt()
+//
+// Return the next packet to transmit at a packet boundary; the head of
+// the DLLP priority queue, if any, else the next on the send queue.
+// The packet following it is returned in next, if not NULL.
+//
+// -------------------------------------------------------------------------
+
+static pPkt_t NextTxPkt (pPkt_t* const next, const int node)
+{
+    pPkt_t pkt = (this->dllp_head_p != NULL) ? this->dllp_head_p : this->send_p;
+
+    if (next != NULL && pkt != NULL)
+    {
+        if (pkt == this->dllp_head_p)
+        {
+            *next = (pkt->NextPkt != NULL) ? pkt->NextPkt : this->send_p;
+        }
+        else
+        {
+            *next = pkt->NextPkt;
+        }
+    }
+
+    return pkt;
+}
+
 // -------------------------------------------------------------------------
 // SendPacket()
 //
@@ -66,9 +264,11 @@ void SendPacket(const int node)
     uint32_t code;
     uint32_t  LinkIn  [MAX_LINK_WIDTH];
     PktData_t LinkOut [MAX_LINK_WIDTH];
-    int i;
 
-    PktData_t AckDataHolder[MAX_DLLP_BYTES], NakDataHolder[MAX_DLLP_BYTES];
+    PktData_t *txdata = NULL;
+    pPkt_t    txpkt   = NULL;
+    pPkt_t    pkt_p   = NULL;
+    pPkt_t    next_p  = NULL;
 
     pUserConfig_t usrconf    = &(this->usrconf);
     bool          padding    = false;
@@ -84,113 +284,74 @@ void SendPacket(const int node)
 
     this->draining_queue = true;
 
-    // If we have outstanding Acks, clear the head of the queue for the
-    // acknowledged packets
-    if (!usrconf->DisableAck)
+    // Main output packet loop
+    do
     {
-        // Service received  acknowledges
-
-        if (this->curr_ack != NULLACK)
-        {
-            while ((this->head_p != NULL && this->head_p != this->send_p) &&
-                   ((this->head_p->seq != DLLP_SEQ_ID && this->head_p->seq <= this->curr_ack) ||
-                    (this->head_p->seq == DLLP_SEQ_ID)))
-            {
-                tmp_p = this->head_p;
-                this->head_p = this->head_p->NextPkt;
-                CheckFree(tmp_p->data);
-                CheckFree(tmp_p);
-            }
-            if (this->head_p == NULL)
-            {
-                this->head_p = this->end_p = this->send_p;
-            }
-            this->curr_ack = NULLACK;
-        }
-
-        // If we have received a NAK, reset the send pointer to the NAK'ed packet
-        if (this->curr_nak != NULLACK)
+        // Between packets, service received ACKs and NAKs, replay on a
+        // replay timer timeout, and send any ACK/NAK whose latency timer
+        // has expired
+        if (!usrconf->DisableAck && idx == 0)
         {
-            this->send_p = this->head_p;
-            while (this->send_p->seq > this->curr_nak)
-            {
-                this->send_p = this->send_p->NextPkt;
-            }
-            this->curr_nak = NULLACK;
+            ServiceAckNak(node);
+            CheckReplayTimer(node);
+            InsertAckNak(node);
         }
 
-        // If we've ACk/NAKs to send, insert to front of send list
-        if (this->nak_to_send_p != NULL && ((GetCycleCount(node) - this->nak_to_send_p->TimeStamp) > usrconf->AckRate))
+        // Loop through lanes
+        for (lanes = 0; lanes < this->LinkWidth; lanes++)
         {
-            // Snap shot the Nak to send (it may get overwritten by new input)
-            this->NakHolder = *(this->nak_to_send_p);
-            this->NakHolder.data = NakDataHolder;
-            for (i = 0; i < MAX_DLLP_BYTES; i++)
+            // At a packet boundary, select the next packet, with queued priority
+            // DLLPs going ahead of the send queue, and get the symbols to send if
+            // a new packet
+            if (idx == 0)
             {
-                NakDataHolder[i] = this->nak_to_send_p->data[i];
+                pkt_p = NextTxPkt(&next_p, node);
             }
-            this->NakHolder.NextPkt = this->send_p;
-            this->send_p = &(this->NakHolder);
-
-            // Free up current NAK memory
-            CheckFree(this->nak_to_send_p->data);
-            CheckFree(this->nak_to_send_p);
-
-            // Mark as sent
-            this->nak_to_send_p = NULL;
-        }
-
 
-        if (this->ack_to_send_p != NULL && ((GetCycleCount(node) - this->ack_to_send_p->TimeStamp) > usrconf->AckRate))
-        {
-            // Snap shot the Ack to send (it may get overwritten by new input)
-            this->AckHolder = *(this->ack_to_send_p);
-            this->AckHolder.data = AckDataHolder;
-            for (i = 0; i < MAX_DLLP_BYTES; i++)
+            if (pkt_p != txpkt)
             {
-                AckDataHolder[i] = this->ack_to_send_p->data[i];
+                txpkt  = pkt_p;
+                txdata = TxPktData(txpkt, node);
             }
-            this->AckHolder.NextPkt = this->send_p;
-            this->send_p = &(this->AckHolder);
-
-            // Free up current ACK memory
-            CheckFree(this->ack_to_send_p->data);
-            CheckFree(this->ack_to_send_p);
 
-            // Mark as sent
-            this->ack_to_send_p = NULL;
-        }
-    }
-
-    // Main output packet loop
-    do
-    {
-        // Loop through lanes
-        for (lanes = 0; lanes < this->LinkWidth; lanes++)
-        {
             // Flag when an SDP is output for this cycle (sticky)
-            if (!sdp_output && !padding && this->send_p)
+            if (!sdp_output && !padding && pkt_p)
             {
-                sdp_output = (this->send_p->data[idx] == SDP);
+                sdp_output = (idx == 0 && pkt_p->data[0] == SDP);
             }
 
             // Whilst in padding mode, encode to end of lanes with PAD, else encode data
             if (padding)
             {
-                LinkOut[lanes] = PAD;
+                LinkOut[lanes] = usrconf->EnableGen3 ? GEN3_IDL : PAD;
             }
             // If nothing to send (and not padding), output IDLE
-            else if (!this->send_p)
+            else if (!pkt_p)
             {
                 LinkOut[lanes] = 0;
             }
             else
             {
-                LinkOut[lanes] = this->send_p->data[idx++];
+                LinkOut[lanes] = this->inject ? InjectPktError(this, pkt_p, txdata, idx) : txdata[idx];
+                idx++;
+                this->linkstats.tx_pkt_symbols++;
             }
 
             // Encode the data
-            code = Encode(LinkOut[lanes], usrconf->DisableScrambling, usrconf->Disable8b10b, lanes, this->LinkWidth, node);
+            if (usrconf->EnableGen3)
+            {
+                code = Gen3TxEncode(this, LinkOut[lanes], lanes, false);
+            }
+            else
+            {
+                code = Encode(LinkOut[lanes], usrconf->DisableScrambling, usrconf->Disable8b10b, lanes, this->LinkWidth, node);
+            }
+
+            // Corrupt the code, if injecting errors
+            if (this->inject)
+            {
+                code = InjectLaneError(this, code, lanes);
+            }
 
             // Output codes to current lanes and read input
             LinkIn[lanes]  = (uint32_t)VWrite(LINKADDR0+lanes, code, lanes != this->LinkWidth-1, node);
@@ -198,12 +359,25 @@ void SendPacket(const int node)
             // Last lane
             if (lanes == (this->LinkWidth-1))
             {
-                // Display raw data
+                // Display and capture raw data
                 DispRaw(this, LinkOut, false);
+                TraceSym(this, LinkOut, false);
 
                 // Process input values
                 ExtractPhyInput(this, LinkIn);
 
+                // Input processing may have queued a packet when nothing to send
+                if (idx == 0)
+                {
+                    pkt_p = NextTxPkt(&next_p, node);
+                }
+
+                if (pkt_p != txpkt)
+                {
+                    txpkt  = pkt_p;
+                    txdata = TxPktData(txpkt, node);
+                }
+
                // Clear any padding status on last lane
                 padding = 0;
                 sdp_output = false;
@@ -214,35 +388,69 @@ void SendPacket(const int node)
                 // next to send is DLLP, or nothing to send.
                 if (!padding)
                 {
-                    padding = (this->send_p && (this->send_p->data[idx] == PKT_TERMINATION) && sdp_output &&
-                              (this->send_p->NextPkt != NULL) && (this->send_p->NextPkt->seq == DLLP_SEQ_ID));
+                    padding = (pkt_p && (txdata[idx] == PKT_TERMINATION) && sdp_output &&
+                              (next_p != NULL) && (next_p->seq == DLLP_SEQ_ID));
                 }
             }
 
             // At end of packet move to next unless padding
-            if (this->send_p)
+            if (pkt_p)
             {
-                if (!padding && this->send_p->data[idx] == PKT_TERMINATION)
+                if (!padding && txdata[idx] == PKT_TERMINATION)
                 {
-                    // At the end of the packet output DLLP/TLP to display
-                    if (this->send_p->data[0] == SDP)
+                    // At the end of the packet output DLLP/TLP to display and trace
+                    TracePkt(this, pkt_p, false);
+
+                    if (pkt_p->data[0] == SDP)
                     {
-                       DispDll(this, this->send_p, false);
+                       DispDll(this, pkt_p, false);
                     }
                     else
                     {
-                        DispTl(this, this->send_p, false);
+                        DispTl(this, pkt_p, false);
+                    }
+
+                    // A priority DLLP is not retried, so is removed from its queue and freed
+                    if (pkt_p == this->dllp_head_p)
+                    {
+                        this->dllp_head_p = pkt_p->NextPkt;
+                        if (this->dllp_head_p == NULL)
+                        {
+                            this->dllp_end_p = NULL;
+                        }
+                        CheckFree(pkt_p->data);
+                        CheckFree(pkt_p);
+                        txpkt = NULL;
+                    }
+                    else
+                    {
+                        // Start the replay timer on transmitting a TLP, if not running,
+                        // and count TLPs sent again by a replay
+                        if (this->send_p->seq != DLLP_SEQ_ID)
+                        {
+                            if (this->send_p->Retry)
+                            {
+                                this->replay.stats.tlps_replayed++;
+                            }
+                            else if (!this->replay.running)
+                            {
+                                this->replay.running = true;
+                                this->replay.start   = GetCycleCount(node);
+                            }
+                        }
+
+                        this->send_p->Retry += 1;
+                        this->send_p = this->send_p->NextPkt;
                     }
 
-                    this->send_p->Retry += 1;
-                    this->send_p = this->send_p->NextPkt;
                     idx = 0;
-                    padding = (this->send_p == NULL);
+                    pkt_p = NextTxPkt(&next_p, node);
+                    padding = (pkt_p == NULL);
                 }
             }
         }
     }
-    while (this->send_p != NULL);
+    while (this->send_p != NULL || this->dllp_head_p != NULL);
 
     // If acknowledges disabled, then delete all the packets
     // on the queue---the user code is responsible for retries
@@ -267,9 +475,169 @@ void SendPacket(const int node)
         SendOs(SKP, node);
     }
 
+#if !defined(EXCLUDE_LTSSM) && !defined(OSVVM)
+    // On a REPLAY_NUM rollover, retrain the link (CONFIG_REPLAY_RETRAIN)
+    if (this->replay.retrain)
+    {
+        this->replay.retrain = false;
+        this->replay.stats.retrains++;
+        RetrainLink(node);
+    }
+#endif
+
     DebugVPrint("** Exiting SendPacket (send_p=%p)\n", this->send_p);
 }
 
+// -------------------------------------------------------------------------
+// WaitForCredits()
+//
+// Call SendPacket to force out any packets on queue (that do have
+// space), or idle if queue empty, until there are enough transmit
+// credits of fc_type for a packet with payload_len bytes. Any wait is
+// recorded as a credit stall episode, and reported as a trigger event
+// if longer than configured.
+//
+// -------------------------------------------------------------------------
+
+static void WaitForCredits(const int fc_type, const int payload_len, const int node)
+{
+    uint32_t start   = this->TicksSinceReset;
+    bool     stalled = false;
+
+    while (!CheckCredits(this->usrconf.DisableFc,
+                         this->flwcntl.fc_state[0],
+                         this->flwcntl.FlowCntlHdrCredits[0][fc_type],
+                         this->flwcntl.FlowCntlDataCredits[0][fc_type],
+                         this->flwcntl.TxHdrCredits[0][fc_type],
+                         this->flwcntl.TxDataCredits[0][fc_type],
+                         payload_len))
+    {
+        if (!stalled)
+        {
+            StallBegin(this, STALL_SRC_TX, fc_type, payload_len);
+            stalled = true;
+        }
+
+        SendPacket(node);
+
+        if (this->usrconf.TrigConditions && (this->TicksSinceReset - start) > this->usrconf.TrigStallCycles)
+        {
+            TrigEvent(this, TRIG_CREDIT_STALL);
+        }
+    }
+
+    if (stalled)
+    {
+        StallEnd(this, STALL_SRC_TX);
+    }
+}
+
+// -------------------------------------------------------------------------
+// SubmitTlp()
+//
+// Submit a new TLP of FC type fc_type for sending. With transmit
+// queues configured, the TLP is added to its type's queue (completions
+// to the completion delay queue) and the arbiter run. Otherwise, waits
+// for credits and releases the TLP straight to the send queue.
+//
+// -------------------------------------------------------------------------
+
+static void SubmitTlp(const int fc_type, const pPkt_t packet, const int node)
+{
+    if (this->usrconf.TxQueueDepth)
+    {
+        if (fc_type == FC_CMPL)
+        {
+            packet->TimeStamp = this->TicksSinceReset;
+            AddPktToQueueTimed(this, packet);
+        }
+        else
+        {
+            TxQueueAdd(this, packet, fc_type);
+        }
+
+        TxArbitrate(this);
+    }
+    else
+    {
+        if (!this->usrconf.DisableFc)
+        {
+            WaitForCredits(fc_type, TlpPayloadLen(packet->data), node);
+        }
+
+        TlpRelease(this, packet, fc_type);
+    }
+}
+
+// -------------------------------------------------------------------------
+// CheckTag()
+//
+// Check an explicit tag is valid for the configured tag size, so that
+// tags of 256 or more (setting T9 or T8) are only sent when 10-bit tags
+// are enabled
+//
+// -------------------------------------------------------------------------
+
+static int CheckTag(const int tag, const char* caller, const int node)
+{
+    if (tag < 0 || tag >= (this->usrconf.Tag10Bit ? TAG_MAX_10BIT : TAG_MAX_8BIT))
+    {
+        VPrint("%s: %s***Error --- invalid tag (%d) at node %d%s\n", caller, fmterrstr, tag, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    return tag;
+}
+
+// -------------------------------------------------------------------------
+// PostedTag()
+//
+// Check a posted request's tag, which is not allocated from the tag
+// pool. TAG_AUTO gives a tag of 0.
+//
+// -------------------------------------------------------------------------
+
+static int PostedTag(const int tag, const char* caller, const int node)
+{
+    return (tag == TAG_AUTO) ? 0 : CheckTag(tag, caller, node);
+}
+
+// -------------------------------------------------------------------------
+// RequestTag()
+//
+// Check a non-posted request's tag is valid for the configured tag size,
+// or, for TAG_AUTO, take a free tag from the tag pool. If the pool is
+// empty, calls SendPacket to force out queued packets, or idle, until
+// a completion returns a tag to the pool.
+//
+// -------------------------------------------------------------------------
+
+static int RequestTag(const int tag, const char* caller, const int node)
+{
+    uint32_t start;
+    int      alloc;
+
+    if (tag != TAG_AUTO)
+    {
+        return CheckTag(tag, caller, node);
+    }
+
+    if ((alloc = TagAlloc(this)) < 0)
+    {
+        start = this->TicksSinceReset;
+        this->tags.stats.waits++;
+
+        while ((alloc = TagAlloc(this)) < 0)
+        {
+            SendPacket(node);
+        }
+
+        this->tags.stats.wait_cycles += this->TicksSinceReset - start;
+    }
+
+    return alloc;
+}
+
 // -------------------------------------------------------------------------
 // MemWrite()
 //
@@ -288,12 +656,12 @@ pPktData_t MemWrite (const uint64_t addr, const PktData_t *data, const int lengt
     return MemWriteDigest (addr, data, length, tag, rid, true, queue, node);
 }
 
-pPktData_t MemWriteDigest (const uint64_t addr, const PktData_t *data, const int length, const int tag, const uint32_t rid, const bool digest,
+pPktData_t MemWriteDigest (const uint64_t addr, const PktData_t *data, const int length, const int req_tag, const uint32_t rid, const bool digest,
                            const bool queue, const int node)
 {
     PktData_t *pkt_p, *data_p;
     pPkt_t packet;
-    int i;
+    int tag;
 
     // Do some checks
     if (node < 0 || node >= VP_MAX_NODES)
@@ -319,6 +687,8 @@ pPktData_t MemWriteDigest (const uint64_t addr, const PktData_t *data, const int
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
+    tag = PostedTag(req_tag, "MemWriteDigest", node);
+
     // Create a template for a mem write
     if ((pkt_p = CreateTlpTemplate (TL_MWR64, addr, length, digest, &data_p)) == NULL)
     {
@@ -326,22 +696,18 @@ pPktData_t MemWriteDigest (const uint64_t addr, const PktData_t *data, const int
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
-    // Set the tag and sequence number of the packet
+    // Set the tag, requester ID and ordering attributes of the packet
     SET_TLP_TAG(tag, pkt_p);
     SET_TLP_RID(rid, pkt_p);
-    SET_DLLP_SEQ(this->seq, pkt_p);
+    SET_TLP_ATTR(this->usrconf.TxAttr, pkt_p);
 
-    for (i = 0; i < length; i++)
-    {
-        data_p[i] = (PktData_t)data[i];
-    }
+    PcieKernelCopy(data_p, data, length);
 
-    // Calc CRCs
+    // Calc ECRC
     if (digest)
     {
         CalcEcrc(pkt_p);
     }
-    CalcLcrc(pkt_p);
 
     if ((packet = (pPkt_t)calloc(sizeof(sPkt_t), 1)) == NULL)
     {
@@ -351,39 +717,14 @@ pPktData_t MemWriteDigest (const uint64_t addr, const PktData_t *data, const int
 
     packet->NextPkt = NULL;
     packet->data = pkt_p;
-    packet->seq = this->seq;
     packet->Retry = 0;
 
-    this->seq++;
+    SubmitTlp(FC_POST, packet, node);
 
-    // Check there's enough space. If not call SendPacket to force out
-    // any packets on queue (that do have space), or idle if queue empty
-    if (!this->usrconf.DisableFc)
+    if (!queue)
     {
-        while (!CheckCredits(this->usrconf.DisableFc,
-                             this->flwcntl.fc_state[0],
-                             this->flwcntl.FlowCntlHdrCredits[0][FC_POST],
-                             this->flwcntl.FlowCntlDataCredits[0][FC_POST],
-                             this->flwcntl.TxHdrCredits[0][FC_POST],
-                             this->flwcntl.TxDataCredits[0][FC_POST],
-                             GET_TLP_LENGTH_ADJ(packet->data)))
-        {
-            SendPacket(node);
-        }
-    }
-
-    AddPktToQueue(this, packet);
-
-    if (!this->usrconf.DisableFc)
-    {
-        this->flwcntl.TxHdrCredits[0][FC_POST]++;
-        this->flwcntl.TxDataCredits[0][FC_POST] += GET_TLP_LENGTH_ADJ(packet->data)/4 + ((GET_TLP_LENGTH_ADJ(packet->data)%4) ? 1 : 0);
-    }
-
-    if (!queue)
-    {
-        SendPacket (node);
-        return NULL;
+        SendPacket (node);
+        return NULL;
     }
     else
     {
@@ -416,12 +757,12 @@ pPktData_t MemReadDigest (const uint64_t addr, const int length, const int tag,
     return MemReadLockDigest(addr, length, tag, rid, false, digest, queue, node);
 }
 
-pPktData_t MemReadLockDigest (const uint64_t addr, const int length, const int tag, const uint32_t rid,
+pPktData_t MemReadLockDigest (const uint64_t addr, const int length, const int req_tag, const uint32_t rid,
                               const bool lock, const bool digest, const bool queue, const int node)
 {
     PktData_t *pkt_p, *data_p;
     pPkt_t packet;
-    int i;
+    int i, tag;
 
     // Do some checks
     if (node < 0 || node >= VP_MAX_NODES)
@@ -447,6 +788,9 @@ pPktData_t MemReadLockDigest (const uint64_t addr, const int length, const int t
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
+    // Take a tag from the pool for TAG_AUTO
+    tag = RequestTag(req_tag, "MemReadDigest", node);
+
     // Create a template for a mem read
     if ((pkt_p = CreateTlpTemplate (TL_MRD64 | (lock ? 1 : 0), addr, length, digest, &data_p)) == NULL)
     {
@@ -454,17 +798,16 @@ pPktData_t MemReadLockDigest (const uint64_t addr, const int length, const int t
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
-    // Set the tag and sequence number of the packet
+    // Set the tag, requester ID and ordering attributes of the packet
     SET_TLP_TAG(tag, pkt_p);
     SET_TLP_RID(rid, pkt_p);
-    SET_DLLP_SEQ(this->seq, pkt_p);
+    SET_TLP_ATTR(this->usrconf.TxAttr, pkt_p);
 
-    // Calc CRCs
+    // Calc ECRC
     if (digest)
     {
         CalcEcrc(pkt_p);
     }
-    CalcLcrc(pkt_p);
 
     if ((packet = calloc(sizeof(sPkt_t), 1)) == NULL)
     {
@@ -474,32 +817,14 @@ pPktData_t MemReadLockDigest (const uint64_t addr, const int length, const int t
 
     packet->NextPkt = NULL;
     packet->data = pkt_p;
-    packet->seq = this->seq;
     packet->Retry = 0;
 
-    this->seq++;
     this->OutstandingCompletions++;
 
-    if (!this->usrconf.DisableFc)
-    {
-        while (!CheckCredits(this->usrconf.DisableFc,
-                             this->flwcntl.fc_state[0],
-                             this->flwcntl.FlowCntlHdrCredits[0][FC_NONPOST],
-                             this->flwcntl.FlowCntlDataCredits[0][FC_NONPOST],
-                             this->flwcntl.TxHdrCredits[0][FC_NONPOST],
-                             this->flwcntl.TxDataCredits[0][FC_NONPOST],
-                             0))
-        {
-            SendPacket(node);
-        }
-    }
-
-    AddPktToQueue(this, packet);
+    SubmitTlp(FC_NONPOST, packet, node);
 
-    if (!this->usrconf.DisableFc)
-    {
-        this->flwcntl.TxHdrCredits[0][FC_NONPOST]++;
-    }
+    // Record the request as outstanding, time stamped for latency statistics
+    TagIssue(this, LAT_MEM_RD, tag, addr, length);
 
     if (!queue)
     {
@@ -573,6 +898,11 @@ pPktData_t CompletionDelay (const uint64_t addr, const PktData_t *data, const in
 // not final for given request (tag). Equal length and
 // rlength indicates whole or final completion packet.
 //
+// Delayed completions are held by the completion scheduler
+// (see CheckDelayQueue()) until their process time and there
+// are enough completion credits, and are given their sequence
+// number when released.
+//
 // -------------------------------------------------------------------------
 
 pPktData_t PartCompletion (const uint64_t addr, const PktData_t *data, const int status, const int fbe, const int lbe,
@@ -595,7 +925,7 @@ pPktData_t PartCompletionLockDelay (const uint64_t addr, const PktData_t *data,
 {
     PktData_t *pkt_p, *data_p;
     pPkt_t packet;
-    int i;
+    bool profiled;
 
     // Do some checks
     if (node < 0 || node >= VP_MAX_NODES)
@@ -630,19 +960,15 @@ pPktData_t PartCompletionLockDelay (const uint64_t addr, const PktData_t *data,
     SET_CPL_STATUS(status, pkt_p);
     SET_CPL_BYTE_COUNT(status ? 4 : CalcByteCount(rlength, fbe, lbe), pkt_p);
     SET_CPL_LOW_ADDR(status ? 0 : (addr | CalcLoAddr(fbe)) & 0x7f, pkt_p);
-    SET_DLLP_SEQ(this->seq, pkt_p);
+    SET_TLP_ATTR(this->CplAttr, pkt_p);
 
-    for (i = 0; i < (length*4); i++)
-    {
-        data_p[i] = data[i] & 0xff;
-    }
+    PcieKernelCopyMask8(data_p, data, length*4);
 
-    // Calc CRCs
+    // Calc ECRC. The sequence number and LCRC are added when queued for sending.
     if (digest)
     {
         CalcEcrc(pkt_p);
     }
-    CalcLcrc(pkt_p);
 
     if ((packet = calloc(sizeof(sPkt_t), 1)) == NULL)
     {
@@ -652,41 +978,34 @@ pPktData_t PartCompletionLockDelay (const uint64_t addr, const PktData_t *data,
 
     packet->NextPkt = NULL;
     packet->data = pkt_p;
-    packet->seq = this->seq;
     packet->Retry = 0;
     packet->TimeStamp = this->TicksSinceReset;
 
-    if (!this->usrconf.DisableFc)
+    // A completer timing profile's ready time for the read replaces the
+    // configured delay, whether enabled or not. Taken now, before anything
+    // that may process further reads.
+    profiled = CplProfileTake(this, &packet->TimeStamp);
+
+    // Delayed and profiled completions wait for credits in the completion
+    // scheduler. So do completions made whilst SendPacket() is processing
+    // input (e.g. from a user callback), as credits can't be waited for there.
+    if (profiled)
     {
-        while (!CheckCredits(this->usrconf.DisableFc,
-                             this->flwcntl.fc_state[0],
-                             this->flwcntl.FlowCntlHdrCredits[0][FC_CMPL],
-                             this->flwcntl.FlowCntlDataCredits[0][FC_CMPL],
-                             this->flwcntl.TxHdrCredits[0][FC_CMPL],
-                             this->flwcntl.TxDataCredits[0][FC_CMPL],
-                             GET_TLP_LENGTH_ADJ(packet->data)))
-        {
-            SendPacket(node);
-        }
+        AddPktToQueueTimed(this, packet);
     }
-
-    if (delay)
+    else if (delay)
     {
         AddPktToQueueDelay(this, packet);
     }
-    else
+    else if (this->draining_queue)
     {
-        AddPktToQueue(this, packet);
+        AddPktToQueueTimed(this, packet);
     }
-
-    if (!this->usrconf.DisableFc)
+    else
     {
-        this->flwcntl.TxHdrCredits[0][FC_CMPL]++;
-        this->flwcntl.TxDataCredits[0][FC_CMPL] += GET_TLP_LENGTH_ADJ(packet->data)/4 + ((GET_TLP_LENGTH_ADJ(packet->data)%4) ? 1 : 0);
+        SubmitTlp(FC_CMPL, packet, node);
     }
 
-    this->seq++;
-
     if (!queue)
     {
         SendPacket (node);
@@ -716,12 +1035,12 @@ pPktData_t IoWrite (const uint64_t addr, const PktData_t *data, const int length
     return IoWriteDigest(addr, data, length, tag, rid, true, queue, node);
 }
 
-pPktData_t IoWriteDigest (const uint64_t addr, const PktData_t *data, const int length, const int tag, const uint32_t rid, const bool digest,
+pPktData_t IoWriteDigest (const uint64_t addr, const PktData_t *data, const int length, const int req_tag, const uint32_t rid, const bool digest,
                           const bool queue, const int node)
 {
     PktData_t *pkt_p, *data_p;
     pPkt_t packet;
-    int i;
+    int tag;
 
     // Do some checks
     if (node < 0 || node >= VP_MAX_NODES)
@@ -747,6 +1066,9 @@ pPktData_t IoWriteDigest (const uint64_t addr, const PktData_t *data, const int
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
+    // Take a tag from the pool for TAG_AUTO
+    tag = RequestTag(req_tag, "IoWriteDigest", node);
+
     // Create a template for an IO write
     if ((pkt_p = CreateTlpTemplate (TL_IOWR, addr, length, digest, &data_p)) == NULL)
     {
@@ -754,22 +1076,17 @@ pPktData_t IoWriteDigest (const uint64_t addr, const PktData_t *data, const int
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
-    // Set the tag and sequence number of the packet
+    // Set the tag and requester ID of the packet
     SET_TLP_TAG(tag, pkt_p);
     SET_TLP_RID(rid, pkt_p);
-    SET_DLLP_SEQ(this->seq, pkt_p);
 
-    for (i = 0; i < length; i++)
-    {
-        data_p[i] = (PktData_t)data[i];
-    }
+    PcieKernelCopy(data_p, data, length);
 
-    // Calc CRCs
+    // Calc ECRC
     if (digest)
     {
         CalcEcrc(pkt_p);
     }
-    CalcLcrc(pkt_p);
 
     if ((packet = calloc(sizeof(sPkt_t), 1)) == NULL)
     {
@@ -779,33 +1096,14 @@ pPktData_t IoWriteDigest (const uint64_t addr, const PktData_t *data, const int
 
     packet->NextPkt = NULL;
     packet->data = pkt_p;
-    packet->seq = this->seq;
     packet->Retry = 0;
 
-    this->seq++;
     this->OutstandingCompletions++;
 
-    if (!this->usrconf.DisableFc)
-    {
-        while (!CheckCredits(this->usrconf.DisableFc,
-                             this->flwcntl.fc_state[0],
-                             this->flwcntl.FlowCntlHdrCredits[0][FC_NONPOST],
-                             this->flwcntl.FlowCntlDataCredits[0][FC_NONPOST],
-                             this->flwcntl.TxHdrCredits[0][FC_NONPOST],
-                             this->flwcntl.TxDataCredits[0][FC_NONPOST],
-                             GET_TLP_LENGTH_ADJ(packet->data)))
-        {
-            SendPacket(node);
-        }
-    }
-
-    AddPktToQueue(this, packet);
+    SubmitTlp(FC_NONPOST, packet, node);
 
-    if (!this->usrconf.DisableFc)
-    {
-        this->flwcntl.TxHdrCredits[0][FC_NONPOST]++;
-        this->flwcntl.TxDataCredits[0][FC_NONPOST] += GET_TLP_LENGTH_ADJ(packet->data)/4 + ((GET_TLP_LENGTH_ADJ(packet->data)%4) ? 1 : 0);
-    }
+    // Record the request as outstanding, time stamped for latency statistics
+    TagIssue(this, LAT_IO_WR, tag, addr, length);
 
     if (!queue)
     {
@@ -830,11 +1128,11 @@ pPktData_t IoRead (const uint64_t addr, const int length, const int tag, const u
     return IoReadDigest (addr, length, tag, rid, true, queue, node);
 }
 
-pPktData_t IoReadDigest (const uint64_t addr, const int length, const int tag, const uint32_t rid, const bool digest, const bool queue, const int node)
+pPktData_t IoReadDigest (const uint64_t addr, const int length, const int req_tag, const uint32_t rid, const bool digest, const bool queue, const int node)
 {
     PktData_t *pkt_p, *data_p;
     pPkt_t packet;
-    int i;
+    int i, tag;
 
     // Do some checks
     if (node < 0 || node >= VP_MAX_NODES)
@@ -860,6 +1158,9 @@ pPktData_t IoReadDigest (const uint64_t addr, const int length, const int tag, c
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
+    // Take a tag from the pool for TAG_AUTO
+    tag = RequestTag(req_tag, "IoReadDigest", node);
+
     // Create a template for an IO read
     if ((pkt_p = CreateTlpTemplate (TL_IORD, addr, length, digest, &data_p)) == NULL)
     {
@@ -867,17 +1168,15 @@ pPktData_t IoReadDigest (const uint64_t addr, const int length, const int tag, c
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
-    // Set the tag and sequence number of the packet
+    // Set the tag and requester ID of the packet
     SET_TLP_TAG(tag, pkt_p);
     SET_TLP_RID(rid, pkt_p);
-    SET_DLLP_SEQ(this->seq, pkt_p);
 
-    // Calc CRCs
+    // Calc ECRC
     if (digest)
     {
         CalcEcrc(pkt_p);
     }
-    CalcLcrc(pkt_p);
 
     if ((packet = calloc(sizeof(sPkt_t), 1)) == NULL)
     {
@@ -887,32 +1186,14 @@ pPktData_t IoReadDigest (const uint64_t addr, const int length, const int tag, c
 
     packet->NextPkt = NULL;
     packet->data = pkt_p;
-    packet->seq = this->seq;
     packet->Retry = 0;
 
-    this->seq++;
     this->OutstandingCompletions++;
 
-    if (!this->usrconf.DisableFc)
-    {
-        while (!CheckCredits(this->usrconf.DisableFc,
-                             this->flwcntl.fc_state[0],
-                             this->flwcntl.FlowCntlHdrCredits[0][FC_NONPOST],
-                             this->flwcntl.FlowCntlDataCredits[0][FC_NONPOST],
-                             this->flwcntl.TxHdrCredits[0][FC_NONPOST],
-                             this->flwcntl.TxDataCredits[0][FC_NONPOST],
-                             0))
-        {
-            SendPacket(node);
-        }
-    }
-
-    AddPktToQueue(this, packet);
+    SubmitTlp(FC_NONPOST, packet, node);
 
-    if (!this->usrconf.DisableFc)
-    {
-        this->flwcntl.TxHdrCredits[0][FC_NONPOST]++;
-    }
+    // Record the request as outstanding, time stamped for latency statistics
+    TagIssue(this, LAT_IO_RD, tag, addr, length);
 
     if (!queue)
     {
@@ -940,12 +1221,12 @@ pPktData_t CfgWrite (const uint64_t addr, const PktData_t *data, const int lengt
     return CfgWriteDigest (addr, data, length, tag, rid, true, queue, node);
 }
 
-pPktData_t CfgWriteDigest (const uint64_t addr, const PktData_t *data, const int length, const int tag, const uint32_t rid, const bool digest,
+pPktData_t CfgWriteDigest (const uint64_t addr, const PktData_t *data, const int length, const int req_tag, const uint32_t rid, const bool digest,
                            const bool queue, const int node)
 {
     PktData_t *pkt_p, *data_p;
     pPkt_t packet;
-    int i;
+    int tag;
 
     // Do some checks
     if (node < 0 || node >= VP_MAX_NODES)
@@ -971,6 +1252,9 @@ pPktData_t CfgWriteDigest (const uint64_t addr, const PktData_t *data, const int
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
+    // Take a tag from the pool for TAG_AUTO
+    tag = RequestTag(req_tag, "CfgWriteDigest", node);
+
     // Create a template for a cfg write
     if ((pkt_p = CreateTlpTemplate (TL_CFGWR0, addr, length, digest, &data_p)) == NULL)
     {
@@ -978,23 +1262,18 @@ pPktData_t CfgWriteDigest (const uint64_t addr, const PktData_t *data, const int
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
-    // Set the tag and sequence number of the packet
+    // Set the tag and requester ID of the packet
     SET_CFG_TAG(tag, pkt_p);
     SET_CFG_RID(rid, pkt_p);
     SET_CFG_CID((uint32_t)(addr >> 16), pkt_p);
-    SET_DLLP_SEQ(this->seq, pkt_p);
 
-    for (i = 0; i < length; i++)
-    {
-        data_p[i] = (PktData_t)data[i];
-    }
+    PcieKernelCopy(data_p, data, length);
 
-    // Calc CRCs
+    // Calc ECRC
     if (digest)
     {
         CalcEcrc(pkt_p);
     }
-    CalcLcrc(pkt_p);
 
     if ((packet = calloc(sizeof(sPkt_t), 1)) == NULL)
     {
@@ -1004,33 +1283,14 @@ pPktData_t CfgWriteDigest (const uint64_t addr, const PktData_t *data, const int
 
     packet->NextPkt = NULL;
     packet->data = pkt_p;
-    packet->seq = this->seq;
     packet->Retry = 0;
 
-    this->seq++;
     this->OutstandingCompletions++;
 
-    if (!this->usrconf.DisableFc)
-    {
-        while (!CheckCredits(this->usrconf.DisableFc,
-                             this->flwcntl.fc_state[0],
-                             this->flwcntl.FlowCntlHdrCredits[0][FC_NONPOST],
-                             this->flwcntl.FlowCntlDataCredits[0][FC_NONPOST],
-                             this->flwcntl.TxHdrCredits[0][FC_NONPOST],
-                             this->flwcntl.TxDataCredits[0][FC_NONPOST],
-                             GET_TLP_LENGTH_ADJ(packet->data)))
-        {
-            SendPacket(node);
-        }
-    }
-
-    AddPktToQueue(this, packet);
+    SubmitTlp(FC_NONPOST, packet, node);
 
-    if (!this->usrconf.DisableFc)
-    {
-        this->flwcntl.TxHdrCredits[0][FC_NONPOST]++;
-        this->flwcntl.TxDataCredits[0][FC_NONPOST] += GET_TLP_LENGTH_ADJ(packet->data)/4 + ((GET_TLP_LENGTH_ADJ(packet->data)%4) ? 1 : 0);
-    }
+    // Record the request as outstanding, time stamped for latency statistics
+    TagIssue(this, LAT_CFG_WR, tag, addr, length);
 
     if (!queue)
     {
@@ -1056,12 +1316,12 @@ pPktData_t CfgRead (const uint64_t addr, const int length, const int tag, const
     return CfgReadDigest(addr, length, tag, rid, true, queue, node);
 }
 
-pPktData_t CfgReadDigest (const uint64_t addr, const int length, const int tag, const uint32_t rid, const bool digest,
+pPktData_t CfgReadDigest (const uint64_t addr, const int length, const int req_tag, const uint32_t rid, const bool digest,
                           const bool queue, const int node)
 {
     PktData_t *pkt_p, *data_p;
     pPkt_t packet;
-    int i;
+    int i, tag;
 
     // Do some checks
     if (node < 0 || node >= VP_MAX_NODES)
@@ -1087,6 +1347,9 @@ pPktData_t CfgReadDigest (const uint64_t addr, const int length, const int tag,
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
+    // Take a tag from the pool for TAG_AUTO
+    tag = RequestTag(req_tag, "CfgReadDigest", node);
+
     // Create a template for a cfg read
     if ((pkt_p = CreateTlpTemplate (TL_CFGRD0, addr, length, digest, &data_p)) == NULL)
     {
@@ -1094,18 +1357,16 @@ pPktData_t CfgReadDigest (const uint64_t addr, const int length, const int tag,
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
-    // Set the tag and sequence number of the packet
+    // Set the tag and requester ID of the packet
     SET_TLP_TAG(tag, pkt_p);
     SET_CFG_RID(rid, pkt_p);
     SET_CFG_CID((uint32_t)(addr >> 16), pkt_p);
-    SET_DLLP_SEQ(this->seq, pkt_p);
 
-    // Calc CRCs
+    // Calc ECRC
     if (digest)
     {
         CalcEcrc(pkt_p);
     }
-    CalcLcrc(pkt_p);
 
     if ((packet = calloc(sizeof(sPkt_t), 1)) == NULL)
     {
@@ -1115,32 +1376,14 @@ pPktData_t CfgReadDigest (const uint64_t addr, const int length, const int tag,
 
     packet->NextPkt = NULL;
     packet->data = pkt_p;
-    packet->seq = this->seq;
     packet->Retry = 0;
 
-    this->seq++;
     this->OutstandingCompletions++;
 
-    if (!this->usrconf.DisableFc)
-    {
-        while (!CheckCredits(this->usrconf.DisableFc,
-                             this->flwcntl.fc_state[0],
-                             this->flwcntl.FlowCntlHdrCredits[0][FC_NONPOST],
-                             this->flwcntl.FlowCntlDataCredits[0][FC_NONPOST],
-                             this->flwcntl.TxHdrCredits[0][FC_NONPOST],
-                             this->flwcntl.TxDataCredits[0][FC_NONPOST],
-                             0))
-        {
-            SendPacket(node);
-        }
-    }
-
-    AddPktToQueue(this, packet);
+    SubmitTlp(FC_NONPOST, packet, node);
 
-    if (!this->usrconf.DisableFc)
-    {
-        this->flwcntl.TxHdrCredits[0][FC_NONPOST]++;
-    }
+    // Record the request as outstanding, time stamped for latency statistics
+    TagIssue(this, LAT_CFG_RD, tag, addr, length);
 
     if (!queue)
     {
@@ -1176,12 +1419,12 @@ pPktData_t MessageDigest (const int code, const PktData_t *data, const int lengt
     return MessageVendorDigest(code, data, length, tag, rid, 0ULL, digest, queue, node);
 }
 
-pPktData_t MessageVendorDigest (const int code, const PktData_t *data, const int length, const int tag, const uint32_t rid, const uint64_t vend_data,
+pPktData_t MessageVendorDigest (const int code, const PktData_t *data, const int length, const int req_tag, const uint32_t rid, const uint64_t vend_data,
                                 const bool digest, const bool queue, const int node)
 {
     PktData_t *pkt_p, *data_p;
     pPkt_t packet;
-    int type, routing, i;
+    int type, routing, tag;
 
     if (node < 0 || node >= VP_MAX_NODES)
     {
@@ -1249,6 +1492,8 @@ pPktData_t MessageVendorDigest (const int code, const PktData_t *data, const int
         break;
     }
 
+    tag = PostedTag(req_tag, "MessageDigest", node);
+
     // Create a template for a message
     if ((pkt_p = CreateTlpTemplate (type | routing, 0, length, digest, &data_p)) == NULL)
     {
@@ -1268,23 +1513,18 @@ pPktData_t MessageVendorDigest (const int code, const PktData_t *data, const int
         pkt_p[18] = (PktData_t)((vend_data >> 56) & 0xffULL);
     }
 
-    // Set the tag and sequence number of the packet
+    // Set the tag and requester ID of the packet
     SET_TLP_TAG(tag, pkt_p);
     SET_TLP_RID(rid, pkt_p);
     SET_MSG_CODE(code, pkt_p);
-    SET_DLLP_SEQ(this->seq, pkt_p);
 
-    for (i = 0; i < length; i++)
-    {
-        data_p[i] = (PktData_t)data[i];
-    }
+    PcieKernelCopy(data_p, data, length);
 
-    // Calc CRCs
+    // Calc ECRC
     if (digest)
     {
         CalcEcrc(pkt_p);
     }
-    CalcLcrc(pkt_p);
 
     if ((packet = calloc(sizeof(sPkt_t), 1)) == NULL)
     {
@@ -1294,32 +1534,9 @@ pPktData_t MessageVendorDigest (const int code, const PktData_t *data, const int
 
     packet->NextPkt = NULL;
     packet->data = pkt_p;
-    packet->seq  = this->seq;
     packet->Retry = 0;
 
-    this->seq++;
-
-    if (!this->usrconf.DisableFc)
-    {
-        while (!CheckCredits(this->usrconf.DisableFc,
-                             this->flwcntl.fc_state[0],
-                             this->flwcntl.FlowCntlHdrCredits[0][FC_POST],
-                             this->flwcntl.FlowCntlDataCredits[0][FC_POST],
-                             this->flwcntl.TxHdrCredits[0][FC_POST],
-                             this->flwcntl.TxDataCredits[0][FC_POST],
-                             length ? GET_TLP_LENGTH_ADJ(packet->data) : 0))
-        {
-            SendPacket(node);
-        }
-    }
-
-    AddPktToQueue(this, packet);
-
-    if (!this->usrconf.DisableFc)
-    {
-        this->flwcntl.TxHdrCredits[0][FC_POST]++;
-        this->flwcntl.TxDataCredits[0][FC_POST] += length ? GET_TLP_LENGTH_ADJ(packet->data)/4 + ((GET_TLP_LENGTH_ADJ(packet->data)%4) ? 1 : 0) : 0;
-    }
+    SubmitTlp(FC_POST, packet, node);
 
     if (!queue)
     {
@@ -1344,7 +1561,8 @@ pPktData_t MessageVendorDigest (const int code, const PktData_t *data, const int
 // an outstanding ack is sent, it overwrites it, if it meets
 // the right criteria. The latest ack is sent from SendPacket()
 // in between other traffic whenever the ack_to_send_p indicates
-// that there is one to send.
+// that there is one to send, and its AckNak latency timer has
+// expired, for the configured policy (CONFIG_ACK_POLICY).
 //
 // -------------------------------------------------------------------------
 
@@ -1372,9 +1590,18 @@ void SendAck (const int sequence, const int node)
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
-    // If no Ack pending, or requested Ack is higher than current sequence, generate
+    this->ackstats.ack_requests++;
+
+    // An Ack already pending covers this one, saving a DLLP
+    if (this->ack_to_send_p != NULL)
+    {
+        this->ackstats.acks_coalesced++;
+        this->ackstats.symbols_saved += ACK_DLLP_SYMBOLS;
+    }
+
+    // If no Ack pending, or requested Ack is later than current sequence, generate
     // a new packet and set Ack pointer to it
-    if (this->ack_to_send_p == NULL || sequence > GET_DLLP_SEQ(this->ack_to_send_p->data))
+    if (this->ack_to_send_p == NULL || SEQ_LT(GET_DLLP_SEQ(this->ack_to_send_p->data), sequence))
     {
 
         // Free up space for superseded Ack
@@ -1456,14 +1683,14 @@ void SendNak (const int sequence, const int node)
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
-    // If no Nak pending, or requested Nak is lowest sequence, generate
+    // If no Nak pending, or requested Nak is earliest sequence, generate
     // a new packet and set NAK pointer to it
-    if (this->nak_to_send_p == NULL || sequence < GET_DLLP_SEQ(this->nak_to_send_p->data))
+    if (this->nak_to_send_p == NULL || SEQ_LT(sequence, GET_DLLP_SEQ(this->nak_to_send_p->data)))
     {
         // Free up space for superseded Nak
         if (this->nak_to_send_p != NULL)
         {
-            OldTimeStamp = this->ack_to_send_p->TimeStamp;
+            OldTimeStamp = this->nak_to_send_p->TimeStamp;
             CheckFree(this->nak_to_send_p->data);
             CheckFree(this->nak_to_send_p);
         }
@@ -1519,9 +1746,7 @@ void SendNak (const int sequence, const int node)
 
 void SendFC (const int type, const int vc, const int hdrfc, const int datafc, const bool queue, const int node)
 {
-    PktData_t *pkt_p, *data_p;
     pPkt_t packet;
-    int Encoding;
 
     DebugVPrint("** SendFC: type=%d hdrfc=%d datafc=%d queue=%d\n", type, hdrfc, datafc, queue);
 
@@ -1548,28 +1773,7 @@ void SendFC (const int type, const int vc, const int hdrfc, const int datafc, co
         VWrite(PVH_FATAL, 0, 0, node);
     }
 
-    Encoding = type | (vc & DL_VC_BITS);
-
-    pkt_p = CreateDllpTemplate (Encoding, &data_p);
-
-    data_p[0] = (PktData_t)(hdrfc >> 2) & 0x3f;
-    data_p[1] = (PktData_t)(((hdrfc & 0x3) << 6) | ((datafc >> 8) & 0xf));
-    data_p[2] = (PktData_t)(datafc & BYTE_MASK);
-
-    // Calc CRC
-    CalcDllpCrc(pkt_p);
-
-    if ((packet = calloc(1, sizeof(sPkt_t))) == NULL)
-    {
-        VPrint( "SendFC: %s***Error --- memory allocation failed at node %d%s\n", fmterrstr, node, fmtnormstr);
-        VWrite(PVH_FATAL, 0, 0, node);
-    }
-
-    packet->NextPkt = NULL;
-    packet->data = pkt_p;
-    packet->seq = DLLP_SEQ_ID;
-    packet->Retry = 0;
-    packet->ByteCount = 8;
+    packet = CreateFcPkt(type | (vc & DL_VC_BITS), hdrfc, datafc, node);
 
     AddPktToQueue(this, packet);
 
@@ -1686,6 +1890,114 @@ void SendVendor (const bool queue, const int data, const int node)
     }
 }
 
+// -------------------------------------------------------------------------
+// Gen3SendSymbols()
+//
+// Output a symbol time of Gen3 data or OS block symbols on all lanes
+// and process the input
+//
+// -------------------------------------------------------------------------
+
+static void Gen3SendSymbols (PktData_t* LinkOut, const bool os_block, const int node)
+{
+    uint32_t LinkIn [MAX_LINK_WIDTH];
+
+    for (int lanes = 0; lanes < this->LinkWidth; lanes++)
+    {
+        LinkIn[lanes] = VWrite(LINKADDR0+lanes, Gen3TxEncode(this, LinkOut[lanes], lanes, os_block), lanes != this->LinkWidth-1, node);
+    }
+
+    DispRaw(this, LinkOut, false);
+    TraceSym(this, LinkOut, false);
+
+    ExtractPhyInput(this, LinkIn);
+}
+
+// -------------------------------------------------------------------------
+// Gen3SendEds()
+//
+// If a Gen3 data stream is active, end it with an EDS token in the last
+// DW of a data block, idling to the end of the current block first if
+// the token doesn't fit in what's left of it
+//
+// -------------------------------------------------------------------------
+
+static void Gen3SendEds (const int node)
+{
+    PktData_t LinkOut [MAX_LINK_WIDTH];
+
+    if (!this->gen3.tx_data)
+    {
+        return;
+    }
+
+    if (this->gen3.tx_sym * this->LinkWidth > (GEN3_BLOCK_SYMS * this->LinkWidth - GEN3_TOKEN_BYTES))
+    {
+        for (int lanes = 0; lanes < this->LinkWidth; lanes++)
+        {
+            LinkOut[lanes] = GEN3_IDL;
+        }
+
+        do
+        {
+            Gen3SendSymbols(LinkOut, false, node);
+        }
+        while (this->gen3.tx_sym != 0);
+    }
+
+    do
+    {
+        for (int lanes = 0; lanes < this->LinkWidth; lanes++)
+        {
+            LinkOut[lanes] = Gen3EdsSymbol(this, lanes);
+        }
+
+        Gen3SendSymbols(LinkOut, false, node);
+    }
+    while (this->gen3.tx_sym != 0);
+
+    this->gen3.tx_data = false;
+}
+
+// -------------------------------------------------------------------------
+// Gen3SendOs()
+//
+// Send a Gen3 OS block for an 8b/10b OS type (with ts_data for TS1_ID
+// and TS2_ID), ending any active data stream first
+//
+// -------------------------------------------------------------------------
+
+static void Gen3SendOs (const int type, const pTS_t const ts_data, const int node)
+{
+    PktData_t LinkOut [MAX_LINK_WIDTH];
+    TS_t      lane_ts;
+
+    Gen3SendEds(node);
+
+    for (int seq = 0; seq < GEN3_BLOCK_SYMS; seq++)
+    {
+        for (int lanes = 0; lanes < this->LinkWidth; lanes++)
+        {
+            LinkOut[lanes] = Gen3OsSymbol(type, ts_data, seq, lanes);
+
+            // In the last symbol, output the OS
+            if (seq == (GEN3_BLOCK_SYMS-1))
+            {
+                if (ts_data != NULL)
+                {
+                    lane_ts         = *ts_data;
+                    lane_ts.lanenum = (ts_data->lanenum == PAD) ? PAD : lanes;
+                }
+
+                DispOS(this, type, (ts_data != NULL) ? &lane_ts : NULL, lanes, false, node);
+                TraceOS(this, type, (ts_data != NULL) ? &lane_ts : NULL, lanes, false, node);
+            }
+        }
+
+        Gen3SendSymbols(LinkOut, true, node);
+    }
+}
+
 // -------------------------------------------------------------------------
 // SendOS()
 //
@@ -1729,6 +2041,13 @@ void SendOs (const int Type, const int node)
     // Make sure RX queues, rather than sends, any transmitted replies
     this->draining_queue = true;
 
+    if (this->usrconf.EnableGen3)
+    {
+        Gen3SendOs(Type, NULL, node);
+        this->draining_queue = old_draining_state;
+        return;
+    }
+
     int oslen = (Type == EIE) ? TS_LENGTH : OS_LENGTH;
 
     for (sequence = 0; sequence < oslen; sequence++)
@@ -1749,11 +2068,13 @@ void SendOs (const int Type, const int node)
                 {
                     DispRaw(this, LinkOut[sequence], false);
                 }
+                TraceSym(this, LinkOut[sequence], false);
             }
 
             if (sequence == oslen-1)
             {
                 DispOS(this, Type, NULL, lanes, false, node);
+                TraceOS(this, Type, NULL, lanes, false, node);
             }
         }
         ExtractPhyInput(this, LinkIn);
@@ -1821,6 +2142,22 @@ void SendTsGen (const int identifier, const int lane_num, const int link_num, co
     // Make sure RX queues, rather than sends, any transmitted replies
     this->draining_queue = true;
 
+    // In Gen3 mode, advertise 8 GT/s, and send an EIEOS before every
+    // GEN3_TS_PER_EIEOS training sequences
+    if (this->usrconf.EnableGen3)
+    {
+        ts_data.datarate = TS_DATA_RATE_GEN3;
+
+        if ((this->gen3.tx_ts_count++ % GEN3_TS_PER_EIEOS) == 0)
+        {
+            Gen3SendOs(EIE, NULL, node);
+        }
+
+        Gen3SendOs(identifier, &ts_data, node);
+        this->draining_queue = old_draining_state;
+        return;
+    }
+
     for (unsigned sequence = 0; sequence < TS_LENGTH; sequence++)
     {
         for (unsigned lanes = 0; lanes < (this->LinkWidth); lanes++)
@@ -1862,6 +2199,8 @@ void SendTsGen (const int identifier, const int lane_num, const int link_num, co
             {
                 for (int seq = 0; seq < TS_LENGTH; seq++)
                     DispRaw(this, LinkOut[seq], false);
+
+                TraceSym(this, LinkOut[sequence], false);
             }
 
             // In the last stripe, output the training sequence OS
@@ -1870,6 +2209,7 @@ void SendTsGen (const int identifier, const int lane_num, const int link_num, co
                 // Get the lane number from its slot in the sequence (either PAD or the current lane #)
                 ts_data.lanenum =  LinkOut[TS_LANE_NUM_SEQ][lanes];
                 DispOS(this, identifier, &ts_data, lanes, false, node);
+                TraceOS(this, identifier, &ts_data, lanes, false, node);
             }
         }
         ExtractPhyInput(this, LinkIn);
@@ -1970,6 +2310,25 @@ void WaitForCompletion(int node)
     WaitForCompletionN (1, node);
 }
 
+// -------------------------------------------------------------------------
+// PcieExit()
+//
+// Finish any nodes not already finished when the simulation exits,
+// and then stop the display writer once their output is written. The
+// node threads are suspended in the simulator by then.
+//
+// -------------------------------------------------------------------------
+
+static void PcieExit (void)
+{
+    for (int node = 0; node < VP_MAX_NODES; node++)
+    {
+        PcieFinish(node);
+    }
+
+    DispWriterStop();
+}
+
 // -------------------------------------------------------------------------
 // InitialisePcie()
 //
@@ -2007,10 +2366,16 @@ void InitialisePcie (const callback_t cb_func, void *usrptr, const int node)
         {
             pms[i] = NULL;
         }
+
+        // Finish the nodes when the simulation exits
+        atexit(PcieExit);
     }
 
     if (this != NULL)
     {
+        TraceClose(this);
+        TrigClose(this);
+        StallTimeline(this, false);
         free((void*)this);
     }
 
@@ -2056,6 +2421,19 @@ void RegisterOsCallback (const os_callback_t cb_func, const int node)
     this->vuser_os_cb = cb_func;
 }
 
+// -------------------------------------------------------------------------
+// RegisterFcCallback()
+//
+// Register a user UpdateFC policy callback, used when CONFIG_FC_POLICY
+// is FC_POLICY_CALLBACK
+//
+// -------------------------------------------------------------------------
+
+void RegisterFcCallback (const fc_callback_t cb_func, const int node)
+{
+    this->vuser_fc_cb = cb_func;
+}
+
 // -------------------------------------------------------------------------
 // ResetEventCount()
 //
@@ -2331,40 +2709,252 @@ void ConfigurePcie (const config_t type, const int value, const int node)
         ConfigDispFormat(type == CONFIG_ENABLE_DISPLINK_COLOUR);
         break;
 
+    case CONFIG_ENABLE_FINISH_STATS:
+    case CONFIG_DISABLE_FINISH_STATS:
+        usrconf->DisableFinishStats = type == CONFIG_DISABLE_FINISH_STATS;
+        break;
+
     case CONFIG_DISP_BCK_NODE_NUM:
         usrconf->BackNodeNum = value % 10; // Maximum of 9 to keep formatting alignment
         break;
 
-    case CONFIG_POST_HDR_CR:
-        if (value > MAX_HDR_CREDITS)
+    case CONFIG_ENABLE_TRACE:
+        // Open default trace file, capturing everything if no types selected
+        TraceOpen(this, NULL, value ? value : PCIE_TRACE_ALL);
+        break;
+
+    case CONFIG_DISABLE_TRACE:
+        TraceClose(this);
+        break;
+
+    case CONFIG_DISP_ASYNC:
+        if (value != DISP_ASYNC_OFF && value != DISP_ASYNC_BLOCK && value != DISP_ASYNC_DROP)
         {
-            VPrint("ConfigurePcie: %s***Error --- post header credits of %d too big at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VPrint("ConfigurePcie: %s***Error --- bad display mode (%d) at node %d%s\n", fmterrstr, value, node, fmtnormstr);
             VWrite(PVH_FATAL, 0, 0, node);
         }
-        else
+        DispWriterConfig(value);
+        break;
+
+    case CONFIG_TRIG_ARM:
+        // Re-arm with the given conditions, restarting the history
+        TrigClose(this);
+        this->usrconf.TrigConditions = value;
+        break;
+
+    case CONFIG_TRIG_DISARM:
+        TrigClose(this);
+        break;
+
+    case CONFIG_TRIG_HISTORY:
+        if (value <= 0)
         {
-            if (flw->ConsumedHdrCredits[0][FC_POST] != usrconf->InitFcHdrCr[0][FC_POST] || flw->AdvertisedHdrCredits[0][FC_POST] != usrconf->InitFcHdrCr[0][FC_POST])
-            {
-                DebugVPrint("ConfigurePcie: ***Warning --- posted header FC init value altered after active flow control. May by out of sync with other end of link at node %d\n", node);
-            }
-            usrconf->InitFcHdrCr[0][FC_POST] = value;
-            flw->ConsumedHdrCredits[0][FC_POST] = value;
-            flw->AdvertisedHdrCredits[0][FC_POST] = value;
+            VPrint("ConfigurePcie: %s***Error --- bad trigger history depth (%d) at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
         }
+        this->usrconf.TrigHistory = value;
         break;
 
-    case CONFIG_NONPOST_HDR_CR:
-        if (value > MAX_HDR_CREDITS)
+    case CONFIG_TRIG_POST:
+        this->usrconf.TrigPost = value;
+        break;
+
+    case CONFIG_TRIG_STALL_CYCLES:
+        this->usrconf.TrigStallCycles = value;
+        break;
+
+    case CONFIG_STALL_TIMELINE:
+        StallTimeline(this, value != 0);
+        break;
+
+    case CONFIG_ENABLE_GEN3:
+    case CONFIG_DISABLE_GEN3:
+        usrconf->EnableGen3 = type == CONFIG_ENABLE_GEN3;
+        Gen3Reset(this);
+        break;
+
+    case CONFIG_CPL_MAX_PAYLOAD:
+        if (value < MIN_CPL_MAX_PAYLOAD || value > MAX_PAYLOAD_BYTES || (value & (value - 1)))
         {
-            VPrint("ConfigurePcie: %s***Error --- non-post header credits of %d too big at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VPrint("ConfigurePcie: %s***Error --- max payload size of %d invalid at node %d%s\n", fmterrstr, value, node, fmtnormstr);
             VWrite(PVH_FATAL, 0, 0, node);
         }
         else
         {
-            if (flw->ConsumedHdrCredits[0][FC_NONPOST] != usrconf->InitFcHdrCr[0][FC_NONPOST] || flw->AdvertisedHdrCredits[0][FC_NONPOST] != usrconf->InitFcHdrCr[0][FC_NONPOST])
-            {
-                DebugVPrint("ConfigurePcie: ***Warning --- non-posted header FC init value altered after active flow control. May by out of sync with other end of link at node %d\n", node);
-            }
+            usrconf->CplMaxPayload = value;
+        }
+        break;
+
+    case CONFIG_ACK_POLICY:
+        if (value < ACK_POLICY_CUSTOM || value > ACK_POLICY_SPEC)
+        {
+            VPrint("ConfigurePcie: %s***Error --- invalid ACK policy (%d) at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            usrconf->AckPolicy = value;
+        }
+        break;
+
+    case CONFIG_FC_POLICY:
+        if (value < FC_POLICY_DEFAULT || value > FC_POLICY_CALLBACK)
+        {
+            VPrint("ConfigurePcie: %s***Error --- invalid UpdateFC policy (%d) at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            usrconf->FcPolicy = value;
+        }
+        break;
+
+    case CONFIG_FC_HDR_WATERMARK:
+        if (value < 0 || value > MAX_HDR_CREDITS)
+        {
+            VPrint("ConfigurePcie: %s***Error --- header credit watermark of %d invalid at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            usrconf->FcHdrWatermark = value;
+        }
+        break;
+
+    case CONFIG_FC_DATA_WATERMARK:
+        if (value < 0 || value > MAX_DATA_CREDITS)
+        {
+            VPrint("ConfigurePcie: %s***Error --- data credit watermark of %d invalid at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            usrconf->FcDataWatermark = value;
+        }
+        break;
+
+    case CONFIG_FC_UPDATE_TIME:
+        if (value <= 0)
+        {
+            VPrint("ConfigurePcie: %s***Error --- UpdateFC timer of %d invalid at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            usrconf->FcUpdateTime = value;
+        }
+        break;
+
+    case CONFIG_TX_QUEUE_DEPTH:
+        if (value < 0)
+        {
+            VPrint("ConfigurePcie: %s***Error --- transmit queue depth of %d invalid at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else if (value == 0 && (this->txq.head_p[FC_POST] != NULL || this->txq.head_p[FC_NONPOST] != NULL))
+        {
+            VPrint("ConfigurePcie: %s***Error --- transmit queues disabled with TLPs queued at node %d%s\n", fmterrstr, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            usrconf->TxQueueDepth = value;
+        }
+        break;
+
+    case CONFIG_TX_ATTR:
+        if (value < 0 || value > (TLP_ATTR_NS | TLP_ATTR_RO | TLP_ATTR_IDO))
+        {
+            VPrint("ConfigurePcie: %s***Error --- TLP attributes 0x%x invalid at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            usrconf->TxAttr = value;
+        }
+        break;
+
+    case CONFIG_TAG_10BIT:
+    case CONFIG_TAG_POOL_SIZE:
+        if (value < 0)
+        {
+            VPrint("ConfigurePcie: %s***Error --- tag configuration value %d invalid at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else if (this->tags.stats.outstanding)
+        {
+            VPrint("ConfigurePcie: %s***Error --- tag pool reconfigured with requests outstanding at node %d%s\n", fmterrstr, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            if (type == CONFIG_TAG_10BIT)
+            {
+                usrconf->Tag10Bit = value ? true : false;
+            }
+            else
+            {
+                usrconf->TagPoolSize = value;
+            }
+
+            TagPoolInit(this);
+        }
+        break;
+
+    case CONFIG_REPLAY_TIMEOUT:
+        if (value < REPLAY_TIMEOUT_OFF)
+        {
+            VPrint("ConfigurePcie: %s***Error --- invalid replay timeout (%d) at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            usrconf->ReplayTimeout = value;
+        }
+        break;
+
+    case CONFIG_READ_CPL_BOUNDARY:
+        if (value != 64 && value != 128)
+        {
+            VPrint("ConfigurePcie: %s***Error --- read completion boundary of %d invalid at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            usrconf->ReadCplBoundary = value;
+        }
+        break;
+
+    case CONFIG_POST_HDR_CR:
+        if (value > MAX_HDR_CREDITS)
+        {
+            VPrint("ConfigurePcie: %s***Error --- post header credits of %d too big at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            if (flw->ConsumedHdrCredits[0][FC_POST] != usrconf->InitFcHdrCr[0][FC_POST] || flw->AdvertisedHdrCredits[0][FC_POST] != usrconf->InitFcHdrCr[0][FC_POST])
+            {
+                DebugVPrint("ConfigurePcie: ***Warning --- posted header FC init value altered after active flow control. May by out of sync with other end of link at node %d\n", node);
+            }
+            usrconf->InitFcHdrCr[0][FC_POST] = value;
+            flw->ConsumedHdrCredits[0][FC_POST] = value;
+            flw->AdvertisedHdrCredits[0][FC_POST] = value;
+        }
+        break;
+
+    case CONFIG_NONPOST_HDR_CR:
+        if (value > MAX_HDR_CREDITS)
+        {
+            VPrint("ConfigurePcie: %s***Error --- non-post header credits of %d too big at node %d%s\n", fmterrstr, value, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+        }
+        else
+        {
+            if (flw->ConsumedHdrCredits[0][FC_NONPOST] != usrconf->InitFcHdrCr[0][FC_NONPOST] || flw->AdvertisedHdrCredits[0][FC_NONPOST] != usrconf->InitFcHdrCr[0][FC_NONPOST])
+            {
+                DebugVPrint("ConfigurePcie: ***Warning --- non-posted header FC init value altered after active flow control. May by out of sync with other end of link at node %d\n", node);
+            }
             usrconf->InitFcHdrCr[0][FC_NONPOST] = value;
             flw->ConsumedHdrCredits[0][FC_NONPOST] = value;
             flw->AdvertisedHdrCredits[0][FC_NONPOST] = value;
@@ -2478,6 +3068,11 @@ void ConfigurePcie (const config_t type, const int value, const int node)
     case CONFIG_LTSSM_POLL_ACTIVE_TX_COUNT:
         ConfigurePcieLtssm(type, value, node);
         break;
+
+    // Retraining on a REPLAY_NUM rollover needs the LTSSM
+    case CONFIG_REPLAY_RETRAIN:
+        usrconf->ReplayRetrain = value ? true : false;
+        break;
 #endif
 
     default:
@@ -2488,70 +3083,991 @@ void ConfigurePcie (const config_t type, const int value, const int node)
 }
 
 // -------------------------------------------------------------------------
-// PcieRand()
+// PcieTraceOpen()
+//
+// Open a binary link trace file for the node, capturing the record
+// types selected in flags (PCIE_TRACE_xxx). If fname is NULL, a
+// default name of pcietrace<node>.bin is used.
 //
 // -------------------------------------------------------------------------
 
-uint32_t PcieRand (const int node)
+int PcieTraceOpen (const char* fname, const uint32_t flags, const int node)
 {
-    this->RandNum = CalcNewRand(this->RandNum);
-    return this->RandNum;
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("PcieTraceOpen: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    return TraceOpen(this, fname, flags);
 }
 
 // -------------------------------------------------------------------------
-// PcieSeed()
+// PcieTraceClose()
+//
+// Flush and close the node's binary link trace file
 //
 // -------------------------------------------------------------------------
 
-void PcieSeed (const uint32_t seed, const int node)
+void PcieTraceClose (const int node)
 {
-    this->RandNum = seed;
+    if (pms != NULL && this != NULL)
+    {
+        TraceClose(this);
+    }
 }
 
 // -------------------------------------------------------------------------
-// SetTxDisabled()
+// PcieReplay()
+//
+// Replay the packets from one side of the link in a binary trace file
+// (see ReplayLoad()), queuing them directly at their recorded times,
+// relative to now, with gaps limited to max_gap cycles unless
+// REPLAY_ORIG_TIMING. Replayed TLPs are submitted as for new TLPs, so
+// are numbered as they are released, honouring transmit credits and
+// any transmit queues.
+// Returns once all the packets have been sent. Returns MEM_BAD_STATUS
+// if the trace file could not be loaded.
 //
 // -------------------------------------------------------------------------
 
-void SetTxDisabled (const int node)
+int PcieReplay (const char* fname, const uint32_t flags, const int max_gap, const int node)
 {
-    this->tx_disabled = true;
+    pPkt_t   packet, next;
+    uint32_t start;
+    int      num = 0;
+
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("PcieReplay: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    // Build all the packets up front
+    if ((packet = ReplayLoad(this, fname, flags, max_gap)) == NULL)
+    {
+        VPrint("PcieReplay: %s***Warning --- nothing to replay from %s at node %d%s\n", fmterrstr, fname, node, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    start = this->TicksSinceReset;
+
+    for (; packet != NULL; packet = next, num++)
+    {
+        next = packet->NextPkt;
+
+        if ((start + packet->TimeStamp) > this->TicksSinceReset)
+        {
+            SendIdle(start + packet->TimeStamp - this->TicksSinceReset, node);
+        }
+
+        packet->TimeStamp = this->TicksSinceReset;
+
+        if (packet->seq == DLLP_SEQ_ID)
+        {
+            AddPktToQueue(this, packet);
+        }
+        else
+        {
+            uint32_t type    = packet->data[TLP_TYPE_BYTE_OFFSET] & 0x7f;
+            bool     is_cpl  = (type & 0x1e) == TL_CPL;
+            bool     is_post = ((type & 0x1f) == 0 && (type & TL_TYPE_WRITE)) || (type & 0x18) == 0x10;   // MWr or Msg
+
+            SubmitTlp(is_cpl ? FC_CMPL : is_post ? FC_POST : FC_NONPOST, packet, node);
+        }
+    }
+
+    SendPacket(node);
+
+    DebugVPrint("PcieReplay: replayed %d packets from %s at node %d\n", num, fname, node);
+
+    return MEM_GOOD_STATUS;
 }
 
 // -------------------------------------------------------------------------
-// SetTxEnabled()
+// PcieTrigArm()
+//
+// Arm triggered capture from a specification string (see TrigConfig()
+// for the syntax). Any capture in progress is stopped first. The last
+// history records, plus the post trigger records, are written to
+// pcietrig<node>.bin when a condition is met.
 //
 // -------------------------------------------------------------------------
 
-void SetTxEnabled (const int node)
+int PcieTrigArm (const char* spec, const int node)
 {
-    this->tx_disabled = false;
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("PcieTrigArm: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    TrigClose(this);
+
+    return TrigConfig(&this->usrconf, spec, node);
 }
 
 // -------------------------------------------------------------------------
-// getPcieVersionString()
+// PcieTrigDisarm()
+//
+// Disarm triggered capture, closing any trigger file
+//
 // -------------------------------------------------------------------------
 
-void getPcieVersionString (char* sbuf, const int bufsize)
+void PcieTrigDisarm (const int node)
 {
-    snprintf(sbuf, bufsize, "pcieVHost version %d.%d.%d\n", PCIE_MAJOR_VER, PCIE_MINOR_VER, PCIE_PATCH_VER);
+    if (pms != NULL && this != NULL)
+    {
+        TrigClose(this);
+    }
 }
 
 // -------------------------------------------------------------------------
-// SelectGen1Clock()
+// GetLatencyStats()
+//
+// Get the request to final completion latency statistics for a type
+// of non-posted request (LAT_xxx). Returns MEM_BAD_STATUS for an
+// invalid type.
+//
 // -------------------------------------------------------------------------
-void SelectGen1Clock (const int node)
+
+int GetLatencyStats (const int type, const pLatencyStats_t stats, const int node)
 {
-    VWrite(GEN2_CLK, 0, 1, node);
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetLatencyStats: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    if (type < 0 || type >= LAT_NUM_TYPES)
+    {
+        VPrint("GetLatencyStats: %s***Warning --- invalid latency type (%d) at node %d%s\n", fmterrstr, type, node, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    LatencyGet(this, type, stats);
+
+    return MEM_GOOD_STATUS;
 }
 
 // -------------------------------------------------------------------------
-// SelectGen2Clock()
+// PrintLatencyStats()
+//
+// Print the latency statistics and histograms for all request types
+// with completed requests
+//
 // -------------------------------------------------------------------------
 
-void SelectGen2Clock (const int node)
+void PrintLatencyStats (const int node)
 {
-    VWrite(GEN2_CLK, 1, 1, node);
+    if (pms != NULL && this != NULL)
+    {
+        LatencyReport(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// ClearLatencyStats()
+//
+// Clear the latency statistics. Requests already outstanding are
+// still timed.
+//
+// -------------------------------------------------------------------------
+
+void ClearLatencyStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        LatencyClear(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// GetCreditStallStats()
+//
+// Get the transmit credit stall statistics for an FC type (FC_POST,
+// FC_NONPOST or FC_CMPL). Returns MEM_BAD_STATUS for an invalid type.
+//
+// -------------------------------------------------------------------------
+
+int GetCreditStallStats (const int fc_type, const pCreditStallStats_t stats, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetCreditStallStats: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    if (fc_type < 0 || fc_type >= FC_NUMTYPES)
+    {
+        VPrint("GetCreditStallStats: %s***Warning --- invalid FC type (%d) at node %d%s\n", fmterrstr, fc_type, node, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    StallGet(this, fc_type, stats);
+
+    return MEM_GOOD_STATUS;
+}
+
+// -------------------------------------------------------------------------
+// PrintCreditStallStats()
+//
+// Print a summary of the transmit credit stalls
+//
+// -------------------------------------------------------------------------
+
+void PrintCreditStallStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        StallReport(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// ClearCreditStallStats()
+//
+// Clear the transmit credit stall statistics
+//
+// -------------------------------------------------------------------------
+
+void ClearCreditStallStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        StallClear(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// GetAckStats()
+//
+// Get the ACK/NAK DLLP statistics
+//
+// -------------------------------------------------------------------------
+
+void GetAckStats (const pAckStats_t stats, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetAckStats: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    *stats = this->ackstats;
+}
+
+// -------------------------------------------------------------------------
+// PrintAckStats()
+//
+// Print the ACK/NAK DLLP statistics
+//
+// -------------------------------------------------------------------------
+
+void PrintAckStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        AckReport(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// ClearAckStats()
+//
+// -------------------------------------------------------------------------
+
+void ClearAckStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        memset(&this->ackstats, 0, sizeof(AckStats_t));
+    }
+}
+
+// -------------------------------------------------------------------------
+// GetFcUpdateStats()
+//
+// Get the UpdateFC DLLP statistics for an FC type (FC_POST, FC_NONPOST
+// or FC_CMPL). Returns MEM_BAD_STATUS for an invalid type.
+//
+// -------------------------------------------------------------------------
+
+int GetFcUpdateStats (const int fc_type, const pFcUpdateStats_t stats, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetFcUpdateStats: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    if (fc_type < 0 || fc_type >= FC_NUMTYPES)
+    {
+        VPrint("GetFcUpdateStats: %s***Warning --- invalid FC type (%d) at node %d%s\n", fmterrstr, fc_type, node, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    *stats = this->fcstats[fc_type];
+
+    return MEM_GOOD_STATUS;
+}
+
+// -------------------------------------------------------------------------
+// PrintFcUpdateStats()
+//
+// Print the UpdateFC DLLP statistics
+//
+// -------------------------------------------------------------------------
+
+void PrintFcUpdateStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        FcUpdateReport(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// ClearFcUpdateStats()
+//
+// -------------------------------------------------------------------------
+
+void ClearFcUpdateStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        memset(this->fcstats, 0, sizeof(this->fcstats));
+    }
+}
+
+// -------------------------------------------------------------------------
+// GetTxQueueStats()
+//
+// Get the transmit queue statistics for an FC type (FC_POST, FC_NONPOST
+// or FC_CMPL). Returns MEM_BAD_STATUS for an invalid type.
+//
+// -------------------------------------------------------------------------
+
+int GetTxQueueStats (const int fc_type, const pTxQueueStats_t stats, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetTxQueueStats: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    if (fc_type < 0 || fc_type >= FC_NUMTYPES)
+    {
+        VPrint("GetTxQueueStats: %s***Warning --- invalid FC type (%d) at node %d%s\n", fmterrstr, fc_type, node, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    *stats = this->txq.stats[fc_type];
+
+    return MEM_GOOD_STATUS;
+}
+
+// -------------------------------------------------------------------------
+// PrintTxQueueStats()
+//
+// Print the transmit queue statistics, if transmit queues are
+// configured
+//
+// -------------------------------------------------------------------------
+
+void PrintTxQueueStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        TxQueueReport(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// ClearTxQueueStats()
+//
+// -------------------------------------------------------------------------
+
+void ClearTxQueueStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        memset(this->txq.stats, 0, sizeof(this->txq.stats));
+    }
+}
+
+// -------------------------------------------------------------------------
+// GetLastTag()
+//
+// Returns the tag of the last non-posted request issued, such as one
+// given a tag from the pool with TAG_AUTO, or TAG_AUTO if none issued
+//
+// -------------------------------------------------------------------------
+
+int GetLastTag (const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetLastTag: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    return this->tags.last;
+}
+
+// -------------------------------------------------------------------------
+// GetOutstandingRequest()
+//
+// Get the details of the outstanding non-posted request with a given
+// tag. The request is outstanding until after its final completion is
+// passed to the user callback. Returns MEM_BAD_STATUS if no request
+// with the tag is outstanding.
+//
+// -------------------------------------------------------------------------
+
+int GetOutstandingRequest (const int tag, const pOutstandingReq_t req, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetOutstandingRequest: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    if (tag < 0 || tag >= TAG_TABLE_SIZE || !this->tags.table[tag].busy)
+    {
+        return MEM_BAD_STATUS;
+    }
+
+    *req = this->tags.table[tag].req;
+
+    return MEM_GOOD_STATUS;
+}
+
+// -------------------------------------------------------------------------
+// GetTagStats()
+//
+// Get the tag pool and outstanding request statistics
+//
+// -------------------------------------------------------------------------
+
+void GetTagStats (const pTagStats_t stats, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetTagStats: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    *stats = this->tags.stats;
+}
+
+// -------------------------------------------------------------------------
+// PrintTagStats()
+//
+// Print the tag statistics
+//
+// -------------------------------------------------------------------------
+
+void PrintTagStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        TagReport(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// ClearTagStats()
+//
+// Clear the tag statistics. The outstanding request count is kept, and
+// restarts the maximum.
+//
+// -------------------------------------------------------------------------
+
+void ClearTagStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        uint32_t outstanding = this->tags.stats.outstanding;
+
+        memset(&this->tags.stats, 0, sizeof(TagStats_t));
+
+        this->tags.stats.outstanding     = outstanding;
+        this->tags.stats.max_outstanding = outstanding;
+    }
+}
+
+// -------------------------------------------------------------------------
+// GetReplayStats()
+//
+// Get the replay timer and retransmission statistics
+//
+// -------------------------------------------------------------------------
+
+void GetReplayStats (const pReplayStats_t stats, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetReplayStats: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    *stats = this->replay.stats;
+}
+
+// -------------------------------------------------------------------------
+// PrintReplayStats()
+//
+// Print the replay statistics
+//
+// -------------------------------------------------------------------------
+
+void PrintReplayStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        ReplayReport(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// ClearReplayStats()
+//
+// -------------------------------------------------------------------------
+
+void ClearReplayStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        memset(&this->replay.stats, 0, sizeof(ReplayStats_t));
+    }
+}
+
+// -------------------------------------------------------------------------
+// PcieGenDefaults()
+//
+// Fill in a traffic generator configuration with defaults, for
+// modifying before PcieGenerate()
+//
+// -------------------------------------------------------------------------
+
+void PcieGenDefaults (const pPcieGenCfg_t cfg)
+{
+    GenDefaults(cfg);
+}
+
+// -------------------------------------------------------------------------
+// PcieGenLoad()
+//
+// Update a traffic generator configuration from a file (see GenLoad()
+// for the syntax). Returns MEM_BAD_STATUS on a file error.
+//
+// -------------------------------------------------------------------------
+
+int PcieGenLoad (const char* fname, const pPcieGenCfg_t cfg, const int node)
+{
+    return GenLoad(fname, cfg, node);
+}
+
+// -------------------------------------------------------------------------
+// PcieGenerate()
+//
+// Run the constrained random traffic generator with the given
+// configuration, returning once all the generated requests have
+// completed. Read completions are passed to the user callback, as
+// usual. The achieved rates are printed and, if stats is not NULL,
+// returned. Returns MEM_BAD_STATUS for an invalid configuration.
+//
+// -------------------------------------------------------------------------
+
+int PcieGenerate (const pPcieGenCfg_t cfg, const pPcieGenStats_t stats, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("PcieGenerate: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    return GenRun(this, cfg, stats, node);
+}
+
+// -------------------------------------------------------------------------
+// PcieBench()
+//
+// Run a benchmark workload with the traffic generator, reporting the
+// achieved data rate, TLP rate, memory read latency percentiles and
+// link utilisation. Latency statistics are cleared at the start. If
+// stats is not NULL, the results are returned. Returns MEM_BAD_STATUS
+// for an invalid configuration.
+//
+// -------------------------------------------------------------------------
+
+int PcieBench (const pPcieGenCfg_t cfg, const pPcieBenchStats_t stats, const int node)
+{
+    PcieBenchStats_t bench;
+    int              status;
+
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("PcieBench: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    if ((status = GenBench(this, cfg, &bench, node)) == MEM_GOOD_STATUS && stats != NULL)
+    {
+        *stats = bench;
+    }
+
+    return status;
+}
+
+// -------------------------------------------------------------------------
+// PcieInjectDefaults()
+//
+// Fill in a lane error injection configuration with no errors, for
+// modifying before PcieInject()
+//
+// -------------------------------------------------------------------------
+
+void PcieInjectDefaults (const pPcieInjectCfg_t cfg)
+{
+    InjectDefaults(cfg);
+}
+
+// -------------------------------------------------------------------------
+// PcieInject()
+//
+// Enable lane error injection on the symbols sent by SendPacket(),
+// with the given configuration, or update the configuration if
+// already enabled. Returns MEM_BAD_STATUS for an invalid configuration.
+//
+// -------------------------------------------------------------------------
+
+int PcieInject (const pPcieInjectCfg_t cfg, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("PcieInject: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    return InjectConfig(this, cfg);
+}
+
+// -------------------------------------------------------------------------
+// PcieInjectStop()
+//
+// Disable lane error injection
+//
+// -------------------------------------------------------------------------
+
+void PcieInjectStop (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        InjectStop(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// GetInjectStats()
+//
+// Get the counts of injected errors
+//
+// -------------------------------------------------------------------------
+
+void GetInjectStats (const pPcieInjectStats_t stats, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetInjectStats: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    *stats = this->injstats;
+}
+
+// -------------------------------------------------------------------------
+// PrintInjectStats()
+//
+// Print the counts of injected errors
+//
+// -------------------------------------------------------------------------
+
+void PrintInjectStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        InjectReport(this);
+    }
+}
+
+// -------------------------------------------------------------------------
+// ClearInjectStats()
+//
+// -------------------------------------------------------------------------
+
+void ClearInjectStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        memset(&this->injstats, 0, sizeof(PcieInjectStats_t));
+    }
+}
+
+// -------------------------------------------------------------------------
+// PrintPcieStats()
+//
+// Print all of the node's statistics. Called from the finish path
+// (PcieFinish()), unless disabled with CONFIG_DISABLE_FINISH_STATS.
+//
+// -------------------------------------------------------------------------
+
+void PrintPcieStats (const int node)
+{
+    PrintLatencyStats(node);
+    PrintCreditStallStats(node);
+    PrintAckStats(node);
+    PrintFcUpdateStats(node);
+    PrintTxQueueStats(node);
+    PrintTagStats(node);
+    PrintReplayStats(node);
+    PrintInjectStats(node);
+}
+
+// -------------------------------------------------------------------------
+// PcieFinish()
+//
+// The node's end of run processing, flushing any partial display line
+// it holds and printing its statistics (unless disabled). Called when a
+// ContDisp finish or stop is reached, and at exit for a simulation
+// finished by user code (PVH_FINISH). A node is only finished once.
+//
+// -------------------------------------------------------------------------
+
+void PcieFinish (const int node)
+{
+    if (pms == NULL || this == NULL || this->finished)
+    {
+        return;
+    }
+
+    this->finished = true;
+
+    DispWriterFlush(node);
+
+    if (!this->usrconf.DisableFinishStats)
+    {
+        PrintPcieStats(node);
+    }
+}
+
+// -------------------------------------------------------------------------
+// GetLinkStats()
+//
+// Get the counts of lane symbols carrying transmitted and received
+// packets. Dividing by cycles times link width gives the utilisation.
+//
+// -------------------------------------------------------------------------
+
+void GetLinkStats (const pLinkStats_t stats, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("GetLinkStats: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    *stats = this->linkstats;
+}
+
+// -------------------------------------------------------------------------
+// ClearLinkStats()
+//
+// -------------------------------------------------------------------------
+
+void ClearLinkStats (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        memset(&this->linkstats, 0, sizeof(LinkStats_t));
+    }
+}
+
+// -------------------------------------------------------------------------
+// GetDispDropCount()
+//
+// Return the number of link display lines dropped for the node when
+// in DISP_ASYNC_DROP mode
+//
+// -------------------------------------------------------------------------
+
+uint32_t GetDispDropCount (const int node)
+{
+    return DispWriterDrops(node);
+}
+
+// -------------------------------------------------------------------------
+// AddDispFilter()
+//
+// Add a link display filter rule (see DispFilterAdd() for the syntax).
+// Once any rules are added, only matching traffic is displayed.
+//
+// -------------------------------------------------------------------------
+
+int AddDispFilter (const char* rule, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("AddDispFilter: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    return DispFilterAdd(&this->usrconf, rule, node);
+}
+
+// -------------------------------------------------------------------------
+// ClearDispFilters()
+//
+// Remove all link display filter rules
+//
+// -------------------------------------------------------------------------
+
+void ClearDispFilters (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        DispFilterClear(&this->usrconf);
+    }
+}
+
+// -------------------------------------------------------------------------
+// AddCplProfile()
+//
+// Add a completer timing profile for an address window. Memory reads
+// completed by the model within the window are timed by the profile,
+// instead of the configured completion delay. Windows are matched in
+// the order added. Returns MEM_BAD_STATUS for an invalid profile, or
+// if the maximum number of profiles are already added.
+//
+// -------------------------------------------------------------------------
+
+int AddCplProfile (const pCplProfile_t profile, const int node)
+{
+    if (pms == NULL || this == NULL)
+    {
+        VPrint("AddCplProfile: %s***Error --- Called before initialisation. Call InitialisePcie() first from node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    if (profile->size == 0 || profile->max_outstanding > CPL_MAX_OUTSTANDING || profile->tail_percent > 100)
+    {
+        VPrint("AddCplProfile: %s***Warning --- invalid completer profile at node %d%s\n", fmterrstr, node, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    if (CplProfileAdd(this, profile) != MEM_GOOD_STATUS)
+    {
+        VPrint("AddCplProfile: %s***Warning --- too many completer profiles (max %d) at node %d%s\n", fmterrstr, CPL_MAX_PROFILES, node, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    return MEM_GOOD_STATUS;
+}
+
+// -------------------------------------------------------------------------
+// ClearCplProfiles()
+//
+// Remove all completer timing profiles
+//
+// -------------------------------------------------------------------------
+
+void ClearCplProfiles (const int node)
+{
+    if (pms != NULL && this != NULL)
+    {
+        this->cplprof.num         = 0;
+        this->cplprof.ready_valid = false;
+    }
+}
+
+// -------------------------------------------------------------------------
+// PcieRand()
+//
+// -------------------------------------------------------------------------
+
+uint32_t PcieRand (const int node)
+{
+    this->RandNum = CalcNewRand(this->RandNum);
+    return this->RandNum;
+}
+
+// -------------------------------------------------------------------------
+// PcieSeed()
+//
+// -------------------------------------------------------------------------
+
+void PcieSeed (const uint32_t seed, const int node)
+{
+    this->RandNum = seed;
+
+    InjectSeed(this, seed);
+}
+
+// -------------------------------------------------------------------------
+// SetTxDisabled()
+//
+// -------------------------------------------------------------------------
+
+void SetTxDisabled (const int node)
+{
+    this->tx_disabled = true;
+}
+
+// -------------------------------------------------------------------------
+// SetTxEnabled()
+//
+// -------------------------------------------------------------------------
+
+void SetTxEnabled (const int node)
+{
+    this->tx_disabled = false;
+}
+
+// -------------------------------------------------------------------------
+// getPcieVersionString()
+// -------------------------------------------------------------------------
+
+void getPcieVersionString (char* sbuf, const int bufsize)
+{
+    snprintf(sbuf, bufsize, "pcieVHost version %d.%d.%d\n", PCIE_MAJOR_VER, PCIE_MINOR_VER, PCIE_PATCH_VER);
+}
+
+// -------------------------------------------------------------------------
+// SelectGen1Clock()
+// -------------------------------------------------------------------------
+void SelectGen1Clock (const int node)
+{
+    VWrite(GEN2_CLK, 0, 1, node);
+
+    if (pms != NULL && this != NULL)
+    {
+        this->Gen2Clk = false;
+    }
+}
+
+// -------------------------------------------------------------------------
+// SelectGen2Clock()
+// -------------------------------------------------------------------------
+
+void SelectGen2Clock (const int node)
+{
+    VWrite(GEN2_CLK, 1, 1, node);
+
+    if (pms != NULL && this != NULL)
+    {
+        this->Gen2Clk = true;
+    }
 }
 
 // Allow reuse in other files
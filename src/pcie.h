@@ -56,8 +56,20 @@
 #include "pcie_dpi.h"
 #endif
 
+// Model and user code output waits for any queued link display output to be
+// written first (CONFIG_DISP_ASYNC), so that the two stay in order. When the
+// display is synchronous, this is the underlying VPrint() (printf(), for both
+// VProc and DPI builds) with just a mode check.
+#if !defined(OSVVM) && !defined(PCIE_VPRINT_DIRECT)
+EXTERN volatile int DispWriterMode;
+EXTERN void DispWriterSync (void);
+# undef  VPrint
+# define VPrint(...) ((DispWriterMode != DISP_ASYNC_OFF) ? DispWriterSync() : (void)0, printf(__VA_ARGS__))
+#endif
+
 #include "pci_express.h"
 #include "pcie_vhost_map.h"
+#include "pcie_trace.h"
 
 // -------------------------------------------------------------------------
 // Generic definitions
@@ -76,6 +88,69 @@
 #define VP_MAX_NODES                      64
 #endif
 
+// Link display output modes (CONFIG_DISP_ASYNC)
+#define DISP_ASYNC_OFF                    0
+#define DISP_ASYNC_BLOCK                  1
+#define DISP_ASYNC_DROP                   2
+
+// Triggered capture conditions (CONFIG_TRIG_ARM and PcieTrigArm())
+#define TRIG_TLP_MATCH                    0x01
+#define TRIG_BAD_LCRC                     0x02
+#define TRIG_NAK                          0x04
+#define TRIG_CPL_STATUS                   0x08
+#define TRIG_CREDIT_STALL                 0x10
+
+// Trace replay selection flags and timing (PcieReplay())
+#define REPLAY_TLP                        0x01         // Replay TLPs
+#define REPLAY_DLLP                       0x02         // Replay DLLPs
+#define REPLAY_RX_SIDE                    0x04         // Replay packets received, rather than sent, by the capturing node
+#define REPLAY_ORIG_TIMING                -1           // Maximum gap for original inter-packet timing
+
+// Non-posted request latency statistics types (GetLatencyStats())
+#define LAT_MEM_RD                        0
+#define LAT_IO_RD                         1
+#define LAT_IO_WR                         2
+#define LAT_CFG_RD                        3
+#define LAT_CFG_WR                        4
+#define LAT_NUM_TYPES                     5
+
+// Latency histogram buckets. Bucket 0 counts zero latencies, and
+// bucket n latencies from 2^(n-1) to 2^n - 1 cycles
+#define LAT_NUM_BUCKETS                   32
+
+// Non-posted request tags. Requests issued with TAG_AUTO are given a free
+// tag from the model's tag pool, which is tags 0 to 255, or, with 10-bit
+// tags enabled (CONFIG_TAG_10BIT), tags 256 to 1023, as 10-bit tags with
+// Tag[9:8] of 0 are not used. An explicit tag, for any request, must be
+// less than TAG_MAX_8BIT, or TAG_MAX_10BIT with 10-bit tags enabled, or
+// it is a fatal error (tags were previously masked to 8 bits). Posted
+// requests issued with TAG_AUTO have a tag of 0.
+#define TAG_AUTO                          -1
+#define TAG_MAX_8BIT                      256
+#define TAG_MAX_10BIT                     1024
+
+// Credit stall timeline file (CONFIG_STALL_TIMELINE)
+#define STALL_TIMELINE_NAME               "pciestall%d.csv"
+
+// Traffic generator TLP types, indexing the PcieGenCfg_t mix weights
+#define GEN_MEM_WR                        0
+#define GEN_MEM_RD                        1
+#define GEN_CFG_WR                        2
+#define GEN_CFG_RD                        3
+#define GEN_IO_WR                         4
+#define GEN_IO_RD                         5
+#define GEN_NUM_TYPES                     6
+
+// Traffic generator memory access size distributions
+#define GEN_SIZE_FIXED                    0            // Always len_min bytes
+#define GEN_SIZE_UNIFORM                  1            // Uniform from len_min to len_max bytes
+#define GEN_SIZE_POW2                     2            // Powers of 2 from len_min to len_max bytes
+
+// Traffic generator address patterns, within the address window
+#define GEN_ADDR_SEQ                      0            // Each access follows on from the last
+#define GEN_ADDR_STRIDE                   1            // Each access addr_stride bytes on from the last
+#define GEN_ADDR_RANDOM                   2            // Random, aligned to addr_align bytes
+
 // -------------------------------------------------------------------------
 // PCIe virtual host definitions
 // -------------------------------------------------------------------------
@@ -87,12 +162,16 @@
 #define DIGEST                            true
 #define NODIGEST                          false
 
-#define LCRC_TERMINATION_LOOKAHEAD        5
-#define ECRC_TERMINATION_LOOKAHEAD        9
-#define PKT_TERMINATION                   0xffff
+#define RX_DLLP_SYMBOLS                   8            // SDP, DLLP bytes and END
+#define RX_TLP_MIN_SYMBOLS                20           // STP, sequence, 3DW header, LCRC and END
 
 #define DLLP_SEQ_ID                       -1
 
+// TLP sequence numbers are compared modulo 4096, with at most 2048 outstanding
+#define SEQ_MASK                          0xfff
+#define SEQ_LE(_A, _B)                    (((((_B) - (_A)) & SEQ_MASK) < 2048))
+#define SEQ_LT(_A, _B)                    (SEQ_LE(_A, _B) && ((((_A) ^ (_B)) & SEQ_MASK) != 0))
+
 #define TS_COMMA_SEQ                      0
 #define TS_LINK_NUM_SEQ                   1
 #define TS_LANE_NUM_SEQ                   2
@@ -128,26 +207,31 @@
 #define TLP_TYPE_MASK                     0x7f
 #define TLP_CFG_LO_ADDR_MASK              0xfffULL
 #define TLP_CPL_LO_ADDR_MASK              0x3fULL
-#define TLP_TYPE_VARIANT_BIT              0x01
-#define TLP_EP_VARIANT_BIT                0x40
+#define TLP_FMT_DATA_BIT                  0x40
 
 #define TLP_TD_BYTE_MASK                  BIT7MASK
 #define TLP_EP_BYTE_MASK                  BIT6MASK
 #define TLP_ATTR_BYTE_MASK                (BIT5MASK | BIT4MASK)
+#define TLP_IDO_BYTE_MASK                 BIT2MASK
+#define TLP_TAG_T9_BYTE_MASK              0x80
+#define TLP_TAG_T8_BYTE_MASK              0x08
+
+// TLP attributes (SET_TLP_ATTR()/GET_TLP_ATTR()), with ID-Based Ordering
+// as Attr[2], in the header byte 1
+#define TLP_ATTR_NS                       0x1          // No Snoop
+#define TLP_ATTR_RO                       0x2          // Relaxed Ordering
+#define TLP_ATTR_IDO                      0x4          // ID-Based Ordering
 
 #define DL_VC_MASK                        0xf8
 #define DL_ROUTE_MASK                     0xf8
 
 // Header field byte offsets
-#define DLLP_SEQ_OFFSET                   1
-#define TLP_TYPE_BYTE_OFFSET              3
 #define TLP_TC_BYTE_OFFSET                4
-#define TLP_TD_BYTE_OFFSET                5
-#define TLP_EP_BYTE_OFFSET                5
-#define TLP_LENGTH_OFFSET                 5
 #define TLP_ATTR_BYTE_OFFSET              5
+#define TLP_IDO_BYTE_OFFSET               4
 #define TLP_RID_OFFSET                    7
 #define TLP_TAG_OFFSET                    9
+#define TLP_TAG_HI_BYTE_OFFSET            4
 #define TLP_BE_OFFSET                     10
 #define TLP_ADDR_OFFSET                   11
 #define TLP_DATA_OFFSET32                 15
@@ -173,9 +257,7 @@
 
 #define DLLP_HDR_FC_OFFSET                2
 #define DLLP_DATA_FC_OFFSET               3
-#define DLLP_CRC_OFFSET                   5
 
-#define MAX_RAW_PKT_SIZE                  4125
 #define NULLACK                           9999
 
 #define FC_POST                           0
@@ -212,10 +294,55 @@
 #define DEFAULT_COMPLETION_RATE           0
 #define DEFAULT_COMPLETION_SPREAD         0
 
+// Auto-completer Max Payload Size and Read Completion Boundary, in bytes
+#define DEFAULT_CPL_MAX_PAYLOAD           4096
+#define MIN_CPL_MAX_PAYLOAD               128
+#define DEFAULT_READ_CPL_BOUNDARY         64
+
 #define DEFAULT_SKIP_INTERVAL             1180
 #define MINIMUM_SKIP_INTERVAL             10
 #define DEFAULT_ACK_RATE                  1
 
+// AckNak latency timer policies (CONFIG_ACK_POLICY)
+#define ACK_POLICY_CUSTOM                 0            // Timer of AckRate cycles (CONFIG_ENABLE_ACK)
+#define ACK_POLICY_IMMEDIATE              1            // No timer, sent at next packet boundary
+#define ACK_POLICY_SPEC                   2            // Timer from the spec's AckNak latency formula
+
+// UpdateFC DLLP transmission policies (CONFIG_FC_POLICY). With all
+// policies, an UpdateFC is also sent for an FC type when no UpdateFC
+// has been sent for CONFIG_FC_UPDATE_TIME cycles.
+#define FC_POLICY_DEFAULT                 0            // No header space, data space below max payload, or idle send queue
+#define FC_POLICY_AGGRESSIVE              1            // Every consumed credit
+#define FC_POLICY_THRESHOLD               2            // Advertised space below watermarks (CONFIG_FC_xxx_WATERMARK)
+#define FC_POLICY_TIMER                   3            // Update timer only
+#define FC_POLICY_CALLBACK                4            // User callback (RegisterFcCallback())
+
+#define DEFAULT_FC_HDR_WATERMARK          1
+#define DEFAULT_FC_DATA_WATERMARK         DEFAULT_MAX_PAYLOAD_SIZE
+
+// Posted and non-posted transmit queue depths (CONFIG_TX_QUEUE_DEPTH). With
+// 0, TLPs go straight to the send queue, in issue order, with each request
+// waiting for credits when issued.
+#define DEFAULT_TX_QUEUE_DEPTH            0
+
+// AckNak latency formula values, in symbol times
+#define ACK_TLP_OVERHEAD                  28
+#define ACK_INTERNAL_DELAY                19
+#define ACK_DLLP_SYMBOLS                  8
+
+// Replay timer limits (CONFIG_REPLAY_TIMEOUT), with values above 0 a
+// limit in cycles
+#define REPLAY_TIMEOUT_SPEC               0            // Limit from the spec's replay timer formula
+#define REPLAY_TIMEOUT_OFF                -1           // No timer; replays on NAKs only
+
+#define REPLAY_TIMER_FACTOR               3            // Replay limit as multiple of AckNak latency
+#define REPLAY_NUM_ROLLOVER               4            // Replays without progress before retraining
+
+// Lane error injection defaults (PcieInjectDefaults())
+#define INJ_DEFAULT_BURST_LEN             4
+#define INJ_ALL_LANES                     0xffffffff
+#define INJ_DLLP_NONE                     -1
+
 #define LAST_ACK_NULL                     -1
 
 // --------------- user macros ---------------
@@ -235,12 +362,19 @@
 // Header field access macros
 // -------------------------------------------------------------------------
 
+// Tags are 10 bits, with bits 9 and 8 (T9 and T8) in header byte 1
+#define SET_TAG_HI(_TAG, _PTR){         \
+    (_PTR)[TLP_TAG_HI_BYTE_OFFSET] = ((_PTR)[TLP_TAG_HI_BYTE_OFFSET] & 0x77) | (((_TAG) >> 2) & 0x80) | (((_TAG) >> 5) & 0x08); \
+}
+
 #define SET_TLP_TAG(_TAG, _PTR){        \
-    (_PTR)[TLP_TAG_OFFSET] = ((_TAG)%0xff);    \
+    (_PTR)[TLP_TAG_OFFSET] = ((_TAG) & BYTE_MASK);    \
+    SET_TAG_HI(_TAG, _PTR);             \
 }
 
 #define SET_CPL_TAG(_TAG, _PTR){        \
-    (_PTR)[CPL_TAG_OFFSET] = (_TAG);    \
+    (_PTR)[CPL_TAG_OFFSET] = ((_TAG) & BYTE_MASK);    \
+    SET_TAG_HI(_TAG, _PTR);             \
 }
 
 #define SET_TLP_TC(_TC, _PTR){  \
@@ -257,6 +391,7 @@
 
 #define SET_TLP_ATTR(_ATTR, _PTR){      \
     (_PTR)[TLP_ATTR_BYTE_OFFSET] = ((_PTR)[TLP_ATTR_BYTE_OFFSET] & 0xcf) | (((_ATTR) & 0x3)<<4); \
+    (_PTR)[TLP_IDO_BYTE_OFFSET]  = ((_PTR)[TLP_IDO_BYTE_OFFSET]  & 0xfb) | ((((_ATTR) >> 2) & 0x1)<<2); \
 }
 
 #define SET_TLP_RID(_RID, _PTR){        \
@@ -293,7 +428,8 @@
 }
 
 #define SET_CFG_TAG(_TAG, _PTR){        \
-    (_PTR)[CFG_TAG_OFFSET] = (_TAG);    \
+    (_PTR)[CFG_TAG_OFFSET] = ((_TAG) & BYTE_MASK);    \
+    SET_TAG_HI(_TAG, _PTR);             \
 }
 
 #define SET_CFG_BUS(_BUS, _PTR){ \
@@ -333,15 +469,12 @@
 #define GET_DLLP_SEQ(_PKT) ((((_PKT)[DLLP_SEQ_OFFSET] & LO_NIBBLE_MASK) << 8) | ((_PKT)[DLLP_SEQ_OFFSET+1]))
 
 #define GET_TLP_TYPE(_PKT)    ((_PKT)[TLP_TYPE_BYTE_OFFSET] & BYTE_MASK)
-#define GET_TLP_LENGTH_RAW(_PKT)  ((((_PKT)[TLP_LENGTH_OFFSET] & 0x3) << 8) | ((_PKT)[TLP_LENGTH_OFFSET+1] & BYTE_MASK))
-#define GET_TLP_LENGTH_ADJ(_PKT)  (GET_TLP_LENGTH_RAW(_PKT) ? GET_TLP_LENGTH_RAW(_PKT) : 1024)
-#define GET_TLP_LENGTH(_PKT)  GET_TLP_LENGTH_ADJ(_PKT)
 #define GET_TLP_FBE(_PKT)     ((_PKT)[TLP_BE_OFFSET] & LO_NIBBLE_MASK)
 #define GET_TLP_LBE(_PKT)     (((_PKT)[TLP_BE_OFFSET] >> 4) & LO_NIBBLE_MASK)
 #define GET_TLP_RID(_PKT)     ((((_PKT)[TLP_RID_OFFSET] & BYTE_MASK) << 8) | ((_PKT)[TLP_RID_OFFSET+1] & BYTE_MASK))
-#define GET_TLP_TAG(_PKT)     ((_PKT)[TLP_TAG_OFFSET] & BYTE_MASK)
-#define TLP_HAS_DIGEST(_PKT)  (((_PKT)[TLP_TD_BYTE_OFFSET] & TLP_TD_BYTE_MASK) ? 1 : 0)
-#define TLP_HDR_4DW(_PKT)     (((_PKT)[TLP_TYPE_BYTE_OFFSET] & 0x20) ? 1 : 0)
+#define GET_TAG_HI(_PKT)      ((((_PKT)[TLP_TAG_HI_BYTE_OFFSET] & TLP_TAG_T9_BYTE_MASK) << 2) | (((_PKT)[TLP_TAG_HI_BYTE_OFFSET] & TLP_TAG_T8_BYTE_MASK) << 5))
+#define GET_TLP_TAG(_PKT)     (GET_TAG_HI(_PKT) | ((_PKT)[TLP_TAG_OFFSET] & BYTE_MASK))
+#define GET_TLP_ATTR(_PKT)    ((((_PKT)[TLP_ATTR_BYTE_OFFSET] >> 4) & 0x3) | (((_PKT)[TLP_IDO_BYTE_OFFSET] >> 2) & 0x1) << 2)
 #define TLP_IS_POSTED(_PKT)   (((_PKT)[TLP_TYPE_BYTE_OFFSET] & 0x20) ? 1 : 0)
 #define OFFSET_FROM_FBE(_FBE) (((((_FBE) & 0x3) == 0x00) ? 0x2 : 0x0) + ( ((((_FBE) & 0x3) == 0x2) || (((_FBE) & 0xc) == 0x80)) ? 0x1 : 0x0))
 #define OFFSET_FROM_LBE(_LBE) ((((_LBE) == 0xf) || ((_LBE) == 0x0)) ? 0x0 : (_LBE) == 0x7 ? 1 : (_LBE) == 0x3 ? 0x2 : 0x3)
@@ -361,10 +494,11 @@
 #define GET_DATA_FC(_DATA)    ((((_DATA)[DLLP_DATA_FC_OFFSET] & LO_NIBBLE_MASK) << 8) | ((_DATA)[DLLP_DATA_FC_OFFSET+1] & BYTE_MASK))
 
 // Completion only status
-#define GET_CPL_TAG(_PKT)     ((_PKT)[CPL_TAG_OFFSET] & BYTE_MASK)
+#define GET_CPL_TAG(_PKT)     (GET_TAG_HI(_PKT) | ((_PKT)[CPL_TAG_OFFSET] & BYTE_MASK))
 #define GET_CPL_BYTECOUNT(_PKT)  (((_PKT)[CPL_BYTE_COUNT_OFFSET] & 0xf) << 8ULL | \
                                   ((_PKT)[CPL_BYTE_COUNT_OFFSET+1] & BYTE_MASK))
 #define GET_CPL_STATUS(_PKT) (((_PKT)[CPL_STATUS_OFFSET] & 0xe0) >> 5)
+#define GET_CPL_LOW_ADDR(_PKT) ((_PKT)[CPL_LOW_ADDR_OFFSET] & 0x7f)
 #define GET_CPL_CID(_PKT)     ((((_PKT)[CPL_CID_OFFSET] & BYTE_MASK) << 8) | (((_PKT)[CPL_CID_OFFSET+1] & BYTE_MASK)))
 #define GET_CFG_CID(_PKT)     ((((_PKT)[CFG_BUS_OFFSET] & BYTE_MASK) << 8) | (((_PKT)[CFG_BUS_OFFSET+1] & BYTE_MASK)))
 
@@ -382,6 +516,8 @@ typedef struct  pkt_struct {
     int         Retry;
     uint32_t    TimeStamp;
     uint32_t    ByteCount;
+    uint32_t    Order;       // Issue order, whilst on a transmit queue (CONFIG_TX_QUEUE_DEPTH)
+    bool        BadLcrc;     // Send with a bad LCRC, as captured (PcieReplay())
 } sPkt_t;
 
 typedef struct {
@@ -396,6 +532,19 @@ typedef struct {
 typedef void (*callback_t)(pPkt_t, int, void *);
 typedef void (*os_callback_t)(int, int, pTS_t, void *);
 
+// Receive credit state for an FC type, passed to a user UpdateFC policy
+// callback (FC_POLICY_CALLBACK), which returns true to send an UpdateFC
+typedef struct {
+    uint32_t    hdr_pending;                    // Consumed credits not yet advertised
+    uint32_t    data_pending;
+    uint32_t    hdr_space;                      // Advertised credits not yet used by received TLPs
+    uint32_t    data_space;
+    uint32_t    cycles;                         // Cycles since the last UpdateFC for the type
+    bool        queue_empty;                    // Nothing queued to send
+} FcUpdateInfo_t, *pFcUpdateInfo_t;
+
+typedef bool (*fc_callback_t)(int, pFcUpdateInfo_t, void *);
+
 enum config_e {
     CONFIG_FC_HDR_RATE                         = 0,
     CONFIG_FC_DATA_RATE,
@@ -452,11 +601,240 @@ enum config_e {
     CONFIG_DISABLE_DISPLINK_COLOUR,
     CONFIG_ENABLE_DISPLINK_COLOUR,
 
-    CONFIG_DISP_BCK_NODE_NUM
+    CONFIG_DISP_BCK_NODE_NUM,
+
+    CONFIG_ENABLE_FINISH_STATS,
+    CONFIG_DISABLE_FINISH_STATS,
+
+    CONFIG_ENABLE_TRACE,
+    CONFIG_DISABLE_TRACE,
+
+    CONFIG_DISP_ASYNC,
+
+    CONFIG_TRIG_ARM,
+    CONFIG_TRIG_DISARM,
+    CONFIG_TRIG_HISTORY,
+    CONFIG_TRIG_POST,
+    CONFIG_TRIG_STALL_CYCLES,
+
+    CONFIG_STALL_TIMELINE,
+
+    CONFIG_ENABLE_GEN3,
+    CONFIG_DISABLE_GEN3,
+
+    CONFIG_CPL_MAX_PAYLOAD,
+    CONFIG_READ_CPL_BOUNDARY,
+
+    CONFIG_ACK_POLICY,
+
+    CONFIG_REPLAY_TIMEOUT,
+    CONFIG_REPLAY_RETRAIN,
+
+    CONFIG_FC_POLICY,
+    CONFIG_FC_HDR_WATERMARK,
+    CONFIG_FC_DATA_WATERMARK,
+    CONFIG_FC_UPDATE_TIME,
+
+    CONFIG_TX_QUEUE_DEPTH,
+    CONFIG_TX_ATTR,
+
+    CONFIG_TAG_10BIT,
+    CONFIG_TAG_POOL_SIZE
 };
 
 typedef enum config_e config_t;
 
+// Request to final completion latency statistics, in cycles. The
+// percentiles are estimated from the histogram buckets.
+typedef struct {
+    uint64_t    count;
+    uint64_t    total;
+    uint32_t    min;
+    uint32_t    max;
+    uint32_t    p50;
+    uint32_t    p90;
+    uint32_t    p99;
+    uint64_t    buckets[LAT_NUM_BUCKETS];
+} LatencyStats_t, *pLatencyStats_t;
+
+// Transmit credit stall statistics, for an FC type (FC_POST etc.)
+typedef struct {
+    uint64_t    episodes;
+    uint64_t    total_cycles;
+    uint32_t    max_cycles;
+    uint64_t    hdr_short;                      // Episodes with too few header credits
+    uint64_t    data_short;                     // Episodes with too few data credits
+} CreditStallStats_t, *pCreditStallStats_t;
+
+// ACK/NAK DLLP statistics. Good TLPs acknowledged by a later ACK,
+// rather than their own, are counted as coalesced.
+typedef struct {
+    uint64_t    ack_requests;                   // Good TLPs to acknowledge (SendAck() calls)
+    uint64_t    acks_sent;
+    uint64_t    naks_sent;
+    uint64_t    acks_coalesced;
+    uint64_t    symbols_saved;                  // Lane symbols saved by coalescing
+} AckStats_t, *pAckStats_t;
+
+// UpdateFC DLLP statistics, for an FC type, with the credits returned
+// to the link partner by the UpdateFCs
+typedef struct {
+    uint64_t    updates_sent;
+    uint64_t    timer_updates;                  // Sent on update timer expiry
+    uint64_t    hdr_credits_returned;
+    uint64_t    data_credits_returned;
+} FcUpdateStats_t, *pFcUpdateStats_t;
+
+// Transmit queue statistics, for an FC type (CONFIG_TX_QUEUE_DEPTH).
+// A TLP sent ahead of an older queued TLP, held for credits or by the
+// ordering rules, is counted as a bypass.
+typedef struct {
+    uint64_t    queued;
+    uint64_t    bypasses;
+    uint32_t    max_depth;
+} TxQueueStats_t, *pTxQueueStats_t;
+
+// An outstanding non-posted request (GetOutstandingRequest()), with the
+// request type (LAT_xxx), the bytes requested and the bytes still to be
+// returned by completions, and the cycle the request was issued
+typedef struct {
+    int         type;
+    uint64_t    addr;
+    uint32_t    length;
+    uint32_t    remaining;
+    uint32_t    issued;
+} OutstandingReq_t, *pOutstandingReq_t;
+
+// Tag statistics. Allocations that found the tag pool empty are counted
+// as waits, and completions with no outstanding request as unmatched.
+typedef struct {
+    uint64_t    allocated;
+    uint64_t    waits;
+    uint64_t    wait_cycles;
+    uint64_t    unmatched;
+    uint32_t    outstanding;
+    uint32_t    max_outstanding;
+} TagStats_t, *pTagStats_t;
+
+// Data link layer retransmission statistics. A replay is started by a
+// NAK or by REPLAY_TIMER expiring, and REPLAY_NUM rolls over after
+// REPLAY_NUM_ROLLOVER replays without forward progress.
+typedef struct {
+    uint64_t    naks_received;
+    uint64_t    timeouts;                       // REPLAY_TIMER expiries
+    uint64_t    replays;
+    uint64_t    tlps_replayed;                  // TLP retransmissions
+    uint64_t    rollovers;                      // REPLAY_NUM rollovers
+    uint64_t    retrains;                       // Link retrains after a rollover
+} ReplayStats_t, *pReplayStats_t;
+
+// Completer timing profile for an address window, applied to the
+// model's own completions of memory reads in the window (AddCplProfile()).
+// A read's data is ready after the access latency, plus the time to
+// transfer it from a backing store of limited bandwidth, which is
+// shared with memory writes to the window. Reads beyond the
+// outstanding limit wait for an earlier read to complete before
+// starting.
+typedef struct {
+    uint64_t    base;                           // Address window
+    uint64_t    size;
+    uint32_t    latency;                        // Fixed access latency, in cycles
+    uint32_t    spread;                         // Random additional latency, from 0 to spread-1 cycles
+    uint32_t    tail_percent;                   // Percentage of reads with an additional tail latency
+    uint32_t    tail_latency;
+    uint32_t    bytes_per_cycle;                // Backing store bandwidth (0 for unlimited)
+    uint32_t    max_outstanding;                // Reads in progress (0 for unlimited)
+} CplProfile_t, *pCplProfile_t;
+
+// Constrained random traffic generator configuration (PcieGenerate()).
+// Memory accesses fall within addr_window bytes from addr_base, and
+// never cross a 4K boundary. Configuration and IO accesses are of a
+// single DW, with configuration reads from completer cfg_cid at the
+// register offset of the generated address, and IO accesses at the
+// lower 32 bits of the generated address. Configuration writes are
+// only made to random registers in the cfg_wr_size byte window from
+// cfg_wr_base, which must be set to registers safe to overwrite.
+typedef struct {
+    uint32_t    seed;                           // Generator random seed (0 for default)
+    uint32_t    num_tlps;                       // TLPs to generate (0 for no limit)
+    uint32_t    max_cycles;                     // Cycles to generate for (0 for no limit)
+    uint32_t    weight[GEN_NUM_TYPES];          // Relative weights of the TLP types
+    int         len_dist;                       // GEN_SIZE_xxx
+    int         len_min;                        // Memory access sizes, in bytes
+    int         len_max;
+    int         addr_mode;                      // GEN_ADDR_xxx
+    uint64_t    addr_base;
+    uint64_t    addr_window;
+    uint32_t    addr_stride;                    // Access spacing for GEN_ADDR_STRIDE
+    uint32_t    addr_align;                     // Access alignment for GEN_ADDR_RANDOM (a power of 2)
+    uint32_t    cfg_cid;
+    uint32_t    cfg_wr_base;                    // Config write register window (byte offsets)
+    uint32_t    cfg_wr_size;
+    uint32_t    rid;
+    int         tag_base;                       // Tags used for non-posted requests, which
+    int         num_tags;                       // also limits the number outstanding
+    int         burst_len;                      // TLPs queued back to back per burst
+    int         burst_gap;                      // Idle cycles between bursts
+    uint32_t    cpl_timeout;                    // Cycles to wait for outstanding completions at the end
+} PcieGenCfg_t, *pPcieGenCfg_t;
+
+// Traffic generator achieved results
+typedef struct {
+    uint64_t    tlps[GEN_NUM_TYPES];
+    uint64_t    wr_bytes;                       // Memory write payload bytes
+    uint64_t    rd_bytes;                       // Memory read bytes requested
+    uint64_t    tag_stall_cycles;               // Cycles waiting for a free tag
+    uint32_t    lost_cpls;                      // Requests with no final completion by cpl_timeout
+    uint32_t    cycles;                         // Cycles from start until all completions returned (or timed out)
+} PcieGenStats_t, *pPcieGenStats_t;
+
+// Lane error injection configuration (PcieInject()). Errors of each
+// type occur at a mean interval, with 0 disabling them. Targeted
+// errors corrupt the last CRC byte of a TLP or DLLP. Flow control
+// DLLP types (DL_INITFCx/DL_UPDATEFCx) match any VC.
+typedef struct {
+    uint32_t    seed;                           // Injector random seed (0 for the node's PcieSeed() state)
+    uint32_t    bit_error_interval[MAX_LINK_WIDTH]; // Mean bits between bit errors, per lane
+    uint32_t    burst_interval;                 // Mean cycles between burst errors
+    uint32_t    burst_len;                      // Burst length, in cycles
+    uint32_t    burst_lanes;                    // Lanes corrupted by bursts (bit mask)
+    uint32_t    disparity_interval;             // Mean symbols between disparity errors, per lane (8b10b only)
+    uint32_t    drop_interval;                  // Mean symbols between dropped symbols, per lane
+    uint32_t    dup_interval;                   // Mean symbols between duplicated symbols, per lane
+    uint32_t    tlp_nth;                        // Corrupt the LCRC of the Nth TLP transmitted (0 for none)
+    int         dllp_type;                      // Corrupt the CRC of DLLPs of this type (INJ_DLLP_NONE for none)
+    uint32_t    dllp_count;                     // DLLPs to corrupt (0 for no limit)
+} PcieInjectCfg_t, *pPcieInjectCfg_t;
+
+// Lane error injection counts
+typedef struct {
+    uint64_t    symbols;                        // Lane symbols passed through the injector
+    uint64_t    bit_errors;
+    uint64_t    bursts;
+    uint64_t    burst_symbols;
+    uint64_t    disparity_errors;
+    uint64_t    symbols_dropped;
+    uint64_t    symbols_duplicated;
+    uint64_t    tlps_corrupted;
+    uint64_t    dllps_corrupted;
+} PcieInjectStats_t, *pPcieInjectStats_t;
+
+// Link packet symbol counts, for link utilisation
+typedef struct {
+    uint64_t    tx_pkt_symbols;                 // Lane symbols carrying transmitted TLPs and DLLPs
+    uint64_t    rx_pkt_symbols;                 // Lane symbols carrying received TLPs and DLLPs
+} LinkStats_t, *pLinkStats_t;
+
+// Benchmark results (PcieBench())
+typedef struct {
+    PcieGenStats_t gen;
+    LatencyStats_t rd_latency;                  // Memory read request to final completion
+    double      mbytes_per_sec;                 // Memory write and read data
+    double      tlps_per_sec;
+    double      tx_utilisation;                 // Fraction of lane symbols carrying packets
+    double      rx_utilisation;
+} PcieBenchStats_t, *pPcieBenchStats_t;
+
 // -------------------------------------------------------------------------
 // PCIe model API prototypes (excluding those define in mem.h)
 // -------------------------------------------------------------------------
@@ -556,9 +934,91 @@ EXTERN void       WaitForCompletion       (const int node);
 EXTERN void       WaitForCompletionN      (const uint32_t count,          const int node);
 EXTERN void       InitialisePcie          (const callback_t    cb_func, void *usrptr, const int node);
 EXTERN void       RegisterOsCallback      (const os_callback_t cb_func, const int node);
+EXTERN void       RegisterFcCallback      (const fc_callback_t cb_func, const int node);
 EXTERN uint32_t   GetCycleCount           (const int node);
 EXTERN void       ConfigurePcie           (const config_t type, const int value, const int node);
 
+// Binary link trace capture
+EXTERN int        PcieTraceOpen           (const char* fname, const uint32_t flags, const int node);
+EXTERN void       PcieTraceClose          (const int node);
+
+// Triggered capture
+EXTERN int        PcieTrigArm             (const char* spec, const int node);
+EXTERN void       PcieTrigDisarm          (const int node);
+
+// Trace replay
+EXTERN int        PcieReplay              (const char* fname, const uint32_t flags, const int max_gap, const int node);
+
+// Non-posted request latency statistics
+EXTERN int        GetLatencyStats         (const int type, const pLatencyStats_t stats, const int node);
+EXTERN void       PrintLatencyStats       (const int node);
+EXTERN void       ClearLatencyStats       (const int node);
+
+// Transmit credit stall statistics
+EXTERN int        GetCreditStallStats     (const int fc_type, const pCreditStallStats_t stats, const int node);
+EXTERN void       PrintCreditStallStats   (const int node);
+EXTERN void       ClearCreditStallStats   (const int node);
+
+// ACK/NAK statistics
+EXTERN void       GetAckStats             (const pAckStats_t stats, const int node);
+EXTERN void       PrintAckStats           (const int node);
+EXTERN void       ClearAckStats           (const int node);
+
+// UpdateFC statistics
+EXTERN int        GetFcUpdateStats        (const int fc_type, const pFcUpdateStats_t stats, const int node);
+EXTERN void       PrintFcUpdateStats      (const int node);
+EXTERN void       ClearFcUpdateStats      (const int node);
+
+// Transmit queue statistics
+EXTERN int        GetTxQueueStats         (const int fc_type, const pTxQueueStats_t stats, const int node);
+EXTERN void       PrintTxQueueStats       (const int node);
+EXTERN void       ClearTxQueueStats       (const int node);
+
+// Non-posted request tags and tag statistics
+EXTERN int        GetLastTag              (const int node);
+EXTERN int        GetOutstandingRequest   (const int tag, const pOutstandingReq_t req, const int node);
+EXTERN void       GetTagStats             (const pTagStats_t stats, const int node);
+EXTERN void       PrintTagStats           (const int node);
+EXTERN void       ClearTagStats           (const int node);
+
+// Replay (retransmission) statistics
+EXTERN void       GetReplayStats          (const pReplayStats_t stats, const int node);
+EXTERN void       PrintReplayStats        (const int node);
+EXTERN void       ClearReplayStats        (const int node);
+
+// Constrained random traffic generator
+EXTERN void       PcieGenDefaults         (const pPcieGenCfg_t cfg);
+EXTERN int        PcieGenLoad             (const char* fname, const pPcieGenCfg_t cfg, const int node);
+EXTERN int        PcieGenerate            (const pPcieGenCfg_t cfg, const pPcieGenStats_t stats, const int node);
+EXTERN int        PcieBench               (const pPcieGenCfg_t cfg, const pPcieBenchStats_t stats, const int node);
+
+// Lane error injection
+EXTERN void       PcieInjectDefaults      (const pPcieInjectCfg_t cfg);
+EXTERN int        PcieInject              (const pPcieInjectCfg_t cfg, const int node);
+EXTERN void       PcieInjectStop          (const int node);
+EXTERN void       GetInjectStats          (const pPcieInjectStats_t stats, const int node);
+EXTERN void       PrintInjectStats        (const int node);
+EXTERN void       ClearInjectStats        (const int node);
+
+// End of run statistics report (all of the above), printed when the
+// node finishes unless CONFIG_DISABLE_FINISH_STATS
+EXTERN void       PrintPcieStats          (const int node);
+
+// Link utilisation
+EXTERN void       GetLinkStats            (const pLinkStats_t stats, const int node);
+EXTERN void       ClearLinkStats          (const int node);
+
+// Asynchronous link display
+EXTERN uint32_t   GetDispDropCount        (const int node);
+
+// Link display filtering
+EXTERN int        AddDispFilter           (const char* rule, const int node);
+EXTERN void       ClearDispFilters        (const int node);
+
+// Completer timing profiles
+EXTERN int        AddCplProfile           (const pCplProfile_t profile, const int node);
+EXTERN void       ClearCplProfiles        (const int node);
+
 // Physical layer event routines
 EXTERN int        ResetEventCount         (const int type, const int node);
 EXTERN int        ReadEventCount          (const int type, uint32_t *ts_data, const int node);
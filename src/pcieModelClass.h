@@ -166,10 +166,106 @@ public:
                                                            {InitialisePcie(cb_func, usrptr, node);};
     void       registerOsCallback   (const os_callback_t cb_func)
                                                            {RegisterOsCallback(cb_func, node);};
+    void       registerFcCallback   (const fc_callback_t cb_func)
+                                                           {RegisterFcCallback(cb_func, node);};
     uint32_t   getCycleCount        (void)                 {return GetCycleCount(node);};
     void       configurePcie        (const config_t type, const int value = 0)
                                         {ConfigurePcie(type, value, node);};
 
+    // Binary link trace capture
+    int        pcieTraceOpen        (const char* fname = NULL, const uint32_t flags = PCIE_TRACE_ALL)
+                                                           {return PcieTraceOpen(fname, flags, node);};
+    void       pcieTraceClose       (void)                 {PcieTraceClose(node);};
+
+    // Triggered capture
+    int        pcieTrigArm          (const char* spec)     {return PcieTrigArm(spec, node);};
+    void       pcieTrigDisarm       (void)                 {PcieTrigDisarm(node);};
+
+    // Trace replay
+    int        pcieReplay           (const char* fname, const uint32_t flags = REPLAY_TLP, const int max_gap = REPLAY_ORIG_TIMING)
+                                                           {return PcieReplay(fname, flags, max_gap, node);};
+
+    // Non-posted request latency statistics
+    int        getLatencyStats      (const int type, const pLatencyStats_t stats)
+                                                           {return GetLatencyStats(type, stats, node);};
+    void       printLatencyStats    (void)                 {PrintLatencyStats(node);};
+    void       clearLatencyStats    (void)                 {ClearLatencyStats(node);};
+
+    // Transmit credit stall statistics
+    int        getCreditStallStats  (const int fc_type, const pCreditStallStats_t stats)
+                                                           {return GetCreditStallStats(fc_type, stats, node);};
+    void       printCreditStallStats(void)                 {PrintCreditStallStats(node);};
+    void       clearCreditStallStats(void)                 {ClearCreditStallStats(node);};
+
+    // ACK/NAK statistics
+    void       getAckStats          (const pAckStats_t stats)  {GetAckStats(stats, node);};
+    void       printAckStats        (void)                 {PrintAckStats(node);};
+    void       clearAckStats        (void)                 {ClearAckStats(node);};
+
+    // UpdateFC statistics
+    int        getFcUpdateStats     (const int fc_type, const pFcUpdateStats_t stats)
+                                                           {return GetFcUpdateStats(fc_type, stats, node);};
+    void       printFcUpdateStats   (void)                 {PrintFcUpdateStats(node);};
+    void       clearFcUpdateStats   (void)                 {ClearFcUpdateStats(node);};
+    int        getTxQueueStats      (const int fc_type, const pTxQueueStats_t stats)
+                                                           {return GetTxQueueStats(fc_type, stats, node);};
+    void       printTxQueueStats    (void)                 {PrintTxQueueStats(node);};
+    void       clearTxQueueStats    (void)                 {ClearTxQueueStats(node);};
+    int        getLastTag           (void)                 {return GetLastTag(node);};
+    int        getOutstandingRequest(const int tag, const pOutstandingReq_t req)
+                                                           {return GetOutstandingRequest(tag, req, node);};
+    void       getTagStats          (const pTagStats_t stats)
+                                                           {GetTagStats(stats, node);};
+    void       printTagStats        (void)                 {PrintTagStats(node);};
+    void       clearTagStats        (void)                 {ClearTagStats(node);};
+
+    // Replay statistics
+    void       getReplayStats       (const pReplayStats_t stats)
+                                                           {GetReplayStats(stats, node);};
+    void       printReplayStats     (void)                 {PrintReplayStats(node);};
+    void       clearReplayStats     (void)                 {ClearReplayStats(node);};
+
+    // Constrained random traffic generator
+    void       pcieGenDefaults      (const pPcieGenCfg_t cfg)
+                                                           {PcieGenDefaults(cfg);};
+    int        pcieGenLoad          (const char* fname, const pPcieGenCfg_t cfg)
+                                                           {return PcieGenLoad(fname, cfg, node);};
+    int        pcieGenerate         (const pPcieGenCfg_t cfg, const pPcieGenStats_t stats = NULL)
+                                                           {return PcieGenerate(cfg, stats, node);};
+    int        pcieBench            (const pPcieGenCfg_t cfg, const pPcieBenchStats_t stats = NULL)
+                                                           {return PcieBench(cfg, stats, node);};
+
+    // Lane error injection
+    void       pcieInjectDefaults   (const pPcieInjectCfg_t cfg)
+                                                           {PcieInjectDefaults(cfg);};
+    int        pcieInject           (const pPcieInjectCfg_t cfg)
+                                                           {return PcieInject(cfg, node);};
+    void       pcieInjectStop       (void)                 {PcieInjectStop(node);};
+    void       getInjectStats       (const pPcieInjectStats_t stats)
+                                                           {GetInjectStats(stats, node);};
+    void       printInjectStats     (void)                 {PrintInjectStats(node);};
+    void       clearInjectStats     (void)                 {ClearInjectStats(node);};
+
+    // End of run statistics report
+    void       printPcieStats       (void)                 {PrintPcieStats(node);};
+
+    // Link utilisation
+    void       getLinkStats         (const pLinkStats_t stats)
+                                                           {GetLinkStats(stats, node);};
+    void       clearLinkStats       (void)                 {ClearLinkStats(node);};
+
+    // Asynchronous link display
+    uint32_t   getDispDropCount     (void)                 {return GetDispDropCount(node);};
+
+    // Link display filtering
+    int        addDispFilter        (const char* rule)     {return AddDispFilter(rule, node);};
+    void       clearDispFilters     (void)                 {ClearDispFilters(node);};
+
+    // Completer timing profiles
+    int        addCplProfile        (const pCplProfile_t profile)
+                                                           {return AddCplProfile(profile, node);};
+    void       clearCplProfiles     (void)                 {ClearCplProfiles(node);};
+
     // Physical layer event routines
     int        resetEventCount      (const int type)       {return ResetEventCount(type, node);};
     int        readEventCount       (const int type, uint32_t *ts_data)
@@ -192,6 +288,9 @@ public:
     int        readRamByteBlock     (const uint64_t addr, PktData_t* const data, const int length)
                                         {return ReadRamByteBlock(addr, data, length, node);};
 
+    int        memSharedOpen        (const char* name = NULL, const uint32_t pages = 0)                     {return MemSharedOpen(name, pages, node);};
+    void       memSharedClose       (const bool unlink_obj = true)                                          {MemSharedClose(unlink_obj, node);};
+
     void       writeRamByte         (const uint64_t addr, const uint32_t data)                              {WriteRamByte(addr, data, node);};
     void       writeRamHWord        (const uint64_t addr, const uint32_t data, const int little_endian = 0) {WriteRamHWord(addr, data, little_endian, node);};
     void       writeRamWord         (const uint64_t addr, const uint32_t data, const int little_endian = 0) {WriteRamWord(addr, data, little_endian, node);};
@@ -206,6 +305,9 @@ public:
     void       writeConfigSpaceMask (const uint32_t addr, const uint32_t data)                              {WriteConfigSpaceMask(addr, data, node);};
     uint32_t   readConfigSpaceMask  (const uint32_t addr)                                                  {return ReadConfigSpaceMask(addr, node);};
 
+    int        loadConfigSpaceImage (const char* fname, const int format = CFG_IMAGE_HEX, const uint32_t func = 0) {return LoadConfigSpaceImage(fname, format, func, node);};
+    int        dumpConfigSpaceImage (const char* fname, const int format = CFG_IMAGE_HEX, const uint32_t func = 0) {return DumpConfigSpaceImage(fname, format, func, node);};
+
 private:
 
     unsigned node;
@@ -0,0 +1,54 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// PCIe CRC generation, shared by the model and the offline tools
+//
+//=============================================================
+
+#ifndef _PCIE_CRC_H_
+#define _PCIE_CRC_H_
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdint.h>
+
+#include "pci_express.h"
+
+// -------------------------------------------------------------------------
+// EXTERNAL REFERENCES
+// -------------------------------------------------------------------------
+
+extern const unsigned int Bitrev8[];
+
+// -------------------------------------------------------------------------
+// PROTOTYPES
+// -------------------------------------------------------------------------
+
+extern uint32_t PciCrc      (const uint32_t Data, const uint32_t CrcIn, const uint32_t Bits, const uint32_t poly, const uint32_t crcsize);
+extern void     CalcLcrc    (PktData_t *pkt);
+extern void     CalcEcrc    (PktData_t *pkt);
+extern void     CalcDllpCrc (PktData_t *dllp);
+
+#endif
@@ -43,8 +43,10 @@ EXTERN void VUserMain1(void);
 
 EXTERN void PcieInit (int node)
 {
-    // Ensure that the Aldec tools can intercept the stdout stream
-    setvbuf(stdout, 0, _IONBF, 0);
+    // Ensure that the Aldec tools can intercept the stdout stream. Line
+    // buffered, so each line is passed on as written, whilst the display
+    // writer's batches of lines (CONFIG_DISP_ASYNC) go out as single writes.
+    setvbuf(stdout, 0, _IOLBF, 0);
 
     VPrint("PcieInit(%d)\n", node);
 
@@ -0,0 +1,633 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Constrained random traffic generator. TLPs are generated from
+// a PcieGenCfg_t (filled directly, or loaded from a file) with a
+// weighted type mix, memory access size distribution and address
+// pattern, and issued in bursts through the normal request API.
+// Non-posted requests use tags from a configured range, with a new
+// request waiting for a tag whose final completion has returned.
+// The generator has its own random number state, so a given seed
+// reproduces the same traffic regardless of the rest of the model.
+// A run can also be made as a benchmark, measuring real time rates,
+// read latency and link utilisation.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include "pcie.h"
+#include "pcie_utils.h"
+#include "displink.h"
+
+// -------------------------------------------------------------------------
+// STATICS
+// -------------------------------------------------------------------------
+
+static const char* gen_type_str[GEN_NUM_TYPES] = {"MemWr", "MemRd", "CfgWr", "CfgRd", "IoWr", "IoRd"};
+
+// -------------------------------------------------------------------------
+// GenRand()
+//
+// Return the next value from the generator's random state
+//
+// -------------------------------------------------------------------------
+
+static inline uint32_t GenRand (uint32_t* rand_num)
+{
+    *rand_num = CalcNewRand(*rand_num);
+
+    return *rand_num;
+}
+
+// -------------------------------------------------------------------------
+// GenType()
+//
+// Pick a TLP type from the weighted mix
+//
+// -------------------------------------------------------------------------
+
+static int GenType (const pPcieGenCfg_t cfg, const uint32_t total_weight, uint32_t* rand_num)
+{
+    uint32_t pick = GenRand(rand_num) % total_weight;
+    int      type;
+
+    for (type = 0; type < GEN_NUM_TYPES - 1; type++)
+    {
+        if (pick < cfg->weight[type])
+        {
+            break;
+        }
+
+        pick -= cfg->weight[type];
+    }
+
+    return type;
+}
+
+// -------------------------------------------------------------------------
+// GenLength()
+//
+// Pick a memory access size from the configured distribution
+//
+// -------------------------------------------------------------------------
+
+static int GenLength (const pPcieGenCfg_t cfg, uint32_t* rand_num)
+{
+    int lo, hi;
+
+    switch (cfg->len_dist)
+    {
+    case GEN_SIZE_UNIFORM:
+        return cfg->len_min + GenRand(rand_num) % (cfg->len_max - cfg->len_min + 1);
+
+    case GEN_SIZE_POW2:
+        lo = (cfg->len_min > 1) ? 32 - __builtin_clz(cfg->len_min - 1) : 0;
+        hi = 31 - __builtin_clz(cfg->len_max);
+
+        return (lo <= hi) ? 1 << (lo + GenRand(rand_num) % (hi - lo + 1)) : cfg->len_min;
+
+    default:
+        return cfg->len_min;
+    }
+}
+
+// -------------------------------------------------------------------------
+// GenAddress()
+//
+// Generate the next access offset within the address window, clipping
+// the length to the window and to the next 4K boundary
+//
+// -------------------------------------------------------------------------
+
+static uint64_t GenAddress (const pPcieGenCfg_t cfg, uint64_t* offset, int* length, uint32_t* rand_num)
+{
+    uint64_t addr, len = (uint64_t)*length;
+
+    if (cfg->addr_mode == GEN_ADDR_RANDOM)
+    {
+        *offset = ((((uint64_t)GenRand(rand_num) << 32) | GenRand(rand_num)) % cfg->addr_window) & ~((uint64_t)cfg->addr_align - 1);
+    }
+    else if (*offset >= cfg->addr_window)
+    {
+        *offset = 0;
+    }
+
+    addr    = cfg->addr_base + *offset;
+
+    len     = (len < (cfg->addr_window - *offset)) ? len : cfg->addr_window - *offset;
+    len     = (len < (4096 - (addr & 0xfff)))      ? len : 4096 - (addr & 0xfff);
+    *length = (int)len;
+
+    // Move on for the next access
+    *offset += (cfg->addr_mode == GEN_ADDR_STRIDE) ? cfg->addr_stride : len;
+
+    return addr;
+}
+
+// -------------------------------------------------------------------------
+// GenTag()
+//
+// Return the next tag in the configured range that isn't awaiting a
+// completion, or -1 if they all are
+//
+// -------------------------------------------------------------------------
+
+static int GenTag (const pPcieModelState_t const state, const pPcieGenCfg_t cfg, int* next_tag)
+{
+    for (int idx = 0; idx < cfg->num_tags; idx++)
+    {
+        int tag = cfg->tag_base + (*next_tag + idx) % cfg->num_tags;
+
+        if (!state->tags.table[tag].busy)
+        {
+            *next_tag = (*next_tag + idx + 1) % cfg->num_tags;
+            return tag;
+        }
+    }
+
+    return -1;
+}
+
+// -------------------------------------------------------------------------
+// GenPending()
+//
+// Return true if any tag in the configured range is awaiting a
+// completion
+//
+// -------------------------------------------------------------------------
+
+static bool GenPending (const pPcieModelState_t const state, const pPcieGenCfg_t cfg)
+{
+    for (int tag = cfg->tag_base; tag < cfg->tag_base + cfg->num_tags; tag++)
+    {
+        if (state->tags.table[tag].busy)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// -------------------------------------------------------------------------
+// GenLost()
+//
+// Report the tags in the configured range still awaiting a completion,
+// returning the number of them
+//
+// -------------------------------------------------------------------------
+
+static uint32_t GenLost (const pPcieModelState_t const state, const pPcieGenCfg_t cfg)
+{
+    char     buf[STRBUFSIZE];
+    int      len  = 0;
+    uint32_t lost = 0;
+
+    buf[0] = 0;
+    for (int tag = cfg->tag_base; tag < cfg->tag_base + cfg->num_tags; tag++)
+    {
+        if (state->tags.table[tag].busy)
+        {
+            if (len < STRBUFSIZE - 8)
+            {
+                len += snprintf(&buf[len], STRBUFSIZE - len, " %d", tag);
+            }
+            lost++;
+        }
+    }
+
+    if (lost)
+    {
+        VPrint("PcieGenerate: %s***Warning --- %u requests not completed, tags%s%s at node %d%s\n",
+               fmterrstr, lost, buf, (len < STRBUFSIZE - 8) ? "" : " ...", state->thisnode, fmtnormstr);
+    }
+
+    return lost;
+}
+
+// -------------------------------------------------------------------------
+// GenCheck()
+//
+// Check a configuration is usable, returning the total of the type
+// weights, or 0 if not. The tags must be valid for the configured tag
+// size (CONFIG_TAG_10BIT).
+//
+// -------------------------------------------------------------------------
+
+static uint32_t GenCheck (const pPcieModelState_t const state, const pPcieGenCfg_t cfg, const int node)
+{
+    uint32_t    total_weight = 0;
+    const char* err          = NULL;
+
+    for (int type = 0; type < GEN_NUM_TYPES; type++)
+    {
+        total_weight += cfg->weight[type];
+    }
+
+    if (total_weight == 0)
+    {
+        err = "no TLP types weighted";
+    }
+    else if (cfg->num_tlps == 0 && cfg->max_cycles == 0)
+    {
+        err = "neither a TLP count or cycle limit";
+    }
+    else if (cfg->len_min < 1 || cfg->len_max > MAX_PAYLOAD_BYTES || cfg->len_min > cfg->len_max)
+    {
+        err = "invalid memory access size range";
+    }
+    else if (cfg->addr_window == 0 || cfg->addr_align == 0 || (cfg->addr_align & (cfg->addr_align - 1)))
+    {
+        err = "invalid address window or alignment";
+    }
+    else if (cfg->num_tags < 1 || cfg->tag_base < 0 ||
+             (cfg->tag_base + cfg->num_tags) > (state->usrconf.Tag10Bit ? TAG_MAX_10BIT : TAG_MAX_8BIT))
+    {
+        err = "invalid tag range";
+    }
+    else if (cfg->weight[GEN_CFG_WR] && (cfg->cfg_wr_size < 4 || ((cfg->cfg_wr_base | cfg->cfg_wr_size) & ADDR_DW_OFFSET_MASK) ||
+                                         (cfg->cfg_wr_base + cfg->cfg_wr_size) > TABLESIZE))
+    {
+        err = "config writes without a valid register window";
+    }
+    else if (cfg->burst_len < 1 || cfg->burst_gap < 0)
+    {
+        err = "invalid burst profile";
+    }
+
+    if (err != NULL)
+    {
+        VPrint("PcieGenerate: %s***Warning --- %s at node %d%s\n", fmterrstr, err, node, fmtnormstr);
+        return 0;
+    }
+
+    return total_weight;
+}
+
+// -------------------------------------------------------------------------
+// GenDefaults()
+//
+// Fill in a configuration with an even mix of memory writes and reads,
+// of uniformly distributed sizes, to sequential addresses
+//
+// -------------------------------------------------------------------------
+
+void GenDefaults (const pPcieGenCfg_t cfg)
+{
+    memset(cfg, 0, sizeof(PcieGenCfg_t));
+
+    cfg->seed               = GEN_DEFAULT_SEED;
+    cfg->num_tlps           = GEN_DEFAULT_TLPS;
+    cfg->weight[GEN_MEM_WR] = 1;
+    cfg->weight[GEN_MEM_RD] = 1;
+    cfg->len_dist           = GEN_SIZE_UNIFORM;
+    cfg->len_min            = 4;
+    cfg->len_max            = GEN_DEFAULT_LEN_MAX;
+    cfg->addr_mode          = GEN_ADDR_SEQ;
+    cfg->addr_window        = GEN_DEFAULT_WINDOW;
+    cfg->addr_stride        = GEN_DEFAULT_LEN_MAX;
+    cfg->addr_align         = 4;
+    cfg->num_tags           = GEN_DEFAULT_TAGS;
+    cfg->burst_len          = 1;
+    cfg->cpl_timeout        = GEN_DEFAULT_CPL_TIMEOUT;
+}
+
+// -------------------------------------------------------------------------
+// GenLoad()
+//
+// Update a configuration from a file. Each line is a list of space
+// separated settings, with "//" starting a comment:
+//
+//   seed=<n> tlps=<n> cycles=<n>
+//   memwr=<w> memrd=<w> cfgwr=<w> cfgrd=<w> iowr=<w> iord=<w>
+//   size=<fixed|uniform|pow2> min=<bytes> max=<bytes>
+//   addr=<seq|stride|random> base=<a> window=<bytes> stride=<bytes> align=<bytes>
+//   cid=<id> cfgwrbase=<offset> cfgwrsize=<bytes>
+//   rid=<id> tagbase=<tag> tags=<n> burst=<n> gap=<cycles> cpltimeout=<cycles>
+//
+// Numbers may be decimal, or hex with a 0x prefix. Settings not in
+// the file are left unchanged. Returns MEM_BAD_STATUS if the file
+// can't be read or has an unrecognised setting.
+//
+// -------------------------------------------------------------------------
+
+int GenLoad (const char* fname, const pPcieGenCfg_t cfg, const int node)
+{
+    FILE* fp;
+    char  buf[STRBUFSIZE];
+    char* tok;
+    char* val;
+    int   status = MEM_GOOD_STATUS;
+
+    if ((fp = fopen(fname, "r")) == NULL)
+    {
+        VPrint("PcieGenLoad: %s***Warning --- could not open %s at node %d%s\n", fmterrstr, fname, node, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    while (fgets(buf, STRBUFSIZE, fp))
+    {
+        if ((tok = strstr(buf, "//")) != NULL)
+        {
+            *tok = 0;
+        }
+
+        for (tok = strtok(buf, " \t\r\n"); tok != NULL; tok = strtok(NULL, " \t\r\n"))
+        {
+            uint64_t num;
+
+            if ((val = strchr(tok, '=')) == NULL)
+            {
+                VPrint("PcieGenLoad: %s***Warning --- bad setting \"%s\" at node %d%s\n", fmterrstr, tok, node, fmtnormstr);
+                status = MEM_BAD_STATUS;
+                continue;
+            }
+
+            *val++ = 0;
+            num    = strtoull(val, NULL, 0);
+
+            if      (!strcmp(tok, "seed"))    cfg->seed                = num;
+            else if (!strcmp(tok, "tlps"))    cfg->num_tlps            = num;
+            else if (!strcmp(tok, "cycles"))  cfg->max_cycles          = num;
+            else if (!strcmp(tok, "memwr"))   cfg->weight[GEN_MEM_WR]  = num;
+            else if (!strcmp(tok, "memrd"))   cfg->weight[GEN_MEM_RD]  = num;
+            else if (!strcmp(tok, "cfgwr"))   cfg->weight[GEN_CFG_WR]  = num;
+            else if (!strcmp(tok, "cfgrd"))   cfg->weight[GEN_CFG_RD]  = num;
+            else if (!strcmp(tok, "iowr"))    cfg->weight[GEN_IO_WR]   = num;
+            else if (!strcmp(tok, "iord"))    cfg->weight[GEN_IO_RD]   = num;
+            else if (!strcmp(tok, "min"))     cfg->len_min             = num;
+            else if (!strcmp(tok, "max"))     cfg->len_max             = num;
+            else if (!strcmp(tok, "base"))    cfg->addr_base           = num;
+            else if (!strcmp(tok, "window"))  cfg->addr_window         = num;
+            else if (!strcmp(tok, "stride"))  cfg->addr_stride         = num;
+            else if (!strcmp(tok, "align"))   cfg->addr_align          = num;
+            else if (!strcmp(tok, "cid"))     cfg->cfg_cid             = num;
+            else if (!strcmp(tok, "cfgwrbase")) cfg->cfg_wr_base       = num;
+            else if (!strcmp(tok, "cfgwrsize")) cfg->cfg_wr_size       = num;
+            else if (!strcmp(tok, "rid"))     cfg->rid                 = num;
+            else if (!strcmp(tok, "tagbase")) cfg->tag_base            = num;
+            else if (!strcmp(tok, "tags"))    cfg->num_tags            = num;
+            else if (!strcmp(tok, "burst"))   cfg->burst_len           = num;
+            else if (!strcmp(tok, "gap"))     cfg->burst_gap           = num;
+            else if (!strcmp(tok, "cpltimeout")) cfg->cpl_timeout      = num;
+            else if (!strcmp(tok, "size") && !strcmp(val, "fixed"))    cfg->len_dist  = GEN_SIZE_FIXED;
+            else if (!strcmp(tok, "size") && !strcmp(val, "uniform"))  cfg->len_dist  = GEN_SIZE_UNIFORM;
+            else if (!strcmp(tok, "size") && !strcmp(val, "pow2"))     cfg->len_dist  = GEN_SIZE_POW2;
+            else if (!strcmp(tok, "addr") && !strcmp(val, "seq"))      cfg->addr_mode = GEN_ADDR_SEQ;
+            else if (!strcmp(tok, "addr") && !strcmp(val, "stride"))   cfg->addr_mode = GEN_ADDR_STRIDE;
+            else if (!strcmp(tok, "addr") && !strcmp(val, "random"))   cfg->addr_mode = GEN_ADDR_RANDOM;
+            else
+            {
+                VPrint("PcieGenLoad: %s***Warning --- bad setting \"%s=%s\" at node %d%s\n", fmterrstr, tok, val, node, fmtnormstr);
+                status = MEM_BAD_STATUS;
+            }
+        }
+    }
+
+    fclose(fp);
+
+    return status;
+}
+
+// -------------------------------------------------------------------------
+// GenRun()
+//
+// Generate traffic from a configuration until the TLP count or cycle
+// limit is reached, then wait for all the completions, for up to
+// cpl_timeout cycles. Requests still outstanding then are counted as
+// lost, and their tags reported, with the tags left outstanding. Each
+// burst is queued back to back and then sent, followed by the burst
+// gap. The completion events for the generated requests are consumed,
+// so they're not seen by a later WaitForCompletion(). Returns
+// MEM_BAD_STATUS if the configuration is invalid.
+//
+// -------------------------------------------------------------------------
+
+int GenRun (const pPcieModelState_t const state, const pPcieGenCfg_t cfg, const pPcieGenStats_t stats, const int node)
+{
+    PcieGenStats_t results;
+    PktData_t*     data;
+    uint32_t       total_weight, rand_num, start, wait_start;
+    uint32_t       issued = 0, num_np = 0;
+    uint64_t       offset = 0;
+    int            next_tag = 0;
+
+    if ((total_weight = GenCheck(state, cfg, node)) == 0)
+    {
+        return MEM_BAD_STATUS;
+    }
+
+    if ((data = malloc(MAX_PAYLOAD_BYTES * sizeof(PktData_t))) == NULL)
+    {
+        VPrint("PcieGenerate: %s***Error --- memory allocation failure at node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+        return MEM_BAD_STATUS;
+    }
+
+    memset(&results, 0, sizeof(PcieGenStats_t));
+
+    rand_num = cfg->seed ? cfg->seed : GEN_DEFAULT_SEED;
+
+    // Write data is generated once, so there's no per packet cost
+    for (int idx = 0; idx < MAX_PAYLOAD_BYTES; idx++)
+    {
+        data[idx] = GenRand(&rand_num) & BYTE_MASK;
+    }
+
+    start = state->TicksSinceReset;
+
+    while ((!cfg->num_tlps || issued < cfg->num_tlps) && (!cfg->max_cycles || (state->TicksSinceReset - start) < cfg->max_cycles))
+    {
+        for (int pkt = 0; pkt < cfg->burst_len && (!cfg->num_tlps || issued < cfg->num_tlps); pkt++, issued++)
+        {
+            bool     queue = (pkt < cfg->burst_len - 1) && (!cfg->num_tlps || (issued + 1) < cfg->num_tlps);
+            int      type  = GenType(cfg, total_weight, &rand_num);
+            int      len   = (type == GEN_MEM_WR || type == GEN_MEM_RD) ? GenLength(cfg, &rand_num) : 4;
+            uint64_t addr  = GenAddress(cfg, &offset, &len, &rand_num);
+            int      tag   = 0;
+
+            // Non-posted requests wait for a free tag
+            if (type != GEN_MEM_WR)
+            {
+                while ((tag = GenTag(state, cfg, &next_tag)) < 0)
+                {
+                    SendIdle(1, node);
+                    results.tag_stall_cycles++;
+                }
+
+                num_np++;
+            }
+
+            switch (type)
+            {
+            case GEN_MEM_WR:
+                MemWrite(addr, data, len, tag, cfg->rid, queue, node);
+                results.wr_bytes += len;
+                break;
+
+            case GEN_MEM_RD:
+                MemRead(addr, len, tag, cfg->rid, queue, node);
+                results.rd_bytes += len;
+                break;
+
+            case GEN_CFG_WR:
+                CfgWrite(((uint64_t)cfg->cfg_cid << 16) | (cfg->cfg_wr_base + (GenRand(&rand_num) % (cfg->cfg_wr_size / 4)) * 4),
+                         data, 4, tag, cfg->rid, queue, node);
+                break;
+
+            case GEN_CFG_RD:
+                CfgRead(((uint64_t)cfg->cfg_cid << 16) | (addr & (TLP_CFG_LO_ADDR_MASK & ~ADDR_DW_OFFSET_MASK)), 4, tag, cfg->rid, queue, node);
+                break;
+
+            case GEN_IO_WR:
+                IoWrite(addr & (ADDR_LO_BIT_MASK & ~ADDR_DW_OFFSET_MASK), data, 4, tag, cfg->rid, queue, node);
+                break;
+
+            case GEN_IO_RD:
+                IoRead(addr & (ADDR_LO_BIT_MASK & ~ADDR_DW_OFFSET_MASK), 4, tag, cfg->rid, queue, node);
+                break;
+            }
+
+            results.tlps[type]++;
+        }
+
+        if (cfg->burst_gap)
+        {
+            SendIdle(cfg->burst_gap, node);
+        }
+    }
+
+    // Wait for the outstanding completions, and consume their events
+    wait_start = state->TicksSinceReset;
+
+    while (GenPending(state, cfg) && (state->TicksSinceReset - wait_start) < cfg->cpl_timeout)
+    {
+        SendIdle(1, node);
+    }
+
+    results.lost_cpls = GenLost(state, cfg);
+
+    state->CompletionEvent -= num_np - results.lost_cpls;
+
+    results.cycles = state->TicksSinceReset - start;
+
+    free(data);
+
+    GenReport(state, &results);
+
+    if (stats != NULL)
+    {
+        *stats = results;
+    }
+
+    return MEM_GOOD_STATUS;
+}
+
+// -------------------------------------------------------------------------
+// GenReport()
+//
+// Print a traffic generator run's achieved rates
+//
+// -------------------------------------------------------------------------
+
+void GenReport (const pPcieModelState_t const state, const pPcieGenStats_t stats)
+{
+    char     buf[STRBUFSIZE];
+    int      len    = 0;
+    uint64_t total  = 0;
+    double   cycles = stats->cycles ? (double)stats->cycles : 1.0;
+
+    buf[0] = 0;
+    for (int type = 0; type < GEN_NUM_TYPES; type++)
+    {
+        if (stats->tlps[type])
+        {
+            len   += snprintf(&buf[len], STRBUFSIZE - len, " %s=%llu", gen_type_str[type], (unsigned long long)stats->tlps[type]);
+            total += stats->tlps[type];
+        }
+    }
+
+    VPrint("PCIE%d: generator TLPs=%llu%s in %u cycles\n", state->thisnode, (unsigned long long)total, buf, stats->cycles);
+    VPrint("PCIE%d: generator rate %.2f TLPs/kcycle, write %.2f bytes/cycle, read %.2f bytes/cycle, tag stalls %llu cycles, lost completions %u\n",
+           state->thisnode, total * 1000.0 / cycles, stats->wr_bytes / cycles, stats->rd_bytes / cycles,
+           (unsigned long long)stats->tag_stall_cycles, stats->lost_cpls);
+}
+
+// -------------------------------------------------------------------------
+// GenBench()
+//
+// Run the traffic generator as a benchmark, measuring the achieved
+// data and TLP rates in real time (from the selected clock's lane
+// symbol period), the memory read latency and the link utilisation
+// in each direction
+//
+// -------------------------------------------------------------------------
+
+int GenBench (const pPcieModelState_t const state, const pPcieGenCfg_t cfg, const pPcieBenchStats_t bench, const int node)
+{
+    LinkStats_t link  = state->linkstats;
+    uint64_t    total = 0;
+    double      secs, symbols;
+    uint32_t    symbol_ps;
+
+    memset(bench, 0, sizeof(PcieBenchStats_t));
+
+    LatencyClear(state);
+
+    if (GenRun(state, cfg, &bench->gen, node) != MEM_GOOD_STATUS)
+    {
+        return MEM_BAD_STATUS;
+    }
+
+    for (int type = 0; type < GEN_NUM_TYPES; type++)
+    {
+        total += bench->gen.tlps[type];
+    }
+
+    symbol_ps              = state->usrconf.EnableGen3 ? GEN3_SYMBOL_PS : state->Gen2Clk ? GEN2_SYMBOL_PS : GEN1_SYMBOL_PS;
+    secs                   = (bench->gen.cycles ? bench->gen.cycles : 1) * symbol_ps * 1e-12;
+    symbols                = (bench->gen.cycles ? bench->gen.cycles : 1) * (double)state->LinkWidth;
+
+    bench->mbytes_per_sec  = (bench->gen.wr_bytes + bench->gen.rd_bytes) / secs / 1e6;
+    bench->tlps_per_sec    = total / secs;
+    bench->tx_utilisation  = (state->linkstats.tx_pkt_symbols - link.tx_pkt_symbols) / symbols;
+    bench->rx_utilisation  = (state->linkstats.rx_pkt_symbols - link.rx_pkt_symbols) / symbols;
+
+    LatencyGet(state, LAT_MEM_RD, &bench->rd_latency);
+
+    VPrint("PCIE%d: bench x%d %s, %.1f MB/s, %.0f TLPs/s, link utilisation tx %.1f%% rx %.1f%%\n",
+           node, state->LinkWidth, state->usrconf.EnableGen3 ? "gen3" : state->Gen2Clk ? "gen2" : "gen1", bench->mbytes_per_sec, bench->tlps_per_sec,
+           bench->tx_utilisation * 100.0, bench->rx_utilisation * 100.0);
+
+    if (bench->rd_latency.count)
+    {
+        VPrint("PCIE%d: bench MemRd latency (cycles) min=%u mean=%llu p50=%u p90=%u p99=%u max=%u\n",
+               node, bench->rd_latency.min, (unsigned long long)(bench->rd_latency.total / bench->rd_latency.count),
+               bench->rd_latency.p50, bench->rd_latency.p90, bench->rd_latency.p99, bench->rd_latency.max);
+    }
+
+    return MEM_GOOD_STATUS;
+}
@@ -0,0 +1,480 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Gen3 128b/130b framing. Lanes carry 16 symbol blocks, each
+// starting with a data or OS sync header. Packets are sent in data
+// blocks with framing tokens in place of the 8b/10b K-codes: a 4 byte
+// STP token (length, frame CRC and parity, and sequence number) with
+// no END, a 2 byte SDP token, IDL tokens between packets, an EDB
+// token after a nullified TLP and an EDS token ending the data stream
+// before an OS block. Received data streams are converted back to
+// STP/SDP...END/EDB framed symbols, so the rest of the model is
+// unchanged. OS blocks (TS1/TS2, SKP, EIEOS, EIOS and FTS) are
+// constructed here and decoded into the 8b/10b OS types.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include "pcie.h"
+#include "pcie_utils.h"
+#include "codec.h"
+#include "displink.h"
+
+// -------------------------------------------------------------------------
+// DEFINES
+// -------------------------------------------------------------------------
+
+// Receive deframer states
+#define GEN3_RX_IDLE                 0
+#define GEN3_RX_SDP                  1
+#define GEN3_RX_STP                  2
+#define GEN3_RX_SEQ                  3
+#define GEN3_RX_TLP                  4
+#define GEN3_RX_TLP_END              5
+#define GEN3_RX_DLLP                 6
+#define GEN3_RX_SKIP                 7
+
+// Smallest TLP in DWs: STP token, 3 DW header and LCRC
+#define GEN3_MIN_TLP_DWS             5
+
+// DLLP bytes following an SDP token
+#define GEN3_DLLP_BYTES              6
+
+// -------------------------------------------------------------------------
+// STATICS
+// -------------------------------------------------------------------------
+
+static const PktData_t eds_token[GEN3_TOKEN_BYTES] = {GEN3_EDS0, GEN3_EDS1, GEN3_EDS2, GEN3_EDS3};
+
+// -------------------------------------------------------------------------
+// Gen3Fcrc()
+//
+// Frame CRC of an STP token's 11 bit length (x^4 + x + 1, MSB first)
+//
+// -------------------------------------------------------------------------
+
+static uint32_t Gen3Fcrc (const uint32_t dws)
+{
+    uint32_t crc = 0, fb;
+
+    for (int bit = 10; bit >= 0; bit--)
+    {
+        fb  = ((crc >> 3) ^ (dws >> bit)) & 1;
+        crc = ((crc << 1) & 0xf) ^ (fb ? 0x3 : 0);
+    }
+
+    return crc;
+}
+
+// -------------------------------------------------------------------------
+// Gen3Reset()
+//
+// Reset the Gen3 framing state and the codec's lane scramblers
+//
+// -------------------------------------------------------------------------
+
+void Gen3Reset (const pPcieModelState_t const state)
+{
+    memset(&state->gen3, 0, sizeof(Gen3State_t));
+
+    Gen3CodecReset(state->thisnode);
+}
+
+// -------------------------------------------------------------------------
+// Gen3FramePkt()
+//
+// Return a Gen3 framed copy of a packet. The STP or SDP K-code, and
+// the END, are replaced by STP or SDP tokens, with the frame CRC in
+// the upper nibble of the first sequence number byte. The framed TLP
+// or DLLP is the same length as the original. A nullified TLP is
+// followed by an EDB token.
+//
+// -------------------------------------------------------------------------
+
+PktData_t * Gen3FramePkt (const pPcieModelState_t const state, const pPkt_t const pkt)
+{
+    PktData_t *in  = pkt->data;
+    PktData_t *out = state->gen3.txbuf;
+    int       len, idx;
+
+    for (len = 0; in[len] != PKT_TERMINATION; len++);
+
+    if (in[0] == SDP)
+    {
+        out[0] = GEN3_SDP0;
+        out[1] = GEN3_SDP1;
+    }
+    else
+    {
+        uint32_t dws  = len / 4;
+        uint32_t fcrc = Gen3Fcrc(dws);
+        uint32_t fp   = __builtin_parity(dws | (fcrc << 11));
+
+        out[0] = ((dws & 0xf) << 4) | GEN3_STP;
+        out[1] = (fp << 7) | ((dws >> 4) & 0x7f);
+        out[2] = (fcrc << 4) | (in[1] & 0x0f);
+    }
+
+    for (idx = (in[0] == SDP) ? 1 : 2; idx < len-1; idx++)
+    {
+        out[idx+1] = in[idx];
+    }
+
+    if (in[len-1] == EDB)
+    {
+        for (idx = 0; idx < GEN3_TOKEN_BYTES; idx++)
+        {
+            out[len++] = GEN3_EDB;
+        }
+    }
+
+    out[len] = PKT_TERMINATION;
+
+    return out;
+}
+
+// -------------------------------------------------------------------------
+// Gen3TxEncode()
+//
+// Encode a byte for a lane at the current transmit block position,
+// adding a data or OS sync header at the start of a block. The block
+// position advances after the last lane.
+//
+// -------------------------------------------------------------------------
+
+uint32_t Gen3TxEncode (const pPcieModelState_t const state, const PktData_t data, const int lane, const bool os_block)
+{
+    pGen3State_t g3   = &state->gen3;
+    int          sync = g3->tx_sym ? 0 : os_block ? GEN3_SYNC_OS : GEN3_SYNC_DATA;
+    uint32_t     code = Gen3Encode(data, sync, state->usrconf.DisableScrambling, lane, state->thisnode);
+
+    if (lane == (state->LinkWidth-1))
+    {
+        g3->tx_sym  = (g3->tx_sym + 1) % GEN3_BLOCK_SYMS;
+        g3->tx_data = !os_block;
+    }
+
+    return code;
+}
+
+// -------------------------------------------------------------------------
+// Gen3EdsSymbol()
+//
+// Return the data stream symbol for a lane at the current transmit
+// block position when ending a data stream; the EDS token in the last
+// DW of the block, and IDL tokens before it
+//
+// -------------------------------------------------------------------------
+
+PktData_t Gen3EdsSymbol (const pPcieModelState_t const state, const int lane)
+{
+    int pos = state->gen3.tx_sym * state->LinkWidth + lane - (GEN3_BLOCK_SYMS * state->LinkWidth - GEN3_TOKEN_BYTES);
+
+    return (pos >= 0) ? eds_token[pos] : GEN3_IDL;
+}
+
+// -------------------------------------------------------------------------
+// Gen3OsSymbol()
+//
+// Return symbol seq of a lane's OS block for an 8b/10b OS type (TS1_ID,
+// TS2_ID, SKP, EIE, IDL or FTS). The scrambler state at the end of a
+// SKP OS is filled in by the codec.
+//
+// -------------------------------------------------------------------------
+
+PktData_t Gen3OsSymbol (const int type, const pTS_t const ts_data, const int seq, const int lane)
+{
+    switch (type)
+    {
+    case TS1_ID:
+    case TS2_ID:
+        switch (seq)
+        {
+        case 0:  return (type == TS1_ID) ? GEN3_TS1 : GEN3_TS2;
+        case 1:  return (ts_data->linknum == PAD) ? GEN3_PAD : ts_data->linknum;
+        case 2:  return (ts_data->lanenum == PAD) ? GEN3_PAD : lane;
+        case 3:  return ts_data->n_fts;
+        case 4:  return ts_data->datarate;
+        case 5:  return ts_data->control;
+        default: return (seq < GEN3_TS_ID_SYM) ? 0 : type;
+        }
+
+    case SKP:
+        return (seq <  GEN3_SKP_END_SYM) ? GEN3_SKP :
+               (seq == GEN3_SKP_END_SYM) ? GEN3_SKP_END : 0;
+
+    case EIE:
+        return (seq & 1) ? 0xff : GEN3_EIEOS;
+
+    case IDL:
+        return GEN3_EIOS;
+
+    default:
+        return GEN3_FTS;
+    }
+}
+
+// -------------------------------------------------------------------------
+// Gen3RxOs()
+//
+// Decode a lane's received OS block, returning its 8b/10b OS type, or
+// 0 if not a valid OS. Training sequence fields are placed in the
+// lane's rx_ts.
+//
+// -------------------------------------------------------------------------
+
+static int Gen3RxOs (const pPcieModelState_t const state, const int lane)
+{
+    PktData_t *os = state->gen3.rx_os[lane];
+    pTS_t     ts  = &state->gen3.rx_ts[lane];
+    int       type;
+
+    switch (os[0])
+    {
+    case GEN3_TS1:
+    case GEN3_TS2:
+        type = (os[0] == GEN3_TS1) ? TS1_ID : TS2_ID;
+
+        for (int seq = GEN3_TS_ID_SYM; seq < GEN3_BLOCK_SYMS; seq++)
+        {
+            if (os[seq] != type)
+            {
+                VPrint("Gen3RxSymbols: %s***Warning --- invalid training sequence on lane %d at node %d%s\n", fmterrstr, lane, state->thisnode, fmtnormstr);
+                return 0;
+            }
+        }
+
+        ts->linknum  = (os[1] == GEN3_PAD) ? PAD : os[1];
+        ts->lanenum  = (os[2] == GEN3_PAD) ? PAD : os[2];
+        ts->n_fts    = os[3];
+        ts->datarate = os[4];
+        ts->control  = os[5];
+        ts->id       = type;
+
+        return type;
+
+    case GEN3_SKP:
+        return (os[GEN3_SKP_END_SYM] == GEN3_SKP_END) ? SKP : 0;
+
+    case GEN3_EIEOS:
+        return EIE;
+
+    case GEN3_EIOS:
+        return IDL;
+
+    case GEN3_FTS:
+        return FTS;
+
+    default:
+        VPrint("Gen3RxSymbols: %s***Warning --- unrecognised OS block (%02x) on lane %d at node %d%s\n", fmterrstr, os[0], lane, state->thisnode, fmtnormstr);
+        return 0;
+    }
+}
+
+// -------------------------------------------------------------------------
+// Gen3RxPush()
+//
+// Push a framed symbol into the receive deframer FIFO
+//
+// -------------------------------------------------------------------------
+
+static inline void Gen3RxPush (const pGen3State_t g3, const PktData_t sym)
+{
+    g3->rx_fifo[g3->rx_fifo_wr++ & (GEN3_RX_FIFO_SIZE-1)] = sym;
+}
+
+// -------------------------------------------------------------------------
+// Gen3Deframe()
+//
+// Process a received data stream byte, converting tokens and packet
+// bytes into STP/SDP...END/EDB framed symbols. One symbol is returned
+// for each byte, from the FIFO, or idle (0) if empty. A TLP's END is
+// pushed on the following byte, becoming an EDB if that starts an EDB
+// token.
+//
+// -------------------------------------------------------------------------
+
+static PktData_t Gen3Deframe (const pPcieModelState_t const state, const PktData_t byte)
+{
+    pGen3State_t g3 = &state->gen3;
+    uint32_t     dws;
+
+    if (g3->rx_state == GEN3_RX_TLP_END)
+    {
+        Gen3RxPush(g3, (byte == GEN3_EDB) ? EDB : END);
+
+        g3->rx_state  = (byte == GEN3_EDB) ? GEN3_RX_SKIP : GEN3_RX_IDLE;
+        g3->rx_remain = GEN3_TOKEN_BYTES;
+    }
+
+    switch (g3->rx_state)
+    {
+    case GEN3_RX_IDLE:
+        if (byte == GEN3_SDP0)
+        {
+            g3->rx_state = GEN3_RX_SDP;
+        }
+        else if ((byte & GEN3_STP_MASK) == GEN3_STP)
+        {
+            g3->rx_tok0  = byte;
+            g3->rx_state = GEN3_RX_STP;
+        }
+        else if (byte != GEN3_IDL)
+        {
+            VPrint("Gen3RxSymbols: %s***Warning --- unexpected token byte (%02x) at node %d%s\n", fmterrstr, byte, state->thisnode, fmtnormstr);
+        }
+        break;
+
+    case GEN3_RX_SDP:
+        if (byte == GEN3_SDP1)
+        {
+            Gen3RxPush(g3, SDP);
+            g3->rx_remain = GEN3_DLLP_BYTES;
+            g3->rx_state  = GEN3_RX_DLLP;
+        }
+        else
+        {
+            VPrint("Gen3RxSymbols: %s***Warning --- bad SDP token at node %d%s\n", fmterrstr, state->thisnode, fmtnormstr);
+            g3->rx_state  = GEN3_RX_IDLE;
+        }
+        break;
+
+    case GEN3_RX_STP:
+        dws = ((byte & 0x7f) << 4) | (g3->rx_tok0 >> 4);
+
+        // An EDS token ends the data stream, with an OS block to follow
+        if (g3->rx_tok0 == GEN3_EDS0 && byte == GEN3_EDS1)
+        {
+            g3->rx_remain = GEN3_TOKEN_BYTES - 2;
+            g3->rx_state  = GEN3_RX_SKIP;
+        }
+        else if (dws < GEN3_MIN_TLP_DWS)
+        {
+            VPrint("Gen3RxSymbols: %s***Warning --- bad STP token length (%d) at node %d%s\n", fmterrstr, dws, state->thisnode, fmtnormstr);
+            g3->rx_state  = GEN3_RX_IDLE;
+        }
+        else
+        {
+            g3->rx_tok1   = byte;
+            g3->rx_state  = GEN3_RX_SEQ;
+        }
+        break;
+
+    case GEN3_RX_SEQ:
+        dws = ((g3->rx_tok1 & 0x7f) << 4) | (g3->rx_tok0 >> 4);
+
+        // Check frame CRC and parity before starting the TLP
+        if ((byte >> 4) != Gen3Fcrc(dws) || (g3->rx_tok1 >> 7) != __builtin_parity(dws | ((byte >> 4) << 11)))
+        {
+            VPrint("Gen3RxSymbols: %s***Warning --- STP token framing error at node %d%s\n", fmterrstr, state->thisnode, fmtnormstr);
+            g3->rx_state  = GEN3_RX_IDLE;
+        }
+        else
+        {
+            Gen3RxPush(g3, STP);
+            Gen3RxPush(g3, byte & 0x0f);
+            g3->rx_remain = dws * 4 - 3;
+            g3->rx_state  = GEN3_RX_TLP;
+        }
+        break;
+
+    case GEN3_RX_TLP:
+        Gen3RxPush(g3, byte);
+        if (--g3->rx_remain == 0)
+        {
+            g3->rx_state = GEN3_RX_TLP_END;
+        }
+        break;
+
+    case GEN3_RX_DLLP:
+        Gen3RxPush(g3, byte);
+        if (--g3->rx_remain == 0)
+        {
+            Gen3RxPush(g3, END);
+            g3->rx_state = GEN3_RX_IDLE;
+        }
+        break;
+
+    case GEN3_RX_SKIP:
+        if (--g3->rx_remain == 0)
+        {
+            g3->rx_state = GEN3_RX_IDLE;
+        }
+        break;
+    }
+
+    return (g3->rx_fifo_rd != g3->rx_fifo_wr) ? g3->rx_fifo[g3->rx_fifo_rd++ & (GEN3_RX_FIFO_SIZE-1)] : 0;
+}
+
+// -------------------------------------------------------------------------
+// Gen3RxSymbols()
+//
+// Process a symbol time of Gen3 decoded lane input. Each lane's block
+// alignment is tracked from the sync headers, which are stripped from
+// linkin. Data block bytes are deframed, in lane order, into rxsym for
+// packet extraction. OS block symbols are collected and, at the end
+// of a block, decoded with the OS type placed in the lane's rx_event
+// (GEN3_RX_OS_ACTIVE whilst collecting, and 0 in a data block).
+//
+// -------------------------------------------------------------------------
+
+void Gen3RxSymbols (const pPcieModelState_t const state, PktData_t* const linkin, PktData_t* const rxsym)
+{
+    pGen3State_t g3 = &state->gen3;
+    int          sync;
+
+    for (int lane = 0; lane < state->LinkWidth; lane++)
+    {
+        sync         = (linkin[lane] >> 8) & 0x3;
+        linkin[lane] = linkin[lane] & 0xff;
+        rxsym[lane]  = 0;
+
+        if (sync)
+        {
+            g3->rx_sync[lane] = sync;
+            g3->rx_sym[lane]  = 0;
+        }
+        else if (g3->rx_sync[lane] && g3->rx_sym[lane] == GEN3_BLOCK_SYMS)
+        {
+            VPrint("Gen3RxSymbols: %s***Warning --- lost block alignment on lane %d at node %d%s\n", fmterrstr, lane, state->thisnode, fmtnormstr);
+            g3->rx_sync[lane] = 0;
+        }
+
+        g3->rx_event[lane] = 0;
+
+        if (g3->rx_sync[lane] == GEN3_SYNC_OS)
+        {
+            g3->rx_os[lane][g3->rx_sym[lane]] = linkin[lane];
+            g3->rx_event[lane] = (g3->rx_sym[lane] == GEN3_BLOCK_SYMS-1) ? Gen3RxOs(state, lane) : GEN3_RX_OS_ACTIVE;
+        }
+        else if (g3->rx_sync[lane] == GEN3_SYNC_DATA)
+        {
+            rxsym[lane] = Gen3Deframe(state, linkin[lane]);
+        }
+
+        g3->rx_sym[lane] += (g3->rx_sym[lane] < GEN3_BLOCK_SYMS) ? 1 : 0;
+    }
+}
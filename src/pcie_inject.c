@@ -0,0 +1,381 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Lane error injection. When enabled (PcieInject()), symbols output
+// by SendPacket() are corrupted between encoding and the link, with
+// per lane bit errors, burst errors across a set of lanes, running
+// disparity errors, and dropped or duplicated symbols. Each error
+// type occurs at a mean interval, with the gap to the next error
+// drawn uniformly from 1 to twice the interval, so that only a
+// countdown is needed per symbol. Symbol slips pass each lane through
+// a short delay line, whose delay is shortened to drop a symbol and
+// lengthened to duplicate one.
+//
+// Targeted errors corrupt the last CRC byte of the Nth TLP, or of
+// DLLPs of a given type, before encoding, so the receiver sees a
+// bad LCRC or DLLP CRC rather than a coding error.
+//
+// The injector has its own random number state, seeded from the
+// configuration or, by default, from the node's PcieSeed() state,
+// and reseeded by PcieSeed() whilst enabled.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include "pcie.h"
+#include "pcie_utils.h"
+#include "codec.h"
+#include "displink.h"
+
+// -------------------------------------------------------------------------
+// InjectGap()
+//
+// Return the gap to the next error for a mean interval, or 0 if the
+// interval is 0 (disabled)
+//
+// -------------------------------------------------------------------------
+
+static uint64_t InjectGap (const pInjectState_t inj, const uint32_t interval)
+{
+    if (interval == 0)
+    {
+        return 0;
+    }
+
+    inj->rand_num = CalcNewRand(inj->rand_num);
+
+    return 1 + (uint64_t)inj->rand_num % (2 * (uint64_t)interval - 1);
+}
+
+// -------------------------------------------------------------------------
+// InjectReset()
+//
+// Restart all the error countdowns, and the targeted TLP count
+//
+// -------------------------------------------------------------------------
+
+static void InjectReset (const pInjectState_t inj)
+{
+    pPcieInjectCfg_t cfg = &inj->cfg;
+
+    for (int lane = 0; lane < MAX_LINK_WIDTH; lane++)
+    {
+        inj->ber_left [lane]   = InjectGap(inj, cfg->bit_error_interval[lane]);
+        inj->disp_left[lane]   = InjectGap(inj, cfg->disparity_interval);
+        inj->drop_left[lane]   = InjectGap(inj, cfg->drop_interval);
+        inj->dup_left [lane]   = InjectGap(inj, cfg->dup_interval);
+        inj->slip_delay[lane]  = INJ_SLIP_DEPTH / 2;
+        inj->slip_primed[lane] = false;
+    }
+
+    inj->burst_left   = InjectGap(inj, cfg->burst_interval);
+    inj->burst_active = 0;
+    inj->tlps         = 0;
+    inj->target       = false;
+}
+
+// -------------------------------------------------------------------------
+// InjectConfig()
+//
+// Enable lane error injection with the given configuration, replacing
+// any current configuration. Returns MEM_BAD_STATUS for an invalid
+// configuration.
+//
+// -------------------------------------------------------------------------
+
+int InjectConfig (const pPcieModelState_t const state, const pPcieInjectCfg_t cfg)
+{
+    pInjectState_t inj = state->inject;
+
+    if ((cfg->burst_interval && cfg->burst_len == 0) || cfg->dllp_type < -1 || cfg->dllp_type > 0xff)
+    {
+        VPrint("PcieInject: %s***Error --- invalid configuration at node %d%s\n", fmterrstr, state->thisnode, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    if (inj == NULL)
+    {
+        if ((inj = calloc(1, sizeof(InjectState_t))) == NULL)
+        {
+            VPrint("PcieInject: %s***Error --- memory allocation failure at node %d%s\n", fmterrstr, state->thisnode, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, state->thisnode);
+            return MEM_BAD_STATUS;
+        }
+    }
+
+    inj->cfg      = *cfg;
+    inj->rand_num = cfg->seed ? cfg->seed : state->RandNum;
+    inj->slip     = cfg->drop_interval || cfg->dup_interval;
+
+    InjectReset(inj);
+
+    state->inject = inj;
+
+    return MEM_GOOD_STATUS;
+}
+
+// -------------------------------------------------------------------------
+// InjectStop()
+//
+// Disable lane error injection. Statistics are kept.
+//
+// -------------------------------------------------------------------------
+
+void InjectStop (const pPcieModelState_t const state)
+{
+    if (state->inject != NULL)
+    {
+        CheckFree(state->inject);
+        state->inject = NULL;
+    }
+}
+
+// -------------------------------------------------------------------------
+// InjectSeed()
+//
+// Reseed the injector's random state, restarting the error countdowns
+//
+// -------------------------------------------------------------------------
+
+void InjectSeed (const pPcieModelState_t const state, const uint32_t seed)
+{
+    if (state->inject != NULL)
+    {
+        state->inject->rand_num = seed;
+        InjectReset(state->inject);
+    }
+}
+
+// -------------------------------------------------------------------------
+// InjectPktError()
+//
+// Targeted corruption of a packet symbol, before encoding. idx is the
+// symbol's index in the packet's transmit data. At the start of each
+// packet, it is checked against the TLP and DLLP targets and, if
+// targeted, the packet's last CRC byte (the last before the END symbol,
+// or the end of the data for Gen3 framing) is inverted.
+//
+// -------------------------------------------------------------------------
+
+PktData_t InjectPktError (const pPcieModelState_t const state, const pPkt_t pkt, const PktData_t* txdata, const int idx)
+{
+    pInjectState_t   inj = state->inject;
+    pPcieInjectCfg_t cfg = &inj->cfg;
+    PktData_t        sym = txdata[idx];
+    int              type, mask;
+
+    if (idx == 0)
+    {
+        if (pkt->seq != DLLP_SEQ_ID)
+        {
+            inj->target = (++inj->tlps == cfg->tlp_nth);
+        }
+        else
+        {
+            type = pkt->data[1];
+            mask = (cfg->dllp_type & 0xc0) ? 0xf0 : 0xff;   // Flow control DLLPs match any VC
+
+            inj->target = cfg->dllp_type >= 0 && (type & mask) == cfg->dllp_type &&
+                          (cfg->dllp_count == 0 || state->injstats.dllps_corrupted < cfg->dllp_count);
+        }
+    }
+
+    if (inj->target && (txdata[idx+1] == PKT_TERMINATION || (txdata[idx+1] == END && txdata[idx+2] == PKT_TERMINATION)))
+    {
+        inj->target = false;
+        sym        ^= BYTE_MASK;
+
+        if (pkt->seq != DLLP_SEQ_ID)
+        {
+            state->injstats.tlps_corrupted++;
+        }
+        else
+        {
+            state->injstats.dllps_corrupted++;
+        }
+    }
+
+    return sym;
+}
+
+// -------------------------------------------------------------------------
+// InjectLaneError()
+//
+// Apply lane errors to an encoded symbol, just before output on the
+// lane, returning the symbol to output. Bit errors are placed on any
+// bit of the 10 bit code with 8b10b encoding, or on the data byte
+// otherwise. Disparity errors replace the 10 bit code with the same
+// symbol's code for the other running disparity, and are only applied
+// with 8b10b encoding. A symbol with no alternate code (the same for
+// both disparities) moves the error on to the lane's next symbol.
+// Burst cycles are counted on lane 0.
+//
+// -------------------------------------------------------------------------
+
+uint32_t InjectLaneError (const pPcieModelState_t const state, const uint32_t code, const int lane)
+{
+    pInjectState_t   inj   = state->inject;
+    pPcieInjectCfg_t cfg   = &inj->cfg;
+    bool             is10b = !state->usrconf.EnableGen3 && !state->usrconf.Disable8b10b;
+    uint32_t         nbits = is10b ? 10 : 8;
+    uint32_t         out   = code;
+    uint32_t         bit;
+
+    state->injstats.symbols++;
+
+    // Symbol slips
+    if (inj->slip)
+    {
+        if (!inj->slip_primed[lane])
+        {
+            for (bit = 0; bit < INJ_SLIP_DEPTH; bit++)
+            {
+                inj->slip_hist[lane][bit] = code;
+            }
+            inj->slip_primed[lane] = true;
+        }
+
+        if (inj->drop_left[lane] && --inj->drop_left[lane] == 0)
+        {
+            inj->drop_left[lane] = InjectGap(inj, cfg->drop_interval);
+
+            if (inj->slip_delay[lane] > 0)
+            {
+                inj->slip_delay[lane]--;
+                state->injstats.symbols_dropped++;
+            }
+        }
+
+        if (inj->dup_left[lane] && --inj->dup_left[lane] == 0)
+        {
+            inj->dup_left[lane] = InjectGap(inj, cfg->dup_interval);
+
+            if (inj->slip_delay[lane] < INJ_SLIP_DEPTH - 1)
+            {
+                inj->slip_delay[lane]++;
+                state->injstats.symbols_duplicated++;
+            }
+        }
+
+        inj->slip_hist[lane][inj->slip_wr[lane] % INJ_SLIP_DEPTH] = code;
+        out = inj->slip_hist[lane][(inj->slip_wr[lane] - inj->slip_delay[lane]) % INJ_SLIP_DEPTH];
+        inj->slip_wr[lane]++;
+    }
+
+    // Bit errors, at the bit positions where the countdown expires
+    if (inj->ber_left[lane])
+    {
+        bit = 0;
+        while (inj->ber_left[lane] <= nbits - bit)
+        {
+            bit += inj->ber_left[lane];
+            out ^= 1 << (bit - 1);
+            inj->ber_left[lane] = InjectGap(inj, cfg->bit_error_interval[lane]);
+            state->injstats.bit_errors++;
+        }
+        inj->ber_left[lane] -= nbits - bit;
+    }
+
+    // Disparity errors
+    if (is10b && inj->disp_left[lane] && --inj->disp_left[lane] == 0)
+    {
+        uint32_t alt = EncodeAltDisparity(out);
+
+        if (alt == out)
+        {
+            inj->disp_left[lane] = 1;
+        }
+        else
+        {
+            inj->disp_left[lane] = InjectGap(inj, cfg->disparity_interval);
+            out = alt;
+            state->injstats.disparity_errors++;
+        }
+    }
+
+    // Burst errors, on the configured lanes, with a random non-zero error
+    // pattern for each symbol
+    if (lane == 0 && inj->burst_left && --inj->burst_left == 0)
+    {
+        inj->burst_left   = InjectGap(inj, cfg->burst_interval);
+        inj->burst_active = cfg->burst_len;
+        state->injstats.bursts++;
+    }
+
+    if (inj->burst_active && (cfg->burst_lanes & (1 << lane)))
+    {
+        inj->rand_num = CalcNewRand(inj->rand_num);
+        out ^= (inj->rand_num % ((1 << nbits) - 1)) + 1;
+        state->injstats.burst_symbols++;
+    }
+
+    if (inj->burst_active && lane == state->LinkWidth - 1)
+    {
+        inj->burst_active--;
+    }
+
+    return out;
+}
+
+// -------------------------------------------------------------------------
+// InjectDefaults()
+//
+// Fill in an injector configuration with no errors, for modifying
+// before PcieInject()
+//
+// -------------------------------------------------------------------------
+
+void InjectDefaults (const pPcieInjectCfg_t cfg)
+{
+    memset(cfg, 0, sizeof(PcieInjectCfg_t));
+
+    cfg->burst_len   = INJ_DEFAULT_BURST_LEN;
+    cfg->burst_lanes = INJ_ALL_LANES;
+    cfg->dllp_type   = INJ_DLLP_NONE;
+}
+
+// -------------------------------------------------------------------------
+// InjectReport()
+//
+// Print the injected error counts, if any symbols have passed through
+// the injector
+//
+// -------------------------------------------------------------------------
+
+void InjectReport (const pPcieModelState_t const state)
+{
+    pPcieInjectStats_t stats = &state->injstats;
+
+    if (stats->symbols)
+    {
+        VPrint("PCIE%d: Injected symbols=%llu bit errors=%llu bursts=%llu (%llu symbols) disparity=%llu dropped=%llu duplicated=%llu TLPs=%llu DLLPs=%llu\n",
+               state->thisnode, (unsigned long long)stats->symbols, (unsigned long long)stats->bit_errors,
+               (unsigned long long)stats->bursts, (unsigned long long)stats->burst_symbols,
+               (unsigned long long)stats->disparity_errors, (unsigned long long)stats->symbols_dropped,
+               (unsigned long long)stats->symbols_duplicated, (unsigned long long)stats->tlps_corrupted,
+               (unsigned long long)stats->dllps_corrupted);
+    }
+}
@@ -0,0 +1,419 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Data movement kernels used for moving payload bytes between
+// PktData_t buffers and the memory/config space models. SSE2
+// and AVX2 variants are provided for x86 hosts, with a scalar
+// fallback. The variant used is selected once at startup, from
+// the host CPU's capabilities. Defining PCIE_NO_SIMD at compile
+// time forces the scalar versions.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "pcie_kernels.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(PCIE_NO_SIMD)
+#define PCIE_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+// -------------------------------------------------------------------------
+// DEFINES
+// -------------------------------------------------------------------------
+
+// Byte enable for element _idx of a _len byte block, with the same semantics
+// as the original per-byte loops (first DW uses fbe, last DW uses lbe)
+#define BYTE_ENABLED(_idx, _fbe, _lbe, _len) ((((_idx) < 4) && ((1 << (_idx)) & (_fbe))) || \
+                                              (((_idx) >= ((_len)-4)) && ((1 << (4-((_len)-(_idx)))) & (_lbe))))
+
+// -------------------------------------------------------------------------
+// TYPEDEFS
+// -------------------------------------------------------------------------
+
+typedef struct {
+    void (*narrow)    (uint8_t*   const dst, const PktData_t* const src, const int len);
+    void (*widen)     (PktData_t* const dst, const uint8_t*   const src, const int len);
+    void (*copymask8) (PktData_t* const dst, const PktData_t* const src, const int len);
+    void (*merge)     (uint8_t*   const dst, const PktData_t* const src, const uint8_t* const rdonly, const int len);
+    int  type;
+} KernelTbl_t;
+
+// -------------------------------------------------------------------------
+// Scalar kernels
+// -------------------------------------------------------------------------
+
+static void NarrowScalar (uint8_t* const dst, const PktData_t* const src, const int len)
+{
+    for (int idx = 0; idx < len; idx++)
+    {
+        dst[idx] = (uint8_t)src[idx];
+    }
+}
+
+static void WidenScalar (PktData_t* const dst, const uint8_t* const src, const int len)
+{
+    for (int idx = 0; idx < len; idx++)
+    {
+        dst[idx] = src[idx];
+    }
+}
+
+static void CopyMask8Scalar (PktData_t* const dst, const PktData_t* const src, const int len)
+{
+    for (int idx = 0; idx < len; idx++)
+    {
+        dst[idx] = src[idx] & 0xff;
+    }
+}
+
+static void MergeScalar (uint8_t* const dst, const PktData_t* const src, const uint8_t* const rdonly, const int len)
+{
+    for (int idx = 0; idx < len; idx++)
+    {
+        dst[idx] = (dst[idx] & rdonly[idx]) | ((uint8_t)src[idx] & ~rdonly[idx]);
+    }
+}
+
+#ifdef PCIE_KERNEL_X86
+
+// -------------------------------------------------------------------------
+// SSE2 kernels (16 bytes per iteration)
+// -------------------------------------------------------------------------
+
+__attribute__((target("sse2")))
+static void NarrowSse2 (uint8_t* const dst, const PktData_t* const src, const int len)
+{
+    const __m128i lo = _mm_set1_epi16(0x00ff);
+    int idx = 0;
+
+    for (; idx + 16 <= len; idx += 16)
+    {
+        __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)&src[idx]),   lo);
+        __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)&src[idx+8]), lo);
+        _mm_storeu_si128((__m128i*)&dst[idx], _mm_packus_epi16(a, b));
+    }
+
+    NarrowScalar(&dst[idx], &src[idx], len - idx);
+}
+
+__attribute__((target("sse2")))
+static void WidenSse2 (PktData_t* const dst, const uint8_t* const src, const int len)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int idx = 0;
+
+    for (; idx + 16 <= len; idx += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)&src[idx]);
+        _mm_storeu_si128((__m128i*)&dst[idx],   _mm_unpacklo_epi8(a, zero));
+        _mm_storeu_si128((__m128i*)&dst[idx+8], _mm_unpackhi_epi8(a, zero));
+    }
+
+    WidenScalar(&dst[idx], &src[idx], len - idx);
+}
+
+__attribute__((target("sse2")))
+static void CopyMask8Sse2 (PktData_t* const dst, const PktData_t* const src, const int len)
+{
+    const __m128i lo = _mm_set1_epi16(0x00ff);
+    int idx = 0;
+
+    for (; idx + 8 <= len; idx += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)&src[idx]);
+        _mm_storeu_si128((__m128i*)&dst[idx], _mm_and_si128(a, lo));
+    }
+
+    CopyMask8Scalar(&dst[idx], &src[idx], len - idx);
+}
+
+__attribute__((target("sse2")))
+static void MergeSse2 (uint8_t* const dst, const PktData_t* const src, const uint8_t* const rdonly, const int len)
+{
+    const __m128i lo = _mm_set1_epi16(0x00ff);
+    int idx = 0;
+
+    for (; idx + 16 <= len; idx += 16)
+    {
+        __m128i a  = _mm_and_si128(_mm_loadu_si128((const __m128i*)&src[idx]),   lo);
+        __m128i b  = _mm_and_si128(_mm_loadu_si128((const __m128i*)&src[idx+8]), lo);
+        __m128i s  = _mm_packus_epi16(a, b);
+        __m128i d  = _mm_loadu_si128((const __m128i*)&dst[idx]);
+        __m128i ro = _mm_loadu_si128((const __m128i*)&rdonly[idx]);
+        _mm_storeu_si128((__m128i*)&dst[idx], _mm_or_si128(_mm_and_si128(ro, d), _mm_andnot_si128(ro, s)));
+    }
+
+    MergeScalar(&dst[idx], &src[idx], &rdonly[idx], len - idx);
+}
+
+// -------------------------------------------------------------------------
+// AVX2 kernels (32 bytes per iteration)
+// -------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+static void NarrowAvx2 (uint8_t* const dst, const PktData_t* const src, const int len)
+{
+    const __m256i lo = _mm256_set1_epi16(0x00ff);
+    int idx = 0;
+
+    for (; idx + 32 <= len; idx += 32)
+    {
+        __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&src[idx]),    lo);
+        __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&src[idx+16]), lo);
+
+        // packus operates per 128 bit lane, so restore element order afterwards
+        _mm256_storeu_si256((__m256i*)&dst[idx], _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8));
+    }
+
+    NarrowSse2(&dst[idx], &src[idx], len - idx);
+}
+
+__attribute__((target("avx2")))
+static void WidenAvx2 (PktData_t* const dst, const uint8_t* const src, const int len)
+{
+    int idx = 0;
+
+    for (; idx + 16 <= len; idx += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)&src[idx]);
+        _mm256_storeu_si256((__m256i*)&dst[idx], _mm256_cvtepu8_epi16(a));
+    }
+
+    WidenScalar(&dst[idx], &src[idx], len - idx);
+}
+
+__attribute__((target("avx2")))
+static void CopyMask8Avx2 (PktData_t* const dst, const PktData_t* const src, const int len)
+{
+    const __m256i lo = _mm256_set1_epi16(0x00ff);
+    int idx = 0;
+
+    for (; idx + 16 <= len; idx += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)&src[idx]);
+        _mm256_storeu_si256((__m256i*)&dst[idx], _mm256_and_si256(a, lo));
+    }
+
+    CopyMask8Sse2(&dst[idx], &src[idx], len - idx);
+}
+
+__attribute__((target("avx2")))
+static void MergeAvx2 (uint8_t* const dst, const PktData_t* const src, const uint8_t* const rdonly, const int len)
+{
+    const __m256i lo = _mm256_set1_epi16(0x00ff);
+    int idx = 0;
+
+    for (; idx + 32 <= len; idx += 32)
+    {
+        __m256i a  = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&src[idx]),    lo);
+        __m256i b  = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&src[idx+16]), lo);
+        __m256i s  = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+        __m256i d  = _mm256_loadu_si256((const __m256i*)&dst[idx]);
+        __m256i ro = _mm256_loadu_si256((const __m256i*)&rdonly[idx]);
+        _mm256_storeu_si256((__m256i*)&dst[idx], _mm256_or_si256(_mm256_and_si256(ro, d), _mm256_andnot_si256(ro, s)));
+    }
+
+    MergeSse2(&dst[idx], &src[idx], &rdonly[idx], len - idx);
+}
+
+#endif
+
+// -------------------------------------------------------------------------
+// STATICS
+// -------------------------------------------------------------------------
+
+// Defaults to the scalar kernels, so that the table is always usable, even
+// if called before PcieKernelInit() has run.
+static KernelTbl_t kernels = {NarrowScalar, WidenScalar, CopyMask8Scalar, MergeScalar, PCIE_KERNEL_SCALAR};
+
+// -------------------------------------------------------------------------
+// PcieKernelInit()
+//
+// Selects the kernel variant for the host CPU. Run as a constructor so that
+// the table is set before any simulation (and VProc user) threads start.
+//
+// -------------------------------------------------------------------------
+
+__attribute__((constructor))
+static void PcieKernelInit (void)
+{
+#ifdef PCIE_KERNEL_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        kernels.narrow    = NarrowAvx2;
+        kernels.widen     = WidenAvx2;
+        kernels.copymask8 = CopyMask8Avx2;
+        kernels.merge     = MergeAvx2;
+        kernels.type      = PCIE_KERNEL_AVX2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        kernels.narrow    = NarrowSse2;
+        kernels.widen     = WidenSse2;
+        kernels.copymask8 = CopyMask8Sse2;
+        kernels.merge     = MergeSse2;
+        kernels.type      = PCIE_KERNEL_SSE2;
+    }
+#endif
+}
+
+// -------------------------------------------------------------------------
+// PcieKernelNarrow()
+//
+// Copy len PktData_t elements to a byte buffer, keeping the bottom 8 bits.
+//
+// -------------------------------------------------------------------------
+
+void PcieKernelNarrow (uint8_t* const dst, const PktData_t* const src, const int len)
+{
+    if (len > 0)
+    {
+        kernels.narrow(dst, src, len);
+    }
+}
+
+// -------------------------------------------------------------------------
+// PcieKernelWiden()
+//
+// Copy len bytes to a PktData_t buffer, zero extending each byte.
+//
+// -------------------------------------------------------------------------
+
+void PcieKernelWiden (PktData_t* const dst, const uint8_t* const src, const int len)
+{
+    if (len > 0)
+    {
+        kernels.widen(dst, src, len);
+    }
+}
+
+// -------------------------------------------------------------------------
+// PcieKernelCopy()
+//
+// Bulk copy of len PktData_t elements.
+//
+// -------------------------------------------------------------------------
+
+void PcieKernelCopy (PktData_t* const dst, const PktData_t* const src, const int len)
+{
+    if (len > 0)
+    {
+        memcpy(dst, src, len * sizeof(PktData_t));
+    }
+}
+
+// -------------------------------------------------------------------------
+// PcieKernelCopyMask8()
+//
+// Copy of len PktData_t elements, masking each to its bottom 8 bits.
+//
+// -------------------------------------------------------------------------
+
+void PcieKernelCopyMask8 (PktData_t* const dst, const PktData_t* const src, const int len)
+{
+    if (len > 0)
+    {
+        kernels.copymask8(dst, src, len);
+    }
+}
+
+// -------------------------------------------------------------------------
+// PcieKernelMaskedStore()
+//
+// Store len PktData_t elements as bytes, honouring the first and last DW
+// byte enables. Only the (at most eight) edge bytes are tested individually,
+// with the body of the block moved with the narrowing kernel.
+//
+// -------------------------------------------------------------------------
+
+void PcieKernelMaskedStore (uint8_t* const dst, const PktData_t* const src, const int fbe, const int lbe, const int len)
+{
+    PcieKernelMaskedMerge(dst, src, NULL, fbe, lbe, len);
+}
+
+// -------------------------------------------------------------------------
+// PcieKernelMaskedMerge()
+//
+// As PcieKernelMaskedStore(), but any bits set in the rdonly array (if not
+// NULL) retain their current value in dst.
+//
+// -------------------------------------------------------------------------
+
+void PcieKernelMaskedMerge (uint8_t* const dst, const PktData_t* const src, const uint8_t* const rdonly,
+                            const int fbe, const int lbe, const int len)
+{
+    int idx;
+    int head_end   = (len < 4) ? len : 4;
+    int tail_start = (len - 4 > head_end) ? len - 4 : head_end;
+
+    // First DW (and, for short blocks, any overlap with the last DW)
+    for (idx = 0; idx < head_end; idx++)
+    {
+        if (BYTE_ENABLED(idx, fbe, lbe, len))
+        {
+            dst[idx] = rdonly ? (dst[idx] & rdonly[idx]) | ((uint8_t)src[idx] & ~rdonly[idx]) : (uint8_t)src[idx];
+        }
+    }
+
+    // Body of the block is always enabled
+    if (tail_start > head_end)
+    {
+        if (rdonly)
+        {
+            kernels.merge(&dst[head_end], &src[head_end], &rdonly[head_end], tail_start - head_end);
+        }
+        else
+        {
+            kernels.narrow(&dst[head_end], &src[head_end], tail_start - head_end);
+        }
+    }
+
+    // Last DW
+    for (idx = tail_start; idx < len; idx++)
+    {
+        if (BYTE_ENABLED(idx, fbe, lbe, len))
+        {
+            dst[idx] = rdonly ? (dst[idx] & rdonly[idx]) | ((uint8_t)src[idx] & ~rdonly[idx]) : (uint8_t)src[idx];
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// PcieKernelType()
+//
+// Returns the kernel variant selected at startup
+//
+// -------------------------------------------------------------------------
+
+int PcieKernelType (void)
+{
+    return kernels.type;
+}
@@ -0,0 +1,69 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Internal data movement kernels header
+//
+//=============================================================
+
+#ifndef _PCIE_KERNELS_H_
+#define _PCIE_KERNELS_H_
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdint.h>
+
+#include "mem.h"
+
+// -------------------------------------------------------------------------
+// DEFINES
+// -------------------------------------------------------------------------
+
+// Kernel implementation selected at startup (see PcieKernelType())
+#define PCIE_KERNEL_SCALAR           0
+#define PCIE_KERNEL_SSE2             1
+#define PCIE_KERNEL_AVX2             2
+
+// -------------------------------------------------------------------------
+// PROTOTYPES
+// -------------------------------------------------------------------------
+
+// PktData_t (byte per 16 bit element) to/from byte buffers
+extern void PcieKernelNarrow      (uint8_t*   const dst, const PktData_t* const src, const int len);
+extern void PcieKernelWiden       (PktData_t* const dst, const uint8_t*   const src, const int len);
+
+// PktData_t to PktData_t copies, plain and with each element masked to a byte
+extern void PcieKernelCopy        (PktData_t* const dst, const PktData_t* const src, const int len);
+extern void PcieKernelCopyMask8   (PktData_t* const dst, const PktData_t* const src, const int len);
+
+// Byte enabled stores of PktData_t data into a byte buffer, with first and last
+// DW byte enables applied. PcieKernelMaskedMerge() additionally protects bits
+// set in rdonly (if not NULL) from being updated.
+extern void PcieKernelMaskedStore (uint8_t*   const dst, const PktData_t* const src, const int fbe, const int lbe, const int len);
+extern void PcieKernelMaskedMerge (uint8_t*   const dst, const PktData_t* const src, const uint8_t* const rdonly,
+                                   const int fbe, const int lbe, const int len);
+
+extern int  PcieKernelType        (void);
+
+#endif
@@ -0,0 +1,471 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Model performance statistics. Non-posted requests are time
+// stamped by tag when issued, and the time stamp closed on the
+// final completion for that tag, with the latency added to a log2
+// bucketed histogram for the request type.
+//
+// Waits for transmit credits are recorded as stall episodes per FC
+// type, with a summary kept and, optionally, each episode written to
+// a CSV timeline file along with the credit state and queue depth at
+// the start of the stall. User TLPs and scheduled completions can
+// stall at the same time, so each has its own current episode.
+//
+// ACK/NAK DLLPs sent are counted, along with the ACKs saved by
+// coalescing under the AckNak latency timer.
+//
+// Replays, from NAKs or replay timer timeouts, are counted along with
+// the TLPs retransmitted and REPLAY_NUM rollovers.
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include "pcie.h"
+#include "pcie_utils.h"
+#include "displink.h"
+
+// -------------------------------------------------------------------------
+// STATICS
+// -------------------------------------------------------------------------
+
+static const char* lat_type_str[LAT_NUM_TYPES]  = {"MemRd", "IoRd", "IoWr", "CfgRd", "CfgWr"};
+static const char* fc_type_str[FC_NUMTYPES]     = {"P", "NP", "CPL"};
+static const char* ack_policy_str[]             = {"custom", "immediate", "spec"};
+static const char* fc_policy_str[]              = {"default", "aggressive", "threshold", "timer", "callback"};
+
+// -------------------------------------------------------------------------
+// LatBucket()
+//
+// Return the histogram bucket for a latency. Bucket 0 is for zero
+// latency, and bucket n for latencies from 2^(n-1) to 2^n - 1.
+//
+// -------------------------------------------------------------------------
+
+static inline int LatBucket (const uint32_t latency)
+{
+    int bucket = latency ? 32 - __builtin_clz(latency) : 0;
+
+    return (bucket < LAT_NUM_BUCKETS) ? bucket : LAT_NUM_BUCKETS - 1;
+}
+
+// -------------------------------------------------------------------------
+// LatPercentile()
+//
+// Estimate a percentile from the histogram, interpolating within the
+// bucket it falls in
+//
+// -------------------------------------------------------------------------
+
+static uint32_t LatPercentile (const pLatencyStats_t stats, const int percent)
+{
+    uint64_t target = (stats->count * percent + 99) / 100;
+    uint64_t cum    = 0;
+
+    for (int bucket = 0; bucket < LAT_NUM_BUCKETS; bucket++)
+    {
+        if (stats->buckets[bucket] && (cum + stats->buckets[bucket]) >= target)
+        {
+            uint64_t lo  = bucket ? 1ULL << (bucket-1) : 0;
+            uint64_t hi  = bucket ? (1ULL << bucket) - 1 : 0;
+            uint64_t est = lo + ((hi - lo) * (target - cum)) / stats->buckets[bucket];
+
+            return (est < stats->min) ? stats->min : (est > stats->max) ? stats->max : est;
+        }
+
+        cum += stats->buckets[bucket];
+    }
+
+    return stats->max;
+}
+
+// -------------------------------------------------------------------------
+// LatencyComplete()
+//
+// Add the latency of an outstanding request, from its issue time stamp,
+// to its type's statistics on its final completion
+//
+// -------------------------------------------------------------------------
+
+void LatencyComplete (const pPcieModelState_t const state, const OutstandingReq_t* const req)
+{
+    pLatencyStats_t stats   = &state->latency.stats[req->type];
+    uint32_t        latency = state->TicksSinceReset - req->issued;
+
+    stats->min    = (stats->count == 0 || latency < stats->min) ? latency : stats->min;
+    stats->max    = (latency > stats->max) ? latency : stats->max;
+    stats->total += latency;
+    stats->count++;
+    stats->buckets[LatBucket(latency)]++;
+}
+
+// -------------------------------------------------------------------------
+// LatencyGet()
+//
+// Return a copy of a request type's statistics, with the percentiles
+// filled in
+//
+// -------------------------------------------------------------------------
+
+void LatencyGet (const pPcieModelState_t const state, const int type, const pLatencyStats_t stats)
+{
+    *stats = state->latency.stats[type];
+
+    if (stats->count)
+    {
+        stats->p50 = LatPercentile(stats, 50);
+        stats->p90 = LatPercentile(stats, 90);
+        stats->p99 = LatPercentile(stats, 99);
+    }
+}
+
+// -------------------------------------------------------------------------
+// LatencyClear()
+//
+// Clear the statistics, keeping outstanding request time stamps
+//
+// -------------------------------------------------------------------------
+
+void LatencyClear (const pPcieModelState_t const state)
+{
+    memset(state->latency.stats, 0, sizeof(state->latency.stats));
+}
+
+// -------------------------------------------------------------------------
+// LatencyReport()
+//
+// Print the statistics, and non-empty histogram buckets, for each
+// request type with completed requests
+//
+// -------------------------------------------------------------------------
+
+void LatencyReport (const pPcieModelState_t const state)
+{
+    LatencyStats_t stats;
+    char           buf[STRBUFSIZE];
+    int            len;
+
+    for (int type = 0; type < LAT_NUM_TYPES; type++)
+    {
+        LatencyGet(state, type, &stats);
+
+        if (stats.count == 0)
+        {
+            continue;
+        }
+
+        VPrint("PCIE%d: %-5s latency (cycles) count=%llu min=%u mean=%llu p50=%u p90=%u p99=%u max=%u\n",
+               state->thisnode, lat_type_str[type], (unsigned long long)stats.count, stats.min,
+               (unsigned long long)(stats.total / stats.count), stats.p50, stats.p90, stats.p99, stats.max);
+
+        len    = 0;
+        buf[0] = 0;
+        for (int bucket = 0; bucket < LAT_NUM_BUCKETS && len < STRBUFSIZE; bucket++)
+        {
+            if (stats.buckets[bucket])
+            {
+                len += snprintf(&buf[len], STRBUFSIZE - len, " <%llu:%llu", 1ULL << bucket, (unsigned long long)stats.buckets[bucket]);
+            }
+        }
+
+        VPrint("PCIE%d: %-5s histogram%s\n", state->thisnode, lat_type_str[type], buf);
+    }
+}
+
+// -------------------------------------------------------------------------
+// StallBegin()
+//
+// Start a credit stall episode for a source (STALL_SRC_xxx), capturing
+// which credits are short, the advertised limits and consumed counts,
+// and the queue depth
+//
+// -------------------------------------------------------------------------
+
+void StallBegin (const pPcieModelState_t const state, const int src, const int fc_type, const int payload_len)
+{
+    pStallEpisode_t stall = &state->stall.episode[src];
+    pFlowControl_t  flw   = &state->flwcntl;
+    pPkt_t          pkt;
+
+    stall->active        = true;
+    stall->fc_type       = fc_type;
+    stall->start         = state->TicksSinceReset;
+    stall->hdr_limit     = flw->FlowCntlHdrCredits[0][fc_type];
+    stall->hdr_consumed  = flw->TxHdrCredits[0][fc_type];
+    stall->data_limit    = flw->FlowCntlDataCredits[0][fc_type];
+    stall->data_consumed = flw->TxDataCredits[0][fc_type];
+
+    // Short credits, as checked by CheckCredits()
+    stall->hdr_short     = !(((stall->hdr_limit - stall->hdr_consumed) > 0) || !stall->hdr_limit);
+    stall->data_short    = !(((stall->data_limit - stall->data_consumed) >= (uint32_t)(payload_len/4 + ((payload_len%4)?1:0))) || !stall->data_limit);
+
+    // Packets queued, whether sent and awaiting acknowledge, or not yet sent
+    stall->queue_depth   = 0;
+    for (pkt = state->head_p; pkt != NULL; pkt = pkt->NextPkt)
+    {
+        stall->queue_depth++;
+    }
+}
+
+// -------------------------------------------------------------------------
+// StallEnd()
+//
+// End a source's current credit stall episode, updating the FC type's
+// statistics and writing to the timeline, if enabled
+//
+// -------------------------------------------------------------------------
+
+void StallEnd (const pPcieModelState_t const state, const int src)
+{
+    pStallEpisode_t     stall  = &state->stall.episode[src];
+    pCreditStallStats_t stats  = &state->stall.stats[stall->fc_type];
+    uint32_t            cycles = state->TicksSinceReset - stall->start;
+
+    stall->active  = false;
+
+    stats->episodes++;
+    stats->total_cycles += cycles;
+    stats->max_cycles    = (cycles > stats->max_cycles) ? cycles : stats->max_cycles;
+    stats->hdr_short    += stall->hdr_short  ? 1 : 0;
+    stats->data_short   += stall->data_short ? 1 : 0;
+
+    if (state->stall.timeline != NULL)
+    {
+        fprintf(state->stall.timeline, "%u,%u,%s,%s%s,%u,%u,%u,%u,%d\n",
+                stall->start, cycles, fc_type_str[stall->fc_type],
+                stall->hdr_short ? "H" : "", stall->data_short ? "D" : "",
+                stall->hdr_limit, stall->hdr_consumed, stall->data_limit, stall->data_consumed, stall->queue_depth);
+    }
+}
+
+// -------------------------------------------------------------------------
+// StallTimeline()
+//
+// Enable or disable writing credit stall episodes to the node's
+// timeline file
+//
+// -------------------------------------------------------------------------
+
+void StallTimeline (const pPcieModelState_t const state, const bool enable)
+{
+    pStallState_t stall = &state->stall;
+    char          fname[STRBUFSIZE];
+
+    if (stall->timeline != NULL)
+    {
+        fclose(stall->timeline);
+        stall->timeline = NULL;
+    }
+
+    if (enable)
+    {
+        snprintf(fname, STRBUFSIZE, STALL_TIMELINE_NAME, state->thisnode);
+
+        if ((stall->timeline = fopen(fname, "w")) == NULL)
+        {
+            VPrint("StallTimeline: %s***Warning --- could not open %s at node %d%s\n", fmterrstr, fname, state->thisnode, fmtnormstr);
+            return;
+        }
+
+        // Line buffered, so episodes aren't lost if the simulation is stopped
+        setvbuf(stall->timeline, NULL, _IOLBF, 0);
+
+        fprintf(stall->timeline, "start,cycles,type,short,hdr_limit,hdr_consumed,data_limit,data_consumed,queue_depth\n");
+    }
+}
+
+// -------------------------------------------------------------------------
+// StallGet()
+//
+// Return a copy of an FC type's credit stall statistics
+//
+// -------------------------------------------------------------------------
+
+void StallGet (const pPcieModelState_t const state, const int fc_type, const pCreditStallStats_t stats)
+{
+    *stats = state->stall.stats[fc_type];
+}
+
+// -------------------------------------------------------------------------
+// StallClear()
+//
+// Clear the credit stall statistics
+//
+// -------------------------------------------------------------------------
+
+void StallClear (const pPcieModelState_t const state)
+{
+    memset(state->stall.stats, 0, sizeof(state->stall.stats));
+}
+
+// -------------------------------------------------------------------------
+// StallReport()
+//
+// Print a summary of the credit stalls for each FC type that stalled
+//
+// -------------------------------------------------------------------------
+
+void StallReport (const pPcieModelState_t const state)
+{
+    for (int fc_type = 0; fc_type < FC_NUMTYPES; fc_type++)
+    {
+        pCreditStallStats_t stats = &state->stall.stats[fc_type];
+
+        if (stats->episodes)
+        {
+            VPrint("PCIE%d: %-3s credit stalls=%llu cycles=%llu mean=%llu max=%u hdr short=%llu data short=%llu\n",
+                   state->thisnode, fc_type_str[fc_type], (unsigned long long)stats->episodes,
+                   (unsigned long long)stats->total_cycles, (unsigned long long)(stats->total_cycles / stats->episodes),
+                   stats->max_cycles, (unsigned long long)stats->hdr_short, (unsigned long long)stats->data_short);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// AckReport()
+//
+// Print the ACK/NAK DLLP counts, and the ACKs coalesced by the AckNak
+// latency timer with the lane symbols this saved
+//
+// -------------------------------------------------------------------------
+
+void AckReport (const pPcieModelState_t const state)
+{
+    pAckStats_t stats = &state->ackstats;
+    uint64_t    sent  = stats->acks_sent * ACK_DLLP_SYMBOLS;
+    uint64_t    tx    = state->linkstats.tx_pkt_symbols;
+
+    if (stats->ack_requests)
+    {
+        VPrint("PCIE%d: ACK policy=%s latency=%u TLPs=%llu acks=%llu naks=%llu coalesced=%llu symbols saved=%llu ack symbols=%llu (%.1f%% of tx)\n",
+               state->thisnode, ack_policy_str[state->usrconf.AckPolicy],
+               (state->usrconf.AckPolicy == ACK_POLICY_SPEC) ? AckNakLatency(state) :
+               (state->usrconf.AckPolicy == ACK_POLICY_IMMEDIATE) ? 0 : (uint32_t)state->usrconf.AckRate + 1,
+               (unsigned long long)stats->ack_requests, (unsigned long long)stats->acks_sent, (unsigned long long)stats->naks_sent,
+               (unsigned long long)stats->acks_coalesced, (unsigned long long)stats->symbols_saved,
+               (unsigned long long)sent, tx ? (100.0 * sent) / tx : 0.0);
+    }
+}
+
+// -------------------------------------------------------------------------
+// FcUpdateReport()
+//
+// Print the UpdateFC DLLPs sent for each FC type, with the mean credits
+// returned per update and the lane symbols the updates used
+//
+// -------------------------------------------------------------------------
+
+void FcUpdateReport (const pPcieModelState_t const state)
+{
+    uint64_t tx = state->linkstats.tx_pkt_symbols;
+
+    for (int fc_type = 0; fc_type < FC_NUMTYPES; fc_type++)
+    {
+        pFcUpdateStats_t stats = &state->fcstats[fc_type];
+
+        if (stats->updates_sent)
+        {
+            VPrint("PCIE%d: %-3s UpdateFC policy=%s updates=%llu timer=%llu hdr returned=%llu data returned=%llu (%.1f/%.1f per update) symbols=%llu (%.1f%% of tx)\n",
+                   state->thisnode, fc_type_str[fc_type], fc_policy_str[state->usrconf.FcPolicy],
+                   (unsigned long long)stats->updates_sent, (unsigned long long)stats->timer_updates,
+                   (unsigned long long)stats->hdr_credits_returned, (unsigned long long)stats->data_credits_returned,
+                   (double)stats->hdr_credits_returned / stats->updates_sent, (double)stats->data_credits_returned / stats->updates_sent,
+                   (unsigned long long)(stats->updates_sent * ACK_DLLP_SYMBOLS),
+                   tx ? (100.0 * stats->updates_sent * ACK_DLLP_SYMBOLS) / tx : 0.0);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// TxQueueReport()
+//
+// Print the TLPs queued on each FC type's transmit queue, with the
+// number sent ahead of older TLPs and the maximum queue depth
+//
+// -------------------------------------------------------------------------
+
+void TxQueueReport (const pPcieModelState_t const state)
+{
+    if (state->usrconf.TxQueueDepth == 0)
+    {
+        return;
+    }
+
+    for (int fc_type = 0; fc_type < FC_NUMTYPES; fc_type++)
+    {
+        pTxQueueStats_t stats = &state->txq.stats[fc_type];
+
+        if (stats->queued)
+        {
+            VPrint("PCIE%d: %-3s tx queue depth=%d queued=%llu bypasses=%llu max depth=%u\n",
+                   state->thisnode, fc_type_str[fc_type], state->usrconf.TxQueueDepth,
+                   (unsigned long long)stats->queued, (unsigned long long)stats->bypasses, stats->max_depth);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// TagReport()
+//
+// Print the tag pool allocations, with the waits for a free tag, and
+// the outstanding request counts
+//
+// -------------------------------------------------------------------------
+
+void TagReport (const pPcieModelState_t const state)
+{
+    pTagStats_t stats = &state->tags.stats;
+
+    if (stats->allocated || stats->max_outstanding)
+    {
+        VPrint("PCIE%d: Tags %s pool=%u allocated=%llu waits=%llu wait cycles=%llu outstanding=%u max outstanding=%u unmatched=%llu\n",
+               state->thisnode, state->usrconf.Tag10Bit ? "10-bit" : "8-bit", state->tags.pool_size,
+               (unsigned long long)stats->allocated, (unsigned long long)stats->waits, (unsigned long long)stats->wait_cycles,
+               stats->outstanding, stats->max_outstanding, (unsigned long long)stats->unmatched);
+    }
+}
+
+// -------------------------------------------------------------------------
+// ReplayReport()
+//
+// Print the replay counts, if any replays, with the replay timer limit
+//
+// -------------------------------------------------------------------------
+
+void ReplayReport (const pPcieModelState_t const state)
+{
+    pReplayStats_t stats = &state->replay.stats;
+
+    if (stats->replays)
+    {
+        VPrint("PCIE%d: Replay timer=%d replays=%llu naks=%llu timeouts=%llu TLPs replayed=%llu rollovers=%llu retrains=%llu\n",
+               state->thisnode,
+               (state->usrconf.ReplayTimeout == REPLAY_TIMEOUT_OFF) ? REPLAY_TIMEOUT_OFF : (int)ReplayTimerLimit(state),
+               (unsigned long long)stats->replays, (unsigned long long)stats->naks_received,
+               (unsigned long long)stats->timeouts, (unsigned long long)stats->tlps_replayed,
+               (unsigned long long)stats->rollovers, (unsigned long long)stats->retrains);
+    }
+}
@@ -0,0 +1,758 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Binary link trace capture. Records are appended, unformatted,
+// to a buffered file (see pcie_trace.h for the layout) and rendered
+// offline with tools/pcietracedec.
+//
+// Triggered capture keeps the most recent packet and ordered set
+// records in a history ring. When an armed condition is seen, the
+// history and a number of following records are dumped to a file,
+// in the same format, and the trigger disarmed.
+//
+// A captured trace can be loaded back as a list of ready built
+// packets, for replaying from a node with PcieReplay().
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include "pcie.h"
+#include "pcie_utils.h"
+#include "displink.h"
+
+// -------------------------------------------------------------------------
+// STATICS
+// -------------------------------------------------------------------------
+
+// Nodes with an open trace or trigger file, for closing at exit
+static pPcieModelState_t traced[VP_MAX_NODES];
+static pPcieModelState_t triggered[VP_MAX_NODES];
+static bool              exit_registered = false;
+
+// -------------------------------------------------------------------------
+// TraceCloseAll()
+//
+// Exit handler to flush and close any trace or trigger files left open
+//
+// -------------------------------------------------------------------------
+
+static void TraceCloseAll (void)
+{
+    for (int node = 0; node < VP_MAX_NODES; node++)
+    {
+        if (traced[node] != NULL)
+        {
+            TraceClose(traced[node]);
+        }
+
+        if (triggered[node] != NULL)
+        {
+            TrigClose(triggered[node]);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// TraceRegisterExit()
+//
+// Register the exit handler, once
+//
+// -------------------------------------------------------------------------
+
+static void TraceRegisterExit (void)
+{
+    if (!exit_registered)
+    {
+        atexit(TraceCloseAll);
+        exit_registered = true;
+    }
+}
+
+// -------------------------------------------------------------------------
+// TraceWriteHdr()
+//
+// Write a trace file header
+//
+// -------------------------------------------------------------------------
+
+static void TraceWriteHdr (const pPcieModelState_t const state, FILE* fp, const uint32_t flags)
+{
+    PcieTraceFileHdr_t hdr;
+
+    hdr.magic        = PCIE_TRACE_MAGIC;
+    hdr.version      = PCIE_TRACE_VERSION;
+    hdr.rec_hdr_size = sizeof(PcieTraceRec_t);
+    hdr.blk_size     = PCIE_TRACE_BLK_SIZE;
+    hdr.node         = state->thisnode;
+    hdr.endpoint     = state->Endpoint;
+    hdr.link_width   = state->LinkWidth;
+    hdr.flags        = flags;
+
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+}
+
+// -------------------------------------------------------------------------
+// TraceWrite()
+//
+// Append a record header, and its data padded to whole blocks
+//
+// -------------------------------------------------------------------------
+
+static void TraceWrite (FILE* fp, const pPcieTraceRec_t const rec, const PktData_t* const data)
+{
+    static const uint8_t padding[PCIE_TRACE_BLK_SIZE] = {0};
+
+    int bytes = rec->count * sizeof(uint16_t);
+
+    fwrite(rec, sizeof(PcieTraceRec_t), 1, fp);
+
+    if (rec->count)
+    {
+        fwrite(data, sizeof(uint16_t), rec->count, fp);
+
+        if (bytes % PCIE_TRACE_BLK_SIZE)
+        {
+            fwrite(padding, 1, PCIE_TRACE_BLK_SIZE - (bytes % PCIE_TRACE_BLK_SIZE), fp);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// TraceMakeRec()
+//
+// Fill in a record header
+//
+// -------------------------------------------------------------------------
+
+static inline void TraceMakeRec (const pPcieModelState_t const state, const pPcieTraceRec_t rec, const int type, const int flags,
+                                 const int node, const int lane, const uint32_t info, const int count)
+{
+    rec->cycle  = state->TicksSinceReset;
+    rec->type   = type;
+    rec->flags  = flags;
+    rec->node   = node;
+    rec->lane   = lane;
+    rec->count  = count;
+    rec->blocks = (count * sizeof(uint16_t) + PCIE_TRACE_BLK_SIZE - 1) / PCIE_TRACE_BLK_SIZE;
+    rec->info   = info;
+}
+
+// -------------------------------------------------------------------------
+// TrigDump()
+//
+// Trigger seen. Write out the history to the trigger file, and start
+// capturing the post trigger records.
+//
+// -------------------------------------------------------------------------
+
+static void TrigDump (const pPcieModelState_t const state, const char* reason)
+{
+    pTrigCapture_t trig = state->Trig;
+    char           fname[STRBUFSIZE];
+    uint64_t       first;
+
+    snprintf(fname, STRBUFSIZE, TRIG_DEFAULT_NAME, state->thisnode);
+
+    VPrint("TrigDump: Info --- %s%s trigger%s at cycle %d. Capturing to %s at node %d\n",
+           fmterrstr, reason, fmtnormstr, state->TicksSinceReset, fname, state->thisnode);
+
+    if ((trig->fp = fopen(fname, "wb")) == NULL)
+    {
+        VPrint("TrigDump: %s***Error --- could not open trigger file %s at node %d%s\n", fmterrstr, fname, state->thisnode, fmtnormstr);
+        TrigClose(state);
+        return;
+    }
+
+    TraceWriteHdr(state, trig->fp, PCIE_TRACE_OS | PCIE_TRACE_DLLP | PCIE_TRACE_TLP);
+
+    // Oldest record first
+    first = (trig->count > trig->depth) ? trig->count - trig->depth : 0;
+
+    for (uint64_t idx = first; idx < trig->count; idx++)
+    {
+        int slot = idx % trig->depth;
+
+        TraceWrite(trig->fp, &trig->recs[slot], &trig->data[slot * MAX_RAW_PKT_SIZE]);
+    }
+
+    triggered[state->thisnode] = state;
+    TraceRegisterExit();
+
+    trig->post_left = state->usrconf.TrigPost;
+
+    if (trig->post_left == 0)
+    {
+        TrigClose(state);
+    }
+}
+
+// -------------------------------------------------------------------------
+// TrigInit()
+//
+// Allocate the trigger history, if not already done, on first use
+// after arming. Returns the trigger state.
+//
+// -------------------------------------------------------------------------
+
+static pTrigCapture_t TrigInit (const pPcieModelState_t const state)
+{
+    pTrigCapture_t trig = state->Trig;
+
+    if (trig == NULL)
+    {
+        if ((trig = calloc(1, sizeof(TrigCapture_t))) == NULL                                        ||
+            (trig->recs = calloc(state->usrconf.TrigHistory, sizeof(PcieTraceRec_t))) == NULL     ||
+            (trig->data = malloc(state->usrconf.TrigHistory * MAX_RAW_PKT_SIZE * sizeof(PktData_t))) == NULL)
+        {
+            VPrint("TrigInit: %s***Error --- memory allocation failure at node %d%s\n", fmterrstr, state->thisnode, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, state->thisnode);
+            return NULL;
+        }
+
+        trig->depth = state->usrconf.TrigHistory;
+        state->Trig = trig;
+    }
+
+    return trig;
+}
+
+// -------------------------------------------------------------------------
+// TrigRecord()
+//
+// Add a record to the trigger history or, once triggered, to the
+// trigger file
+//
+// -------------------------------------------------------------------------
+
+static void TrigRecord (const pPcieModelState_t const state, const pPcieTraceRec_t const rec, const PktData_t* const data)
+{
+    pTrigCapture_t trig = TrigInit(state);
+
+    if (trig == NULL)
+    {
+        return;
+    }
+
+    if (trig->fp != NULL)
+    {
+        TraceWrite(trig->fp, rec, data);
+
+        if (--trig->post_left == 0)
+        {
+            TrigClose(state);
+        }
+    }
+    else
+    {
+        int slot = trig->count++ % trig->depth;
+
+        trig->recs[slot] = *rec;
+        memcpy(&trig->data[slot * MAX_RAW_PKT_SIZE], data, rec->count * sizeof(PktData_t));
+    }
+}
+
+// -------------------------------------------------------------------------
+// TrigCheckPkt()
+//
+// Check a packet, just added to the history, against the armed
+// trigger conditions
+//
+// -------------------------------------------------------------------------
+
+static void TrigCheckPkt (const pPcieModelState_t const state, const pPkt_t const pkt, const bool rx, const bool is_dllp)
+{
+    const pUserConfig_t usrconf = &state->usrconf;
+
+    if (state->Trig == NULL || state->Trig->fp != NULL)
+    {
+        return;
+    }
+
+    if (is_dllp)
+    {
+        if ((usrconf->TrigConditions & TRIG_NAK) && pkt->data[1] == DL_NAK)
+        {
+            TrigDump(state, "NAK");
+            return;
+        }
+    }
+    else if (usrconf->TrigConditions & TRIG_CPL_STATUS)
+    {
+        // Completion type, ignoring whether it has data
+        uint32_t type = pkt->data[TLP_TYPE_BYTE_OFFSET] & 0x3f;
+
+        if ((type == TL_CPL || type == TL_CPLLK) && GET_CPL_STATUS(pkt->data) != CPL_SUCCESS)
+        {
+            TrigDump(state, "Completion status");
+            return;
+        }
+    }
+
+    if ((usrconf->TrigConditions & TRIG_TLP_MATCH) &&
+        DispFilterRulesMatch(state, rx, pkt, &usrconf->TrigMatch, 1, usrconf->TrigMatch.fields))
+    {
+        TrigDump(state, "Match");
+    }
+}
+
+// -------------------------------------------------------------------------
+// TraceDirFlags()
+//
+// Return direction flags, and set the displayed node number, for
+// traffic in the given direction
+//
+// -------------------------------------------------------------------------
+
+static inline int TraceDirFlags (const pPcieModelState_t const state, const bool rx, const int node, int* nodenum)
+{
+    bool is_down = (rx && state->Endpoint) | (!rx && !state->Endpoint);
+
+    *nodenum = rx ? state->usrconf.BackNodeNum : node;
+
+    return (rx ? PCIE_TRACE_FLAG_RX : 0) | (is_down ? PCIE_TRACE_FLAG_DOWN : 0);
+}
+
+// -------------------------------------------------------------------------
+// TraceOpen()
+//
+// Open a trace file for a node, capturing the record types selected
+// in flags. Any trace file already open is closed first. Returns
+// MEM_BAD_STATUS if the file could not be opened.
+//
+// -------------------------------------------------------------------------
+
+int TraceOpen (const pPcieModelState_t const state, const char* fname, const uint32_t flags)
+{
+    char fnamebuf[STRBUFSIZE];
+
+    TraceClose(state);
+
+    if (fname == NULL)
+    {
+        snprintf(fnamebuf, STRBUFSIZE, PCIE_TRACE_DEFAULT_NAME, state->thisnode);
+        fname = fnamebuf;
+    }
+
+    if ((state->TraceFp = fopen(fname, "wb")) == NULL)
+    {
+        VPrint("TraceOpen: %s***Error --- could not open trace file %s at node %d%s\n", fmterrstr, fname, state->thisnode, fmtnormstr);
+        return MEM_BAD_STATUS;
+    }
+
+    // Give the file a large buffer so records are written in bulk
+    if ((state->TraceBuf = malloc(PCIE_TRACE_BUF_SIZE)) != NULL)
+    {
+        setvbuf(state->TraceFp, state->TraceBuf, _IOFBF, PCIE_TRACE_BUF_SIZE);
+    }
+
+    state->TraceFlags = flags & PCIE_TRACE_ALL;
+
+    TraceWriteHdr(state, state->TraceFp, state->TraceFlags);
+
+    traced[state->thisnode] = state;
+    TraceRegisterExit();
+
+    return MEM_GOOD_STATUS;
+}
+
+// -------------------------------------------------------------------------
+// TraceClose()
+//
+// Flush and close a node's trace file, if open
+//
+// -------------------------------------------------------------------------
+
+void TraceClose (const pPcieModelState_t const state)
+{
+    if (state->TraceFp != NULL)
+    {
+        fclose(state->TraceFp);
+        CheckFree(state->TraceBuf);
+    }
+
+    state->TraceFp          = NULL;
+    state->TraceBuf         = NULL;
+    state->TraceFlags       = 0;
+    traced[state->thisnode] = NULL;
+}
+
+// -------------------------------------------------------------------------
+// TraceSym()
+//
+// Capture a cycle's lane symbols
+//
+// -------------------------------------------------------------------------
+
+void TraceSym (const pPcieModelState_t const state, const PktData_t *linkin, const int rx)
+{
+    int            nodenum, flags;
+    PcieTraceRec_t rec;
+
+    if (state->TraceFlags & PCIE_TRACE_SYM)
+    {
+        flags = TraceDirFlags(state, rx, state->thisnode, &nodenum);
+
+        TraceMakeRec(state, &rec, PCIE_TRACE_REC_SYM, flags, nodenum, 0, 0, state->LinkWidth);
+        TraceWrite(state->TraceFp, &rec, linkin);
+    }
+}
+
+// -------------------------------------------------------------------------
+// TraceOS()
+//
+// Capture an ordered set seen on a lane, to the trace file and/or
+// trigger history
+//
+// -------------------------------------------------------------------------
+
+void TraceOS (const pPcieModelState_t const state, const int type, const pTS_t const ts_data, const int lane, const bool rx, const int node)
+{
+    int            nodenum, flags, count = 0;
+    PktData_t      ts[PCIE_TRACE_TS_COUNT];
+    PcieTraceRec_t rec;
+
+    if ((state->TraceFlags & PCIE_TRACE_OS) || state->usrconf.TrigConditions)
+    {
+        flags = TraceDirFlags(state, rx, node, &nodenum);
+
+        if ((type == TS1_ID || type == TS2_ID) && ts_data != NULL)
+        {
+            ts[PCIE_TRACE_TS_LINKNUM]  = ts_data->linknum;
+            ts[PCIE_TRACE_TS_LANENUM]  = ts_data->lanenum;
+            ts[PCIE_TRACE_TS_N_FTS]    = ts_data->n_fts;
+            ts[PCIE_TRACE_TS_DATARATE] = ts_data->datarate;
+            ts[PCIE_TRACE_TS_CONTROL]  = ts_data->control;
+
+            count = PCIE_TRACE_TS_COUNT;
+        }
+
+        TraceMakeRec(state, &rec, PCIE_TRACE_REC_OS, flags, nodenum, lane, type, count);
+
+        if (state->TraceFlags & PCIE_TRACE_OS)
+        {
+            TraceWrite(state->TraceFp, &rec, ts);
+        }
+
+        if (state->usrconf.TrigConditions)
+        {
+            TrigRecord(state, &rec, ts);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// TracePkt()
+//
+// Capture a complete DLLP or TLP, as seen on the link (i.e. before
+// any CRC checking on received packets), to the trace file and/or
+// trigger history
+//
+// -------------------------------------------------------------------------
+
+void TracePkt (const pPcieModelState_t const state, const pPkt_t const pkt, const bool rx)
+{
+    int            nodenum, flags, count;
+    bool           is_dllp = pkt->data[0] == SDP;
+    bool           trace   = state->TraceFlags & (is_dllp ? PCIE_TRACE_DLLP : PCIE_TRACE_TLP);
+    PcieTraceRec_t rec;
+
+    if (trace || state->usrconf.TrigConditions)
+    {
+        flags = TraceDirFlags(state, rx, state->thisnode, &nodenum);
+
+        for (count = 0; count < MAX_RAW_PKT_SIZE && pkt->data[count] != PKT_TERMINATION; count++);
+
+        if (count && pkt->data[count-1] == EDB)
+        {
+            flags |= PCIE_TRACE_FLAG_EDB;
+        }
+
+        TraceMakeRec(state, &rec, is_dllp ? PCIE_TRACE_REC_DLLP : PCIE_TRACE_REC_TLP, flags, nodenum, 0, 0, count);
+
+        if (trace)
+        {
+            TraceWrite(state->TraceFp, &rec, pkt->data);
+        }
+
+        if (state->usrconf.TrigConditions)
+        {
+            TrigRecord(state, &rec, pkt->data);
+            TrigCheckPkt(state, pkt, rx, is_dllp);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// TrigEvent()
+//
+// Report a trigger condition detected elsewhere in the model (bad
+// LCRC, or a credit stall that has exceeded the configured limit).
+// Triggers if the condition is armed.
+//
+// -------------------------------------------------------------------------
+
+void TrigEvent (const pPcieModelState_t const state, const uint32_t condition)
+{
+    if ((state->usrconf.TrigConditions & condition) && TrigInit(state) != NULL && state->Trig->fp == NULL)
+    {
+        TrigDump(state, condition == TRIG_BAD_LCRC ? "Bad LCRC" : "Credit stall");
+    }
+}
+
+// -------------------------------------------------------------------------
+// TrigClose()
+//
+// Disarm triggered capture, closing any trigger file and freeing the
+// history
+//
+// -------------------------------------------------------------------------
+
+void TrigClose (const pPcieModelState_t const state)
+{
+    pTrigCapture_t trig = state->Trig;
+
+    if (trig != NULL)
+    {
+        if (trig->fp != NULL)
+        {
+            fclose(trig->fp);
+        }
+
+        CheckFree(trig->recs);
+        CheckFree(trig->data);
+        CheckFree(trig);
+    }
+
+    state->Trig                     = NULL;
+    state->usrconf.TrigConditions   = 0;
+    triggered[state->thisnode]      = NULL;
+}
+
+// -------------------------------------------------------------------------
+// TrigConfig()
+//
+// Arm triggered capture from a specification string. This is a list
+// of space separated conditions and settings:
+//
+//   lcrc             Received TLP with a bad LCRC
+//   nak              NAK sent or received
+//   cplerr           Completion with a status other than successful
+//   stall=<cycles>   Waited for transmit credits for longer than cycles
+//   history=<n>      Records kept before the trigger
+//   post=<n>         Records captured after the trigger
+//
+// followed optionally by ':' and a display filter rule (see
+// DispFilterParse()) to trigger on a matching packet.
+//
+// -------------------------------------------------------------------------
+
+int TrigConfig (const pUserConfig_t usrconf, const char* spec, const int node)
+{
+    char     buf[STRBUFSIZE];
+    char     *tok, *rule, *saveptr;
+    uint32_t conditions = 0;
+
+    strncpy(buf, spec, STRBUFSIZE-1);
+    buf[STRBUFSIZE-1] = 0;
+
+    // Split off any match rule
+    if ((rule = strchr(buf, ':')) != NULL)
+    {
+        *rule++ = 0;
+
+        if (DispFilterParse(rule, &usrconf->TrigMatch, node) != MEM_GOOD_STATUS)
+        {
+            return MEM_BAD_STATUS;
+        }
+
+        conditions |= TRIG_TLP_MATCH;
+    }
+
+    for (tok = strtok_r(buf, " \t\r\n", &saveptr); tok != NULL; tok = strtok_r(NULL, " \t\r\n", &saveptr))
+    {
+        if (strncmp(tok, "//", 2) == 0)
+        {
+            break;
+        }
+        else if (strcmp(tok, "lcrc") == 0)
+        {
+            conditions |= TRIG_BAD_LCRC;
+        }
+        else if (strcmp(tok, "nak") == 0)
+        {
+            conditions |= TRIG_NAK;
+        }
+        else if (strcmp(tok, "cplerr") == 0)
+        {
+            conditions |= TRIG_CPL_STATUS;
+        }
+        else if (strncmp(tok, "stall=", 6) == 0)
+        {
+            conditions |= TRIG_CREDIT_STALL;
+            usrconf->TrigStallCycles = strtoul(&tok[6], NULL, 10);
+        }
+        else if (strncmp(tok, "history=", 8) == 0 && strtol(&tok[8], NULL, 10) > 0)
+        {
+            usrconf->TrigHistory = strtol(&tok[8], NULL, 10);
+        }
+        else if (strncmp(tok, "post=", 5) == 0)
+        {
+            usrconf->TrigPost = strtol(&tok[5], NULL, 10);
+        }
+        else
+        {
+            VPrint("TrigConfig: %s***Warning --- bad trigger setting '%s' at node %d. Trigger not armed%s\n", fmterrstr, tok, node, fmtnormstr);
+            return MEM_BAD_STATUS;
+        }
+    }
+
+    usrconf->TrigConditions = conditions;
+
+    return MEM_GOOD_STATUS;
+}
+
+// -------------------------------------------------------------------------
+// ReplayLoad()
+//
+// Load the packets sent (or, with REPLAY_RX_SIDE, received) by the
+// capturing node from a trace file, selected with the REPLAY_TLP and
+// REPLAY_DLLP flags. All packets are built before replay starts.
+// Records with a bad length, for their data or as a TLP or DLLP, are
+// skipped with a warning.
+// TLPs captured with a bad LCRC (including nullified TLPs) are marked
+// BadLcrc, as they are numbered afresh when released (TlpRelease()).
+// Each packet's TimeStamp is set to its replay time, relative
+// to the first packet, with gaps limited to max_gap cycles (unless
+// REPLAY_ORIG_TIMING). Returns NULL on error, or if nothing to replay.
+//
+// -------------------------------------------------------------------------
+
+pPkt_t ReplayLoad (const pPcieModelState_t const state, const char* fname, const uint32_t flags, const int max_gap)
+{
+    FILE               *fp;
+    PcieTraceFileHdr_t hdr;
+    PcieTraceRec_t     rec;
+    PktData_t          *data;
+    pPkt_t             head = NULL, end = NULL, packet;
+    uint32_t           last_cycle = 0, time = 0;
+    int                node       = state->thisnode;
+    int                side       = (flags & REPLAY_RX_SIDE) ? PCIE_TRACE_FLAG_RX : 0;
+
+    if ((fp = fopen(fname, "rb")) == NULL)
+    {
+        VPrint("ReplayLoad: %s***Error --- could not open trace file %s at node %d%s\n", fmterrstr, fname, node, fmtnormstr);
+        return NULL;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != PCIE_TRACE_MAGIC || hdr.version != PCIE_TRACE_VERSION ||
+        hdr.rec_hdr_size != sizeof(PcieTraceRec_t) || hdr.blk_size != PCIE_TRACE_BLK_SIZE)
+    {
+        VPrint("ReplayLoad: %s***Error --- %s is not a compatible trace file at node %d%s\n", fmterrstr, fname, node, fmtnormstr);
+        fclose(fp);
+        return NULL;
+    }
+
+    while (fread(&rec, sizeof(rec), 1, fp) == 1)
+    {
+        bool selected = (rec.flags & PCIE_TRACE_FLAG_RX) == side &&
+                        ((rec.type == PCIE_TRACE_REC_TLP  && (flags & REPLAY_TLP)) ||
+                         (rec.type == PCIE_TRACE_REC_DLLP && (flags & REPLAY_DLLP)));
+
+        if (!selected)
+        {
+            fseek(fp, rec.blocks * PCIE_TRACE_BLK_SIZE, SEEK_CUR);
+            continue;
+        }
+
+        if (rec.count > MAX_RAW_PKT_SIZE || rec.count * sizeof(PktData_t) > rec.blocks * PCIE_TRACE_BLK_SIZE ||
+            ((rec.type == PCIE_TRACE_REC_TLP) ? rec.count < RX_TLP_MIN_SYMBOLS : rec.count != RX_DLLP_SYMBOLS))
+        {
+            VPrint("ReplayLoad: %s***Warning --- skipping %s record of bad length %d at cycle %u in %s at node %d%s\n", fmterrstr,
+                   (rec.type == PCIE_TRACE_REC_TLP) ? "TLP" : "DLLP", rec.count, rec.cycle, fname, node, fmtnormstr);
+            fseek(fp, rec.blocks * PCIE_TRACE_BLK_SIZE, SEEK_CUR);
+            continue;
+        }
+
+        if ((data = malloc(rec.blocks * PCIE_TRACE_BLK_SIZE + sizeof(PktData_t))) == NULL ||
+            (packet = calloc(1, sizeof(sPkt_t))) == NULL)
+        {
+            VPrint("ReplayLoad: %s***Error --- memory allocation failure at node %d%s\n", fmterrstr, node, fmtnormstr);
+            VWrite(PVH_FATAL, 0, 0, node);
+            break;
+        }
+
+        if (fread(data, PCIE_TRACE_BLK_SIZE, rec.blocks, fp) != rec.blocks)
+        {
+            VPrint("ReplayLoad: %s***Warning --- truncated trace file %s at node %d%s\n", fmterrstr, fname, node, fmtnormstr);
+            CheckFree(data);
+            CheckFree(packet);
+            break;
+        }
+
+        data[rec.count]   = PKT_TERMINATION;
+        packet->data      = data;
+        packet->ByteCount = rec.count;
+
+        if (rec.type == PCIE_TRACE_REC_DLLP)
+        {
+            packet->seq = DLLP_SEQ_ID;
+        }
+        else
+        {
+            PktData_t crc[4];
+
+            memcpy(crc, &data[rec.count-5], sizeof(crc));
+            CalcLcrc(data);
+
+            packet->BadLcrc = memcmp(crc, &data[rec.count-5], sizeof(crc)) != 0;
+        }
+
+        // Replay time, relative to the first packet, with any gap limiting
+        if (head != NULL)
+        {
+            uint32_t gap = rec.cycle - last_cycle;
+
+            time += (max_gap == REPLAY_ORIG_TIMING || gap < (uint32_t)max_gap) ? gap : (uint32_t)max_gap;
+        }
+
+        last_cycle        = rec.cycle;
+        packet->TimeStamp = time;
+
+        if (head == NULL)
+        {
+            head = packet;
+        }
+        else
+        {
+            end->NextPkt = packet;
+        }
+        end = packet;
+    }
+
+    fclose(fp);
+
+    return head;
+}
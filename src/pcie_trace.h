@@ -0,0 +1,113 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Published layout of the binary link trace files written when
+// capture is enabled with PcieTraceOpen() (or CONFIG_ENABLE_TRACE).
+// This header has no dependencies on the rest of the model, and is
+// used by the offline decoder in tools/.
+//
+// A trace file is laid out as:
+//
+//   offset 0 : PcieTraceFileHdr_t
+//   then     : records, each a PcieTraceRec_t followed by
+//              rec.blocks * PCIE_TRACE_BLK_SIZE bytes of data
+//
+// All fields are in the capturing host's byte order. Record data is
+// rec.count 16 bit values, zero padded to a whole number of blocks,
+// so every record is a multiple of 16 bytes. For symbol records these are
+// the decoded lane symbols (as PktData_t), for packet records the
+// complete packet from STP/SDP to END/EDB, with CRCs as seen on the
+// link, and for ordered set records the TS fields (PCIE_TRACE_TS_*).
+//
+//=============================================================
+
+#ifndef _PCIE_TRACE_H_
+#define _PCIE_TRACE_H_
+
+#include <stdint.h>
+
+#define PCIE_TRACE_MAGIC             0x54485650   // "PVHT"
+#define PCIE_TRACE_VERSION           1
+#define PCIE_TRACE_BLK_SIZE          16
+
+#define PCIE_TRACE_DEFAULT_NAME      "pcietrace%d.bin"
+#define PCIE_TRACE_BUF_SIZE          (1024*1024)
+
+// Capture selection flags (PcieTraceOpen() and CONFIG_ENABLE_TRACE)
+#define PCIE_TRACE_SYM               0x001        // Raw lane symbols, every cycle, tx and rx
+#define PCIE_TRACE_OS                0x002        // Ordered sets
+#define PCIE_TRACE_DLLP              0x004        // Complete DLLPs
+#define PCIE_TRACE_TLP               0x008        // Complete TLPs
+#define PCIE_TRACE_ALL               0x00f
+
+// Record types
+#define PCIE_TRACE_REC_SYM           1
+#define PCIE_TRACE_REC_OS            2
+#define PCIE_TRACE_REC_DLLP          3
+#define PCIE_TRACE_REC_TLP           4
+
+// Record flags
+#define PCIE_TRACE_FLAG_RX           0x01         // Received (else transmitted) by the capturing node
+#define PCIE_TRACE_FLAG_DOWN         0x02         // Downstream traffic
+#define PCIE_TRACE_FLAG_EDB          0x04         // Packet terminated with EDB
+
+// Packet kinds, as selected by the display filters (DispFilterAdd()) and
+// the offline decoder's -k option
+#define DISP_KIND_MEM                0x01
+#define DISP_KIND_CPL                0x02
+#define DISP_KIND_CFG                0x04
+#define DISP_KIND_MSG                0x08
+#define DISP_KIND_IO                 0x10
+#define DISP_KIND_DLLP               0x20
+
+// Ordered set record data indexes
+#define PCIE_TRACE_TS_LINKNUM        0
+#define PCIE_TRACE_TS_LANENUM        1
+#define PCIE_TRACE_TS_N_FTS          2
+#define PCIE_TRACE_TS_DATARATE       3
+#define PCIE_TRACE_TS_CONTROL        4
+#define PCIE_TRACE_TS_COUNT          5
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rec_hdr_size;                        // sizeof(PcieTraceRec_t)
+    uint32_t blk_size;                            // PCIE_TRACE_BLK_SIZE
+    uint32_t node;                                // Capturing node
+    uint32_t endpoint;                            // Capturing node is an endpoint
+    uint32_t link_width;
+    uint32_t flags;                               // Capture selection flags
+} PcieTraceFileHdr_t, *pPcieTraceFileHdr_t;
+
+typedef struct {
+    uint32_t cycle;                               // Capturing node's cycle count
+    uint8_t  type;                                // PCIE_TRACE_REC_xxx
+    uint8_t  flags;                               // PCIE_TRACE_FLAG_xxx
+    uint8_t  node;                                // Node number as displayed for this direction
+    uint8_t  lane;                                // Lane (ordered sets only)
+    uint16_t count;                               // Number of 16 bit data values
+    uint16_t blocks;                              // Number of data blocks following
+    uint32_t info;                                // Ordered set type (ordered sets only)
+} PcieTraceRec_t, *pPcieTraceRec_t;
+
+#endif
@@ -197,6 +197,71 @@ static void ProcessRxFlowControl(const pFlowControl_t const flw, const int intyp
     }
 }
 
+// UpdateFC DLLP types, indexed by FC type, and the order in which the
+// FC types are updated
+static const int fc_update_dllp[FC_NUMTYPES]  = {DL_UPDATEFC_P, DL_UPDATEFC_NP, DL_UPDATEFC_CPL};
+static const int fc_update_order[FC_NUMTYPES] = {FC_NONPOST, FC_CMPL, FC_POST};
+
+// -------------------------------------------------------------------------
+// FcUpdateDue()
+//
+// Returns true if an UpdateFC is due for an FC type with changed
+// consumed credits, for the configured policy (CONFIG_FC_POLICY). The
+// update timer is checked separately, and is the only trigger for
+// FC_POLICY_TIMER. The default policy sends an update when no header
+// space is left, or data space is less than max payload size (or none
+// for non-posted), or the send queue is empty.
+//
+// -------------------------------------------------------------------------
+
+static bool FcUpdateDue(const pPcieModelState_t const state, const int type)
+{
+    pFlowControl_t flw      = &(state->flwcntl);
+    bool           hdr_upd  = flw->ConsumedHdrUpdated[0][type];
+    bool           data_upd = flw->ConsumedDataUpdated[0][type];
+    uint32_t       hdr_sp   = flw->AdvertisedHdrCredits[0][type]  - flw->RxHdrCredits[0][type];
+    uint32_t       data_sp  = flw->AdvertisedDataCredits[0][type] - flw->RxDataCredits[0][type];
+    FcUpdateInfo_t info;
+
+    if (!hdr_upd && !data_upd)
+    {
+        return false;
+    }
+
+    switch (state->usrconf.FcPolicy)
+    {
+    case FC_POLICY_AGGRESSIVE:
+        return true;
+
+    case FC_POLICY_THRESHOLD:
+        return (hdr_upd  && hdr_sp  < state->usrconf.FcHdrWatermark) ||
+               (data_upd && data_sp < state->usrconf.FcDataWatermark);
+
+    case FC_POLICY_TIMER:
+        return false;
+
+    case FC_POLICY_CALLBACK:
+        if (state->vuser_fc_cb != NULL)
+        {
+            info.hdr_pending  = flw->ConsumedHdrCredits[0][type]  - flw->AdvertisedHdrCredits[0][type];
+            info.data_pending = flw->ConsumedDataCredits[0][type] - flw->AdvertisedDataCredits[0][type];
+            info.hdr_space    = hdr_sp;
+            info.data_space   = data_sp;
+            info.cycles       = GetCycleCount(state->thisnode) - flw->LastSentFcTime[0][type];
+            info.queue_empty  = state->send_p == NULL;
+
+            return (state->vuser_fc_cb)(type, &info, state->usrptr);
+        }
+
+        // No callback registered, so use the default policy
+        // fall through
+    default:
+        return (hdr_upd  && hdr_sp == 0) ||
+               (data_upd && (type == FC_NONPOST ? data_sp == 0 : data_sp < DEFAULT_MAX_PAYLOAD_SIZE)) ||
+               state->send_p == NULL;
+    }
+}
+
 // -------------------------------------------------------------------------
 // UpdateConsumedFC()
 //
@@ -210,7 +275,6 @@ static void UpdateConsumedFC(const pPcieModelState_t const state)
     uint32_t current_cycle, i;
     bool no_change = true;
     pFlowControl_t flw = &(state->flwcntl);
-    int fc_timeout[FC_NUMTYPES];
 
     if (state->usrconf.DisableFc  || flw->fc_state[0] != INITFC_FI2 || flw->fc_init_count[0] < FC_INIT_SENT_MIN)
     {
@@ -255,70 +319,38 @@ static void UpdateConsumedFC(const pPcieModelState_t const state)
         }
     }
 
-    // Flag if a flow control timeout for any of the types
+    // Send an UpdateFC for each type, in non-posted, completion, posted
+    // order, if its credits are not infinite and the policy requires it.
+    // The UpdateFCs go on the DLLP priority queue, so are not held up
+    // behind queued TLPs.
     for (i = 0; i < FC_NUMTYPES; i++)
     {
-        // If a timeout, pretend there's been a change to force sending of flow control
-        if (fc_timeout[i] = ((GetCycleCount(state->thisnode) - flw->LastSentFcTime[0][i]) > DEFAULT_FC_TIME))
-        {
-            no_change = false;
-        }
-    }
-
-    // We need to send an update if not both header and data infinite, if there's been
-    // a change in consumed credits and if no header space left or data space
-    // less than max payload size (or equal 0 for non-posted).
-
-    // Non-posted
-    if (flw->ConsumedHdrCredits[0][FC_NONPOST] || flw->ConsumedDataCredits[0][FC_NONPOST])
-    {
-        if ((flw->ConsumedHdrUpdated[0][FC_NONPOST]  && ((flw->AdvertisedHdrCredits[0][FC_NONPOST]  - flw->RxHdrCredits[0][FC_NONPOST]) == 0)) ||
-            (flw->ConsumedDataUpdated[0][FC_NONPOST] && ((flw->AdvertisedDataCredits[0][FC_NONPOST] - flw->RxDataCredits[0][FC_NONPOST]) == 0)) ||
-            ((flw->ConsumedHdrUpdated[0][FC_NONPOST] || flw->ConsumedDataUpdated[0][FC_NONPOST]) && (state->send_p == NULL)) ||
-            fc_timeout[FC_NONPOST])
-        {
-            SendFC (DL_UPDATEFC_NP, 0, flw->ConsumedHdrCredits[0][FC_NONPOST]%(DL_MAX_HDRFC+1), flw->ConsumedDataCredits[0][FC_NONPOST]%(DL_MAX_DATAFC+1), state->draining_queue, state->thisnode);
-            flw->AdvertisedHdrCredits[0][FC_NONPOST] = flw->ConsumedHdrCredits[0][FC_NONPOST];
-            flw->AdvertisedDataCredits[0][FC_NONPOST] = flw->ConsumedDataCredits[0][FC_NONPOST];
-            flw->LastSentFcTime[0][FC_NONPOST] = GetCycleCount(state->thisnode);
-            flw->ConsumedHdrUpdated[0][FC_NONPOST]  = 0;
-            flw->ConsumedDataUpdated[0][FC_NONPOST] = 0;
-        }
-    }
+        int      type    = fc_update_order[i];
+        bool     timeout = (current_cycle - flw->LastSentFcTime[0][type]) > state->usrconf.FcUpdateTime;
 
-    // Completions
-    if (flw->ConsumedHdrCredits[0][FC_CMPL] || flw->ConsumedDataCredits[0][FC_CMPL])
-    {
-        if ((flw->ConsumedHdrUpdated[0][FC_CMPL]  && ((flw->AdvertisedHdrCredits[0][FC_CMPL]  - flw->RxHdrCredits[0][FC_CMPL]) == 0)) ||
-            (flw->ConsumedDataUpdated[0][FC_CMPL] && ((flw->AdvertisedDataCredits[0][FC_CMPL] - flw->RxDataCredits[0][FC_CMPL]) < DEFAULT_MAX_PAYLOAD_SIZE)) ||
-            ((flw->ConsumedHdrUpdated[0][FC_CMPL] || flw->ConsumedDataUpdated[0][FC_CMPL]) && (state->send_p == NULL)) ||
-            fc_timeout[FC_CMPL])
+        if ((flw->ConsumedHdrCredits[0][type] || flw->ConsumedDataCredits[0][type]) && (timeout || FcUpdateDue(state, type)))
         {
-            SendFC (DL_UPDATEFC_CPL, 0, flw->ConsumedHdrCredits[0][FC_CMPL]%(DL_MAX_HDRFC+1), flw->ConsumedDataCredits[0][FC_CMPL]%(DL_MAX_DATAFC+1), state->draining_queue, state->thisnode);
-            flw->AdvertisedHdrCredits[0][FC_CMPL] = flw->ConsumedHdrCredits[0][FC_CMPL];
-            flw->AdvertisedDataCredits[0][FC_CMPL] = flw->ConsumedDataCredits[0][FC_CMPL];
-            flw->LastSentFcTime[0][FC_CMPL] = GetCycleCount(state->thisnode);
-            flw->ConsumedHdrUpdated[0][FC_CMPL]  = 0;
-            flw->ConsumedDataUpdated[0][FC_CMPL] = 0;
+            pFcUpdateStats_t stats = &state->fcstats[type];
+
+            stats->updates_sent++;
+            stats->timer_updates         += timeout;
+            stats->hdr_credits_returned  += flw->ConsumedHdrCredits[0][type]  - flw->AdvertisedHdrCredits[0][type];
+            stats->data_credits_returned += flw->ConsumedDataCredits[0][type] - flw->AdvertisedDataCredits[0][type];
+
+            AddPktToDllpQueue(state, CreateFcPkt(fc_update_dllp[type], flw->ConsumedHdrCredits[0][type]%(DL_MAX_HDRFC+1),
+                                                 flw->ConsumedDataCredits[0][type]%(DL_MAX_DATAFC+1), state->thisnode));
+            flw->AdvertisedHdrCredits[0][type]  = flw->ConsumedHdrCredits[0][type];
+            flw->AdvertisedDataCredits[0][type] = flw->ConsumedDataCredits[0][type];
+            flw->LastSentFcTime[0][type]        = current_cycle;
+            flw->ConsumedHdrUpdated[0][type]    = 0;
+            flw->ConsumedDataUpdated[0][type]   = 0;
         }
     }
 
-    // Posted
-    if (flw->ConsumedHdrCredits[0][FC_POST] || flw->ConsumedDataCredits[0][FC_POST])
+    // Send any updates now, if not called from within SendPacket()
+    if (state->dllp_head_p != NULL && !state->draining_queue)
     {
-        if ((flw->ConsumedHdrUpdated[0][FC_POST]  && ((flw->AdvertisedHdrCredits[0][FC_POST]  - flw->RxHdrCredits[0][FC_POST]) == 0)) ||
-            (flw->ConsumedDataUpdated[0][FC_POST] && ((flw->AdvertisedDataCredits[0][FC_POST] - flw->RxDataCredits[0][FC_POST]) < DEFAULT_MAX_PAYLOAD_SIZE)) ||
-            ((flw->ConsumedHdrUpdated[0][FC_POST] || flw->ConsumedDataUpdated[0][FC_POST]) && (state->send_p == NULL)) ||
-            fc_timeout[FC_POST])
-        {
-
-            SendFC (DL_UPDATEFC_P, 0, flw->ConsumedHdrCredits[0][FC_POST]%(DL_MAX_HDRFC+1), flw->ConsumedDataCredits[0][FC_POST]%(DL_MAX_DATAFC+1), state->draining_queue, state->thisnode);
-            flw->AdvertisedHdrCredits[0][FC_POST] = flw->ConsumedHdrCredits[0][FC_POST];
-            flw->AdvertisedDataCredits[0][FC_POST] = flw->ConsumedDataCredits[0][FC_POST];
-            flw->LastSentFcTime[0][FC_POST] = GetCycleCount(state->thisnode);
-            flw->ConsumedHdrUpdated[0][FC_POST]  = 0;
-            flw->ConsumedDataUpdated[0][FC_POST] = 0;
-        }
+        SendPacket(state->thisnode);
     }
 }
 
@@ -334,7 +366,7 @@ static void UpdateConsumedFC(const pPcieModelState_t const state)
 
 static void CheckSkips(const pPcieModelState_t const state)
 {
-    if ((state->TicksSinceReset - state->LastTxSkipTime) > state->usrconf.SkipInterval)
+    if ((state->TicksSinceReset - state->LastTxSkipTime) > (uint32_t)state->usrconf.SkipInterval)
     {
         state->SkipScheduled += 1;
         state->LastTxSkipTime = state->TicksSinceReset;
@@ -346,13 +378,14 @@ static void CheckSkips(const pPcieModelState_t const state)
 //
 // Acknowledging packets consists of updating curr_ack to
 // acknowledge sequence, only if acknowledge sequence is
-// higher *and* there is no higher outstanding NAK.
+// later *and* there is no later outstanding NAK.
 //
 // -------------------------------------------------------------------------
 
 static void AckPkt(const pPcieModelState_t const state, const int sequence)
 {
-    if (sequence < state->curr_nak && (sequence > state->curr_ack || state->curr_ack == NULLACK))
+    if ((state->curr_nak == NULLACK || SEQ_LT(sequence, state->curr_nak)) &&
+        (state->curr_ack == NULLACK || SEQ_LT(state->curr_ack, sequence)))
     {
         state->curr_ack = sequence;
     }
@@ -361,7 +394,7 @@ static void AckPkt(const pPcieModelState_t const state, const int sequence)
 // -------------------------------------------------------------------------
 // NakPkt()
 //
-// Update curr_nak with nak sequence, but only if lower
+// Update curr_nak with nak sequence, but only if earlier
 // than outstanding Nak (i.e. we've Nak'd earlier, are not
 // yet retrying, and a later packet also gets Nak'd).
 //
@@ -369,113 +402,466 @@ static void AckPkt(const pPcieModelState_t const state, const int sequence)
 
 static void NakPkt(const pPcieModelState_t const state, const int sequence)
 {
-    if (sequence < state->curr_nak)
+    state->replay.stats.naks_received++;
+
+    if (state->curr_nak == NULLACK || SEQ_LT(sequence, state->curr_nak))
     {
         state->curr_nak = sequence;
     }
 }
 
+// -------------------------------------------------------------------------
+// TlpPayloadLen()
+//
+// Returns a TLP's payload length in DWs, for credit checks, or 0 if
+// the TLP type has no data
+//
+// -------------------------------------------------------------------------
+
+int TlpPayloadLen (const PktData_t* const pkt)
+{
+    return (GET_TLP_TYPE(pkt) & TLP_FMT_DATA_BIT) ? GET_TLP_LENGTH_ADJ(pkt) : 0;
+}
+
+// -------------------------------------------------------------------------
+// TlpRelease()
+//
+// Add a TLP to the send queue, giving it the next sequence number
+// and its LCRC, and consuming its credits of fc_type. A TLP marked
+// BadLcrc gets an inverted LCRC and, if nullified, doesn't use up
+// its sequence number.
+//
+// -------------------------------------------------------------------------
+
+void TlpRelease (const pPcieModelState_t const state, const pPkt_t const packet, const int fc_type)
+{
+    pFlowControl_t flw = &state->flwcntl;
+    int            len = TlpPayloadLen(packet->data);
+
+    SET_DLLP_SEQ(state->seq, packet->data);
+    CalcLcrc(packet->data);
+    packet->seq = state->seq;
+
+    if (packet->BadLcrc)
+    {
+        for (int idx = packet->ByteCount - 5; idx < (int)packet->ByteCount - 1; idx++)
+        {
+            packet->data[idx] = ~packet->data[idx] & BYTE_MASK;
+        }
+    }
+
+    // Nullified TLPs don't use up a sequence number
+    if (!packet->BadLcrc || packet->data[packet->ByteCount-1] != EDB)
+    {
+        state->seq++;
+    }
+
+    AddPktToQueue(state, packet);
+
+    if (!state->usrconf.DisableFc)
+    {
+        flw->TxHdrCredits[0][fc_type]++;
+        flw->TxDataCredits[0][fc_type] += len/4 + ((len%4) ? 1 : 0);
+    }
+}
+
 // -------------------------------------------------------------------------
 // CheckDelayQueue()
 //
+// The completion scheduler. Completions on the delay queue are
+// released to the send queue, in order, once their process time is
+// reached and there are enough completion credits. They are then
+// sent interleaved with other TLPs in the order queued, whilst a
+// completion held for credits does not hold up posted or non-posted
+// requests. Holding a completion is recorded as a credit stall.
+//
 // -------------------------------------------------------------------------
 
 static void CheckDelayQueue (const pPcieModelState_t const state)
 {
-    pPkt_t tmp;
+    pFlowControl_t  flw   = &state->flwcntl;
+    pStallEpisode_t stall = &state->stall.episode[STALL_SRC_CPL];
+    pPkt_t          pkt;
+    int             len;
 
-    while (state->cpl_head_p != NULL && state->cpl_head_p->TimeStamp <= state->TicksSinceReset)
+    while ((pkt = state->cpl_head_p) != NULL && pkt->TimeStamp <= state->TicksSinceReset)
     {
-        tmp = state->cpl_head_p->NextPkt;
-        AddPktToQueue(state, state->cpl_head_p);
-        state->cpl_head_p = tmp;
+        len = TlpPayloadLen(pkt->data);
+
+        if (!CheckCredits(state->usrconf.DisableFc,
+                          flw->fc_state[0],
+                          flw->FlowCntlHdrCredits[0][FC_CMPL],
+                          flw->FlowCntlDataCredits[0][FC_CMPL],
+                          flw->TxHdrCredits[0][FC_CMPL],
+                          flw->TxDataCredits[0][FC_CMPL],
+                          len))
+        {
+            if (!stall->active)
+            {
+                StallBegin(state, STALL_SRC_CPL, FC_CMPL, len);
+            }
+            else if (state->usrconf.TrigConditions && (state->TicksSinceReset - stall->start) > state->usrconf.TrigStallCycles)
+            {
+                TrigEvent(state, TRIG_CREDIT_STALL);
+            }
+
+            break;
+        }
+
+        if (stall->active)
+        {
+            StallEnd(state, STALL_SRC_CPL);
+        }
+
+        state->cpl_head_p = pkt->NextPkt;
+        state->txq.depth[FC_CMPL]--;
+        TlpRelease(state, pkt, FC_CMPL);
     }
 }
 
 // -------------------------------------------------------------------------
-// checkBars()
+// TxQueueAdd()
 //
-// Check address against BARs. Returns true if within a configured
-// BARs region. Also returns true if this node's configuration space
-// or configuration space mask aren't configured, when all address
-// space is made available.
+// Add a posted or non-posted TLP to its FC type's transmit queue, in
+// issue order, first sending until there is space on the queue if it
+// is full. The arbiter (TxArbitrate()) releases it to the send queue.
+// Completions are queued on the completion delay queue instead.
 //
 // -------------------------------------------------------------------------
 
-static bool checkBars(const uint64_t addr, const uint32_t bytelen, const unsigned node)
+void TxQueueAdd (const pPcieModelState_t const state, const pPkt_t const packet, const int fc_type)
 {
-    uint64_t BAR;
-    uint64_t BARMASK;
-
-    bool ok_to_access = false;
-    unsigned locatable;
-
-    PktData_t buf[4];
-
-    // Go through all six  BARs
-    for (unsigned idx = 0; idx < 6; idx++)
-    {
-       // Read the first word of the BAR. Returns true if a config space configured.
-       if (ReadConfigSpaceBufChk(CFG_BAR_HDR_OFFSET + 4*idx, buf, 4, false, node))
-       {
-           locatable = (buf[0] >> 1) & 0x3;
-
-           // Set BAR lower address bits and mask lower type/locatable and prefetchable bits
-           BAR = ((uint64_t)buf[0] | ((uint64_t)buf[1] << 8) | ((uint64_t)buf[2] << 16) | ((uint64_t)buf[3] << 24)) & 0xfffffffffffffff0ULL;
-
-           if (locatable == CFG_BAR_LOCATABLE_64_BIT)
-           {
-               // Read the upper BAR bits and OR into BAR value
-               ReadConfigSpaceBufChk(CFG_BAR_HDR_OFFSET + 4 + 4*idx, buf, 4, false, node);
-               BAR = ((uint64_t)buf[0] <<  32) | ((uint64_t)buf[1] << 40) | ((uint64_t)buf[2] << 48) | ((uint64_t)buf[3] << 56);
-           }
-       }
-       // If no config space configured, always allow access
-       else
-       {
-           ok_to_access = true;
-           break;
-       }
-
-       // Read the first word of the BAR mask. Returns true if a config space mask configured.
-       if (ReadConfigSpaceMaskBufChk(CFG_BAR_HDR_OFFSET + 4*idx, buf, 4, false, node))
-       {
-           // Set BAR lower mask bits
-           BARMASK = (uint64_t)buf[0] | ((uint64_t)buf[1] << 8) | ((uint64_t)buf[2] << 16) | ((uint64_t)buf[3] << 24);
-
-           if (locatable == CFG_BAR_LOCATABLE_64_BIT)
-           {
-               // Read the upper BAR mask bits and OR into BAR mask value
-               ReadConfigSpaceMaskBufChk(CFG_BAR_HDR_OFFSET + 4 + 4*idx, buf, 4, false, node);
-               BARMASK = ((uint64_t)buf[0] <<  32) | ((uint64_t)buf[1] << 40) | ((uint64_t)buf[2] << 48) | ((uint64_t)buf[3] << 56);
-
-               // Skip over upper bits of 64-bit BAR
-               idx++;
-           }
-       }
-       else
-       {
-           // If no config space masks configured, always allow access
-           ok_to_access = true;
-           break;
-       }
-
-        // Calculate the length from the mask bits
-        uint64_t length = (BARMASK + 1) & ((locatable == CFG_BAR_LOCATABLE_64_BIT) ? 0xffffffffffffffffULL : 0x00000000ffffffffULL);
-
-        // Calculate end address of burst
-        uint64_t endaddr = addr + bytelen;
-
-        // Check if all addresses are within the BAR's range
-        if (addr >= BAR && addr < (BAR + length) && endaddr >= BAR && endaddr < (BAR + length))
-        {
-            // OK to access if it is.
-            ok_to_access = true;
-            break;
+    pTxQueueState_t txq = &state->txq;
+
+    while (txq->depth[fc_type] >= (uint32_t)state->usrconf.TxQueueDepth)
+    {
+        SendPacket(state->thisnode);
+    }
+
+    packet->NextPkt = NULL;
+    packet->Order   = txq->order++;
+
+    if (txq->head_p[fc_type] == NULL)
+    {
+        txq->head_p[fc_type] = packet;
+    }
+    else
+    {
+        txq->end_p[fc_type]->NextPkt = packet;
+    }
+    txq->end_p[fc_type] = packet;
+
+    txq->stats[fc_type].queued++;
+    if (++txq->depth[fc_type] > txq->stats[fc_type].max_depth)
+    {
+        txq->stats[fc_type].max_depth = txq->depth[fc_type];
+    }
+}
+
+// -------------------------------------------------------------------------
+// TxMayPass()
+//
+// Returns true if a queued non-posted request or completion may be sent
+// ahead of an older queued posted request, from the PCIe ordering rules.
+// A completion with Relaxed Ordering may pass, and a TLP with ID-Based
+// Ordering may pass if its requester ID (completer ID for a completion)
+// differs from the posted request's requester ID. Posted requests may
+// always pass non-posted requests and completions, and completions may
+// always pass non-posted requests, so these are not checked.
+//
+// -------------------------------------------------------------------------
+
+static bool TxMayPass (const PktData_t* const pkt, const int fc_type, const PktData_t* const posted)
+{
+    int  attr = GET_TLP_ATTR(pkt);
+    int  id   = (fc_type == FC_CMPL) ? GET_CPL_CID(pkt) : GET_TLP_RID(pkt);
+
+    if (fc_type == FC_CMPL && (attr & TLP_ATTR_RO))
+    {
+        return true;
+    }
+
+    return (attr & TLP_ATTR_IDO) && id != GET_TLP_RID(posted);
+}
+
+// -------------------------------------------------------------------------
+// TxArbitrate()
+//
+// The transmit queue arbiter. Releases TLPs from the heads of the
+// posted, non-posted and (once their process time is reached)
+// completion queues to the send queue, oldest first, whilst there are
+// enough credits. A TLP may be released ahead of an older TLP held for
+// credits if the ordering rules allow (TxMayPass()), so posted requests
+// never wait behind other types, and completions never wait behind
+// non-posted requests. A head held for credits is recorded as a credit
+// stall of its FC type.
+//
+// -------------------------------------------------------------------------
+
+void TxArbitrate (const pPcieModelState_t const state)
+{
+    pTxQueueState_t txq = &state->txq;
+    pFlowControl_t  flw = &state->flwcntl;
+    pPkt_t          head[FC_NUMTYPES], pkt;
+    int             fc_type, best, len;
+    bool            ok[FC_NUMTYPES];
+
+    do
+    {
+        head[FC_POST]    = txq->head_p[FC_POST];
+        head[FC_NONPOST] = txq->head_p[FC_NONPOST];
+        head[FC_CMPL]    = (state->cpl_head_p != NULL && state->cpl_head_p->TimeStamp <= state->TicksSinceReset) ? state->cpl_head_p : NULL;
+
+        // Flag the heads with credits, and track credit stalls
+        for (fc_type = 0; fc_type < FC_NUMTYPES; fc_type++)
+        {
+            pStallEpisode_t stall = &state->stall.episode[STALL_SRC_TXQ + fc_type];
+
+            if (head[fc_type] == NULL)
+            {
+                ok[fc_type] = false;
+                continue;
+            }
+
+            len         = TlpPayloadLen(head[fc_type]->data);
+            ok[fc_type] = CheckCredits(state->usrconf.DisableFc, flw->fc_state[0],
+                                       flw->FlowCntlHdrCredits[0][fc_type], flw->FlowCntlDataCredits[0][fc_type],
+                                       flw->TxHdrCredits[0][fc_type], flw->TxDataCredits[0][fc_type], len);
+
+            if (!ok[fc_type] && !stall->active)
+            {
+                StallBegin(state, STALL_SRC_TXQ + fc_type, fc_type, len);
+            }
+            else if (!ok[fc_type] && state->usrconf.TrigConditions && (state->TicksSinceReset - stall->start) > state->usrconf.TrigStallCycles)
+            {
+                TrigEvent(state, TRIG_CREDIT_STALL);
+            }
+            else if (ok[fc_type] && stall->active)
+            {
+                StallEnd(state, STALL_SRC_TXQ + fc_type);
+            }
+        }
+
+        // Non-posted requests and completions can only pass the older posted requests the ordering rules allow
+        for (fc_type = FC_NONPOST; fc_type <= FC_CMPL; fc_type++)
+        {
+            for (pkt = txq->head_p[FC_POST]; ok[fc_type] && pkt != NULL && (int32_t)(pkt->Order - head[fc_type]->Order) < 0; pkt = pkt->NextPkt)
+            {
+                ok[fc_type] = TxMayPass(head[fc_type]->data, fc_type, pkt->data);
+            }
+        }
+
+        // Release the oldest head that may go
+        best = -1;
+        for (fc_type = 0; fc_type < FC_NUMTYPES; fc_type++)
+        {
+            if (ok[fc_type] && (best < 0 || (int32_t)(head[fc_type]->Order - head[best]->Order) < 0))
+            {
+                best = fc_type;
+            }
+        }
+
+        if (best >= 0)
+        {
+            // Count passing an older head held for credits or by the ordering rules
+            for (fc_type = 0; fc_type < FC_NUMTYPES; fc_type++)
+            {
+                if (head[fc_type] != NULL && (int32_t)(head[fc_type]->Order - head[best]->Order) < 0)
+                {
+                    txq->stats[best].bypasses++;
+                    break;
+                }
+            }
+
+            if (best == FC_CMPL)
+            {
+                state->cpl_head_p = head[best]->NextPkt;
+            }
+            else
+            {
+                txq->head_p[best] = head[best]->NextPkt;
+            }
+
+            txq->depth[best]--;
+            TlpRelease(state, head[best], best);
         }
     }
+    while (best >= 0);
+}
+
+// -------------------------------------------------------------------------
+// TagPoolInit()
+//
+// Fill the tag pool with the configured number of tags, from tag 0 for
+// 8-bit tags, or from tag 256 for 10-bit tags (CONFIG_TAG_10BIT)
+//
+// -------------------------------------------------------------------------
+
+void TagPoolInit (const pPcieModelState_t const state)
+{
+    pTagState_t tags  = &state->tags;
+    int         base  = state->usrconf.Tag10Bit ? TAG_MAX_8BIT : 0;
+    int         avail = (state->usrconf.Tag10Bit ? TAG_MAX_10BIT : TAG_MAX_8BIT) - base;
+    int         size  = (state->usrconf.TagPoolSize && state->usrconf.TagPoolSize < avail) ? state->usrconf.TagPoolSize : avail;
 
-    return ok_to_access;
+    for (int tag = 0; tag < TAG_TABLE_SIZE; tag++)
+    {
+        tags->table[tag].pooled = false;
+    }
+
+    for (int idx = 0; idx < size; idx++)
+    {
+        tags->pool[idx] = (uint16_t)(base + idx);
+    }
+
+    tags->pool_size = size;
+    tags->pool_rd   = 0;
+    tags->pool_num  = size;
+}
+
+// -------------------------------------------------------------------------
+// TagAlloc()
+//
+// Take the next free tag from the pool, marking it as in use. Returns
+// -1 if the pool is empty.
+//
+// -------------------------------------------------------------------------
+
+int TagAlloc (const pPcieModelState_t const state)
+{
+    pTagState_t tags = &state->tags;
+    pTagEntry_t entry;
+    int         tag;
+
+    while (tags->pool_num)
+    {
+        tag           = tags->pool[tags->pool_rd];
+        tags->pool_rd = (tags->pool_rd + 1) % TAG_TABLE_SIZE;
+        tags->pool_num--;
+
+        entry         = &tags->table[tag];
+        entry->pooled = true;
+
+        // A tag in use from an explicit tag request returns to the pool on completion
+        if (!entry->busy)
+        {
+            entry->busy = true;
+            tags->stats.allocated++;
+            if (++tags->stats.outstanding > tags->stats.max_outstanding)
+            {
+                tags->stats.max_outstanding = tags->stats.outstanding;
+            }
+
+            return tag;
+        }
+    }
+
+    return -1;
+}
+
+// -------------------------------------------------------------------------
+// TagIssue()
+//
+// Record a non-posted request of the given type (LAT_xxx) in the
+// outstanding request table, time stamped for latency statistics.
+// A request with an explicit tag still outstanding replaces the
+// earlier request.
+//
+// -------------------------------------------------------------------------
+
+void TagIssue (const pPcieModelState_t const state, const int type, const int tag, const uint64_t addr, const int length)
+{
+    pTagState_t tags  = &state->tags;
+    pTagEntry_t entry = &tags->table[tag];
+
+    if (!entry->busy)
+    {
+        entry->busy = true;
+        if (++tags->stats.outstanding > tags->stats.max_outstanding)
+        {
+            tags->stats.max_outstanding = tags->stats.outstanding;
+        }
+    }
+
+    entry->req.type      = type;
+    entry->req.addr      = addr;
+    entry->req.length    = length;
+    entry->req.remaining = length;
+    entry->req.issued    = state->TicksSinceReset;
+
+    tags->last           = tag;
+}
+
+// -------------------------------------------------------------------------
+// TagComplete()
+//
+// Match a received completion to its outstanding request, updating the
+// bytes remaining. On the final completion, the request's latency is
+// added to the statistics and its tag freed, returning to the pool if
+// a pool tag. Completions with no outstanding request are counted as
+// unmatched.
+//
+// -------------------------------------------------------------------------
+
+void TagComplete (const pPcieModelState_t const state, const int tag, const uint32_t remaining, const bool last)
+{
+    pTagState_t tags  = &state->tags;
+    pTagEntry_t entry = &tags->table[tag];
+
+    if (!entry->busy)
+    {
+        tags->stats.unmatched++;
+        return;
+    }
+
+    entry->req.remaining = last ? 0 : remaining;
+
+    if (last)
+    {
+        LatencyComplete(state, &entry->req);
+
+        entry->busy = false;
+        tags->stats.outstanding--;
+
+        if (entry->pooled)
+        {
+            entry->pooled = false;
+            tags->pool[(tags->pool_rd + tags->pool_num) % TAG_TABLE_SIZE] = (uint16_t)tag;
+            tags->pool_num++;
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// RxPktMalformed()
+//
+// Returns true if a received packet's length, up to and including the
+// END/EDB, doesn't match that expected from its type and header, as
+// when symbols have been corrupted on the link.
+//
+// -------------------------------------------------------------------------
+
+static bool RxPktMalformed (const pPkt_t const pkt)
+{
+    int rx_len, lcrc_offset;
+
+    for (rx_len = 0; pkt->data[rx_len] != PKT_TERMINATION; rx_len++)
+        ;
+
+    if (pkt->seq == DLLP_SEQ_ID)
+    {
+        return rx_len != RX_DLLP_SYMBOLS;
+    }
+
+    if (rx_len < RX_TLP_MIN_SYMBOLS)
+    {
+        return true;
+    }
+
+    lcrc_offset = 15 + 4 * (((pkt->data[TLP_TYPE_BYTE_OFFSET] & TL_TYPE_WRITE) ? GET_TLP_LENGTH(pkt->data) : 0) +
+                            (TLP_HAS_DIGEST(pkt->data) ? 1 : 0) + TLP_HDR_4DW(pkt->data));
+
+    return rx_len != lcrc_offset + LCRC_TERMINATION_LOOKAHEAD;
 }
 
 // -------------------------------------------------------------------------
@@ -497,12 +883,45 @@ static void ProcessInput (const pPcieModelState_t const state, const pPkt_t cons
     uint64_t addr;
     uint32_t length, rid, cid, tag, fbe, lbe, byte_count;
     PktData_t buff[MAX_BYTE_BLOCK], *pdata;
-    int status;
+    int status, func;
     pFlowControl_t flw = &(state->flwcntl);
 
     // Set an optimistic packet status
     status = PKT_STATUS_GOOD;
 
+    // Capture the packet before any CRCs are recalculated
+    TracePkt(state, pkt, true);
+
+    // Discard a malformed packet before its fields are used, NAK'ing a TLP
+    if (RxPktMalformed(pkt))
+    {
+        if (pkt->seq == DLLP_SEQ_ID)
+        {
+            status = PKT_STATUS_BAD_DLLP_CRC;
+        }
+        else
+        {
+            VPrint("ProcessInput: Info --- %sMalformed Tlp%s. Sending NAK from node %d\n", fmterrstr, fmtnormstr, state->thisnode);
+            TrigEvent(state, TRIG_BAD_LCRC);
+            if (!state->usrconf.DisableAck)
+            {
+                SendNak ((state->next_rcv_seq - 1) & SEQ_MASK, state->thisnode);
+            }
+            status = PKT_STATUS_BAD_LCRC;
+        }
+
+        if (state->vuser_cb != NULL)
+        {
+            (state->vuser_cb)(pkt, status, state->usrptr);
+        }
+        else
+        {
+            CheckFree(pkt->data);
+            CheckFree(pkt);
+        }
+        return;
+    }
+
     // DLLP
     if (pkt->seq == DLLP_SEQ_ID)
     {
@@ -703,9 +1122,10 @@ static void ProcessInput (const pPcieModelState_t const state, const pPkt_t cons
             else
             {
                 VPrint("ProcessInput: Info --- %sTlp LCRC failure%s. Sending NAK from node %d\n", fmterrstr, fmtnormstr, state->thisnode);
+                TrigEvent(state, TRIG_BAD_LCRC);
                 if (!state->usrconf.DisableAck)
                 {
-                    SendNak (pkt->seq, state->thisnode);
+                    SendNak ((state->next_rcv_seq - 1) & SEQ_MASK, state->thisnode);
                 }
                 status |= PKT_STATUS_BAD_LCRC;
             }
@@ -742,10 +1162,34 @@ static void ProcessInput (const pPcieModelState_t const state, const pPkt_t cons
             return;
         }
 
-        // Good CRC, so send an Ack
+        // Good CRC. If the expected sequence number, accept and send an Ack.
+        // Discard a duplicate (e.g. replayed after a lost Ack), acknowledging
+        // the last good TLP again, or a TLP beyond the expected sequence
+        // number, after a lost TLP, and send a Nak.
         if (!state->usrconf.DisableAck)
         {
-            SendAck (pkt->seq, state->thisnode);
+            if ((uint32_t)pkt->seq == state->next_rcv_seq)
+            {
+                state->next_rcv_seq = (state->next_rcv_seq + 1) & SEQ_MASK;
+                SendAck (pkt->seq, state->thisnode);
+            }
+            else
+            {
+                if (SEQ_LT(pkt->seq, state->next_rcv_seq))
+                {
+                    SendAck ((state->next_rcv_seq - 1) & SEQ_MASK, state->thisnode);
+                }
+                else
+                {
+                    VPrint("ProcessInput: Info --- %sTlp sequence error (%d, expected %d)%s. Sending NAK from node %d\n",
+                           fmterrstr, pkt->seq, state->next_rcv_seq, fmtnormstr, state->thisnode);
+                    SendNak ((state->next_rcv_seq - 1) & SEQ_MASK, state->thisnode);
+                }
+
+                CheckFree(pkt->data);
+                CheckFree(pkt);
+                return;
+            }
         }
 
         // If mem write ...
@@ -768,8 +1212,10 @@ static void ProcessInput (const pPcieModelState_t const state, const pPkt_t cons
             length     = GET_TLP_LENGTH(pkt->data);
 
             // Check if address is ok to to use
-            if (checkBars(addr, length*4, state->thisnode))
+            if (CheckBarAccess(addr, length*4, NULL, state->thisnode))
             {
+                CplProfileWrite(state, addr, length*4);
+
                 pdata  = (type == TL_MWR32) ? &(pkt->data[TLP_DATA_OFFSET32]) : &(pkt->data[TLP_DATA_OFFSET64]);
                 fbe    = GET_TLP_FBE(pkt->data);
                 lbe    = GET_TLP_LBE(pkt->data);
@@ -804,12 +1250,14 @@ static void ProcessInput (const pPcieModelState_t const state, const pPkt_t cons
             fbe        = GET_TLP_FBE(pkt->data);
             lbe        = GET_TLP_LBE(pkt->data);
             rid        = GET_TLP_RID(pkt->data);
-            cid        = state->CplId;
             tag        = GET_TLP_TAG(pkt->data);
 
             // Check address is good for an access
-            if (checkBars(addr, length*4, state->thisnode))
+            if (CheckBarAccess(addr, length*4, &func, state->thisnode))
             {
+                // Completer is the function owning the matched BAR
+                cid = CPL_FUNC_ID(state->CplId, func);
+
                 if (ReadRamByteBlock (addr, buff, length*4, state->thisnode))
                 {
                     VPrint("ProcessInput: %s***Error --- ReadRamByteBlock for address %llx returned bad status at node %d%s\n", fmterrstr, (long long unsigned)addr, state->thisnode, fmtnormstr);
@@ -817,11 +1265,33 @@ static void ProcessInput (const pPcieModelState_t const state, const pPkt_t cons
                 }
 
                 int rlen = (length ? length : MAX_PAYLOAD_BYTES/4);
-                PartCompletionLockDelay(addr, buff, CPL_SUCCESS, fbe, lbe, rlen, rlen, tag, cid, rid, is_locked, gen_cmpl_ecrc, state->usrconf.CompletionRate, true, state->thisnode);
+                CplProfileRead(state, addr, rlen*4);
+                CplProfileState_t read = state->cplprof;
+
+                // Completions have the request's ordering attributes
+                state->CplAttr = GET_TLP_ATTR(pkt->data);
+
+                // Split into completions of no more than the max payload size, with
+                // each but the last ending on a read completion boundary
+                for (int offset = 0, plen; offset < rlen*4; offset += plen*4)
+                {
+                    uint64_t paddr = addr + offset;
+                    uint64_t pend  = (paddr + state->usrconf.CplMaxPayload) & ~((uint64_t)state->usrconf.ReadCplBoundary - 1);
+
+                    plen = (pend < (addr + rlen*4)) ? (int)((pend - paddr)/4) : rlen - offset/4;
+
+                    // Always via the completion scheduler, as credits can't be waited for whilst processing input
+                    CplProfilePart(state, &read, offset + plen*4);
+                    PartCompletionLockDelay(paddr, &buff[offset], CPL_SUCCESS, offset ? 0xf : fbe, lbe, rlen - offset/4, plen, tag, cid, rid, is_locked,
+                                            gen_cmpl_ecrc, true, true, state->thisnode);
+                }
+
+                state->CplAttr = 0;
             }
             else
             {
-                PartCompletionLockDelay(0, NULL, CPL_UNSUPPORTED, 0x0, 0x0, 0, 0, tag, cid, rid, is_locked, gen_cmpl_ecrc, state->usrconf.CompletionRate, true, state->thisnode);
+                cid = state->CplId;
+                PartCompletionLockDelay(0, NULL, CPL_UNSUPPORTED, 0x0, 0x0, 0, 0, tag, cid, rid, is_locked, gen_cmpl_ecrc, true, true, state->thisnode);
             }
 
             CheckFree(pkt->data);
@@ -832,8 +1302,18 @@ static void ProcessInput (const pPcieModelState_t const state, const pPkt_t cons
         else if (type == TL_CPLD || type == TL_CPL || type == TL_CPLLK || type == TL_CPLDLK)
         {
             byte_count = GET_CPL_BYTECOUNT(pkt->data);
+            byte_count = byte_count ? byte_count : MAX_PAYLOAD_BYTES;   // Zero byte count is 4096
             length     = GET_TLP_LENGTH(pkt->data);
 
+            bool last  = (type == TL_CPL) || (type == TL_CPLLK) || (length*4) >= byte_count;
+
+            // Bytes of the request left after this completion's payload, which
+            // starts at the DW holding the completion's lower address
+            uint32_t delivered = length*4 - (GET_CPL_LOW_ADDR(pkt->data) & ADDR_DW_OFFSET_MASK);
+            uint32_t remaining = (byte_count > delivered) ? byte_count - delivered : 0;
+
+            tag = GET_CPL_TAG(pkt->data);
+
             // Return read data to user process, if registered. Otherwise discard
             if (state->vuser_cb != NULL)
             {
@@ -844,8 +1324,12 @@ static void ProcessInput (const pPcieModelState_t const state, const pPkt_t cons
                 CheckFree(pkt->data);
                 CheckFree(pkt);
             }
+            // Match to the outstanding request, after the user callback so the
+            // request details are available to it (GetOutstandingRequest())
+            TagComplete(state, tag, remaining, last);
+
             // If a last completion increment the completion event counter
-            if ((type == TL_CPL) || (type == TL_CPLLK) || (length*4) >= byte_count)
+            if (last)
             {
                 state->CompletionEvent++;
             }
@@ -860,23 +1344,32 @@ static void ProcessInput (const pPcieModelState_t const state, const pPkt_t cons
             pdata             = &(pkt->data[TLP_DATA_OFFSET32]);
             fbe               = GET_TLP_FBE(pkt->data);
             rid               = GET_TLP_RID(pkt->data);
-            cid               = state->CplId;
             tag               = GET_TLP_TAG(pkt->data);
 
-            if (type == TL_CFGRD0)
+            // Type 0 accesses select the target function's config space with the device/function number.
+            // The request is for this device, whatever its bus number, so the bus isn't part of the index.
+            func              = CFG_ADDR_FUNC(addr);
+            cid               = CPL_FUNC_ID(state->CplId, func);
+
+            // Functions other than 0 only exist if they have been given a config space
+            if (func != 0 && !ConfigSpaceFuncPresent(func, state->thisnode))
+            {
+                PartCompletionDelay(0, NULL, CPL_UNSUPPORTED, 0x0, 0x0, 0, 0, tag, cid, rid, gen_cmpl_ecrc, true, true, state->thisnode);
+            }
+            else if (type == TL_CFGRD0)
             {
                 // Read a word (4 bytes) from the config space and put in buffer
-                ReadConfigSpaceBuf((uint32_t)(addr & 0xfff), buff, 4, state->thisnode);
+                ReadConfigSpaceBuf(CFG_FUNC_ADDR(func, addr), buff, 4, state->thisnode);
 
-                PartCompletionDelay(0, buff, CPL_SUCCESS, 0xf, 0x0, 1, 1, tag, cid, rid, gen_cmpl_ecrc, state->usrconf.CompletionRate, true, state->thisnode);
+                PartCompletionDelay(0, buff, CPL_SUCCESS, 0xf, 0x0, 1, 1, tag, cid, rid, gen_cmpl_ecrc, true, true, state->thisnode);
             }
             else
             {
                 // The device completer ID is always updated on config writes
                 state->CplId = GET_CFG_CID(pkt->data);
-                WriteConfigSpaceBuf((uint32_t)(addr & 0xfff), pdata, fbe, 0, 4, true, state->thisnode);
+                WriteConfigSpaceBuf(CFG_FUNC_ADDR(func, addr), pdata, fbe, 0, 4, true, state->thisnode);
 
-                PartCompletionDelay(0, buff, CPL_SUCCESS, 0xf, 0x0, 0, 0, tag, cid, rid, gen_cmpl_ecrc, state->usrconf.CompletionRate, true, state->thisnode);
+                PartCompletionDelay(0, buff, CPL_SUCCESS, 0xf, 0x0, 0, 0, tag, cid, rid, gen_cmpl_ecrc, true, true, state->thisnode);
             }
 
             CheckFree(pkt->data);
@@ -900,7 +1393,7 @@ static void ProcessInput (const pPcieModelState_t const state, const pPkt_t cons
                (type & DL_ROUTE_MASK) != TL_MSG && (type & DL_ROUTE_MASK) != TL_MSGD &&
                 type != TL_MWR32 && type != TL_MWR64 && type != TL_MRD32 && type != TL_MRD64 && type != TL_MRDLCK32 && type != TL_MRDLCK64)
             {
-                PartCompletionDelay(0, NULL, CPL_UNSUPPORTED, 0x0, 0x0, 0, 0, tag, cid, rid, gen_cmpl_ecrc, state->usrconf.CompletionRate, true, state->thisnode);
+                PartCompletionDelay(0, NULL, CPL_UNSUPPORTED, 0x0, 0x0, 0, 0, tag, cid, rid, gen_cmpl_ecrc, true, true, state->thisnode);
             }
 
             // Return unsupported packet to user process, if one registered. Otherwise discard.
@@ -994,6 +1487,7 @@ static void ProcessOS(const pPcieModelState_t const state,
             }
 
             DispOS(state, type, ts_data, lane, true, node);
+            TraceOS(state, type, ts_data, lane, true, node);
         }
     }
 }
@@ -1044,91 +1538,6 @@ uint32_t CalcNewRand(const unsigned int Seed)
      return NewNum;
 }
 
-// -------------------------------------------------------------------------
-// PcieCompare()
-//
-// Routine used by qsort for reording completion requests.
-//
-// -------------------------------------------------------------------------
-
-static int PcieCompare (const void *p1, const void *p2)
-{
-    pPkt_t pkt1, pkt2;
-
-    pkt1 = (pPkt_t)p1;
-    pkt2 = (pPkt_t)p2;
-
-    if (pkt1->TimeStamp > pkt2->TimeStamp)
-    {
-        return (1);
-    }
-    else if (pkt1->TimeStamp < pkt2->TimeStamp)
-    {
-        return (-1);
-    }
-
-    return (0);
-}
-
-// -------------------------------------------------------------------------
-// PcieSortQueue()
-//
-// Reorders the completion delay queue by timestamp,
-// modified by AddPktToQueueDelay() to give a processing
-// time rather than a creation time.
-//
-// -------------------------------------------------------------------------
-
-static pPkt_t PcieSortQueue (const pPkt_t const head_p, pPkt_t* end, const int node)
-{
-    pPkt_t array[MAX_HDR_CREDITS+1], tmp_p, newhead_p;
-    int idx = 0, len;
-
-    tmp_p = head_p;
-
-    // Troll through linked list, placing pointers into an array
-    while(tmp_p != NULL && idx < (MAX_HDR_CREDITS+1))
-    {
-        array[idx++] = tmp_p;
-        tmp_p = tmp_p->NextPkt;
-    }
-
-    // Check we haven't overflowed
-    if (idx == (MAX_HDR_CREDITS+1) && tmp_p != NULL)
-    {
-        VPrint("PcieSortQueue(): %s***Error --- completion queue overflow%s\n", fmterrstr, fmtnormstr);
-        VWrite(PVH_FATAL, 0, 0, node);
-    }
-
-    // If less than 2 elements, no need to sort
-    if (idx <= 1)
-    {
-        return head_p;
-    }
-
-    len = idx;
-
-    // Perform sorting
-    qsort ((void *)array, len, sizeof(pPkt_t), PcieCompare);
-
-    // Reconstruct list
-    newhead_p = array[0];
-    for (idx = 0; idx < len; idx++)
-    {
-        if (idx < (len-1))
-        {
-            array[idx]->NextPkt = array[idx+1];
-        }
-        else
-        {
-            array[idx]->NextPkt = NULL;
-            *end = array[idx];
-        }
-    }
-
-    return newhead_p;
-}
-
 // -------------------------------------------------------------------------
 // CalcByteCount()
 //
@@ -1174,119 +1583,34 @@ int CalcLoAddr (const int fbe)
 // -------------------------------------------------------------------------
 // CalcBe()
 //
-// Returns the 8 bit LBE/FBE TLP header field, based on
-// address and byte length.
-//
-// -------------------------------------------------------------------------
-
-int CalcBe (const int inaddr, const int byte_len)
-{
-    int val, endpos;
-    int addr = inaddr & 0x3;
-
-    endpos = addr + byte_len;
-
-    // First BE
-    val = (0xf << (addr & 0x3)) & 0xf;
-
-    // Only one double word---combine start and end BEs
-    if (endpos <= 4)
-    {
-        val &= 0xf >> (4-endpos);
-    // More than one DW
-    }
-    else
-    {
-        endpos %= 4;
-        endpos += endpos ? 0 : 4;
-        val |= (0xf0 >> (4-endpos)) & 0xf0;
-    }
-    return val;
-}
-
-// -------------------------------------------------------------------------
-// CalcDllpCrc()
-//
-// 16 bit CRC calculator, based on a polynomial of 0x100b
-//
-// -------------------------------------------------------------------------
-
-void CalcDllpCrc(PktData_t *dllp)
-{
-    uint32_t Crc=DLLP_CRC_INITIAL_VALUE;
-    uint32_t Data;
-    int i;
-
-    for (i = 1; i < 5; i++)
-    {
-        Data = (uint32_t)dllp[i];
-        Crc = PciCrc(Data, Crc, 8, DLLPPOLY, DLLPCRCSIZE);
-    }
-
-    dllp[DLLP_CRC_OFFSET]   = (PktData_t)Bitrev8[(Crc >> 8) & BYTE_MASK] ^ BYTE_MASK;
-    dllp[DLLP_CRC_OFFSET+1] = (PktData_t)Bitrev8[(Crc >> 0) & BYTE_MASK] ^ BYTE_MASK;
-}
-
-// -------------------------------------------------------------------------
-// CalcEcrc()
-//
-// 32 bit CRC calculator, masking variant fields for ECRC.
-// Input is a pointer to a data packet (with blank ECRC).
-//
-// -------------------------------------------------------------------------
-
-void CalcEcrc(PktData_t *pkt)
-{
-    int i = TLP_TYPE_BYTE_OFFSET;
-    uint32_t Crc = TLP_CRC_INITIAL_VALUE;
-    uint32_t InvariantMask;
-
-    if ((pkt[TLP_TD_BYTE_OFFSET] & TLP_DIGEST_MASK) == 0)
-    {
-        DebugVPrint( "CalcEcrc(): Warning --- Digest bit not set. Not adding Ecrc.\n");
-        return;
-    }
-
-    // Terminate CRC generation on the byte before the ECRC position
-    while (pkt[i + ECRC_TERMINATION_LOOKAHEAD] != PKT_TERMINATION)
-    {
-        InvariantMask = (i == TLP_TYPE_BYTE_OFFSET) ? TLP_TYPE_VARIANT_BIT : (i == TLP_EP_BYTE_OFFSET) ? TLP_EP_VARIANT_BIT : 0;
-        Crc = PciCrc ((uint32_t)pkt[i] | InvariantMask, Crc, 8, TLPPOLY, TLPCRCSIZE);
-        i++;
-    }
-
-    // Add CRC to packet
-    pkt[i++] = (PktData_t)Bitrev8[(Crc >> 24) & BYTE_MASK] ^ BYTE_MASK;
-    pkt[i++] = (PktData_t)Bitrev8[(Crc >> 16) & BYTE_MASK] ^ BYTE_MASK;
-    pkt[i++] = (PktData_t)Bitrev8[(Crc >>  8) & BYTE_MASK] ^ BYTE_MASK;
-    pkt[i++] = (PktData_t)Bitrev8[(Crc >>  0) & BYTE_MASK] ^ BYTE_MASK;
-}
-
-// -------------------------------------------------------------------------
-// CalcLcrc()
-//
-// 32 bit LCRC generator. Inputs is a pointer to a packet,
-// with pre-calculated ECRC (if applicable).
+// Returns the 8 bit LBE/FBE TLP header field, based on
+// address and byte length.
 //
 // -------------------------------------------------------------------------
 
-void CalcLcrc(PktData_t *pkt)
+int CalcBe (const int inaddr, const int byte_len)
 {
-    int i = DLLP_SEQ_OFFSET;
-    uint32_t Crc = TLP_CRC_INITIAL_VALUE;
+    int val, endpos;
+    int addr = inaddr & 0x3;
+
+    endpos = addr + byte_len;
+
+    // First BE
+    val = (0xf << (addr & 0x3)) & 0xf;
 
-    // Termintate CRC calculation at byte before LCRC position
-    while (pkt[i + LCRC_TERMINATION_LOOKAHEAD] != PKT_TERMINATION)
+    // Only one double word---combine start and end BEs
+    if (endpos <= 4)
     {
-        Crc = PciCrc ((uint32_t)pkt[i], Crc, 8, TLPPOLY, TLPCRCSIZE);
-        i++;
+        val &= 0xf >> (4-endpos);
+    // More than one DW
     }
-
-    // Add CRC to packet
-    pkt[i++] = (PktData_t)Bitrev8[(Crc >> 24) & BYTE_MASK] ^ BYTE_MASK;
-    pkt[i++] = (PktData_t)Bitrev8[(Crc >> 16) & BYTE_MASK] ^ BYTE_MASK;
-    pkt[i++] = (PktData_t)Bitrev8[(Crc >>  8) & BYTE_MASK] ^ BYTE_MASK;
-    pkt[i++] = (PktData_t)Bitrev8[(Crc >>  0) & BYTE_MASK] ^ BYTE_MASK;
+    else
+    {
+        endpos %= 4;
+        endpos += endpos ? 0 : 4;
+        val |= (0xf0 >> (4-endpos)) & 0xf0;
+    }
+    return val;
 }
 
 // -------------------------------------------------------------------------
@@ -1696,8 +2020,86 @@ int CheckCredits(const int DisableFc, const uint32_t fc_state, const uint32_t hd
                  const uint32_t tx_hdr, const uint32_t tx_data, const int payload_len)
 {
     return (DisableFc || ((((hdr_credits - tx_hdr) > 0) || !hdr_credits) /* && (fc_state == INITFC_FI2)*/  &&
-           (((data_credits - tx_data) >= (payload_len/4 + ((payload_len%4)?1:0))) || !data_credits)));
+           (((data_credits - tx_data) >= (uint32_t)(payload_len/4 + ((payload_len%4)?1:0))) || !data_credits)));
+
+}
+
+// -------------------------------------------------------------------------
+// AckNakLatency()
+//
+// Returns the spec's AckNak latency limit, in symbol times, for the
+// link width and max payload size (CONFIG_CPL_MAX_PAYLOAD):
+//
+//   ((MPS + TLP overhead) * ack factor / width) + internal delay
+//
+// with the ack factor (in tenths) from the spec's table. Widths are
+// rounded down to the nearest in the table.
+//
+// -------------------------------------------------------------------------
+
+uint32_t AckNakLatency (const pPcieModelState_t const state)
+{
+    int mps   = state->usrconf.CplMaxPayload;
+    int width = state->LinkWidth;
+    int factor;
+
+    width = (width >= 32) ? 32 : (width >= 16) ? 16 : (width >= 12) ? 12 : (width >= 8) ? 8 :
+            (width >= 4)  ? 4  : (width >= 2)  ? 2  : 1;
+
+    if (mps <= 256)
+    {
+        factor = (width <= 4) ? 14 : (width == 8) ? 25 : 30;
+    }
+    else
+    {
+        factor = (width <= 8) ? 10 : 20;
+    }
+
+    return ((mps + ACK_TLP_OVERHEAD) * factor) / (width * 10) + ACK_INTERNAL_DELAY;
+}
+
+// -------------------------------------------------------------------------
+// AckNakDue()
+//
+// Returns true if the AckNak latency timer, started when the pending
+// ACK or NAK was first scheduled, has expired for the configured policy
+//
+// -------------------------------------------------------------------------
+
+bool AckNakDue (const pPcieModelState_t const state, const uint32_t pending_since)
+{
+    uint32_t elapsed = GetCycleCount(state->thisnode) - pending_since;
+
+    switch (state->usrconf.AckPolicy)
+    {
+    case ACK_POLICY_IMMEDIATE:
+        return true;
+
+    case ACK_POLICY_SPEC:
+        return elapsed >= AckNakLatency(state);
+
+    default:
+        return elapsed > (uint32_t)state->usrconf.AckRate;
+    }
+}
+
+// -------------------------------------------------------------------------
+// ReplayTimerLimit()
+//
+// Returns the REPLAY_TIMER limit, in cycles. The spec's formula is
+// three times the AckNak latency (with no L0s adjustment), unless a
+// limit is configured (CONFIG_REPLAY_TIMEOUT).
+//
+// -------------------------------------------------------------------------
+
+uint32_t ReplayTimerLimit (const pPcieModelState_t const state)
+{
+    if (state->usrconf.ReplayTimeout == REPLAY_TIMEOUT_SPEC)
+    {
+        return REPLAY_TIMER_FACTOR * AckNakLatency(state);
+    }
 
+    return state->usrconf.ReplayTimeout;
 }
 
 // -------------------------------------------------------------------------
@@ -1720,8 +2122,14 @@ void InitPcieState(const pPcieModelState_t const state, const int node)
     state->cpl_head_p    = NULL;
     state->head_p        = state->send_p        = state->end_p = NULL;
     state->ack_to_send_p = state->nak_to_send_p = NULL;
+    state->dllp_head_p   = state->dllp_end_p    = NULL;
     state->curr_ack      = state->curr_nak      = NULLACK;
     state->seq           = 0;
+    state->CplAttr       = 0;
+
+    memset(&state->txq, 0, sizeof(TxQueueState_t));
+    memset(&state->tags, 0, sizeof(TagState_t));
+    state->tags.last = TAG_AUTO;
 
     for (fc_vc = 0; fc_vc < NUM_VIRTUAL_CHANNELS; fc_vc++)
     {
@@ -1767,6 +2175,8 @@ void InitPcieState(const pPcieModelState_t const state, const int node)
     usrconf->DataConsumptionRate  = DEFAULT_DFC_CONSUMPTION_RATE;
     usrconf->CompletionRate       = DEFAULT_COMPLETION_RATE;
     usrconf->CompletionSpread     = DEFAULT_COMPLETION_SPREAD;
+    usrconf->CplMaxPayload        = DEFAULT_CPL_MAX_PAYLOAD;
+    usrconf->ReadCplBoundary      = DEFAULT_READ_CPL_BOUNDARY;
     usrconf->DisableMem           = 0;
     usrconf->DisableAck           = 0;
     usrconf->DisableFc            = 0;
@@ -1778,12 +2188,30 @@ void InitPcieState(const pPcieModelState_t const state, const int node)
     usrconf->DisableCrcChk        = 0;
     usrconf->SkipInterval         = DEFAULT_SKIP_INTERVAL;
     usrconf->AckRate              = DEFAULT_ACK_RATE;
+    usrconf->AckPolicy            = ACK_POLICY_CUSTOM;
+    usrconf->ReplayTimeout        = REPLAY_TIMEOUT_SPEC;
+    usrconf->ReplayRetrain        = false;
+    usrconf->FcPolicy             = FC_POLICY_DEFAULT;
+    usrconf->FcHdrWatermark       = DEFAULT_FC_HDR_WATERMARK;
+    usrconf->FcDataWatermark      = DEFAULT_FC_DATA_WATERMARK;
+    usrconf->FcUpdateTime         = DEFAULT_FC_TIME;
+    usrconf->TxQueueDepth         = DEFAULT_TX_QUEUE_DEPTH;
+    usrconf->TxAttr               = 0;
+    usrconf->Tag10Bit             = false;
+    usrconf->TagPoolSize          = 0;
     usrconf->ContDispIdx          = 0;
     usrconf->ActiveContDisp       = 0;
+    usrconf->NumDispFilters       = 0;
+    usrconf->DispFilterFields     = 0;
+    usrconf->TrigConditions       = 0;
+    usrconf->TrigStallCycles      = TRIG_DEFAULT_STALL;
+    usrconf->TrigHistory          = TRIG_DEFAULT_HISTORY;
+    usrconf->TrigPost             = TRIG_DEFAULT_POST;
     usrconf->BackNodeNum          = node ^ 1; // Assumes connected devices are one node apart
 
     ContDisp(usrconf, node);
 
+    TagPoolInit(state);
 
     state->RandNum                = node;
 
@@ -1793,6 +2221,7 @@ void InitPcieState(const pPcieModelState_t const state, const int node)
     state->CplId                  = 0;
 
     state->vuser_os_cb            = NULL;
+    state->vuser_fc_cb            = NULL;
 
     state->OutstandingCompletions = 0;
 
@@ -1841,15 +2270,6 @@ void AddPktToQueue(const pPcieModelState_t const state, const pPkt_t const packe
             state->send_p = packet;
         }
 
-        if (state->AckHolder.NextPkt == NULL)
-        {
-            state->AckHolder.NextPkt = packet;
-        }
-        if (state->NakHolder.NextPkt == NULL)
-        {
-            state->NakHolder.NextPkt = packet;
-        }
-
         // Point current end of queue NextPkt pointer to
         // the new packet, and then update end_p to the
         // added packet.
@@ -1858,6 +2278,69 @@ void AddPktToQueue(const pPcieModelState_t const state, const pPkt_t const packe
     }
 }
 
+// -------------------------------------------------------------------------
+// AddPktToDllpQueue()
+//
+// DLLP packet pointer added to end of the DLLP priority queue.
+// SendPacket() sends DLLPs on this queue at the next packet
+// boundary, ahead of packets on the send queue, and frees them
+// once sent, as they are not retried.
+//
+// -------------------------------------------------------------------------
+
+void AddPktToDllpQueue(const pPcieModelState_t const state, const pPkt_t const packet)
+{
+    packet->NextPkt = NULL;
+
+    if (state->dllp_head_p == NULL)
+    {
+        state->dllp_head_p = packet;
+    }
+    else
+    {
+        state->dllp_end_p->NextPkt = packet;
+    }
+
+    state->dllp_end_p = packet;
+}
+
+// -------------------------------------------------------------------------
+// CreateFcPkt()
+//
+// Create a flow control DLLP packet, with the given DLLP encoding
+// (type and VC) and credits.
+//
+// -------------------------------------------------------------------------
+
+pPkt_t CreateFcPkt(const int Encoding, const int hdrfc, const int datafc, const int node)
+{
+    PktData_t *pkt_p, *data_p;
+    pPkt_t packet;
+
+    pkt_p = CreateDllpTemplate (Encoding, &data_p);
+
+    data_p[0] = (PktData_t)(hdrfc >> 2) & 0x3f;
+    data_p[1] = (PktData_t)(((hdrfc & 0x3) << 6) | ((datafc >> 8) & 0xf));
+    data_p[2] = (PktData_t)(datafc & BYTE_MASK);
+
+    // Calc CRC
+    CalcDllpCrc(pkt_p);
+
+    if ((packet = calloc(1, sizeof(sPkt_t))) == NULL)
+    {
+        VPrint( "CreateFcPkt: %s***Error --- memory allocation failed at node %d%s\n", fmterrstr, node, fmtnormstr);
+        VWrite(PVH_FATAL, 0, 0, node);
+    }
+
+    packet->NextPkt = NULL;
+    packet->data = pkt_p;
+    packet->seq = DLLP_SEQ_ID;
+    packet->Retry = 0;
+    packet->ByteCount = 8;
+
+    return packet;
+}
+
 // -------------------------------------------------------------------------
 // AddPktToQueueDelay()
 //
@@ -1885,14 +2368,243 @@ void AddPktToQueueDelay (const pPcieModelState_t const state, const pPkt_t const
         packet->TimeStamp = num + (int)packet->TimeStamp;
     }
 
+    AddPktToQueueTimed(state, packet);
+}
+
+// -------------------------------------------------------------------------
+// AddPktToQueueTimed()
+//
+// Add a completion to the delay queue to be processed at its
+// existing timestamp, keeping the queue in timestamp order
+//
+// -------------------------------------------------------------------------
+
+void AddPktToQueueTimed (const pPcieModelState_t const state, const pPkt_t const packet)
+{
+    pTxQueueState_t txq = &state->txq;
+    pPkt_t          prev;
+
+    packet->NextPkt = NULL;
+    packet->Order   = txq->order++;
+
+    txq->stats[FC_CMPL].queued++;
+    if (++txq->depth[FC_CMPL] > txq->stats[FC_CMPL].max_depth)
+    {
+        txq->stats[FC_CMPL].max_depth = txq->depth[FC_CMPL];
+    }
+
     if (state->cpl_head_p == NULL)
     {
         state->cpl_head_p = state->cpl_end_p = packet;
     }
-    else
+    // Usually the latest, so simply add to the end
+    else if (packet->TimeStamp >= state->cpl_end_p->TimeStamp)
     {
         state->cpl_end_p->NextPkt = packet;
-        state->cpl_head_p = PcieSortQueue (state->cpl_head_p, &(state->cpl_end_p), state->thisnode);
+        state->cpl_end_p          = packet;
+    }
+    else if (packet->TimeStamp < state->cpl_head_p->TimeStamp)
+    {
+        packet->NextPkt   = state->cpl_head_p;
+        state->cpl_head_p = packet;
+    }
+    // Insert after any completions with the same timestamp, so that the
+    // parts of a split completion stay in order
+    else
+    {
+        prev = state->cpl_head_p;
+        while (prev->NextPkt->TimeStamp <= packet->TimeStamp)
+        {
+            prev = prev->NextPkt;
+        }
+
+        packet->NextPkt = prev->NextPkt;
+        prev->NextPkt   = packet;
+    }
+}
+
+// -------------------------------------------------------------------------
+// CplProfileAdd()
+//
+// Add a completer timing profile window. Returns MEM_BAD_STATUS if
+// there are no free windows.
+//
+// -------------------------------------------------------------------------
+
+int CplProfileAdd (const pPcieModelState_t const state, const pCplProfile_t profile)
+{
+    pCplProfileState_t cplprof = &state->cplprof;
+
+    if (cplprof->num == CPL_MAX_PROFILES)
+    {
+        return MEM_BAD_STATUS;
+    }
+
+    memset(&cplprof->window[cplprof->num], 0, sizeof(CplWindow_t));
+    cplprof->window[cplprof->num++].profile = *profile;
+
+    return MEM_GOOD_STATUS;
+}
+
+// -------------------------------------------------------------------------
+// CplProfileFind()
+//
+// Return the first completer timing profile window containing addr,
+// or NULL if none
+//
+// -------------------------------------------------------------------------
+
+static pCplWindow_t CplProfileFind (const pPcieModelState_t const state, const uint64_t addr)
+{
+    for (int idx = 0; idx < state->cplprof.num; idx++)
+    {
+        pCplWindow_t win = &state->cplprof.window[idx];
+
+        if (addr >= win->profile.base && (addr - win->profile.base) < win->profile.size)
+        {
+            return win;
+        }
+    }
+
+    return NULL;
+}
+
+// -------------------------------------------------------------------------
+// CplProfileStore()
+//
+// Transfer bytes to or from a window's backing store, starting no
+// earlier than start, returning the time the transfer finishes
+//
+// -------------------------------------------------------------------------
+
+static uint32_t CplProfileStore (const pCplWindow_t win, const uint32_t start, const uint32_t bytes)
+{
+    uint32_t bpc = win->profile.bytes_per_cycle;
+
+    if (bpc)
+    {
+        win->busy_until = ((start > win->busy_until) ? start : win->busy_until) + (bytes + bpc - 1) / bpc;
+
+        return win->busy_until;
+    }
+
+    return start;
+}
+
+// -------------------------------------------------------------------------
+// CplProfileRead()
+//
+// Calculate when a memory read's data is ready, if within a completer
+// timing profile window, for its completion to take with
+// CplProfileTake()
+//
+// -------------------------------------------------------------------------
+
+void CplProfileRead (const pPcieModelState_t const state, const uint64_t addr, const uint32_t bytes)
+{
+    pCplWindow_t win = CplProfileFind(state, addr);
+    uint32_t     start, latency;
+    uint32_t     slot = 0;
+
+    if (win == NULL)
+    {
+        return;
+    }
+
+    start = state->TicksSinceReset;
+
+    // When at the outstanding limit, wait for the earliest read in progress to finish
+    if (win->profile.max_outstanding)
+    {
+        for (uint32_t idx = 1; idx < win->profile.max_outstanding; idx++)
+        {
+            slot = (win->done[idx] < win->done[slot]) ? idx : slot;
+        }
+
+        start = (win->done[slot] > start) ? win->done[slot] : start;
+    }
+
+    latency  = win->profile.latency;
+    latency += win->profile.spread ? PcieRand(state->thisnode) % win->profile.spread : 0;
+
+    if (win->profile.tail_percent && (PcieRand(state->thisnode) % 100) < win->profile.tail_percent)
+    {
+        latency += win->profile.tail_latency;
+    }
+
+    // Data is transferred from when the latency expires, or the backing store is free
+    start   += latency;
+    start    = (win->profile.bytes_per_cycle && win->busy_until > start) ? win->busy_until : start;
+
+    state->cplprof.start           = start;
+    state->cplprof.bytes_per_cycle = win->profile.bytes_per_cycle;
+    state->cplprof.ready           = CplProfileStore(win, start, bytes);
+    state->cplprof.ready_valid     = true;
+
+    if (win->profile.max_outstanding)
+    {
+        win->done[slot] = state->cplprof.ready;
+    }
+}
+
+// -------------------------------------------------------------------------
+// CplProfileWrite()
+//
+// Account for a memory write's use of the backing store bandwidth,
+// if within a completer timing profile window
+//
+// -------------------------------------------------------------------------
+
+void CplProfileWrite (const pPcieModelState_t const state, const uint64_t addr, const uint32_t bytes)
+{
+    pCplWindow_t win = CplProfileFind(state, addr);
+
+    if (win != NULL)
+    {
+        CplProfileStore(win, state->TicksSinceReset, bytes);
+    }
+}
+
+// -------------------------------------------------------------------------
+// CplProfileTake()
+//
+// Take the ready time calculated by CplProfileRead(), if any. Called
+// as the read's completion is created, before anything that may
+// process further input.
+//
+// -------------------------------------------------------------------------
+
+bool CplProfileTake (const pPcieModelState_t const state, uint32_t* ready)
+{
+    if (state->cplprof.ready_valid)
+    {
+        *ready                     = state->cplprof.ready;
+        state->cplprof.ready_valid = false;
+
+        return true;
+    }
+
+    return false;
+}
+
+// -------------------------------------------------------------------------
+// CplProfilePart()
+//
+// Set the ready time for a part completion of a read, from a copy of
+// the state left by CplProfileRead(), as the time the first bytes of
+// the read have been transferred. The copy is used since sending an
+// earlier part may process further reads.
+//
+// -------------------------------------------------------------------------
+
+void CplProfilePart (const pPcieModelState_t const state, const pCplProfileState_t const read, const uint32_t bytes)
+{
+    uint32_t bpc = read->bytes_per_cycle;
+
+    if (read->ready_valid)
+    {
+        state->cplprof.ready       = bpc ? read->start + (bytes + bpc - 1) / bpc : read->ready;
+        state->cplprof.ready_valid = true;
     }
 }
 
@@ -1903,25 +2615,53 @@ void AddPktToQueueDelay (const pPcieModelState_t const state, const pPkt_t const
 // incoming DLLP and TLP packets, and calls ProcessInput()
 // when a new input packet is complete. If order sets or
 // training sequences are seen, the event is passed to
-// ProcessOS().
+// ProcessOS(). In Gen3 mode, the lanes' data stream is
+// first converted to STP/SDP...END/EDB framed symbols,
+// and OS blocks decoded, by Gen3RxSymbols().
 //
 // -------------------------------------------------------------------------
 
 void ExtractPhyInput(const pPcieModelState_t const state, const unsigned int* const rawlinkin)
 {
     PktData_t linkin [MAX_LINK_WIDTH];
+    PktData_t gen3in [MAX_LINK_WIDTH];
+    PktData_t *rxsym = linkin;
     pPkt_t pkt;
     int idx, i;
     pLinkEventCount_t linkevent = &(state->linkevent);
+    pGen3State_t      g3        = &(state->gen3);
+
+    if (state->usrconf.EnableGen3)
+    {
+        for (idx = 0; idx < state->LinkWidth; idx++)
+        {
+            linkin[idx] = Gen3Decode(rawlinkin[idx], state->usrconf.DisableScrambling, idx, state->thisnode);
+        }
+
+        Gen3RxSymbols(state, linkin, gen3in);
+        rxsym = gen3in;
+    }
 
     for (idx = 0; idx < state->LinkWidth; idx++)
     {
-        linkin[idx] = Decode (rawlinkin[idx], state->usrconf.DisableScrambling, state->usrconf.Disable8b10b, idx, state->LinkWidth, state->thisnode);
+        if (!state->usrconf.EnableGen3)
+        {
+            linkin[idx] = Decode (rawlinkin[idx], state->usrconf.DisableScrambling, state->usrconf.Disable8b10b, idx, state->LinkWidth, state->thisnode);
+        }
 
         // ----- Extracting Ordered Sets/Training Sequences for each lane -----
 
+        // Gen3 OS blocks are decoded by Gen3RxSymbols(), with nothing
+        // flagged whilst one is being received
+        if (state->usrconf.EnableGen3)
+        {
+            if (g3->rx_event[idx] != GEN3_RX_OS_ACTIVE)
+            {
+                ProcessOS(state, linkevent, idx, g3->rx_event[idx], &g3->rx_ts[idx], state->vuser_os_cb, state->usrptr, state->thisnode);
+            }
+        }
         // Seen Comma for this lane
-        if (linkin[idx] == COM)
+        else if (linkin[idx] == COM)
         {
             // If active OS, check that we haven't had a bad OS boundary.
             if (linkevent->OsState[idx] && ((linkevent->OsCount [idx] > 15) ||
@@ -2026,12 +2766,13 @@ void ExtractPhyInput(const pPcieModelState_t const state, const unsigned int* co
 
         // ----- Extracting DLLP/TLPs across lanes -----
 
-        if (linkin[idx] == STP || linkin[idx] == SDP)
+        if (rxsym[idx] == STP || rxsym[idx] == SDP)
         {
+            // The active packet's END/EDB was lost, so discard it as a framing error
             if (state->RxActive)
             {
-                VPrint( "ExtractPhyInput: %s***Error --- New STP/SDP (lane %d) whilst packet active at node %d%s\n", fmterrstr, idx, state->thisnode, fmtnormstr);
-                VWrite(PVH_FATAL, 0, 0, state->thisnode);
+                VPrint( "ExtractPhyInput: %s***Warning --- New STP/SDP (lane %d) whilst packet active, discarding packet at node %d%s\n", fmterrstr, idx, state->thisnode, fmtnormstr);
+                CheckFree(state->pRxPktData);
             }
             state->RxActive = true;
             state->RxDataIdx = 0;
@@ -2046,19 +2787,24 @@ void ExtractPhyInput(const pPcieModelState_t const state, const unsigned int* co
         // If a TLP or Dllp is arriving...
         if (state->RxActive)
         {
+            state->linkstats.rx_pkt_symbols++;
+
             // Copy byte to indata buffer
             if (state->RxDataIdx < (MAX_RAW_PKT_SIZE-1))
             {
-                (state->pRxPktData)[state->RxDataIdx++] = linkin[idx];
+                (state->pRxPktData)[state->RxDataIdx++] = rxsym[idx];
             }
+            // With no END/EDB (e.g. lost to a link error), discard as a framing error
             else
             {
-                VPrint( "ExtractPhyInput: %s***Error --- packet overflow at node %d%s\n", fmterrstr, state->thisnode, fmtnormstr);
-                VWrite(PVH_FATAL, 0, 0, state->thisnode);
+                VPrint( "ExtractPhyInput: %s***Warning --- packet overflow, discarding at node %d%s\n", fmterrstr, state->thisnode, fmtnormstr);
+                CheckFree(state->pRxPktData);
+                state->RxActive = false;
+                continue;
             }
 
             // If we've reached the end of a packet...
-            if (linkin[idx] == END || linkin[idx] == EDB)
+            if (rxsym[idx] == END || rxsym[idx] == EDB)
             {
                 // Mark buffer with terminations
                 (state->pRxPktData)[state->RxDataIdx++] = PKT_TERMINATION;
@@ -2078,19 +2824,30 @@ void ExtractPhyInput(const pPcieModelState_t const state, const unsigned int* co
 
                 pkt->NextPkt = NULL;
                 pkt->data = state->pRxPktData;
-                pkt->seq  = (pkt->data[0] == SDP) ? DLLP_SEQ_ID : ((((pkt->data[1] & 0xff) << 8) | (pkt->data[2] & 0xff)) & 0xfff);
                 pkt->Retry = 0;
-                pkt->ByteCount = (pkt->data[0] == SDP) ? 8 : (4 * ((pkt->data[5] & 0x3) | (pkt->data[6] & 0xff)));
+
+                // A TLP too short for a header is left for ProcessInput() to discard
+                if (pkt->data[0] == SDP)
+                {
+                    pkt->seq       = DLLP_SEQ_ID;
+                    pkt->ByteCount = 8;
+                }
+                else if (state->RxDataIdx > RX_TLP_MIN_SYMBOLS)
+                {
+                    pkt->seq       = (((pkt->data[1] & 0xff) << 8) | (pkt->data[2] & 0xff)) & 0xfff;
+                    pkt->ByteCount = 4 * ((pkt->data[5] & 0x3) | (pkt->data[6] & 0xff));
+                }
                 pkt->TimeStamp = GetCycleCount(state->thisnode);
 
                 state->RxActive = false;
 
-                ProcessInput(state, pkt, (linkin[idx] == EDB));
+                ProcessInput(state, pkt, (rxsym[idx] == EDB));
             }
         }
     }
 
     DispRaw(state, linkin, true);
+    TraceSym(state, linkin, true);
 
     // Keep track of time
     state->TicksSinceReset++;
@@ -2098,8 +2855,15 @@ void ExtractPhyInput(const pPcieModelState_t const state, const unsigned int* co
     // Check ContDisp
     CheckContDisp(&state->usrconf, state->thisnode);
 
-    // Check completion delay queue
-    CheckDelayQueue(state);
+    // Check the transmit queues, or else the completion delay queue
+    if (state->usrconf.TxQueueDepth)
+    {
+        TxArbitrate(state);
+    }
+    else
+    {
+        CheckDelayQueue(state);
+    }
 
     // Update Rx consumption counts
     if (!state->usrconf.DisableFc)
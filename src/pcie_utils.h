@@ -35,6 +35,8 @@
 #include <ctype.h>
 #include "pci_express.h"
 #include "pcie_vhost_map.h"
+#include "pcie_trace.h"
+#include "pcie_crc.h"
 
 // -------------------------------------------------------------------------
 // DEFINES
@@ -69,12 +71,69 @@
 
 #define MAXCONSTDISP                 256
 
+// Link display filter rules
+#define MAX_DISP_FILTERS             16
+
+#define DISP_FILT_TYPE               0x01
+#define DISP_FILT_ADDR               0x02
+#define DISP_FILT_RID                0x04
+#define DISP_FILT_TAG                0x08
+#define DISP_FILT_NODE               0x10
+#define DISP_FILT_DIR                0x20
+#define DISP_FILT_PKT_FIELDS         (DISP_FILT_TYPE | DISP_FILT_ADDR | DISP_FILT_RID | DISP_FILT_TAG)
+
+// Triggered capture defaults
+#define TRIG_DEFAULT_HISTORY         64
+#define TRIG_DEFAULT_POST            16
+#define TRIG_DEFAULT_STALL           1000
+#define TRIG_DEFAULT_NAME            "pcietrig%d.bin"
+
+// Outstanding request table size, indexed by tag
+#define TAG_TABLE_SIZE               TAG_MAX_10BIT
+
+// Credit stall episode sources: user TLPs waiting in WaitForCredits(),
+// completions held by the completion scheduler, and the heads of the
+// transmit queues (STALL_SRC_TXQ + FC type)
+#define STALL_SRC_TX                 0
+#define STALL_SRC_CPL                1
+#define STALL_SRC_TXQ                2
+#define STALL_NUM_SRCS               (STALL_SRC_TXQ + FC_NUMTYPES)
+
+// Completer timing profile windows, and maximum outstanding read limit
+#define CPL_MAX_PROFILES             8
+#define CPL_MAX_OUTSTANDING          64
+
+// Traffic generator defaults
+#define GEN_DEFAULT_SEED             0x1234567
+#define GEN_DEFAULT_TLPS             1000
+#define GEN_DEFAULT_LEN_MAX          256
+#define GEN_DEFAULT_WINDOW           0x10000
+#define GEN_DEFAULT_TAGS             32
+#define GEN_DEFAULT_CPL_TIMEOUT      100000
+
+// Lane symbol periods for the selected clock, used for benchmark rates
+#define GEN1_SYMBOL_PS               4000
+#define GEN2_SYMBOL_PS               2000
+#define GEN3_SYMBOL_PS               1016   // 8 GT/s, including each 130 bit block's sync header
+
+// Gen3 training sequences sent per EIEOS
+#define GEN3_TS_PER_EIEOS            32
+
+// Gen3 receive deframer output FIFO size (must be a power of 2)
+#define GEN3_RX_FIFO_SIZE            8
+
+// Gen3 receive lane OS status, whilst an OS block is being received
+#define GEN3_RX_OS_ACTIVE            -1
+
 // -------------------------------------------------------------------------
 // MACROS
 // -------------------------------------------------------------------------
 
 #define CharToHex(_x) (((_x) >= '0' && (_x) <= '9') ? ((_x) - '0') : ((_x) >= 'a' && (_x) <= 'f') ? ((_x) - 'a') : ((_x) - 'A'))
 
+// Completer ID of a function, from the captured bus/device number
+#define CPL_FUNC_ID(_CPLID, _FUNC)   (((_CPLID) & 0xff00) | ((_FUNC) & 0xff))
+
 #define PcieOddParity(_X)\
            (ByteParity[((_X) >>  0) & 0xff] ^ \
             ByteParity[((_X) >>  8) & 0xff] ^ \
@@ -146,12 +205,39 @@ typedef struct {
     uint64_t time;
 } ContDisp_type;
 
+// A display filter rule matches when all of its selected fields match
+typedef struct {
+    uint32_t fields;           // DISP_FILT_xxx fields to be matched
+    uint32_t kinds;            // DISP_KIND_xxx packet types
+    uint64_t addr_lo;
+    uint64_t addr_hi;
+    uint32_t rid;
+    uint32_t rid_mask;
+    uint32_t tag;
+    uint32_t tag_mask;
+    int      node;
+    bool     down;
+} DispFilter_t, *pDispFilter_t;
+
 typedef struct {
     uint32_t       HdrConsumptionRate;
     uint32_t       DataConsumptionRate;
     int            AckRate;
+    int            AckPolicy;
+    int            ReplayTimeout;
+    bool           ReplayRetrain;
+    int            FcPolicy;
+    uint32_t       FcHdrWatermark;
+    uint32_t       FcDataWatermark;
+    uint32_t       FcUpdateTime;
+    int            TxQueueDepth;
+    int            TxAttr;
+    bool           Tag10Bit;
+    int            TagPoolSize;
     int            CompletionRate;
     int            CompletionSpread;
+    int            CplMaxPayload;
+    int            ReadCplBoundary;
     int            SkipInterval;
     int            DisableMem;
     int            DisableAck;
@@ -160,20 +246,204 @@ typedef struct {
     int            DisableUrCpl;
     int            DisableScrambling;
     int            Disable8b10b;
+    int            EnableGen3;
     int            DisableEcrcCmpl;
     int            DisableCrcChk;
     int            BackNodeNum;
+    int            DisableFinishStats;
 
     ContDisp_type  contdisp[MAXCONSTDISP];
     uint32_t       ActiveContDisp;
     int            ContDispIdx;
 
+    // Display filter rules, and union of the fields they select
+    DispFilter_t   DispFilters[MAX_DISP_FILTERS];
+    int            NumDispFilters;
+    uint32_t       DispFilterFields;
+
+    // Triggered capture conditions (TRIG_xxx) and settings
+    uint32_t       TrigConditions;
+    DispFilter_t   TrigMatch;
+    uint32_t       TrigStallCycles;
+    int            TrigHistory;
+    int            TrigPost;
+
     // Rx buffer sizes
     uint32_t       InitFcDataCr        [NUM_VIRTUAL_CHANNELS][FC_NUMTYPES];
     uint32_t       InitFcHdrCr         [NUM_VIRTUAL_CHANNELS][FC_NUMTYPES];
 
 } UserConfig_t, *pUserConfig_t;
 
+////////////////////////
+// Completer timing profile state. The backing store is busy until
+// busy_until, and done holds the ready times of reads in progress
+// (max_outstanding of them). The ready time of a read being completed
+// is passed to the completion it generates in ready.
+
+typedef struct {
+    CplProfile_t     profile;
+    uint32_t         busy_until;
+    uint32_t         done     [CPL_MAX_OUTSTANDING];
+} CplWindow_t, *pCplWindow_t;
+
+typedef struct {
+    CplWindow_t      window   [CPL_MAX_PROFILES];
+    int              num;
+    bool             ready_valid;
+    uint32_t         ready;
+    uint32_t         start;
+    uint32_t         bytes_per_cycle;
+} CplProfileState_t, *pCplProfileState_t;
+
+////////////////////////
+// Triggered capture state. The last 'depth' packets and ordered sets
+// are kept, in trace record form, until a trigger.
+
+typedef struct {
+    PcieTraceRec_t   *recs;
+    PktData_t        *data;                // MAX_RAW_PKT_SIZE values per record
+    uint32_t         depth;
+    uint64_t         count;                // Records added to the history
+    FILE             *fp;                  // Dump file, open from trigger until post trigger records captured
+    int              post_left;
+} TrigCapture_t, *pTrigCapture_t;
+
+////////////////////////
+// Non-posted request latency state
+
+typedef struct {
+    LatencyStats_t   stats    [LAT_NUM_TYPES];
+} LatencyState_t, *pLatencyState_t;
+
+////////////////////////
+// Non-posted request tag state. The outstanding request table is
+// indexed by tag, and the tag pool is a ring of free tags. A pool tag
+// found in use, from a request given an explicit tag, is marked to be
+// returned to the pool when the request completes.
+
+typedef struct {
+    bool             busy;
+    bool             pooled;
+    OutstandingReq_t req;
+} TagEntry_t, *pTagEntry_t;
+
+typedef struct {
+    TagEntry_t       table    [TAG_TABLE_SIZE];
+    uint16_t         pool     [TAG_TABLE_SIZE];
+    uint32_t         pool_size;
+    uint32_t         pool_rd;
+    uint32_t         pool_num;
+    int              last;
+    TagStats_t       stats;
+} TagState_t, *pTagState_t;
+
+////////////////////////
+// Transmit credit stall state. The current episode's details, for
+// each source, are captured when it starts.
+
+typedef struct {
+    bool             active;
+    int              fc_type;
+    uint32_t         start;
+    bool             hdr_short;
+    bool             data_short;
+    uint32_t         hdr_limit;
+    uint32_t         hdr_consumed;
+    uint32_t         data_limit;
+    uint32_t         data_consumed;
+    int              queue_depth;
+} StallEpisode_t, *pStallEpisode_t;
+
+typedef struct {
+    CreditStallStats_t stats    [FC_NUMTYPES];
+    StallEpisode_t   episode    [STALL_NUM_SRCS];
+
+    FILE             *timeline;
+} StallState_t, *pStallState_t;
+
+////////////////////////
+// Replay timer state. The timer runs whilst transmitted TLPs are
+// unacknowledged, and REPLAY_NUM counts replays since the last
+// forward progress. A retrain is flagged on REPLAY_NUM rollover.
+typedef struct {
+    bool             running;
+    uint32_t         start;
+    int              num;
+    bool             retrain;
+    ReplayStats_t    stats;
+} ReplayState_t, *pReplayState_t;
+
+////////////////////////
+// Lane error injection state, allocated when enabled. The countdowns
+// are to the next error of each type (0 when disabled), and symbol
+// slips are made with a per lane delay line.
+
+#define INJ_SLIP_DEPTH 8
+
+typedef struct {
+    PcieInjectCfg_t  cfg;
+    uint32_t         rand_num;
+
+    uint64_t         ber_left    [MAX_LINK_WIDTH];     // Bits to next bit error
+    uint32_t         disp_left   [MAX_LINK_WIDTH];     // Symbols to next error
+    uint32_t         drop_left   [MAX_LINK_WIDTH];
+    uint32_t         dup_left    [MAX_LINK_WIDTH];
+    uint32_t         burst_left;                       // Cycles to next burst
+    uint32_t         burst_active;                     // Cycles of current burst left
+
+    bool             slip;
+    uint32_t         slip_hist   [MAX_LINK_WIDTH][INJ_SLIP_DEPTH];
+    uint32_t         slip_wr     [MAX_LINK_WIDTH];
+    uint32_t         slip_delay  [MAX_LINK_WIDTH];
+    bool             slip_primed [MAX_LINK_WIDTH];
+
+    uint32_t         tlps;                             // TLPs transmitted since enabled
+    bool             target;                           // Current packet to be corrupted
+} InjectState_t, *pInjectState_t;
+
+////////////////////////
+// Gen3 (128b/130b) physical layer state. On transmit, the position
+// in the current block and whether a data stream is active (needing
+// an EDS token before the next OS block) are kept, along with the
+// framed copy of the packet being sent. On receive, each lane's block
+// position and OS block symbols are kept, and the data stream is
+// converted back to STP/SDP...END/EDB framed symbols via a FIFO.
+
+typedef struct {
+    int              tx_sym;
+    bool             tx_data;
+    uint32_t         tx_ts_count;
+    PktData_t        txbuf    [MAX_RAW_PKT_SIZE + GEN3_TOKEN_BYTES];
+
+    int              rx_sym   [MAX_LINK_WIDTH];
+    int              rx_sync  [MAX_LINK_WIDTH];
+    PktData_t        rx_os    [MAX_LINK_WIDTH][GEN3_BLOCK_SYMS];
+    int              rx_event [MAX_LINK_WIDTH];
+    TS_t             rx_ts    [MAX_LINK_WIDTH];
+
+    int              rx_state;
+    int              rx_remain;
+    PktData_t        rx_tok0;
+    PktData_t        rx_tok1;
+    PktData_t        rx_fifo  [GEN3_RX_FIFO_SIZE];
+    uint32_t         rx_fifo_rd;
+    uint32_t         rx_fifo_wr;
+} Gen3State_t, *pGen3State_t;
+
+////////////////////////
+// Transmit queue state (CONFIG_TX_QUEUE_DEPTH). Posted and non-posted
+// TLPs wait on their FC type's queue, and completions on the completion
+// delay queue, without sequence numbers, until released to the send
+// queue by the arbiter (TxArbitrate()). The completion queue entries
+// are unused.
+typedef struct {
+    pPkt_t           head_p     [FC_NUMTYPES];
+    pPkt_t           end_p      [FC_NUMTYPES];
+    uint32_t         depth      [FC_NUMTYPES];
+    uint32_t         order;
+    TxQueueStats_t   stats      [FC_NUMTYPES];
+} TxQueueState_t, *pTxQueueState_t;
+
 ////////////////////////
 // Flow control state
 typedef struct {
@@ -213,6 +483,7 @@ typedef struct {
 
     // 'real' time (cycle count)
     uint32_t         TicksSinceReset;
+    bool             Gen2Clk;
 
     // Send queue pointers
     pPkt_t           head_p;
@@ -223,13 +494,20 @@ typedef struct {
     pPkt_t           cpl_head_p;
     pPkt_t           cpl_end_p;
 
+    // Per FC type transmit queues
+    TxQueueState_t   txq;
+
     // AckNak state
     pPkt_t           ack_to_send_p;
     pPkt_t           nak_to_send_p;
     int              curr_ack;
     int              curr_nak;
-    sPkt_t           AckHolder, NakHolder;
+
+    // DLLP priority queue, for ACK/NAKs and UpdateFCs sent ahead of TLPs
+    pPkt_t           dllp_head_p;
+    pPkt_t           dllp_end_p;
     uint32_t         seq;
+    uint32_t         next_rcv_seq;
 
     // Skip Timing
     int              LastTxSkipTime;
@@ -239,6 +517,7 @@ typedef struct {
     int              CompletionEvent;
     int              OutstandingCompletions;
     int              CplId;
+    int              CplAttr;
     callback_t       vuser_cb;
     void             *usrptr;
 
@@ -250,6 +529,9 @@ typedef struct {
     // Input OS State
     os_callback_t    vuser_os_cb;
 
+    // User UpdateFC policy callback
+    fc_callback_t    vuser_fc_cb;
+
     // Ordered set and Training sequence reception state
     LinkEventCount_t linkevent;
 
@@ -262,13 +544,49 @@ typedef struct {
     bool             draining_queue;
     bool             tx_disabled;
 
-} PcieModelState_t, *pPcieModelState_t;
+    // End of run processing done (PcieFinish())
+    bool             finished;
 
-// -------------------------------------------------------------------------
-// EXTERNAL REFERENCES
-// -------------------------------------------------------------------------
+    // Binary link trace capture state
+    FILE             *TraceFp;
+    char             *TraceBuf;
+    uint32_t         TraceFlags;
+
+    // Triggered capture state, allocated when first armed
+    pTrigCapture_t   Trig;
+
+    // Non-posted request latency state
+    LatencyState_t   latency;
+
+    // Non-posted request tags and outstanding request table
+    TagState_t       tags;
+
+    // Transmit credit stall state
+    StallState_t     stall;
+
+    // ACK/NAK DLLP statistics
+    AckStats_t       ackstats;
 
-extern const unsigned int       Bitrev8[];
+    // UpdateFC DLLP statistics
+    FcUpdateStats_t  fcstats[FC_NUMTYPES];
+
+    // Lane error injection state, allocated when enabled, and counts
+    pInjectState_t   inject;
+    PcieInjectStats_t injstats;
+
+    // Replay timer state and statistics
+    ReplayState_t    replay;
+
+    // Completer timing profiles
+    CplProfileState_t cplprof;
+
+    // Link packet symbol counts
+    LinkStats_t      linkstats;
+
+    // Gen3 physical layer state
+    Gen3State_t      gen3;
+
+} PcieModelState_t, *pPcieModelState_t;
 
 // -------------------------------------------------------------------------
 // PCIe model support function prototypes
@@ -277,16 +595,32 @@ extern const unsigned int       Bitrev8[];
 void        InitPcieState        (const pPcieModelState_t const state, const int node);
 PktData_t * CreateDllpTemplate   (const int Type, PktData_t **payload_start);
 PktData_t * CreateTlpTemplate    (const int Type, const uint64_t addr, const int bytelen, const int digest_present, PktData_t **payload_start);
-void        CalcLcrc             (PktData_t *pkt);
-void        CalcEcrc             (PktData_t *pkt);
-void        CalcDllpCrc          (PktData_t *dllp);
 int         CalcBe               (const int inaddr, const int byte_len);
 int         CalcLoAddr           (const int fbe);
 int         CalcByteCount        (const int len, int fbe, int lbe);
 int         CheckCredits         (const int disable_fc, const uint32_t fc_state, const uint32_t hdr_credits, const uint32_t data_credits,
                                   const uint32_t tx_hdr, const uint32_t tx_data, const int payload_len);
+uint32_t    AckNakLatency        (const pPcieModelState_t const state);
+bool        AckNakDue            (const pPcieModelState_t const state, const uint32_t pending_since);
+uint32_t    ReplayTimerLimit     (const pPcieModelState_t const state);
 void        AddPktToQueue        (const pPcieModelState_t const state, const pPkt_t const packet);
+void        AddPktToDllpQueue    (const pPcieModelState_t const state, const pPkt_t const packet);
+pPkt_t      CreateFcPkt          (const int Encoding, const int hdrfc, const int datafc, const int node);
 void        AddPktToQueueDelay   (const pPcieModelState_t const state, const pPkt_t const packet);
+void        AddPktToQueueTimed   (const pPcieModelState_t const state, const pPkt_t const packet);
+int         TlpPayloadLen        (const PktData_t* const pkt);
+void        TlpRelease           (const pPcieModelState_t const state, const pPkt_t const packet, const int fc_type);
+void        TxQueueAdd           (const pPcieModelState_t const state, const pPkt_t const packet, const int fc_type);
+void        TxArbitrate          (const pPcieModelState_t const state);
+void        TagPoolInit          (const pPcieModelState_t const state);
+int         TagAlloc             (const pPcieModelState_t const state);
+void        TagIssue             (const pPcieModelState_t const state, const int type, const int tag, const uint64_t addr, const int length);
+void        TagComplete          (const pPcieModelState_t const state, const int tag, const uint32_t remaining, const bool last);
+int         CplProfileAdd        (const pPcieModelState_t const state, const pCplProfile_t profile);
+void        CplProfileRead       (const pPcieModelState_t const state, const uint64_t addr, const uint32_t bytes);
+void        CplProfileWrite      (const pPcieModelState_t const state, const uint64_t addr, const uint32_t bytes);
+bool        CplProfileTake       (const pPcieModelState_t const state, uint32_t* ready);
+void        CplProfilePart       (const pPcieModelState_t const state, const pCplProfileState_t const read, const uint32_t bytes);
 void        ExtractPhyInput      (const pPcieModelState_t const state, const uint32_t* const rawlinkin);
 
 uint32_t    CalcNewRand          (const uint32_t Seed);
@@ -294,5 +628,60 @@ void        CheckFree            (void *ptr);
 void        TxFcInitInt          (const pFlowControl_t const flw, const pUserConfig_t usrcfg, const int node);
 void        RxFcInit             (const pFlowControl_t const flw, const int dllptype, const int hdrval, const int dataval, const int node);
 
+// End of run processing (pcie.c)
+void        PcieFinish           (const int node);
+
+// Binary link trace capture (pcie_trace.c)
+int         TraceOpen            (const pPcieModelState_t const state, const char* fname, const uint32_t flags);
+void        TraceClose           (const pPcieModelState_t const state);
+void        TraceSym             (const pPcieModelState_t const state, const PktData_t *linkin, const int rx);
+void        TraceOS              (const pPcieModelState_t const state, const int type, const pTS_t const ts_data, const int lane, const bool rx, const int node);
+void        TracePkt             (const pPcieModelState_t const state, const pPkt_t const pkt, const bool rx);
+int         TrigConfig           (const pUserConfig_t usrconf, const char* spec, const int node);
+void        TrigClose            (const pPcieModelState_t const state);
+void        TrigEvent            (const pPcieModelState_t const state, const uint32_t condition);
+pPkt_t      ReplayLoad           (const pPcieModelState_t const state, const char* fname, const uint32_t flags, const int max_gap);
+
+// Model statistics (pcie_stats.c)
+void        LatencyComplete      (const pPcieModelState_t const state, const OutstandingReq_t* const req);
+void        LatencyGet           (const pPcieModelState_t const state, const int type, const pLatencyStats_t stats);
+void        LatencyClear         (const pPcieModelState_t const state);
+void        LatencyReport        (const pPcieModelState_t const state);
+void        StallBegin           (const pPcieModelState_t const state, const int src, const int fc_type, const int payload_len);
+void        StallEnd             (const pPcieModelState_t const state, const int src);
+void        StallTimeline        (const pPcieModelState_t const state, const bool enable);
+void        StallGet             (const pPcieModelState_t const state, const int fc_type, const pCreditStallStats_t stats);
+void        StallClear           (const pPcieModelState_t const state);
+void        StallReport          (const pPcieModelState_t const state);
+void        AckReport            (const pPcieModelState_t const state);
+void        FcUpdateReport       (const pPcieModelState_t const state);
+void        TxQueueReport        (const pPcieModelState_t const state);
+void        TagReport            (const pPcieModelState_t const state);
+void        ReplayReport         (const pPcieModelState_t const state);
+
+// Constrained random traffic generator (pcie_gen.c)
+void        GenDefaults          (const pPcieGenCfg_t cfg);
+int         GenLoad              (const char* fname, const pPcieGenCfg_t cfg, const int node);
+int         GenRun               (const pPcieModelState_t const state, const pPcieGenCfg_t cfg, const pPcieGenStats_t stats, const int node);
+void        GenReport            (const pPcieModelState_t const state, const pPcieGenStats_t stats);
+int         GenBench             (const pPcieModelState_t const state, const pPcieGenCfg_t cfg, const pPcieBenchStats_t bench, const int node);
+
+// Lane error injection (pcie_inject.c)
+void        InjectDefaults       (const pPcieInjectCfg_t cfg);
+int         InjectConfig         (const pPcieModelState_t const state, const pPcieInjectCfg_t cfg);
+void        InjectStop           (const pPcieModelState_t const state);
+void        InjectSeed           (const pPcieModelState_t const state, const uint32_t seed);
+PktData_t   InjectPktError       (const pPcieModelState_t const state, const pPkt_t pkt, const PktData_t* txdata, const int idx);
+uint32_t    InjectLaneError      (const pPcieModelState_t const state, const uint32_t code, const int lane);
+void        InjectReport         (const pPcieModelState_t const state);
+
+// Gen3 128b/130b framing (pcie_gen3.c)
+void        Gen3Reset            (const pPcieModelState_t const state);
+PktData_t * Gen3FramePkt         (const pPcieModelState_t const state, const pPkt_t const pkt);
+uint32_t    Gen3TxEncode         (const pPcieModelState_t const state, const PktData_t data, const int lane, const bool os_block);
+PktData_t   Gen3EdsSymbol        (const pPcieModelState_t const state, const int lane);
+PktData_t   Gen3OsSymbol         (const int type, const pTS_t const ts_data, const int seq, const int lane);
+void        Gen3RxSymbols        (const pPcieModelState_t const state, PktData_t* const linkin, PktData_t* const rxsym);
+
 #endif
 
@@ -0,0 +1,680 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+//
+// Offline decoder for pcieVHost binary link trace files. Renders
+// captured records in the same text format as the model's link
+// display (displink.c), optionally filtered by layer, direction,
+// node, cycle window and TLP type.
+//
+// Usage: pcietracedec [options] <trace file>
+//
+//=============================================================
+
+// -------------------------------------------------------------------------
+// INCLUDES
+// -------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pci_express.h"
+#include "pcie_trace.h"
+#include "pcie_crc.h"
+
+// -------------------------------------------------------------------------
+// DEFINES
+// -------------------------------------------------------------------------
+
+#define STRBUFSIZE                   1024
+
+#define FMT_NORMAL                   "\033[0m"
+#define FMT_RED                      "\033[31m"
+#define FMT_BRIGHT_GREEN             "\033[92m"
+#define FMT_BRIGHT_BLUE              "\033[94m"
+#define FMT_GREY                     "\033[38;5;244m"
+
+// Display layer selection (as for the ContDisps.hex controls)
+#define DECTL                        0x1
+#define DECDL                        0x2
+#define DECPL                        0x4
+#define DECRAWSYM                    0x8
+
+// TLP type filter selection (DISP_KIND_xxx)
+#define DECKINDALL                   (DISP_KIND_MEM | DISP_KIND_CPL | DISP_KIND_CFG | DISP_KIND_MSG | DISP_KIND_IO)
+
+// Decoded output, for the shared TLP field display routines
+#define DISPPRINT(...)               printf(__VA_ARGS__)
+
+// -------------------------------------------------------------------------
+// TYPEDEFS
+// -------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t layers;
+    uint32_t kinds;
+    int      node;
+    int      dir;                                 // -1 both, 0 up, 1 down
+    uint64_t start;
+    uint64_t end;
+    bool     cycles;
+} DecOpts_t;
+
+// -------------------------------------------------------------------------
+// STATICS
+// -------------------------------------------------------------------------
+
+static const char* fmtupstr   = "";
+static const char* fmtdnstr   = "";
+static const char* fmterrstr  = "";
+static const char* fmtnormstr = "";
+static const char* fmtdatastr = "";
+
+// -------------------------------------------------------------------------
+// TlpKind()
+//
+// Map a TLP type to a type filter selection bit
+//
+// -------------------------------------------------------------------------
+
+static uint32_t TlpKind (const PktData_t* pkt)
+{
+    uint32_t tl_type = pkt[3] & 0x7f;
+    uint32_t tl_type_adj = tl_type & (((tl_type & 0x30) == 0x30) ? ~0x7 : ~0x0);
+
+    switch (tl_type_adj)
+    {
+    case TL_MRD32: case TL_MRDLCK32: case TL_MRD64: case TL_MRDLCK64: case TL_MWR32: case TL_MWR64:
+        return DISP_KIND_MEM;
+    case TL_CPL: case TL_CPLD: case TL_CPLLK: case TL_CPLDLK:
+        return DISP_KIND_CPL;
+    case TL_CFGRD0: case TL_CFGRD1: case TL_CFGWR0: case TL_CFGWR1:
+        return DISP_KIND_CFG;
+    case TL_MSG: case TL_MSGD:
+        return DISP_KIND_MSG;
+    case TL_IORD: case TL_IOWR:
+        return DISP_KIND_IO;
+    }
+
+    return 0;
+}
+
+// TLP field display routines, using DISPPRINT() and the above format strings
+#include "disptlp.h"
+
+// -------------------------------------------------------------------------
+// DecRaw()
+// -------------------------------------------------------------------------
+
+static void DecRaw (const char* prefixstr, const PktData_t *linkin, const int width)
+{
+    printf("%s ", prefixstr);
+
+    for (int idx = 0; idx < width; idx++)
+    {
+        switch (linkin[idx])
+        {
+        case COM: printf("COM "); break;
+        case STP: printf("STP "); break;
+        case SDP: printf("SDP "); break;
+        case END: printf("END "); break;
+        case EDB: printf("EDB "); break;
+        case PAD: printf("PAD "); break;
+        case SKP: printf("SKP "); break;
+        case FTS: printf("FTS "); break;
+        case IDL: printf("IDL "); break;
+        case EIE: printf("EIE "); break;
+        case RV2: printf("RV2 "); break;
+        case RV3: printf("RV3 "); break;
+        default:
+            if (linkin[idx] & SYMCTRLBIT)
+            {
+                printf("??? ");
+            }
+            else
+            {
+                printf(" %02x ", linkin[idx]);
+            }
+            break;
+        }
+    }
+    printf("\n");
+}
+
+// -------------------------------------------------------------------------
+// DecOS()
+// -------------------------------------------------------------------------
+
+static void DecOS (const char* prefixstr, const PcieTraceRec_t* rec, const PktData_t* ts)
+{
+    char lanestr[STRBUFSIZE], linkstr[STRBUFSIZE];
+    int  type = rec->info;
+
+    switch (type)
+    {
+    case TS1_ID:
+    case TS2_ID:
+        if (rec->count < PCIE_TRACE_TS_COUNT)
+        {
+            printf("%s %02d: PL %s**Truncated TS record**%s\n", prefixstr, rec->lane, fmterrstr, fmtnormstr);
+            break;
+        }
+
+        snprintf(lanestr, STRBUFSIZE, "%3d", ts[PCIE_TRACE_TS_LANENUM]);
+        snprintf(linkstr, STRBUFSIZE, "%3d", ts[PCIE_TRACE_TS_LINKNUM]);
+
+        printf("%s %02d: PL TS%d OS Link=%s Lane=%s N_FTS=%2d DataRate=%s %s %s %s %s %s %s %s\n",
+               prefixstr, rec->lane, (type == TS1_ID) ? 1 : 2,
+               (ts[PCIE_TRACE_TS_LINKNUM] == PAD) ? "PAD" : linkstr,
+               (ts[PCIE_TRACE_TS_LANENUM] == PAD) ? "PAD" : lanestr,
+               ts[PCIE_TRACE_TS_N_FTS],
+               (ts[PCIE_TRACE_TS_DATARATE] == 6)  ? "GEN2+GEN1" :
+               (ts[PCIE_TRACE_TS_DATARATE] == 4)  ? "GEN2" :
+               (ts[PCIE_TRACE_TS_DATARATE] == 2)  ? "GEN1" : "GEN?",
+               (ts[PCIE_TRACE_TS_DATARATE] & TS_DATA_RATE_CHANGE_AUTO)  ? "AutonomousChange" : "",
+               (ts[PCIE_TRACE_TS_DATARATE] & TS_DATA_RATE_CHANGE_SPEED) ? "SpeedChange" : "",
+               (ts[PCIE_TRACE_TS_CONTROL]  & 0x01) ? "AssertReset"   : "",
+               (ts[PCIE_TRACE_TS_CONTROL]  & 0x02) ? "DisableLink"   : "",
+               (ts[PCIE_TRACE_TS_CONTROL]  & 0x04) ? "Loopback"      : "",
+               (ts[PCIE_TRACE_TS_CONTROL]  & 0x08) ? "NoScramble"    : "",
+               (ts[PCIE_TRACE_TS_CONTROL]  & 0x10) ? "ComplianceRx"  : ""
+               );
+        break;
+    case IDL: printf("%s %02d: PL Electrical idle ordered set\n", prefixstr, rec->lane); break;
+    case FTS: printf("%s %02d: PL Fast training sequence ordered set\n", prefixstr, rec->lane); break;
+    case EIE: printf("%s %02d: PL Electrical Idle Exit ordered set\n", prefixstr, rec->lane); break;
+    case SKP: printf("%s %02d: PL Skip ordered set\n", prefixstr, rec->lane); break;
+    default:  printf("%s %02d: PL %s**Unrecognised ordered set (0x%03x)**%s\n", prefixstr, rec->lane, fmterrstr, type, fmtnormstr); break;
+    }
+}
+
+// -------------------------------------------------------------------------
+// DecDll()
+// -------------------------------------------------------------------------
+
+static void DecDll (const char* prefixstr, PktData_t* pkt, const int count, const uint32_t layers)
+{
+    char offstr[STRBUFSIZE];
+    bool phyen = layers & DECPL;
+
+    if (phyen)
+    {
+        printf("%s: {SDP\n", prefixstr);
+        printf("%s%s:", prefixstr, fmtdatastr);
+        for (int idx = 1; idx <= 6; idx++)
+        {
+            printf(" %02x", pkt[idx]);
+        }
+        printf("%s", fmtnormstr);
+
+        printf("\n%s: %s}\n", prefixstr, pkt[count-1] == EDB ? "EDB" : "END");
+    }
+
+    if (layers & DECDL)
+    {
+        PktData_t gotcrc = (pkt[5] << 8) | pkt[6];
+        CalcDllpCrc(pkt);
+        PktData_t expcrc = (pkt[5] << 8) | pkt[6];
+
+        uint32_t type = pkt[1] & (((pkt[1] & 0x30) == 0x20) ? 0xff : 0xf8);
+        uint32_t data = (pkt[2] << 16) | (pkt[3] << 8) | pkt[4];
+
+        sprintf(offstr, "%s", phyen ? "..." : "");
+
+        switch (type & 0xf8)
+        {
+        case DL_ACK:
+        case DL_NAK:
+            printf("%s: %sDL %s seq %02d\n", prefixstr, offstr, (type == DL_ACK) ? "Ack" : "Nak" , data & 0xfff);
+            break;
+        case DL_INITFC1_P:
+        case DL_INITFC1_NP:
+        case DL_INITFC1_CPL:
+        case DL_INITFC2_P:
+        case DL_INITFC2_NP:
+        case DL_INITFC2_CPL:
+            printf("%s: %sDL %s%s VC%d  HdrFC=%d DataFC=%d\n", prefixstr, offstr, (type & 0x80) ? "InitFC2-" : "InitFC1-",
+                   (type & 0x30) == 0x00 ? "P   " : (type & 0x30) == 0x10 ? "NP  " : "Cpl ", type & 0x7,
+                   (data >> 14) & 0xff, (data & 0xfff));
+            break;
+        case DL_UPDATEFC_P:
+        case DL_UPDATEFC_NP:
+        case DL_UPDATEFC_CPL:
+            printf("%s: %sDL UpdateFC-%sVC%d  HdrFC=%d DataFC=%d\n", prefixstr, offstr,
+                   (type & 0x30) == 0x00 ? "P   " : (type & 0x30) == 0x10 ? "NP  ": "Cpl ", type & 0x7,
+                   (data >> 14) & 0xff, (data & 0xfff));
+            break;
+        case DL_PM_ENTER_L1:
+            switch (type)
+            {
+            case DL_PM_ENTER_L1  : printf("%s: %sDL PM_Enter_L1\n", prefixstr, offstr); break;
+            case DL_PM_ENTER_L23 : printf("%s: %sDL PM_Enter_L23\n", prefixstr, offstr); break;
+            case DL_PM_REQ_L0S   : printf("%s: %sDL PM_Active_State_Request_L0s\n", prefixstr, offstr); break;
+            case DL_PM_REQ_L1    : printf("%s: %sDL PM_Active_State_Request_L1\n", prefixstr, offstr); break;
+            case DL_PM_REQ_ACK   : printf("%s: %sDL PM_Request_Ack\n", prefixstr, offstr); break;
+            default: printf("%s:*** Unknown DLLP packet type\n", prefixstr); break;
+            }
+            break;
+        case DL_VENDOR:
+            printf("%s: %sDL Vendor Specific DLLP\n", prefixstr, offstr);
+            break;
+        default:
+            printf("%s:*** Unknown DLLP packet type\n", prefixstr);
+            break;
+        }
+
+        printf("%s: %sDL ", prefixstr, offstr);
+        if (expcrc == gotcrc)
+        {
+            printf("Good DLLP CRC (%04x)\n", gotcrc);
+        }
+        else
+        {
+            printf("**BAD PCIe DLLP CRC (%04x v %04x)\n", gotcrc, expcrc);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// DecTl()
+// -------------------------------------------------------------------------
+
+static void DecTl (const char* prefixstr, PktData_t* pkt, const uint32_t layers)
+{
+    int      idx;
+    char     tloffstr[STRBUFSIZE];
+    char     dlloffstr[STRBUFSIZE];
+    bool     phyen = layers & DECPL;
+    bool     dllen = layers & DECDL;
+    uint32_t data_offset;
+
+    if (phyen)
+    {
+        printf("%s: {STP\n", prefixstr);
+
+        for (idx = 1; pkt[idx] != EDB && pkt[idx] != END && pkt[idx] != PKT_TERMINATION; idx++)
+        {
+            if ((idx-1)%22 == 0)
+                printf("%s:%s", prefixstr, fmtdatastr);
+
+            printf(" %02x", pkt[idx]);
+
+            if ((idx-1)%22 == 21)
+                printf("%s\n", fmtnormstr);
+        }
+        printf("%s", fmtnormstr);
+        printf("%s", !((idx-1)%22) ? "" : "\n");
+        printf("%s: %s}\n", prefixstr, pkt[idx] == EDB ? "EDB" : "END");
+    }
+
+    if (!(layers & DECTL))
+    {
+        return;
+    }
+
+    sprintf(dlloffstr, "%s", (phyen & dllen) ? "..." : "");
+    sprintf(tloffstr, "%s", (phyen & dllen) ? "......" : (phyen ^ dllen) ? "..." : "");
+
+    uint32_t dl_seq_num  =  (pkt[1]  << 8)  | (pkt[2]);
+    uint32_t tl_word0    =  (pkt[3]  << 24) | (pkt[4]  << 16) | (pkt[5]  << 8) | (pkt[6]);
+    uint32_t tl_word1    =  (pkt[7]  << 24) | (pkt[8]  << 16) | (pkt[9]  << 8) | (pkt[10]);
+    uint32_t tl_word2    =  (pkt[11] << 24) | (pkt[12] << 16) | (pkt[13] << 8) | (pkt[14]);
+    uint32_t tl_word3    =  (pkt[15] << 24) | (pkt[16] << 16) | (pkt[17] << 8) | (pkt[18]);
+
+    uint32_t tl_td       = (tl_word0 >> 15) & 0x1;
+    uint32_t tl_length   = tl_word0 & 0x3ff;
+    uint32_t tl_type     = (tl_word0 >> 24) & 0x7f;
+    uint32_t tl_tc       = (tl_word0 >> 20) & 0x7;
+    uint32_t tl_ep       = (tl_word0 >> 14) & 0x1;
+    uint32_t tl_attr     = (tl_word0 >> 12) & 0x3;
+
+    uint32_t tl_id       = (tl_word1 >> 16) & 0xffff;
+    uint32_t tl_tag      = (tl_word1 >>  8) & 0xff;
+    uint32_t tl_lbe      = (tl_word1 >>  4) & 0xf; tl_lbe = ((tl_lbe & 0x8) ? 0x1000 : 0) | ((tl_lbe & 0x4) ? 0x0100 : 0) | ((tl_lbe & 0x2) ? 0x0010 : 0) | ((tl_lbe & 0x1) ? 0x0001 : 0);
+    uint32_t tl_fbe      = (tl_word1 >>  0) & 0xf; tl_fbe = ((tl_fbe & 0x8) ? 0x1000 : 0) | ((tl_fbe & 0x4) ? 0x0100 : 0) | ((tl_fbe & 0x2) ? 0x0010 : 0) | ((tl_fbe & 0x1) ? 0x0001 : 0);
+
+    uint32_t tl_type_adj = tl_type & (((tl_type & 0x30) == 0x30) ? ~0x7 : ~0x0);
+
+    switch (tl_type_adj)
+    {
+    case TL_MRD32:
+    case TL_MRDLCK32:
+    case TL_MRD64:
+    case TL_MRDLCK64:
+    case TL_MWR32:
+    case TL_MWR64:
+        printf("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
+        printf("%s: %sTL Mem %s req Addr=", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "write" : "read");
+
+        if (tl_type & TL_TYPE_ADDR64)
+        {
+            printf("%016lx (64) ", ((uint64_t)tl_word2 << 32) | ((uint64_t)tl_word3));
+        }
+        else
+        {
+            printf("%08x (32) ", tl_word2);
+        }
+
+        printf("%s=%04x TAG=%02x FBE=%04x LBE=%04x ", (tl_type & TL_TYPE_MEMLOCK) ? "LOCKED ID" : "RID", tl_id, tl_tag, tl_fbe, tl_lbe);
+
+        if (!(tl_type & TL_TYPE_WRITE))
+        {
+            printf("Len=%03x", tl_length);
+        }
+        printf("\n");
+
+        DispTc(prefixstr, tloffstr, tl_type, tl_tc, tl_td, tl_ep, tl_attr, tl_length);
+
+        if (tl_type & TL_TYPE_WRITE)
+        {
+            data_offset = 15 + ((tl_type & TL_TYPE_ADDR64)? 4 : 0);
+            DispPayload(prefixstr, tloffstr, pkt, data_offset, tl_length);
+        }
+
+        DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt);
+        break;
+
+    case TL_CPL:
+    case TL_CPLD:
+    case TL_CPLLK:
+    case TL_CPLDLK:
+    {
+        uint32_t tl_cstatus   = (tl_word1 >> 13) & 0x3;
+        uint32_t tl_bcm       = (tl_word1 >> 12) & 0x1;
+        uint32_t tl_byte_cnt  = (tl_word1 >>  0) & 0xfff;
+        uint32_t tl_crid      = (tl_word2 >> 16) & 0xffff;
+        uint32_t tl_ctag      = (tl_word2 >>  8) & 0xff;
+        uint32_t tl_laddr     = (tl_word2 >>  0) & 0x7f;
+
+        printf("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
+        printf("%s: %sTL Completion %s%s%s", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "with data " : "", (tl_type & TL_TYPE_MEMLOCK) ? "LOCKED " : "",
+                  (tl_cstatus == 0) ? "Successful "              :
+                  (tl_cstatus == 1) ? "Unsupported Request "     :
+                  (tl_cstatus == 2) ? "Config Req Retry Status " :
+                                      "Completer Abort ");
+        printf("CID=%04x BCM=%d Byte Count=%03x RID=%04x TAG=%02x Lower Addr=%02x\n", tl_id, tl_bcm, tl_byte_cnt, tl_crid, tl_ctag, tl_laddr);
+
+        DispTc(prefixstr, tloffstr, tl_type, tl_tc, tl_td, tl_ep, tl_attr, tl_length);
+
+        if (tl_type & TL_TYPE_WRITE)
+        {
+            DispPayload(prefixstr, tloffstr, pkt, 15, tl_length);
+        }
+
+        DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt);
+        break;
+    }
+
+    case TL_CFGRD0:
+    case TL_CFGRD1:
+    case TL_CFGWR0:
+    case TL_CFGWR1:
+    {
+        uint32_t tl_bus  = (tl_word2 >> 24) & 0xff;
+        uint32_t tl_dev  = (tl_word2 >> 20) & 0xf;
+        uint32_t tl_func = (tl_word2 >> 16) & 0xf;
+        uint32_t tl_ereg = (tl_word2 >>  8) & 0xf;
+        uint32_t tl_reg  = (tl_word2 >>  2) & 0x3f;
+
+        printf("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
+        printf("%s: %sTL Config %s type %d RID=%04x TAG=%02x FBE=%04x LBE=%04x Bus=%02x Dev=%02x Func=%x EReg=%x Reg=%02x\n",
+            prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "write" : "read", tl_type & 1,
+            tl_id, tl_tag, tl_fbe, tl_lbe, tl_bus, tl_dev, tl_func, tl_ereg, tl_reg);
+
+        DispTc(prefixstr, tloffstr, tl_type, tl_tc, tl_td, tl_ep, tl_attr, tl_length);
+
+        if (tl_type & TL_TYPE_WRITE)
+        {
+            DispPayload(prefixstr, tloffstr, pkt, 15, tl_length);
+        }
+
+        DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt);
+        break;
+    }
+
+    case TL_MSG:
+    case TL_MSGD:
+    {
+        printf("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
+        printf("%s: %sTL Message req%s ", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? " with Data" : "");
+
+        uint32_t msg_code   = tl_word1 & 0xff;
+        uint32_t vend_id    = tl_word2 & 0xffff;
+        uint32_t route_type = tl_type & 0x7;
+
+        switch(msg_code)
+        {
+        case MSG_ASSERT_INTA  : printf("Assert INTA "); break;
+        case MSG_ASSERT_INTB  : printf("Assert INTB "); break;
+        case MSG_ASSERT_INTC  : printf("Assert INTC "); break;
+        case MSG_ASSERT_INTD  : printf("Assert INTD "); break;
+        case MSG_DEASSERT_INTA: printf("Deassert INTA "); break;
+        case MSG_DEASSERT_INTB: printf("Deassert INTB "); break;
+        case MSG_DEASSERT_INTC: printf("Deassert INTC "); break;
+        case MSG_DEASSERT_INTD: printf("Deassert INTD "); break;
+        case MSG_PM_ACTIVE_NAK: printf("PM Active State NAK "); break;
+        case MSG_PM_PME       : printf("PM Power Management Enable "); break;
+        case MSG_PME_OFF      : printf("PM Turn Off "); break;
+        case MSG_PME_TO_ACK   : printf("PM TO Ack "); break;
+        case MSG_ERR_COR      : printf("Error Correctable "); break;
+        case MSG_ERR_NONFATAL : printf("Error Non-fatal "); break;
+        case MSG_ERR_FATAL    : printf("Error Fatal "); break;
+        case MSG_UNLOCK       : printf("Unlock locked transaction "); break;
+        case MSG_SET_PWR_LIMIT: printf("Set slot power limit "); break;
+        case MSG_VENDOR_0     : printf("Vendor type 0 "); break;
+        case MSG_VENDOR_1     : printf("Vendor type 1 "); break;
+        default               : printf("%s**illegal Msg code**%s ", fmterrstr, fmtnormstr);
+        }
+
+        printf("ID=%04x TAG=%02x ", tl_id, tl_tag);
+
+        if (msg_code == MSG_VENDOR_0 || msg_code == MSG_VENDOR_1)
+        {
+            printf("Vendor ID=%04x Vendor Data=%08x ", vend_id, tl_word3);
+        }
+
+        switch(route_type)
+        {
+        case MSG_ROUTE_ROOT  : printf("(route to root complex)\n"); break;
+        case MSG_ROUTE_ADDR  : printf("(route by address)\n"); break;
+        case MSG_ROUTE_ID    : printf("(route by ID = 0x%04x)\n", tl_id); break;
+        case MSG_ROUTE_BCAST : printf("(broadcast from root complex)\n"); break;
+        case MSG_ROUTE_LOCAL : printf("(Local)\n"); break;
+        case MSG_ROUTE_GATHER: printf("(Gather and route to root complex)\n"); break;
+        default              : printf("(%s**illegal route**%s)\n", fmterrstr, fmtnormstr); break;
+        }
+
+        DispTc(prefixstr, tloffstr, tl_type, tl_tc, tl_td, tl_ep, tl_attr, tl_length);
+
+        if (tl_type & TL_TYPE_WRITE)
+        {
+            DispPayload(prefixstr, tloffstr, pkt, 19, tl_length);
+        }
+
+        DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt);
+        break;
+    }
+
+    case TL_IORD:
+    case TL_IOWR:
+        printf("%s: %sDL Sequence number=%d\n", prefixstr, dlloffstr, dl_seq_num);
+        printf("%s: %sTL IO %s req Addr=", prefixstr, tloffstr, (tl_type & TL_TYPE_WRITE) ? "write" : "read");
+        printf("%08x (32) ", tl_word2);
+        printf("RID=%04x TAG=%02x FBE=%04x LBE=%04x\n", tl_id, tl_tag, tl_fbe, tl_lbe);
+
+        DispTc(prefixstr, tloffstr, tl_type, tl_tc, tl_td, tl_ep, tl_attr, tl_length);
+
+        if (tl_type & TL_TYPE_WRITE)
+        {
+            DispPayload(prefixstr, tloffstr, pkt, 15, tl_length);
+        }
+
+        DispTlpCrc(prefixstr, tloffstr, dlloffstr, tl_td, pkt);
+        break;
+    }
+}
+
+// -------------------------------------------------------------------------
+// Usage()
+// -------------------------------------------------------------------------
+
+static void Usage (const char* prog)
+{
+    fprintf(stderr, "Usage: %s [options] <trace file>\n"
+                    "    -l <layers>  Layers to display, any of t(ransaction), d(ata link), p(hysical), r(aw symbols) (default tdp)\n"
+                    "    -k <kinds>   TLP types to display, any of m(em), c(pl), f (cfg), g (msg), i(o) (default all)\n"
+                    "    -n <node>    Only display traffic labelled with this node number\n"
+                    "    -d <u|d>     Only display upstream (u) or downstream (d) traffic\n"
+                    "    -s <cycle>   Start of cycle window\n"
+                    "    -e <cycle>   End of cycle window\n"
+                    "    -t           Prefix each record with its cycle count\n"
+                    "    -c           Colour output\n"
+                    "    -h           Display this message\n", prog);
+}
+
+// -------------------------------------------------------------------------
+// main()
+// -------------------------------------------------------------------------
+
+int main (int argc, char** argv)
+{
+    int                option;
+    FILE*              fp;
+    PcieTraceFileHdr_t hdr;
+    PcieTraceRec_t     rec;
+    char               prefixstr[STRBUFSIZE];
+    char*              cp;
+    static PktData_t   data[MAX_RAW_PKT_SIZE + PCIE_TRACE_BLK_SIZE];
+
+    DecOpts_t opts = {DECTL | DECDL | DECPL, DECKINDALL, -1, -1, 0, UINT64_MAX, false};
+
+    while ((option = getopt(argc, argv, "l:k:n:d:s:e:tch")) != EOF)
+    {
+        switch (option)
+        {
+        case 'l':
+            opts.layers = 0;
+            for (cp = optarg; *cp; cp++)
+            {
+                opts.layers |= (*cp == 't') ? DECTL : (*cp == 'd') ? DECDL : (*cp == 'p') ? DECPL : (*cp == 'r') ? DECRAWSYM : 0;
+            }
+            break;
+        case 'k':
+            opts.kinds = 0;
+            for (cp = optarg; *cp; cp++)
+            {
+                opts.kinds |= (*cp == 'm') ? DISP_KIND_MEM : (*cp == 'c') ? DISP_KIND_CPL : (*cp == 'f') ? DISP_KIND_CFG :
+                              (*cp == 'g') ? DISP_KIND_MSG : (*cp == 'i') ? DISP_KIND_IO  : 0;
+            }
+            break;
+        case 'n': opts.node   = strtol(optarg, NULL, 0); break;
+        case 'd': opts.dir    = (optarg[0] == 'd') ? 1 : 0; break;
+        case 's': opts.start  = strtoull(optarg, NULL, 0); break;
+        case 'e': opts.end    = strtoull(optarg, NULL, 0); break;
+        case 't': opts.cycles = true; break;
+        case 'c':
+            fmtupstr   = FMT_BRIGHT_BLUE;
+            fmtdnstr   = FMT_BRIGHT_GREEN;
+            fmterrstr  = FMT_RED;
+            fmtnormstr = FMT_NORMAL;
+            fmtdatastr = FMT_GREY;
+            break;
+        case 'h':
+        default:
+            Usage(argv[0]);
+            return (option == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        Usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if ((fp = fopen(argv[optind], "rb")) == NULL)
+    {
+        fprintf(stderr, "%s: ***Error --- could not open trace file %s\n", argv[0], argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != PCIE_TRACE_MAGIC ||
+        hdr.rec_hdr_size != sizeof(PcieTraceRec_t) || hdr.blk_size != PCIE_TRACE_BLK_SIZE)
+    {
+        fprintf(stderr, "%s: ***Error --- %s is not a compatible trace file\n", argv[0], argv[optind]);
+        fclose(fp);
+        return EXIT_FAILURE;
+    }
+
+    while (fread(&rec, sizeof(rec), 1, fp) == 1)
+    {
+        bool   rx      = rec.flags & PCIE_TRACE_FLAG_RX;
+        bool   is_down = rec.flags & PCIE_TRACE_FLAG_DOWN;
+        size_t bytes   = (size_t)rec.blocks * PCIE_TRACE_BLK_SIZE;
+
+        if (rec.count > MAX_RAW_PKT_SIZE || bytes > sizeof(data) || fread(data, 1, bytes, fp) != bytes)
+        {
+            fprintf(stderr, "%s: ***Error --- truncated or corrupt record at cycle %u\n", argv[0], rec.cycle);
+            break;
+        }
+
+        data[rec.count] = PKT_TERMINATION;
+
+        // Apply the filters
+        if (rec.cycle < opts.start || rec.cycle > opts.end                      ||
+            (opts.node >= 0 && opts.node != rec.node)                           ||
+            (opts.dir  >= 0 && opts.dir  != is_down)                            ||
+            (rec.type == PCIE_TRACE_REC_SYM && !(opts.layers & DECRAWSYM))      ||
+            (rec.type == PCIE_TRACE_REC_OS  && !(opts.layers & DECPL))          ||
+            (rec.type == PCIE_TRACE_REC_DLLP && !(opts.layers & (DECPL | DECDL)))||
+            (rec.type == PCIE_TRACE_REC_TLP && (!(opts.layers & (DECPL | DECTL)) || !(TlpKind(data) & opts.kinds))))
+        {
+            continue;
+        }
+
+        if (opts.cycles)
+        {
+            printf("%10u %s ", rec.cycle, rx ? "RX" : "TX");
+        }
+
+        sprintf(prefixstr, "%sPCIE%s%d%s", is_down ? fmtdnstr : fmtupstr, is_down ? "D" : "U", rec.node, fmtnormstr);
+
+        switch (rec.type)
+        {
+        case PCIE_TRACE_REC_SYM:  sprintf(prefixstr + strlen(prefixstr), ":"); DecRaw(prefixstr, data, rec.count); break;
+        case PCIE_TRACE_REC_OS:   DecOS(prefixstr, &rec, data); break;
+        case PCIE_TRACE_REC_DLLP: DecDll(prefixstr, data, rec.count, opts.layers); break;
+        case PCIE_TRACE_REC_TLP:  DecTl(prefixstr, data, opts.layers); break;
+        default:
+            fprintf(stderr, "%s: ***Error --- unknown record type %d at cycle %u\n", argv[0], rec.type, rec.cycle);
+            break;
+        }
+    }
+
+    fclose(fp);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+//=============================================================
+// VUserMain0.cpp
+//=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pcieModelClass.h"
+
+//-------------------------------------------------------------
+// DEFINES and MACROS
+//-------------------------------------------------------------
+
+#define RST_DEASSERT_INT 4
+
+// Workload description, relative to the simulation directory
+#ifndef BENCH_CFG_FILE
+#define BENCH_CFG_FILE   "usercodeBench/bench.cfg"
+#endif
+
+//-------------------------------------------------------------
+// STATICS
+//-------------------------------------------------------------
+
+static unsigned int Interrupt = 0;
+
+//-------------------------------------------------------------
+// ResetDeasserted()
+//
+// ISR for reset de-assertion. Clears interrupts state.
+//
+//-------------------------------------------------------------
+
+static int ResetDeasserted(int irq)
+{
+    Interrupt |= irq & RST_DEASSERT_INT;
+
+    return 0;
+}
+
+//-------------------------------------------------------------
+// VUserInput_0()
+//
+// Consumes the unhandled input Packets, including the
+// benchmark's read completions
+//-------------------------------------------------------------
+
+static void VUserInput_0(pPkt_t pkt, int status, void* usrptr)
+{
+    DISCARD_PACKET(pkt);
+}
+
+//-------------------------------------------------------------
+// VUserMain0()
+//
+// Benchmark program. Brings up the link and then runs the
+// workload described in BENCH_CFG_FILE against the endpoint,
+// which may be the auto-completing pcieVHost endpoint of
+// VUserMain1, or a DUT. Reports the achieved data rate, TLP
+// rate, read completion latency and link utilisation.
+//
+//-------------------------------------------------------------
+
+extern "C" void VUserMain0(int node)
+{
+    PcieGenCfg_t     cfg;
+    PcieBenchStats_t stats;
+    char             sbuf[128];
+    int              errors = 0;
+
+    // Create an API object for this node
+    pcieModelClass* pcie = new pcieModelClass(node);
+
+    // Initialise PCIe VHost, with input callback function and no user pointer.
+    pcie->initialisePcie(VUserInput_0, NULL);
+
+    pcie->getPcieVersionStr(sbuf, 128);
+    VPrint("  %s\n", sbuf);
+
+    // Make sure the link is out of electrical idle
+    VWrite(LINK_STATE, 0, 0, node);
+
+    pcie->configurePcie(CONFIG_ENABLE_SKIPS, 20000);
+
+    VRegIrq(ResetDeasserted, node);
+
+    // Use node number as seed
+    pcie->pcieSeed(node);
+
+    // Send out idles until we recieve an interrupt
+    do
+    {
+        pcie->sendOs(IDL);
+    }
+    while (!Interrupt);
+
+    Interrupt &= ~RST_DEASSERT_INT;
+
+    // Initialise the link for 16 lanes
+    InitLink(16, node);
+
+    // Initialise flow control
+    pcie->initFc();
+
+    // Load the workload over the defaults, and run it
+    pcie->pcieGenDefaults(&cfg);
+    cfg.rid = node+1;
+
+    if (pcie->pcieGenLoad(BENCH_CFG_FILE, &cfg) != MEM_GOOD_STATUS)
+    {
+        VPrint("****ERROR: failed to load workload %s\n", BENCH_CFG_FILE);
+        errors++;
+    }
+    else if (pcie->pcieBench(&cfg, &stats) != MEM_GOOD_STATUS)
+    {
+        VPrint("****ERROR: invalid workload in %s\n", BENCH_CFG_FILE);
+        errors++;
+    }
+
+    // Print results
+    if (errors)
+    {
+        VPrint("\n****ERROR: Finished with %d errors\n\n", errors);
+    }
+    else
+    {
+        VPrint("\n===> Finished with no errors\n\n");
+    }
+
+    // Go quiet for a while, before finishing
+    pcie->sendIdle(100);
+
+    // Halt the simulation
+    VWrite(PVH_FINISH, 0, 0, node);
+}
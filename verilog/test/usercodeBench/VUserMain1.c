@@ -0,0 +1,107 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+//=============================================================
+// VUserMain1.c
+//=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pcie.h"
+#include "ltssm.h"
+
+#define RST_DEASSERT_INT 4
+
+static int          node      = 1;
+static unsigned int Interrupt = 0;
+
+//-------------------------------------------------------------
+// ResetDeasserted()
+//
+// ISR for reset de-assertion. Clears interrupts state.
+//
+//-------------------------------------------------------------
+
+static int ResetDeasserted(int irq)
+{
+    Interrupt |= irq & RST_DEASSERT_INT;
+
+    return 0;
+}
+
+//-------------------------------------------------------------
+// VUserInput_1()
+//
+// Consumes the unhandled input Packets
+//-------------------------------------------------------------
+
+static void VUserInput_1(pPkt_t pkt, int status, void* usrptr)
+{
+    DISCARD_PACKET(pkt);
+}
+
+//-------------------------------------------------------------
+// VUserMain1()
+//
+// Auto-completing endpoint for the benchmark in VUserMain0.
+// No configuration space is constructed, so all of the
+// memory address space is accessible. Initialises link and FC
+// before sending idles indefinitely, with the model's memory
+// completing the benchmark's reads.
+//
+//-------------------------------------------------------------
+
+void VUserMain1()
+{
+    // Initialise PCIe VHost, with input callback function and no user pointer.
+    InitialisePcie(VUserInput_1, NULL, node);
+
+    // Make sure the link is out of electrical idle
+    VWrite(LINK_STATE, 0, 0, node);
+
+    VRegIrq(ResetDeasserted, node);
+
+    // Use node number as seed
+    PcieSeed(node, node);
+
+    // Send out idles until we recieve an interrupt
+    do
+    {
+        SendOs(IDL, node);
+    }
+    while (!Interrupt);
+
+    Interrupt &= ~RST_DEASSERT_INT;
+
+    // Initialise the link for 16 lanes
+    InitLink(16, node);
+
+    // Initialise flow control
+    InitFc(node);
+
+    // Send out idles forever
+    while (true)
+    {
+        SendIdle(100, node);
+    }
+}
@@ -0,0 +1,239 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+//=============================================================
+// VUserMain0.cpp
+//=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pcieModelClass.h"
+
+//-------------------------------------------------------------
+// DEFINES and MACROS
+//-------------------------------------------------------------
+
+#define RST_DEASSERT_INT 4
+
+// The 10-bit tag pool holds tags 256 to 1023. More reads than this
+// are issued, so that the later ones must wait for a free tag.
+#define TAG_POOL         (TAG_MAX_10BIT - TAG_MAX_8BIT)
+#define NUM_READS        (TAG_POOL + 64)
+
+// Reads are single words in one 4K page. The endpoint returns the
+// lower 32 bits of the address as the data.
+#define RD_BASE          0x10000000ULL
+
+//-------------------------------------------------------------
+// STATICS
+//-------------------------------------------------------------
+
+static unsigned int Interrupt = 0;
+
+static int          CplCount  = 0;
+static int          CplErrors = 0;
+static int          T9Count   = 0;
+static int          T8Count   = 0;
+
+//-------------------------------------------------------------
+// ResetDeasserted()
+//
+// ISR for reset de-assertion. Clears interrupts state.
+//
+//-------------------------------------------------------------
+
+static int ResetDeasserted(int irq)
+{
+    Interrupt |= irq & RST_DEASSERT_INT;
+
+    return 0;
+}
+
+//-------------------------------------------------------------
+// VUserInput_0()
+//
+// Checks the read completions against the outstanding
+// requests. The callback is made before the request is
+// completed, so the completion's 10-bit tag must still match
+// an outstanding read, with the data for its address.
+//
+//-------------------------------------------------------------
+
+static void VUserInput_0(pPkt_t pkt, int status, void* usrptr)
+{
+    pcieModelClass*  pcie = (pcieModelClass*)usrptr;
+    OutstandingReq_t req;
+    pPktData_t       payload;
+    uint32_t         data;
+    int              tag;
+
+    if (pkt->seq != DLLP_SEQ_ID && GET_TLP_TYPE(pkt->data) == TL_CPLD)
+    {
+        tag     = GET_CPL_TAG(pkt->data);
+        payload = GET_TLP_PAYLOAD_PTR(pkt->data);
+        data    = (payload[0] & 0xff) | ((payload[1] & 0xff) << 8) | ((payload[2] & 0xff) << 16) | ((payload[3] & 0xff) << 24);
+
+        CplCount++;
+        T9Count += (pkt->data[TLP_TAG_HI_BYTE_OFFSET] & TLP_TAG_T9_BYTE_MASK) ? 1 : 0;
+        T8Count += (pkt->data[TLP_TAG_HI_BYTE_OFFSET] & TLP_TAG_T8_BYTE_MASK) ? 1 : 0;
+
+        if (pcie->getOutstandingRequest(tag, &req) != MEM_GOOD_STATUS)
+        {
+            VPrint("****ERROR: completion with tag %d has no outstanding request\n", tag);
+            CplErrors++;
+        }
+        else if (data != (uint32_t)req.addr)
+        {
+            VPrint("****ERROR: completion with tag %d returned 0x%08x for address 0x%08x\n", tag, data, (uint32_t)req.addr);
+            CplErrors++;
+        }
+    }
+
+    DISCARD_PACKET(pkt);
+}
+
+//-------------------------------------------------------------
+// VUserMain0()
+//
+// 10-bit tag test. With 10-bit tags enabled, issues more
+// TAG_AUTO reads than the tag pool holds, queued back to back.
+// The endpoint in VUserMain1 holds its completions until the
+// whole pool is in use, so the reads past the pool size must
+// wait for a free tag. Checks the tags are taken from the pool
+// in order, the T9 and T8 tag bits in the request headers,
+// the completions' tags and data, and the tag statistics.
+//
+//-------------------------------------------------------------
+
+extern "C" void VUserMain0(int node)
+{
+    TagStats_t stats;
+    pPktData_t pkt_p;
+    uint32_t   rid    = node+1;
+    int        errors = 0;
+    int        tag;
+
+    // Create an API object for this node
+    pcieModelClass* pcie = new pcieModelClass(node);
+
+    // Initialise PCIe VHost, with input callback function and the API object as user pointer.
+    pcie->initialisePcie(VUserInput_0, pcie);
+
+    // Make sure the link is out of electrical idle
+    VWrite(LINK_STATE, 0, 0, node);
+
+    pcie->configurePcie(CONFIG_ENABLE_SKIPS, 20000);
+
+    // Requests issued with TAG_AUTO take 10-bit tags
+    pcie->configurePcie(CONFIG_TAG_10BIT, 1);
+
+    VRegIrq(ResetDeasserted, node);
+
+    // Use node number as seed
+    pcie->pcieSeed(node);
+
+    // Send out idles until we recieve an interrupt
+    do
+    {
+        pcie->sendOs(IDL);
+    }
+    while (!Interrupt);
+
+    Interrupt &= ~RST_DEASSERT_INT;
+
+    // Initialise the link for 16 lanes
+    InitLink(16, node);
+
+    // Initialise flow control
+    pcie->initFc();
+
+    pcie->clearTagStats();
+
+    for (int idx = 0; idx < NUM_READS; idx++)
+    {
+        pkt_p = pcie->memRead(RD_BASE + idx*4, 4, TAG_AUTO, rid, QUEUE);
+        tag   = pcie->getLastTag();
+
+        // The first tags are the whole pool, in order
+        if ((idx < TAG_POOL && tag != TAG_MAX_8BIT + idx) || tag < TAG_MAX_8BIT || tag >= TAG_MAX_10BIT)
+        {
+            VPrint("****ERROR: read %d given tag %d\n", idx, tag);
+            errors++;
+        }
+
+        // Check the tag in the queued request's header, with T9 and T8 in header byte 1
+        if ((pkt_p[TLP_TAG_OFFSET] & 0xff) != (tag & 0xff) ||
+            ((pkt_p[TLP_TAG_HI_BYTE_OFFSET] & TLP_TAG_T9_BYTE_MASK) ? 1 : 0) != ((tag >> 9) & 1) ||
+            ((pkt_p[TLP_TAG_HI_BYTE_OFFSET] & TLP_TAG_T8_BYTE_MASK) ? 1 : 0) != ((tag >> 8) & 1))
+        {
+            VPrint("****ERROR: read %d with tag %d has header tag bytes 0x%02x 0x%02x\n", idx, tag,
+                   pkt_p[TLP_TAG_HI_BYTE_OFFSET] & 0xff, pkt_p[TLP_TAG_OFFSET] & 0xff);
+            errors++;
+        }
+    }
+
+    pcie->waitForCompletionN(NUM_READS);
+
+    // Check the completions and the tag statistics
+    pcie->getTagStats(&stats);
+    pcie->printTagStats();
+
+    errors += CplErrors;
+
+    if (CplCount != NUM_READS || T9Count == 0 || T8Count == 0)
+    {
+        VPrint("****ERROR: %d completions received (%d with T9, %d with T8), expected %d\n", CplCount, T9Count, T8Count, NUM_READS);
+        errors++;
+    }
+
+    if (stats.allocated != NUM_READS || stats.max_outstanding != TAG_POOL || stats.outstanding != 0 || stats.unmatched != 0)
+    {
+        VPrint("****ERROR: tag stats allocated %llu, max outstanding %u, outstanding %u, unmatched %llu\n",
+               (unsigned long long)stats.allocated, stats.max_outstanding, stats.outstanding, (unsigned long long)stats.unmatched);
+        errors++;
+    }
+
+    // Every read past the pool size could have waited, but at least the first must have
+    if (stats.waits == 0 || stats.waits > NUM_READS - TAG_POOL || stats.wait_cycles < stats.waits)
+    {
+        VPrint("****ERROR: tag stats waits %llu, wait cycles %llu\n", (unsigned long long)stats.waits, (unsigned long long)stats.wait_cycles);
+        errors++;
+    }
+
+    // Print results
+    if (errors)
+    {
+        VPrint("\n****ERROR: Finished with %d errors\n\n", errors);
+    }
+    else
+    {
+        VPrint("\n===> Finished with no errors\n\n");
+    }
+
+    // Go quiet for a while, before finishing
+    pcie->sendIdle(100);
+
+    // Halt the simulation
+    VWrite(PVH_FINISH, 0, 0, node);
+}
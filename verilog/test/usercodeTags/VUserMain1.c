@@ -0,0 +1,196 @@
+//=============================================================
+//
+// Copyright (c) 2026 Simon Southwell. All rights reserved.
+//
+// Date: 18th Oct 2026
+//
+// This file is part of the pcieVHost package.
+//
+// pcieVHost is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pcieVHost is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pcieVHost. If not, see <http://www.gnu.org/licenses/>.
+//
+//=============================================================
+
+//=============================================================
+// VUserMain1.c
+//=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pcie.h"
+#include "ltssm.h"
+
+#define RST_DEASSERT_INT 4
+
+// Completions are held until the requester's whole 10-bit tag pool
+// is in use
+#define TAG_POOL         (TAG_MAX_10BIT - TAG_MAX_8BIT)
+
+#define CPL_ID           0x0100
+
+typedef struct {
+    uint64_t addr;
+    uint32_t rid;
+    int      tag;
+} HeldRead_t;
+
+static int          node      = 1;
+static unsigned int Interrupt = 0;
+
+static HeldRead_t   Held[TAG_POOL];
+static int          NumReads  = 0;
+
+//-------------------------------------------------------------
+// ResetDeasserted()
+//
+// ISR for reset de-assertion. Clears interrupts state.
+//
+//-------------------------------------------------------------
+
+static int ResetDeasserted(int irq)
+{
+    Interrupt |= irq & RST_DEASSERT_INT;
+
+    return 0;
+}
+
+//-------------------------------------------------------------
+// ReadCompletion()
+//
+// Queue a completion for a single word read, returning the
+// lower 32 bits of the address as the data
+//
+//-------------------------------------------------------------
+
+static void ReadCompletion(const HeldRead_t* rd)
+{
+    PktData_t buff[4];
+
+    buff[0] = (rd->addr >>  0) & 0xff;
+    buff[1] = (rd->addr >>  8) & 0xff;
+    buff[2] = (rd->addr >> 16) & 0xff;
+    buff[3] = (rd->addr >> 24) & 0xff;
+
+    CompletionDelay(rd->addr, buff, CPL_SUCCESS, 0xf, 0, 1, rd->tag, CPL_ID, rd->rid, node);
+}
+
+//-------------------------------------------------------------
+// VUserInput_1()
+//
+// Completes the memory reads, as the model's memory is
+// disabled. The first reads should have the requester's tag
+// pool in order, and the raw tag bits of each, including T9
+// and T8 in header byte 1, are checked. Their completions are
+// held until the whole pool has been received, and later reads
+// are completed straight away.
+//
+//-------------------------------------------------------------
+
+static void VUserInput_1(pPkt_t pkt, int status, void* usrptr)
+{
+    HeldRead_t rd;
+    int        type, exp;
+
+    if (pkt->seq != DLLP_SEQ_ID)
+    {
+        type = GET_TLP_TYPE(pkt->data);
+
+        if (type == TL_MRD32 || type == TL_MRD64)
+        {
+            rd.addr = GET_TLP_ADDRESS(pkt->data);
+            rd.rid  = GET_TLP_RID(pkt->data);
+            rd.tag  = GET_TLP_TAG(pkt->data);
+
+            if (NumReads < TAG_POOL)
+            {
+                exp = TAG_MAX_8BIT + NumReads;
+
+                if ((pkt->data[TLP_TAG_OFFSET] & 0xff) != (exp & 0xff) ||
+                    ((pkt->data[TLP_TAG_HI_BYTE_OFFSET] & TLP_TAG_T9_BYTE_MASK) ? 1 : 0) != ((exp >> 9) & 1) ||
+                    ((pkt->data[TLP_TAG_HI_BYTE_OFFSET] & TLP_TAG_T8_BYTE_MASK) ? 1 : 0) != ((exp >> 8) & 1))
+                {
+                    VPrint("****ERROR: read %d received with tag %d, expected %d (header tag bytes 0x%02x 0x%02x)\n", NumReads, rd.tag, exp,
+                           pkt->data[TLP_TAG_HI_BYTE_OFFSET] & 0xff, pkt->data[TLP_TAG_OFFSET] & 0xff);
+                }
+
+                Held[NumReads] = rd;
+
+                // Once the whole pool is in use, complete all the held reads
+                if (NumReads == TAG_POOL - 1)
+                {
+                    for (int idx = 0; idx < TAG_POOL; idx++)
+                    {
+                        ReadCompletion(&Held[idx]);
+                    }
+                }
+            }
+            else
+            {
+                ReadCompletion(&rd);
+            }
+
+            NumReads++;
+        }
+    }
+
+    DISCARD_PACKET(pkt);
+}
+
+//-------------------------------------------------------------
+// VUserMain1()
+//
+// Endpoint for the 10-bit tag test in VUserMain0. The model's
+// memory is disabled, so that the reads come to VUserInput_1
+// to be checked and completed. Initialises link and FC before
+// sending idles indefinitely.
+//
+//-------------------------------------------------------------
+
+void VUserMain1()
+{
+    // Initialise PCIe VHost, with input callback function and no user pointer.
+    InitialisePcie(VUserInput_1, NULL, node);
+
+    // Make sure the link is out of electrical idle
+    VWrite(LINK_STATE, 0, 0, node);
+
+    // Reads are completed by VUserInput_1, with 10-bit tags
+    ConfigurePcie(CONFIG_DISABLE_MEM, 0, node);
+    ConfigurePcie(CONFIG_TAG_10BIT, 1, node);
+
+    VRegIrq(ResetDeasserted, node);
+
+    // Use node number as seed
+    PcieSeed(node, node);
+
+    // Send out idles until we recieve an interrupt
+    do
+    {
+        SendOs(IDL, node);
+    }
+    while (!Interrupt);
+
+    Interrupt &= ~RST_DEASSERT_INT;
+
+    // Initialise the link for 16 lanes
+    InitLink(16, node);
+
+    // Initialise flow control
+    InitFc(node);
+
+    // Send out idles forever
+    while (true)
+    {
+        SendIdle(100, node);
+    }
+}